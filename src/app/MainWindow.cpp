@@ -1,3 +1,7 @@
+#ifdef DEBUG
+#include <cstdio>
+#endif
+
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
 
@@ -22,7 +26,7 @@ MainWindow::~MainWindow()
 }
 
 
-bool MainWindow::create(const char* title, int32_t width, int32_t height) noexcept
+bool MainWindow::create(const char* title, int32_t width, int32_t height, const WindowOptions& options) noexcept
 {
     if(!m_api.createContext())
         return false;
@@ -60,6 +64,19 @@ bool MainWindow::create(const char* title, int32_t width, int32_t height) noexce
 
     m_api.resize(width, height);
 
+//  Static views cost nothing between changes
+    if (options.onDemand)
+        m_api.setOnDemandRendering(true);
+
+//  Input and simulation keep running while the previous frame is recorded and presented.
+//  Without the thread drawFrame() records and presents inline, so a failed start is not fatal
+    if (options.renderThread && !m_api.startRenderThread())
+    {
+#ifdef DEBUG
+        printf("Render thread could not be started, drawing on the main thread\n");
+#endif
+    }
+
     return true;
 }
 
@@ -92,7 +109,16 @@ int MainWindow::run() noexcept
 
         m_api.drawFrame();
 
-        glfwPollEvents();
+//      Nothing changed: sleep until input arrives or the keep-alive frame is due
+        if (m_api.needsFrame())
+        {
+            glfwPollEvents();
+        }
+        else
+        {
+            glfwWaitEventsTimeout(m_api.getIdleTimeout());
+            lastFrame = (float)glfwGetTime(); // the wait is not movement time
+        }
     }
 
     return 0;
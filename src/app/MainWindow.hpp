@@ -4,13 +4,21 @@
 #include "VulkanApi.hpp"
 
 
+// Optional engine features, all off unless the command line asks for them
+struct WindowOptions
+{
+    bool renderThread = false; // record and present on a separate thread (--render-thread)
+    bool onDemand     = false; // skip frames while nothing changes (--on-demand)
+};
+
+
 class MainWindow
 {
 public:
     MainWindow() noexcept;
     ~MainWindow();
 
-    bool create(const char* title, int32_t width, int32_t height) noexcept;
+    bool create(const char* title, int32_t width, int32_t height, const WindowOptions& options = {}) noexcept;
     int run() noexcept;
 
 private:
@@ -2,19 +2,32 @@
 #include <cstdio>
 #endif
 
+#include <cstring>
+
 #include "MainWindow.hpp"
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	const char title[] = "Star Dust";
     const int width = 800;
     const int height = 600;
 
+	WindowOptions options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--render-thread") == 0)
+			options.renderThread = true;
+
+		if (strcmp(argv[i], "--on-demand") == 0)
+			options.onDemand = true;
+	}
+
 	MainWindow app;
 	int retCode = -1;
 
-	if (app.create(title, width, height))
+	if (app.create(title, width, height, options))
 		retCode = app.run();
 
     return retCode;
@@ -0,0 +1,356 @@
+#include <cstdio>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "camera/Frustum.hpp"
+#include "scene/BoundingVolumeHierarchy.hpp"
+#include "BvhBenchmark.hpp"
+
+
+namespace
+{
+    constexpr uint32_t DEFAULT_OBJECTS = 1u << 20;
+    constexpr uint32_t RAY_COUNT       = 1u << 17;
+    constexpr uint32_t BRUTE_RAYS      = 64;     // every box per ray, checked against the tree as well
+    constexpr uint32_t FRUSTUM_COUNT   = 1u << 12;
+    constexpr uint32_t VOLUME_COUNT    = 1u << 16; // boxes and spheres
+    constexpr uint32_t BRUTE_VOLUMES   = 16;
+    constexpr float    FIELD_OF_VIEW   = 1.0471976f; // 60 degrees
+    constexpr float    FAR_DISTANCE    = 250.f;
+    constexpr float    VOLUME_EXTENT   = 25.f;       // half edge of the query boxes, radius of the spheres
+    constexpr float    WORLD_SIZE      = 1000.f;
+    constexpr float    MAX_EXTENT      = 2.f;
+    constexpr float    RAY_LENGTH      = 2000.f;
+
+    using Clock = std::chrono::steady_clock;
+
+
+    struct Random
+    {
+        uint32_t state = 0x9E3779B9u;
+
+        float next() noexcept // [0, 1)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            return static_cast<float>(state >> 8) * (1.f / 16777216.f);
+        }
+    };
+
+
+    Aabb random_box(Random& random) noexcept
+    {
+        const vec3s center = { { random.next() * WORLD_SIZE, random.next() * WORLD_SIZE, random.next() * WORLD_SIZE } };
+        const float extent = 0.1f + random.next() * MAX_EXTENT;
+
+        return
+        {
+            .min = { { center.x - extent, center.y - extent, center.z - extent } },
+            .max = { { center.x + extent, center.y + extent, center.z + extent } }
+        };
+    }
+
+
+//  From a random point towards another one, so rays cross the whole cube in every direction
+    void random_ray(Random& random, vec3s& origin, vec3s& direction) noexcept
+    {
+        origin    = { { random.next() * WORLD_SIZE, random.next() * WORLD_SIZE, random.next() * WORLD_SIZE } };
+        direction = { { random.next() * WORLD_SIZE - origin.x, random.next() * WORLD_SIZE - origin.y, random.next() * WORLD_SIZE - origin.z } };
+    }
+
+
+//  Same slab test as the tree, over every box
+    float brute_raycast(const BoundingVolumeHierarchy& bvh, vec3s origin, vec3s direction, float maxDistance) noexcept
+    {
+        const float length    = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        const float inverse[3] = { length / direction.x, length / direction.y, length / direction.z };
+        float closest = FLT_MAX;
+
+        for (uint32_t proxy = 0, count = bvh.getCount(); proxy < count; ++proxy)
+        {
+            const Aabb& box = bvh.getBox(proxy);
+            float tNear = 0.f;
+            float tFar  = maxDistance;
+
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                float t0 = (box.min.raw[axis] - origin.raw[axis]) * inverse[axis];
+                float t1 = (box.max.raw[axis] - origin.raw[axis]) * inverse[axis];
+
+                if (t0 > t1)
+                    std::swap(t0, t1);
+
+                tNear = std::max(tNear, t0);
+                tFar  = std::min(tFar, t1);
+            }
+
+            if (tNear <= tFar)
+                closest = std::min(closest, tNear);
+        }
+
+        return closest;
+    }
+
+
+//  Perspective camera at a random point looking at another one, planes taken the way Camera does
+    Frustum random_frustum(Random& random) noexcept
+    {
+        const vec3s eye    = { { random.next() * WORLD_SIZE, random.next() * WORLD_SIZE, random.next() * WORLD_SIZE } };
+        const vec3s target = { { random.next() * WORLD_SIZE, random.next() * WORLD_SIZE, random.next() * WORLD_SIZE } };
+
+        auto normalize = [](vec3s v)
+        {
+            const float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+
+            return (length > 0.f) ? vec3s{ { v.x / length, v.y / length, v.z / length } } : vec3s{ { 1.f, 0.f, 0.f } };
+        };
+
+        auto cross = [](vec3s a, vec3s b)
+        {
+            return vec3s{ { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x } };
+        };
+
+        auto dot = [](vec3s a, vec3s b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+
+        const vec3s f = normalize({ { target.x - eye.x, target.y - eye.y, target.z - eye.z } });
+        const vec3s s = normalize(cross(f, (std::fabs(f.y) < 0.99f) ? vec3s{ { 0.f, 1.f, 0.f } } : vec3s{ { 1.f, 0.f, 0.f } }));
+        const vec3s u = cross(s, f);
+
+        const float view[4][4] = 
+        {
+            { s.x, u.x, -f.x, 0.f },
+            { s.y, u.y, -f.y, 0.f },
+            { s.z, u.z, -f.z, 0.f },
+            { -dot(s, eye), -dot(u, eye), dot(f, eye), 1.f }
+        };
+
+        const float t    = 1.f / tanf(FIELD_OF_VIEW * 0.5f);
+        const float near = 0.1f;
+
+        const float projection[4][4] = 
+        {
+            { t,   0.f, 0.f, 0.f },
+            { 0.f, t,   0.f, 0.f },
+            { 0.f, 0.f, (FAR_DISTANCE + near) / (near - FAR_DISTANCE), -1.f },
+            { 0.f, 0.f, 2.f * FAR_DISTANCE * near / (near - FAR_DISTANCE), 0.f }
+        };
+
+        mat4s viewProjection;
+
+        for (uint32_t column = 0; column < 4; ++column)
+            for (uint32_t row = 0; row < 4; ++row)
+                viewProjection.raw[column][row] = projection[0][row] * view[column][0] + projection[1][row] * view[column][1] +
+                                                  projection[2][row] * view[column][2] + projection[3][row] * view[column][3];
+
+        Frustum frustum;
+        frustum.extract(viewProjection);
+
+        return frustum;
+    }
+
+
+//  Times 'count' queries, then checks the first BRUTE_VOLUMES against a scan of every box and times that scan
+    template<class Query, class Inside>
+    bool measure_volumes(const char* name, const BoundingVolumeHierarchy& bvh, uint32_t count, std::vector<uint32_t>& out,
+                         const Query& query, const Inside& inside) noexcept
+    {
+        const uint32_t capacity = static_cast<uint32_t>(out.size());
+        uint64_t found = 0;
+
+        auto start = Clock::now();
+
+        for (uint32_t i = 0; i < count; ++i)
+            found += query(i, out.data(), capacity);
+
+        const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+
+        for (uint32_t i = 0; i < BRUTE_VOLUMES; ++i)
+        {
+            uint32_t expected = 0;
+
+            for (uint32_t proxy = 0, objects = bvh.getCount(); proxy < objects; ++proxy)
+                expected += inside(i, bvh.getBox(proxy));
+
+            const uint32_t result = query(i, out.data(), capacity);
+
+            if (result != expected)
+            {
+                fprintf(stderr, "%s query %u disagrees with the brute force scan: %u instead of %u objects\n", name, i, result, expected);
+                return false;
+            }
+        }
+
+        const double bruteMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        const double perSecond      = count / (milliseconds * 0.001);
+        const double brutePerSecond = BRUTE_VOLUMES / (bruteMilliseconds * 0.001);
+
+        printf("%s: %.3g queries/s over %u queries (%.1f objects each), brute force %.3g queries/s, %.0fx\n",
+               name, perSecond, count, static_cast<double>(found) / count, brutePerSecond, perSecond / brutePerSecond);
+
+        return true;
+    }
+
+
+    double milliseconds_since(Clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+
+
+bool BvhBenchmark::run(uint32_t objectCount) noexcept
+{
+    if (objectCount == 0)
+        objectCount = DEFAULT_OBJECTS;
+
+    BoundingVolumeHierarchy bvh;
+    Random random;
+
+    if (!bvh.reserve(objectCount))
+        return false;
+
+    for (uint32_t i = 0; i < objectCount; ++i)
+    {
+        if (bvh.insert(random_box(random), i) == BoundingVolumeHierarchy::INVALID_PROXY)
+            return false;
+    }
+
+    auto start = Clock::now();
+
+    if (!bvh.build())
+        return false;
+
+    const double buildMilliseconds = milliseconds_since(start);
+
+//  A tenth of the objects moves by a little, below the rebuild threshold: update() only refits
+    for (uint32_t proxy = 0; proxy < objectCount; proxy += 10)
+    {
+        Aabb box = bvh.getBox(proxy);
+        const float offset = random.next() - 0.5f;
+
+        box.min.x += offset;
+        box.max.x += offset;
+        bvh.move(proxy, box);
+    }
+
+    start = Clock::now();
+    bvh.update(false);
+    const double refitMilliseconds = milliseconds_since(start);
+
+    std::vector<vec3s> rays;
+
+    try
+    {
+        rays.resize(RAY_COUNT * 2);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < RAY_COUNT; ++i)
+        random_ray(random, rays[i * 2], rays[i * 2 + 1]);
+
+    uint32_t hits = 0;
+    start = Clock::now();
+
+    for (uint32_t i = 0; i < RAY_COUNT; ++i)
+        hits += (bvh.raycast(rays[i * 2], rays[i * 2 + 1], RAY_LENGTH).proxy != BoundingVolumeHierarchy::INVALID_PROXY);
+
+    const double rayMilliseconds = milliseconds_since(start);
+
+    start = Clock::now();
+
+    for (uint32_t i = 0; i < BRUTE_RAYS; ++i)
+    {
+        const float expected = brute_raycast(bvh, rays[i * 2], rays[i * 2 + 1], RAY_LENGTH);
+        const auto  hit      = bvh.raycast(rays[i * 2], rays[i * 2 + 1], RAY_LENGTH);
+        const float distance = (hit.proxy != BoundingVolumeHierarchy::INVALID_PROXY) ? hit.distance : FLT_MAX;
+
+        if (distance != expected)
+        {
+            fprintf(stderr, "raycast %u disagrees with the brute force scan: %g instead of %g\n", i, distance, expected);
+            return false;
+        }
+    }
+
+    const double bruteMilliseconds = milliseconds_since(start);
+
+    const double raysPerSecond  = RAY_COUNT / (rayMilliseconds * 0.001);
+    const double brutePerSecond = BRUTE_RAYS / (bruteMilliseconds * 0.001);
+
+    std::vector<Frustum>  frustums;
+    std::vector<Aabb>     boxes;
+    std::vector<uint32_t> out;
+
+    try
+    {
+        frustums.resize(FRUSTUM_COUNT);
+        boxes.resize(VOLUME_COUNT);
+        out.resize(objectCount);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (Frustum& frustum : frustums)
+        frustum = random_frustum(random);
+
+//  Spheres share the boxes: same center, the half edge as radius
+    for (Aabb& box : boxes)
+    {
+        const vec3s center = { { random.next() * WORLD_SIZE, random.next() * WORLD_SIZE, random.next() * WORLD_SIZE } };
+
+        box.min = { { center.x - VOLUME_EXTENT, center.y - VOLUME_EXTENT, center.z - VOLUME_EXTENT } };
+        box.max = { { center.x + VOLUME_EXTENT, center.y + VOLUME_EXTENT, center.z + VOLUME_EXTENT } };
+    }
+
+    printf("objects %u: build %.1f ms, refit of %u moved %.2f ms\n", objectCount, buildMilliseconds, (objectCount + 9) / 10, refitMilliseconds);
+    printf("raycast: %.3g queries/s over %u rays (%u hits), brute force %.3g queries/s, %.0fx\n",
+           raysPerSecond, RAY_COUNT, hits, brutePerSecond, raysPerSecond / brutePerSecond);
+
+    const bool frustumResult = measure_volumes("frustum", bvh, FRUSTUM_COUNT, out,
+        [&](uint32_t i, uint32_t* result, uint32_t capacity) { return bvh.queryFrustum(frustums[i], result, capacity); },
+        [&](uint32_t i, const Aabb& box) { return frustums[i].intersectsBox(box.min, box.max); });
+
+    const bool boxResult = frustumResult && measure_volumes("box", bvh, VOLUME_COUNT, out,
+        [&](uint32_t i, uint32_t* result, uint32_t capacity) { return bvh.queryBox(boxes[i], result, capacity); },
+        [&](uint32_t i, const Aabb& box)
+        {
+            const Aabb& volume = boxes[i];
+
+            return box.min.x <= volume.max.x && box.max.x >= volume.min.x && box.min.y <= volume.max.y &&
+                   box.max.y >= volume.min.y && box.min.z <= volume.max.z && box.max.z >= volume.min.z;
+        });
+
+    return boxResult && measure_volumes("sphere", bvh, VOLUME_COUNT, out,
+        [&](uint32_t i, uint32_t* result, uint32_t capacity)
+        {
+            const vec3s center = { { boxes[i].min.x + VOLUME_EXTENT, boxes[i].min.y + VOLUME_EXTENT, boxes[i].min.z + VOLUME_EXTENT } };
+
+            return bvh.querySphere(center, VOLUME_EXTENT, result, capacity);
+        },
+        [&](uint32_t i, const Aabb& box)
+        {
+            const vec3s center = { { boxes[i].min.x + VOLUME_EXTENT, boxes[i].min.y + VOLUME_EXTENT, boxes[i].min.z + VOLUME_EXTENT } };
+            float distance = 0.f;
+
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float d = std::max({ box.min.raw[axis] - center.raw[axis], 0.f, center.raw[axis] - box.max.raw[axis] });
+                distance += d * d;
+            }
+
+            return distance <= VOLUME_EXTENT * VOLUME_EXTENT;
+        });
+}
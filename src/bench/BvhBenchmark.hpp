@@ -0,0 +1,15 @@
+#ifndef BVH_BENCHMARK_HPP
+#define BVH_BENCHMARK_HPP
+
+#include <cstdint>
+
+
+// BoundingVolumeHierarchy over 'objectCount' boxes scattered through a cube (1M by default):
+// build and refit times, then raycasts, frustum, box and sphere queries per second against the tree and against
+// a brute force scan of every box
+struct BvhBenchmark
+{
+    static bool run(uint32_t objectCount) noexcept;
+};
+
+#endif // !BVH_BENCHMARK_HPP
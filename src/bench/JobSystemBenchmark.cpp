@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "jobs/JobSystem.hpp"
+#include "JobSystemBenchmark.hpp"
+
+
+namespace
+{
+    constexpr uint32_t ELEMENT_COUNT = 1u << 22;
+    constexpr uint32_t GRAIN         = 4096;
+    constexpr uint32_t JOB_COUNT     = 1u << 20;
+    constexpr uint32_t JOB_BATCH     = 1024; // well below JobSystem::MAX_JOBS
+    constexpr uint32_t REPEATS       = 5;
+
+    using Clock = std::chrono::steady_clock;
+
+//  A few dozen flops per element, enough that the memory bus is not the limit
+    void kernel(const float* in, float* out, uint32_t begin, uint32_t end) noexcept
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float x = in[i];
+
+            for (uint32_t k = 0; k < 8; ++k)
+                x = std::sqrt(x * x + 1.f) * 0.5f + std::sin(x) * 0.25f;
+
+            out[i] = x;
+        }
+    }
+
+//  Best of REPEATS in milliseconds
+    template<class F>
+    double measure(const F& function) noexcept
+    {
+        double best = 1e30;
+
+        for (uint32_t r = 0; r < REPEATS; ++r)
+        {
+            const auto start = Clock::now();
+            function();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        return best;
+    }
+}
+
+
+
+bool JobSystemBenchmark::run(uint32_t maxThreads) noexcept
+{
+    if (maxThreads == 0)
+        maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<float> input;
+    std::vector<float> output;
+
+    try
+    {
+        input.resize(ELEMENT_COUNT);
+        output.resize(ELEMENT_COUNT);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < ELEMENT_COUNT; ++i)
+        input[i] = static_cast<float>(i % 1000) * 0.001f;
+
+    printf("parallelFor: %u elements, grain %u. Jobs: %u empty jobs in batches of %u\n", ELEMENT_COUNT, GRAIN, JOB_COUNT, JOB_BATCH);
+    printf("threads  parallelFor ms  speedup  efficiency  jobs/s\n");
+
+    double serial = 0.0;
+
+    for (uint32_t threads = 1; threads <= maxThreads; ++threads)
+    {
+        JobSystem jobs;
+
+//      One thread is the caller alone, init(0) would pick every hardware thread
+        if (threads > 1 && !jobs.init(threads - 1))
+            return false;
+
+        const double milliseconds = measure([&]()
+        {
+            if (threads > 1)
+                jobs.parallelFor(ELEMENT_COUNT, GRAIN, [&](uint32_t begin, uint32_t end) { kernel(input.data(), output.data(), begin, end); });
+            else
+                kernel(input.data(), output.data(), 0, ELEMENT_COUNT);
+        });
+
+        if (threads == 1)
+            serial = milliseconds;
+
+        double jobsPerSecond = 0.0;
+
+        if (threads > 1)
+        {
+            std::atomic<uint32_t> executed = 0;
+            std::atomic<uint32_t>* counter = &executed;
+
+            const double jobMilliseconds = measure([&]()
+            {
+                for (uint32_t batch = 0; batch < JOB_COUNT; batch += JOB_BATCH)
+                {
+                    Job* root = jobs.createJob(JobFunction{});
+
+                    for (uint32_t i = 0; i < JOB_BATCH; ++i)
+                        jobs.run(jobs.createJob([counter]() { counter->fetch_add(1, std::memory_order_relaxed); }, root));
+
+                    jobs.run(root);
+                    jobs.wait(root);
+                }
+            });
+
+            if (executed.load() != JOB_COUNT * REPEATS)
+            {
+                fprintf(stderr, "job system lost work: %u of %u jobs ran\n", executed.load(), JOB_COUNT * REPEATS);
+                return false;
+            }
+
+            jobsPerSecond = JOB_COUNT / (jobMilliseconds * 0.001);
+        }
+
+        const double speedup = serial / milliseconds;
+
+        printf("%7u  %14.2f  %7.2f  %9.0f%%  %.3g\n", threads, milliseconds, speedup, 100.0 * speedup / threads, jobsPerSecond);
+    }
+
+    return true;
+}
@@ -0,0 +1,15 @@
+#ifndef JOB_SYSTEM_BENCHMARK_HPP
+#define JOB_SYSTEM_BENCHMARK_HPP
+
+#include <cstdint>
+
+
+// Scaling of JobSystem from one thread up to 'maxThreads' (0 for every hardware thread,
+// more oversubscribe the cores):
+// a parallelFor over a compute bound loop and the throughput of small jobs under one parent
+struct JobSystemBenchmark
+{
+    static bool run(uint32_t maxThreads) noexcept;
+};
+
+#endif // !JOB_SYSTEM_BENCHMARK_HPP
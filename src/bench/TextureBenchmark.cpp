@@ -0,0 +1,236 @@
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <stb_image.h>
+
+#include "jobs/JobSystem.hpp"
+#include "texture/Image.hpp"
+#include "TextureBenchmark.hpp"
+
+
+namespace
+{
+    constexpr uint32_t DEFAULT_TEXTURES  = 500;
+    constexpr uint64_t STAGING_ALIGNMENT = 16; // as in UploadBatch
+
+    using Clock = std::chrono::steady_clock;
+
+
+    struct Source
+    {
+        std::vector<uint8_t> bytes;
+        uint32_t             width  = 0;
+        uint32_t             height = 0;
+    };
+
+
+    bool read_file(const std::string& path, std::vector<uint8_t>& bytes) noexcept
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+
+        if ( ! file )
+            return false;
+
+        fseek(file, 0, SEEK_END);
+        const long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        bool result = (size > 0);
+
+        if (result)
+        {
+            try
+            {
+                bytes.resize(static_cast<size_t>(size));
+                result = (fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+            }
+            catch (const std::bad_alloc&)
+            {
+                result = false;
+            }
+        }
+
+        fclose(file);
+
+        return result;
+    }
+
+
+    bool find_images(const char* directory, std::vector<std::string>& files) noexcept
+    {
+        std::error_code error;
+
+        try
+        {
+            for (const auto& item : std::filesystem::directory_iterator(directory, error))
+            {
+                const std::string extension = item.path().extension().string();
+
+                if (item.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg"))
+                    files.push_back(item.path().string());
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        std::sort(files.begin(), files.end());
+
+        return ! files.empty();
+    }
+
+
+    double elapsed_ms(Clock::time_point since) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    }
+}
+
+
+
+bool TextureBenchmark::run(const char* directory, uint32_t textureCount) noexcept
+{
+    if (textureCount == 0)
+        textureCount = DEFAULT_TEXTURES;
+
+    std::vector<std::string> files;
+
+    if ( ! find_images(directory, files) )
+    {
+        fprintf(stderr, "no PNG/JPG images in %s\n", directory);
+        return false;
+    }
+
+    std::vector<Source> sources;
+    std::vector<uint64_t> offsets;
+    std::unique_ptr<uint8_t[]> staging;
+    uint64_t stagingSize = 0;
+
+//  One untimed pass sizes the staging buffer and leaves every file in the page cache, so all runs read warm files
+    try
+    {
+        sources.resize(textureCount);
+        offsets.resize(textureCount);
+
+        for (uint32_t i = 0; i < textureCount; ++i)
+        {
+            Source& source = sources[i];
+            int32_t w = 0;
+            int32_t h = 0;
+            int32_t channels = 0;
+
+            if (i < files.size())
+            {
+                if ( ! read_file(files[i], source.bytes) || ! stbi_info_from_memory(source.bytes.data(), static_cast<int>(source.bytes.size()), &w, &h, &channels) )
+                {
+                    fprintf(stderr, "cannot read %s\n", files[i].c_str());
+                    return false;
+                }
+
+                source.width  = static_cast<uint32_t>(w);
+                source.height = static_cast<uint32_t>(h);
+            }
+            else
+            {
+                source.width  = sources[i % files.size()].width;
+                source.height = sources[i % files.size()].height;
+            }
+
+            offsets[i]  = (stagingSize + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+            stagingSize = offsets[i] + static_cast<uint64_t>(source.width) * source.height * 4;
+        }
+
+        staging.reset(new uint8_t[static_cast<size_t>(stagingSize)]);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+//  Mapped staging memory is backed before anything is written to it
+    memset(staging.get(), 0, static_cast<size_t>(stagingSize));
+
+    printf("%u textures from %zu files in %s, %.1f MB of pixels\n", textureCount, files.size(), directory, static_cast<double>(stagingSize) / (1024.0 * 1024.0));
+    printf("threads     io ms  decode ms  upload ms   total ms  speedup\n");
+
+    const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    double serial = 0.0;
+
+//  Powers of two, then every hardware thread
+    for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        JobSystem jobs;
+
+//      One thread is the caller alone, init(0) would pick every hardware thread
+        if (threads > 1 && ! jobs.init(threads - 1))
+            return false;
+
+        std::unique_ptr<Image[]> decoded(new (std::nothrow) Image[textureCount]);
+
+        if ( ! decoded )
+            return false;
+
+//      Every run allocates its file buffers again, as the loader does
+        for (auto& source : sources)
+            source.bytes = std::vector<uint8_t>();
+
+        std::atomic<bool> failed = false;
+
+        auto start = Clock::now();
+
+        jobs.parallelFor(textureCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                if ( ! read_file(files[i % files.size()], sources[i].bytes) )
+                    failed = true;
+        });
+
+        const double io = elapsed_ms(start);
+        start = Clock::now();
+
+        jobs.parallelFor(textureCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                if ( ! decoded[i].loadFromMemory(sources[i].bytes.data(), sources[i].bytes.size()) || decoded[i].width != sources[i].width || decoded[i].height != sources[i].height )
+                    failed = true;
+        });
+
+        const double decode = elapsed_ms(start);
+        start = Clock::now();
+
+        jobs.parallelFor(textureCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                memcpy(staging.get() + offsets[i], decoded[i].pixels, static_cast<size_t>(decoded[i].getSize()));
+        });
+
+        const double upload = elapsed_ms(start);
+
+        if (failed)
+        {
+            fprintf(stderr, "loading the textures failed with %u threads\n", threads);
+            return false;
+        }
+
+        const double total = io + decode + upload;
+
+        if (threads == 1)
+            serial = total;
+
+        printf("%7u  %8.1f  %9.1f  %9.1f  %9.1f  %7.2f\n", threads, io, decode, upload, total, serial / total);
+
+        if (threads == maxThreads)
+            break;
+    }
+
+    return true;
+}
@@ -0,0 +1,15 @@
+#ifndef TEXTURE_BENCHMARK_HPP
+#define TEXTURE_BENCHMARK_HPP
+
+#include <cstdint>
+
+
+// The CPU side of TextureLoader over 'textureCount' PNG/JPG files (500 by default, the images of 'directory'
+// repeated as often as needed) from one thread up to every hardware thread: reading the files, decoding them and
+// copying the pixels into one shared staging buffer. The GPU transfer itself needs a device and is left out
+struct TextureBenchmark
+{
+    static bool run(const char* directory, uint32_t textureCount) noexcept;
+};
+
+#endif // !TEXTURE_BENCHMARK_HPP
@@ -0,0 +1,43 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "JobSystemBenchmark.hpp"
+#include "BvhBenchmark.hpp"
+#include "TextureBenchmark.hpp"
+
+
+// Usage: star_dust_bench jobs [max_threads]
+//  scaling of the job system from 1 to max_threads threads (all hardware threads by default)
+// Usage: star_dust_bench bvh [objects]
+//  build, refit and query throughput of the bounding volume hierarchy (1M objects by default)
+// Usage: star_dust_bench textures [count] [directory]
+//  read, decode and staging times of 'count' textures (500 by default) from the images in 'directory' (res/textures)
+//  against the thread count
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "jobs") == 0)
+    {
+        const uint32_t maxThreads = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 0;
+
+        return JobSystemBenchmark::run(maxThreads) ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bvh") == 0)
+    {
+        const uint32_t objectCount = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 0;
+
+        return BvhBenchmark::run(objectCount) ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "textures") == 0)
+    {
+        const uint32_t textureCount = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 0;
+
+        return TextureBenchmark::run((argc > 3) ? argv[3] : "res/textures", textureCount) ? 0 : 1;
+    }
+
+    fprintf(stderr, "usage: star_dust_bench jobs [max_threads] | bvh [objects] | textures [count] [directory]\n");
+
+    return 1;
+}
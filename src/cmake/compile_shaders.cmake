@@ -1,7 +1,8 @@
 #====================================================================================================================#
 # Function: compile_shaders
 # Description: 
-#	If the shader is missing or has been modified (re)compile it, otherwise skip it
+#	If the shader is missing or it or one of its #include files has been modified (re)compile it, otherwise skip it.
+#	Shaders and include files are configure dependencies, so editing any of them re-runs this check
 # Usage: 
 #	compile_shaders(src_dir dest_dir)
 function(compile_shaders SRC_DIR DEST_DIR)
@@ -31,6 +32,9 @@ function(compile_shaders SRC_DIR DEST_DIR)
 		${SRC_DIR}/*.comp
 	)
 
+	file(GLOB_RECURSE shader_includes CONFIGURE_DEPENDS ${SRC_DIR}/*.glsl)
+	set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${shaders} ${shader_includes})
+
 	list(LENGTH shaders shaders_count)
 	message(STATUS "compile_shaders: Compiling ${shaders_count} shaders from ${SRC_DIR} to ${DEST_DIR}")
 
@@ -38,9 +42,23 @@ function(compile_shaders SRC_DIR DEST_DIR)
 	foreach(shader IN LISTS shaders)
 		get_filename_component(filename ${shader} NAME)
 		get_filename_component(filename_we ${shader} NAME_WE)
+		get_filename_component(shader_dir ${shader} DIRECTORY)
 		set(output_file ${DEST_DIR}/${filename_we}.spv)
 
-		if(NOT EXISTS ${output_file} OR ${shader} IS_NEWER_THAN ${output_file})
+		# glslc resolves quoted includes relative to the including file
+		set(include_changed FALSE)
+		file(STRINGS ${shader} include_lines REGEX "^[ \t]*#[ \t]*include[ \t]+\"[^\"]+\"")
+
+		foreach(include_line IN LISTS include_lines)
+			string(REGEX REPLACE "^[^\"]*\"([^\"]+)\".*$" "\\1" include_name "${include_line}")
+			set(include_file ${shader_dir}/${include_name})
+
+			if(EXISTS ${output_file} AND EXISTS ${include_file} AND ${include_file} IS_NEWER_THAN ${output_file})
+				set(include_changed TRUE)
+			endif()
+		endforeach()
+
+		if(NOT EXISTS ${output_file} OR ${shader} IS_NEWER_THAN ${output_file} OR include_changed)
 			execute_process(
 				COMMAND ${Vulkan_GLSLC_EXECUTABLE} ${shader} -o ${output_file}
 				OUTPUT_VARIABLE output
@@ -0,0 +1,47 @@
+#====================================================================================================================#
+# Function: cook_assets
+# Description: 
+#	Adds the cook_assets target which runs star_dust_cook over the source assets on every build.
+#	The cooker keeps a content hash next to each output and only re-cooks what has changed.
+#	The cooked assets and the compiled shaders are then packed into a single memory-mapped archive
+# Usage: 
+#	cook_assets(src_dir dest_dir shader_dir pack_file)
+function(cook_assets SRC_DIR DEST_DIR SHADER_DIR PACK_FILE)
+	if(NOT SRC_DIR)
+		message(SEND_ERROR "cook_assets: SOURCE DIRECTORY not specified")
+		return()
+	endif()
+
+	if(NOT DEST_DIR)
+		message(SEND_ERROR "cook_assets: OUTPUT DIRECTORY not specified")
+		return()
+	endif()
+
+	if(NOT TARGET star_dust_cook)
+		message(SEND_ERROR "cook_assets: star_dust_cook target not found")
+		return()
+	endif()
+
+	file(GLOB_RECURSE assets CONFIGURE_DEPENDS 
+		${SRC_DIR}/*.jpg 
+		${SRC_DIR}/*.jpeg 
+		${SRC_DIR}/*.png 
+		${SRC_DIR}/*.tga 
+		${SRC_DIR}/*.bmp 
+		${SRC_DIR}/*.obj
+	)
+
+	list(LENGTH assets assets_count)
+	message(STATUS "cook_assets: ${assets_count} source assets in ${SRC_DIR} will be cooked to ${DEST_DIR}")
+
+	file(MAKE_DIRECTORY ${DEST_DIR})
+
+	add_custom_target(cook_assets ALL
+		COMMAND $<TARGET_FILE:star_dust_cook> ${SRC_DIR} ${DEST_DIR}
+		COMMAND ${CMAKE_COMMAND} -E copy_directory_if_different ${SHADER_DIR} ${DEST_DIR}/shaders
+		COMMAND $<TARGET_FILE:star_dust_cook> --pack ${PACK_FILE} ${DEST_DIR}
+		DEPENDS star_dust_cook ${assets}
+		COMMENT "cook_assets: cooking ${SRC_DIR}"
+		VERBATIM
+	)
+endfunction()
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "BlockEncoder.hpp"
+
+
+namespace
+{
+//  Copies a 4x4 block, edge texels are repeated for levels that are not a multiple of 4
+    void fetch_block(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t* block) noexcept
+    {
+        for (uint32_t y = 0; y < 4; ++y)
+        {
+            const uint32_t sy = (by * 4 + y < height) ? by * 4 + y : height - 1;
+
+            for (uint32_t x = 0; x < 4; ++x)
+            {
+                const uint32_t sx = (bx * 4 + x < width) ? bx * 4 + x : width - 1;
+
+                memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+            }
+        }
+    }
+
+
+    uint16_t pack_565(const uint8_t* rgb) noexcept
+    {
+        return static_cast<uint16_t>(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+    }
+
+
+    void unpack_565(uint16_t color, int32_t* rgb) noexcept
+    {
+        const int32_t r = (color >> 11) & 0x1F;
+        const int32_t g = (color >> 5)  & 0x3F;
+        const int32_t b = color & 0x1F;
+
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+
+//  Always emits the four-color mode (c0 > c1), which is also what BC3 expects
+    void encode_color_block(const uint8_t* block, uint8_t* out) noexcept
+    {
+    //  Endpoints are the extremes of the texels projected on the principal axis of the block
+        float mean[3] = { 0.f, 0.f, 0.f };
+
+        for (uint32_t i = 0; i < 16; ++i)
+            for (uint32_t c = 0; c < 3; ++c)
+                mean[c] += block[i * 4 + c] / 16.f;
+
+        float covariance[6] = {}; // rr, rg, rb, gg, gb, bb
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            const float r = block[i * 4]     - mean[0];
+            const float g = block[i * 4 + 1] - mean[1];
+            const float b = block[i * 4 + 2] - mean[2];
+
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+
+        float axis[3] = { 1.f, 1.f, 1.f };
+
+        for (uint32_t iteration = 0; iteration < 8; ++iteration)
+        {
+            const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+            const float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+
+            if (length < 1e-6f)
+                break;
+
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+
+        float minProjection = FLT_MAX;
+        float maxProjection = -FLT_MAX;
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            const float projection = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] + (block[i * 4 + 2] - mean[2]) * axis[2];
+
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+        uint8_t minColor[3];
+        uint8_t maxColor[3];
+
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const float direction = (axisLengthSq > 0.f) ? axis[c] / axisLengthSq : 0.f;
+
+            minColor[c] = static_cast<uint8_t>(std::clamp(mean[c] + direction * minProjection + 0.5f, 0.f, 255.f));
+            maxColor[c] = static_cast<uint8_t>(std::clamp(mean[c] + direction * maxProjection + 0.5f, 0.f, 255.f));
+        }
+
+        uint16_t c0 = pack_565(maxColor);
+        uint16_t c1 = pack_565(minColor);
+
+        uint32_t indices = 0;
+
+        if (c0 == c1)
+        {
+        //  Flat block, every texel takes c0
+        }
+        else
+        {
+            if (c0 < c1)
+            {
+                const uint16_t tmp = c0;
+                c0 = c1;
+                c1 = tmp;
+            }
+
+            int32_t palette[4][3];
+            unpack_565(c0, palette[0]);
+            unpack_565(c1, palette[1]);
+
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                uint32_t best = 0;
+                int32_t bestDistance = INT32_MAX;
+
+                for (uint32_t p = 0; p < 4; ++p)
+                {
+                    const int32_t dr = block[i * 4]     - palette[p][0];
+                    const int32_t dg = block[i * 4 + 1] - palette[p][1];
+                    const int32_t db = block[i * 4 + 2] - palette[p][2];
+                    const int32_t distance = dr * dr + dg * dg + db * db;
+
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+
+                indices |= best << (i * 2);
+            }
+        }
+
+        out[0] = static_cast<uint8_t>(c0 & 0xFF);
+        out[1] = static_cast<uint8_t>(c0 >> 8);
+        out[2] = static_cast<uint8_t>(c1 & 0xFF);
+        out[3] = static_cast<uint8_t>(c1 >> 8);
+        memcpy(out + 4, &indices, 4);
+    }
+
+
+//  Eight-value mode (a0 > a1) between the block extremes
+    void encode_alpha_block(const uint8_t* block, uint8_t* out) noexcept
+    {
+        uint8_t minAlpha = 255;
+        uint8_t maxAlpha = 0;
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (block[i * 4 + 3] < minAlpha) minAlpha = block[i * 4 + 3];
+            if (block[i * 4 + 3] > maxAlpha) maxAlpha = block[i * 4 + 3];
+        }
+
+        out[0] = maxAlpha;
+        out[1] = minAlpha;
+
+        uint64_t indices = 0;
+
+        if (maxAlpha != minAlpha)
+        {
+            int32_t palette[8];
+            palette[0] = maxAlpha;
+            palette[1] = minAlpha;
+
+            for (int32_t i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha + 3) / 7;
+
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                uint64_t best = 0;
+                int32_t bestDistance = INT32_MAX;
+
+                for (uint32_t p = 0; p < 8; ++p)
+                {
+                    const int32_t distance = (block[i * 4 + 3] > palette[p]) ? block[i * 4 + 3] - palette[p] : palette[p] - block[i * 4 + 3];
+
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+
+                indices |= best << (i * 3);
+            }
+        }
+
+        for (uint32_t i = 0; i < 6; ++i)
+            out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+
+
+void BlockEncoder::encodeBC1(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out) noexcept
+{
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    out.resize(static_cast<size_t>(blocksX) * blocksY * 8);
+
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            fetch_block(rgba, width, height, bx, by, block);
+            encode_color_block(block, out.data() + (static_cast<size_t>(by) * blocksX + bx) * 8);
+        }
+    }
+}
+
+
+void BlockEncoder::encodeBC3(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out) noexcept
+{
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    out.resize(static_cast<size_t>(blocksX) * blocksY * 16);
+
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            uint8_t* dst = out.data() + (static_cast<size_t>(by) * blocksX + bx) * 16;
+
+            fetch_block(rgba, width, height, bx, by, block);
+            encode_alpha_block(block, dst);
+            encode_color_block(block, dst + 8);
+        }
+    }
+}
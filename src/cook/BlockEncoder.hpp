@@ -0,0 +1,16 @@
+#ifndef BLOCK_ENCODER_HPP
+#define BLOCK_ENCODER_HPP
+
+#include <cstdint>
+#include <vector>
+
+
+// Offline BC1/BC3 compressor. Color endpoints come from the principal axis of each block,
+// good enough for albedo maps and fast enough to run on every changed asset
+struct BlockEncoder
+{
+    static void encodeBC1(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out) noexcept;
+    static void encodeBC3(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& out) noexcept;
+};
+
+#endif // !BLOCK_ENCODER_HPP
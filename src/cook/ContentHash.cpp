@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <cinttypes>
+
+#include "ContentHash.hpp"
+
+
+namespace
+{
+    constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+    constexpr uint64_t FNV_PRIME        = 0x100000001B3ull;
+
+
+    std::filesystem::path stamp_path(const std::filesystem::path& output) noexcept
+    {
+        std::filesystem::path stamp = output;
+        stamp += ".hash";
+
+        return stamp;
+    }
+}
+
+
+
+bool ContentHash::hashFile(const std::filesystem::path& path, uint64_t seed, uint64_t* hash) noexcept
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+
+    if ( ! file )
+        return false;
+
+    uint64_t value = FNV_OFFSET_BASIS ^ seed;
+    uint8_t chunk[64 * 1024];
+
+    for (size_t count = fread(chunk, 1, sizeof(chunk), file); count > 0; count = fread(chunk, 1, sizeof(chunk), file))
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            value ^= chunk[i];
+            value *= FNV_PRIME;
+        }
+    }
+
+    const bool result = (ferror(file) == 0);
+    fclose(file);
+
+    *hash = value;
+
+    return result;
+}
+
+
+bool ContentHash::isUpToDate(const std::filesystem::path& output, uint64_t hash) noexcept
+{
+    std::error_code error;
+
+    if ( ! std::filesystem::exists(output, error) )
+        return false;
+
+    FILE* file = fopen(stamp_path(output).string().c_str(), "r");
+
+    if ( ! file )
+        return false;
+
+    uint64_t stored = 0;
+    const bool result = (fscanf(file, "%" SCNx64, &stored) == 1) && (stored == hash);
+    fclose(file);
+
+    return result;
+}
+
+
+bool ContentHash::writeStamp(const std::filesystem::path& output, uint64_t hash) noexcept
+{
+    FILE* file = fopen(stamp_path(output).string().c_str(), "w");
+
+    if ( ! file )
+        return false;
+
+    fprintf(file, "%016" PRIx64 "\n", hash);
+    fclose(file);
+
+    return true;
+}
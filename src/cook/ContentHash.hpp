@@ -0,0 +1,17 @@
+#ifndef CONTENT_HASH_HPP
+#define CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <filesystem>
+
+
+// Cooked outputs are keyed by a hash of the source bytes and the cooker settings.
+// The key is kept next to the output in a <output>.hash file
+struct ContentHash
+{
+    static bool hashFile(const std::filesystem::path& path, uint64_t seed, uint64_t* hash) noexcept;
+    static bool isUpToDate(const std::filesystem::path& output, uint64_t hash) noexcept;
+    static bool writeStamp(const std::filesystem::path& output, uint64_t hash) noexcept;
+};
+
+#endif // !CONTENT_HASH_HPP
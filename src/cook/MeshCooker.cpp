@@ -0,0 +1,438 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <new>
+
+#include "mesh/MeshBlob.hpp"
+#include "mesh/MeshSimplifier.hpp"
+#include "MeshCooker.hpp"
+
+
+namespace
+{
+    constexpr float MAX_LOD_ERROR = 0.05f; // coarsest level may stray this far, relative to the bounds diagonal
+
+
+    struct SourceVertex
+    {
+        float position[3];
+        float texCoord[2];
+
+        bool operator == (const SourceVertex& other) const noexcept
+        {
+            return memcmp(this, &other, sizeof(SourceVertex)) == 0;
+        }
+    };
+
+
+    struct SourceVertexHash
+    {
+        size_t operator () (const SourceVertex& vertex) const noexcept
+        {
+            uint64_t hash = 0xCBF29CE484222325ull;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+
+            for (size_t i = 0; i < sizeof(SourceVertex); ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 0x100000001B3ull;
+            }
+
+            return static_cast<size_t>(hash);
+        }
+    };
+
+
+    bool parse_obj(const std::filesystem::path& source, std::vector<SourceVertex>& vertices, std::vector<uint32_t>& indices) noexcept
+    {
+        FILE* file = fopen(source.string().c_str(), "r");
+
+        if ( ! file )
+            return false;
+
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::unordered_map<SourceVertex, uint32_t, SourceVertexHash> welded;
+
+        char line[512];
+        bool result = true;
+
+        while (result && fgets(line, sizeof(line), file))
+        {
+            if (line[0] == 'v' && line[1] == ' ')
+            {
+                float x, y, z;
+
+                if (sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3)
+                    positions.insert(positions.end(), { x, y, z });
+            }
+            else if (line[0] == 'v' && line[1] == 't')
+            {
+                float u, v;
+
+                if (sscanf(line + 3, "%f %f", &u, &v) == 2)
+                    texCoords.insert(texCoords.end(), { u, v });
+            }
+            else if (line[0] == 'f' && line[1] == ' ')
+            {
+                std::vector<uint32_t> polygon;
+                char* cursor = line + 2;
+
+                for (char* token = strtok(cursor, " \t\r\n"); token; token = strtok(nullptr, " \t\r\n"))
+                {
+                    long positionIndex = 0;
+                    long texCoordIndex = 0;
+
+                    if (sscanf(token, "%ld/%ld", &positionIndex, &texCoordIndex) < 1)
+                        continue;
+
+                //  Negative indices are relative to the end of the lists
+                    if (positionIndex < 0) positionIndex += static_cast<long>(positions.size() / 3) + 1;
+                    if (texCoordIndex < 0) texCoordIndex += static_cast<long>(texCoords.size() / 2) + 1;
+
+                    if (positionIndex < 1 || static_cast<size_t>(positionIndex) * 3 > positions.size())
+                    {
+                        result = false;
+                        break;
+                    }
+
+                    SourceVertex vertex = {};
+                    memcpy(vertex.position, positions.data() + (positionIndex - 1) * 3, sizeof(vertex.position));
+
+                    if (texCoordIndex >= 1 && static_cast<size_t>(texCoordIndex) * 2 <= texCoords.size())
+                        memcpy(vertex.texCoord, texCoords.data() + (texCoordIndex - 1) * 2, sizeof(vertex.texCoord));
+
+                    auto [it, inserted] = welded.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+
+                    if (inserted)
+                        vertices.push_back(vertex);
+
+                    polygon.push_back(it->second);
+                }
+
+            //  Fan triangulation of convex polygons
+                for (size_t i = 2; i < polygon.size(); ++i)
+                    indices.insert(indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+            }
+        }
+
+        fclose(file);
+
+        return result && ! indices.empty();
+    }
+
+
+//  Tom Forsyth's linear-speed vertex cache optimisation
+    void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertexCount) noexcept
+    {
+        constexpr int32_t CACHE_SIZE = 32;
+
+        const size_t triangleCount = indices.size() / 3;
+
+        std::vector<uint32_t> valence(vertexCount, 0);
+
+        for (uint32_t index : indices)
+            ++valence[index];
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+        for (uint32_t i = 0; i < vertexCount; ++i)
+            adjacencyOffsets[i + 1] = adjacencyOffsets[i] + valence[i];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<uint32_t> remaining(valence);
+
+        auto vertex_score = [&](uint32_t vertex) noexcept -> float
+        {
+            if (remaining[vertex] == 0)
+                return -1.f;
+
+            float score = 0.f;
+            const int32_t position = cachePosition[vertex];
+
+            if (position >= 0)
+                score = (position < 3) ? 0.75f : std::pow(1.f - (position - 3) / static_cast<float>(CACHE_SIZE - 3), 1.5f);
+
+            return score + 2.f / std::sqrt(static_cast<float>(remaining[vertex]));
+        };
+
+        std::vector<float> vertexScores(vertexCount);
+
+        for (uint32_t i = 0; i < vertexCount; ++i)
+            vertexScores[i] = vertex_score(i);
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+
+        for (size_t t = 0; t < triangleCount; ++t)
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        std::vector<uint32_t> cache;
+        cache.reserve(CACHE_SIZE + 3);
+
+        size_t nextCandidate = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+        {
+        //  Best triangle around the vertices in the cache, or the next unemitted one when the cache has nothing
+            int64_t best = -1;
+            float bestScore = -1.f;
+
+            for (uint32_t vertex : cache)
+            {
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+                {
+                    const uint32_t triangle = adjacency[a];
+
+                    if ( ! emitted[triangle] && triangleScores[triangle] > bestScore )
+                    {
+                        bestScore = triangleScores[triangle];
+                        best = triangle;
+                    }
+                }
+            }
+
+            if (best < 0)
+            {
+                while (emitted[nextCandidate])
+                    ++nextCandidate;
+
+                best = static_cast<int64_t>(nextCandidate);
+            }
+
+            emitted[best] = true;
+
+            std::vector<uint32_t> newCache;
+            newCache.reserve(CACHE_SIZE + 3);
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t vertex = indices[best * 3 + k];
+
+                result.push_back(vertex);
+                newCache.push_back(vertex);
+                --remaining[vertex];
+            }
+
+            for (uint32_t vertex : cache)
+                if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+                    newCache.push_back(vertex);
+
+            for (uint32_t vertex : cache)
+                cachePosition[vertex] = -1;
+
+            if (newCache.size() > CACHE_SIZE)
+                newCache.resize(CACHE_SIZE);
+
+            for (size_t i = 0; i < newCache.size(); ++i)
+                cachePosition[newCache[i]] = static_cast<int32_t>(i);
+
+        //  Only triangles touching the cache change their score
+            for (uint32_t vertex : newCache)
+                vertexScores[vertex] = vertex_score(vertex);
+
+            for (uint32_t vertex : cache)
+                if (cachePosition[vertex] < 0)
+                    vertexScores[vertex] = vertex_score(vertex);
+
+            for (uint32_t vertex : newCache)
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+                {
+                    const uint32_t triangle = adjacency[a];
+                    triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+                }
+
+            cache.swap(newCache);
+        }
+
+        indices.swap(result);
+    }
+
+
+//  Renumbers vertices in first-use order so the vertex fetch walks memory forward
+    void optimize_vertex_fetch(std::vector<SourceVertex>& vertices, std::vector<uint32_t>& indices) noexcept
+    {
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<SourceVertex> ordered;
+        ordered.reserve(vertices.size());
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = static_cast<uint32_t>(ordered.size());
+                ordered.push_back(vertices[index]);
+            }
+
+            index = remap[index];
+        }
+
+        vertices.swap(ordered);
+    }
+
+
+    uint16_t to_half(float value) noexcept
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const uint32_t sign     = (bits >> 16) & 0x8000;
+        const int32_t  exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t       mantissa = bits & 0x7FFFFF;
+
+        if (((bits >> 23) & 0xFF) == 0xFF) // inf or nan
+            return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+        if (exponent >= 31)
+            return static_cast<uint16_t>(sign | 0x7C00);
+
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+                return static_cast<uint16_t>(sign);
+
+            mantissa |= 0x800000;
+            const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+            const uint32_t half  = mantissa >> shift;
+            const uint32_t round = (mantissa >> (shift - 1)) & 1;
+
+            return static_cast<uint16_t>(sign | (half + round));
+        }
+
+        const uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+
+    //  Round to nearest, a carry into the exponent is still the correct result
+        return static_cast<uint16_t>(half + ((mantissa >> 12) & 1));
+    }
+
+
+    template<class T>
+    bool write_all(FILE* file, const T* data, size_t count) noexcept
+    {
+        return fwrite(data, sizeof(T), count, file) == count;
+    }
+}
+
+
+
+bool MeshCooker::cook(const std::filesystem::path& source, const std::filesystem::path& output) noexcept
+{
+    std::vector<SourceVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> lodIndices;
+    MeshSimplifier::Level levels[MeshBlob::MAX_LODS];
+    uint32_t lodCount = 0;
+
+    try
+    {
+        if ( ! parse_obj(source, vertices, indices) )
+        {
+            fprintf(stderr, "star_dust_cook: cannot parse %s\n", source.string().c_str());
+            return false;
+        }
+
+        float extent[3] = { 0.f, 0.f, 0.f };
+
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const auto [lowest, highest] = std::minmax_element(vertices.begin(), vertices.end(), [c](const SourceVertex& a, const SourceVertex& b)
+            {
+                return a.position[c] < b.position[c];
+            });
+
+            extent[c] = highest->position[c] - lowest->position[c];
+        }
+
+        const float diagonal = std::sqrt(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]);
+
+    //  Coarser levels are simplified from the finer ones and share their vertices
+        lodCount = MeshSimplifier::buildLevels(vertices[0].position, sizeof(SourceVertex), static_cast<uint32_t>(vertices.size()), indices,
+                                               MeshBlob::MAX_LODS, MAX_LOD_ERROR * diagonal, lodIndices, levels);
+
+        if (lodCount == 0)
+            return false;
+
+        for (uint32_t i = 0; i < lodCount; ++i)
+        {
+            const auto first = lodIndices.begin() + levels[i].firstIndex;
+            std::vector<uint32_t> level(first, first + levels[i].indexCount);
+
+            optimize_vertex_cache(level, static_cast<uint32_t>(vertices.size()));
+            std::copy(level.begin(), level.end(), first);
+        }
+
+    //  Level 0 comes first and uses every vertex, so the fetch order follows the full mesh
+        optimize_vertex_fetch(vertices, lodIndices);
+        indices.swap(lodIndices);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    MeshBlob::Header header = 
+    {
+        .magic        = MeshBlob::MAGIC,
+        .version      = MeshBlob::VERSION,
+        .vertexCount  = static_cast<uint32_t>(vertices.size()),
+        .indexCount   = static_cast<uint32_t>(indices.size()),
+        .vertexStride = sizeof(MeshBlob::Vertex),
+        .indexSize    = (vertices.size() <= UINT16_MAX) ? 2u : 4u,
+        .boundsMin    = {  INFINITY,  INFINITY,  INFINITY },
+        .boundsMax    = { -INFINITY, -INFINITY, -INFINITY },
+        .lodCount     = lodCount,
+        .lods         = {}
+    };
+
+    for (uint32_t i = 0; i < lodCount; ++i)
+        header.lods[i] = { levels[i].firstIndex, levels[i].indexCount, levels[i].error };
+
+    std::vector<MeshBlob::Vertex> quantized(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            header.boundsMin[c] = std::min(header.boundsMin[c], vertices[i].position[c]);
+            header.boundsMax[c] = std::max(header.boundsMax[c], vertices[i].position[c]);
+            quantized[i].position[c] = to_half(vertices[i].position[c]);
+        }
+
+        quantized[i].position[3] = to_half(1.f);
+        quantized[i].texCoord[0] = to_half(vertices[i].texCoord[0]);
+        quantized[i].texCoord[1] = to_half(vertices[i].texCoord[1]);
+    }
+
+    FILE* file = fopen(output.string().c_str(), "wb");
+
+    if ( ! file )
+        return false;
+
+    bool result = write_all(file, &header, 1) && write_all(file, quantized.data(), quantized.size());
+
+    if (header.indexSize == 2)
+    {
+        std::vector<uint16_t> narrow(indices.begin(), indices.end());
+        result = result && write_all(file, narrow.data(), narrow.size());
+    }
+    else
+    {
+        result = result && write_all(file, indices.data(), indices.size());
+    }
+
+    fclose(file);
+
+    return result;
+}
@@ -0,0 +1,16 @@
+#ifndef MESH_COOKER_HPP
+#define MESH_COOKER_HPP
+
+#include <filesystem>
+
+
+// Reads a Wavefront OBJ (positions, texture coordinates, polygon faces), welds identical vertices,
+// simplifies it into up to MeshBlob::MAX_LODS levels of detail, reorders the triangles of every level for the
+// post-transform cache and vertices for fetch locality, then writes a MeshBlob with half float attributes
+// and 16-bit indices when they fit
+struct MeshCooker
+{
+    static bool cook(const std::filesystem::path& source, const std::filesystem::path& output) noexcept;
+};
+
+#endif // !MESH_COOKER_HPP
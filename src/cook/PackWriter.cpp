@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <new>
+
+#include "assets/LZ4.hpp"
+#include "assets/AssetPack.hpp"
+#include "mesh/MeshBlob.hpp"
+#include "PackWriter.hpp"
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct PendingEntry
+    {
+        std::string          name;
+        AssetPack::Entry     entry;
+        std::vector<uint8_t> payload;
+    };
+
+
+    bool read_file(const fs::path& path, std::vector<uint8_t>& bytes) noexcept
+    {
+        FILE* file = fopen(path.string().c_str(), "rb");
+
+        if ( ! file )
+            return false;
+
+        fseek(file, 0, SEEK_END);
+        const long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        bool result = (size >= 0);
+
+        if (result)
+        {
+            try
+            {
+                bytes.resize(static_cast<size_t>(size));
+                result = (fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+            }
+            catch (const std::bad_alloc&)
+            {
+                result = false;
+            }
+        }
+
+        fclose(file);
+
+        return result;
+    }
+
+
+    AssetPack::Format format_of(const fs::path& path) noexcept
+    {
+        const std::string extension = path.extension().string();
+
+        if (extension == ".spv")
+            return AssetPack::SpirV;
+
+        if (extension == ".ktx2" || extension == ".dds")
+            return AssetPack::Texture;
+
+        if (extension == ".mesh")
+            return AssetPack::Mesh;
+
+        return AssetPack::Raw;
+    }
+
+
+    uint64_t align_up(uint64_t value, uint64_t alignment) noexcept
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+
+//  Keeps the compressed form only when it saves at least an eighth of the payload
+    void compress_entry(PendingEntry& pending, std::vector<uint8_t>& source, uint32_t prefixSize)
+    {
+        std::vector<uint8_t> compressed;
+        LZ4::compress(source.data() + prefixSize, source.size() - prefixSize, compressed);
+
+        if (prefixSize + compressed.size() > source.size() - source.size() / 8)
+        {
+            pending.payload.swap(source);
+            return;
+        }
+
+        pending.payload.assign(source.begin(), source.begin() + prefixSize);
+        pending.payload.insert(pending.payload.end(), compressed.begin(), compressed.end());
+        pending.entry.compression = AssetPack::LZ4Block;
+        pending.entry.prefixSize  = prefixSize;
+    }
+}
+
+
+
+bool PackWriter::write(const fs::path& rootDir, const fs::path& packFile) noexcept
+{
+    std::vector<PendingEntry> entries;
+    std::error_code error;
+
+    try
+    {
+        for (const auto& item : fs::recursive_directory_iterator(rootDir, error))
+        {
+            if ( ! item.is_regular_file() || item.path().extension() == ".hash" )
+                continue;
+
+            PendingEntry pending;
+            pending.name = fs::relative(item.path(), rootDir, error).generic_string();
+
+            std::vector<uint8_t> source;
+
+            if ( ! read_file(item.path(), source) )
+            {
+                fprintf(stderr, "star_dust_cook: cannot read %s\n", item.path().string().c_str());
+                return false;
+            }
+
+            const AssetPack::Format format = format_of(item.path());
+
+            pending.entry = 
+            {
+                .nameHash    = AssetPack::hashName(pending.name),
+                .offset      = 0,
+                .storedSize  = 0,
+                .size        = source.size(),
+                .format      = format,
+                .compression = AssetPack::Uncompressed,
+                .prefixSize  = 0,
+                .reserved    = 0
+            };
+
+            if (format == AssetPack::Texture)
+                pending.payload.swap(source);
+            else if (format == AssetPack::Mesh && source.size() >= sizeof(MeshBlob::Header))
+                compress_entry(pending, source, sizeof(MeshBlob::Header));
+            else if (format == AssetPack::Mesh)
+                pending.payload.swap(source);
+            else
+                compress_entry(pending, source, 0);
+
+            pending.entry.storedSize = pending.payload.size();
+            entries.push_back(std::move(pending));
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const PendingEntry& a, const PendingEntry& b) 
+    { 
+        return a.entry.nameHash < b.entry.nameHash; 
+    });
+
+    for (size_t i = 1; i < entries.size(); ++i)
+    {
+        if (entries[i].entry.nameHash == entries[i - 1].entry.nameHash)
+        {
+            fprintf(stderr, "star_dust_cook: name hash collision between %s and %s\n", entries[i - 1].name.c_str(), entries[i].name.c_str());
+            return false;
+        }
+    }
+
+//  Header, index, then the 4K-aligned payloads
+    const AssetPack::Header header = 
+    {
+        .magic       = AssetPack::MAGIC,
+        .version     = AssetPack::VERSION,
+        .entryCount  = static_cast<uint32_t>(entries.size()),
+        .reserved    = 0,
+        .indexOffset = sizeof(AssetPack::Header)
+    };
+
+    uint64_t offset = sizeof(AssetPack::Header) + entries.size() * sizeof(AssetPack::Entry);
+
+    for (auto& pending : entries)
+    {
+        offset = align_up(offset, AssetPack::PAYLOAD_ALIGNMENT);
+        pending.entry.offset = offset;
+        offset += pending.payload.size();
+    }
+
+    FILE* file = fopen(packFile.string().c_str(), "wb");
+
+    if ( ! file )
+        return false;
+
+    bool result = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    for (const auto& pending : entries)
+        result = result && (fwrite(&pending.entry, sizeof(AssetPack::Entry), 1, file) == 1);
+
+    uint64_t position = sizeof(AssetPack::Header) + entries.size() * sizeof(AssetPack::Entry);
+    const uint8_t padding[AssetPack::PAYLOAD_ALIGNMENT] = {};
+
+    for (const auto& pending : entries)
+    {
+        result = result && (fwrite(padding, 1, static_cast<size_t>(pending.entry.offset - position), file) == pending.entry.offset - position);
+        result = result && (fwrite(pending.payload.data(), 1, pending.payload.size(), file) == pending.payload.size());
+        position = pending.entry.offset + pending.payload.size();
+
+        if (result)
+            printf("star_dust_cook: packed %s (%llu -> %llu bytes)\n", pending.name.c_str(), 
+                   static_cast<unsigned long long>(pending.entry.size), 
+                   static_cast<unsigned long long>(pending.entry.storedSize));
+    }
+
+    fclose(file);
+
+    return result;
+}
@@ -0,0 +1,16 @@
+#ifndef PACK_WRITER_HPP
+#define PACK_WRITER_HPP
+
+#include <filesystem>
+
+
+// Builds an AssetPack from every file under a directory, entries are named by their relative path.
+// SPIR-V and raw files are LZ4-compressed when it pays off, meshes keep their header stored so it can be
+// parsed in place, textures are stored as they are (already block-compressed, and the streamer reads their levels
+// from the mapping; a compressed texture entry is still loaded, but only as a whole chain)
+struct PackWriter
+{
+    static bool write(const std::filesystem::path& rootDir, const std::filesystem::path& packFile) noexcept;
+};
+
+#endif // !PACK_WRITER_HPP
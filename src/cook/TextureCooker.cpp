@@ -0,0 +1,199 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "texture/Image.hpp"
+#include "BlockEncoder.hpp"
+#include "TextureCooker.hpp"
+
+
+namespace
+{
+    constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr uint32_t KTX2_HEADER_SIZE  = 80;
+    constexpr uint32_t KTX2_LEVEL_STRIDE = 24;
+    constexpr uint32_t KTX2_LEVEL_ALIGNMENT = 16;
+
+//  Khronos Data Format values used by the basic descriptor block
+    constexpr uint32_t KHR_DF_MODEL_BC1A          = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3           = 130;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709     = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR     = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB       = 2;
+    constexpr uint32_t KHR_DF_CHANNEL_COLOR       = 0;
+    constexpr uint32_t KHR_DF_CHANNEL_BC3_ALPHA   = 15;
+
+
+    struct Level
+    {
+        std::vector<uint8_t> blocks;
+        uint64_t offset = 0;
+    };
+
+
+    void append_u32(std::vector<uint8_t>& out, uint32_t value) noexcept
+    {
+        const size_t at = out.size();
+        out.resize(at + sizeof(value));
+        memcpy(out.data() + at, &value, sizeof(value));
+    }
+
+
+    void append_u64(std::vector<uint8_t>& out, uint64_t value) noexcept
+    {
+        const size_t at = out.size();
+        out.resize(at + sizeof(value));
+        memcpy(out.data() + at, &value, sizeof(value));
+    }
+
+
+    std::vector<uint8_t> build_data_format_descriptor(bool hasAlpha, bool linear) noexcept
+    {
+        const uint32_t sampleCount = hasAlpha ? 2 : 1;
+        const uint32_t blockSize   = 24 + 16 * sampleCount;
+        const uint32_t bytesPlane0 = hasAlpha ? 16 : 8;
+
+        std::vector<uint8_t> dfd;
+        append_u32(dfd, 4 + blockSize);
+        append_u32(dfd, 0); // Khronos vendor, basic descriptor type
+        append_u32(dfd, 2 | (blockSize << 16));
+        append_u32(dfd, (hasAlpha ? KHR_DF_MODEL_BC3 : KHR_DF_MODEL_BC1A) | (KHR_DF_PRIMARIES_BT709 << 8) | ((linear ? KHR_DF_TRANSFER_LINEAR : KHR_DF_TRANSFER_SRGB) << 16));
+        append_u32(dfd, 3 | (3 << 8)); // 4x4 texel blocks
+        append_u32(dfd, bytesPlane0);
+        append_u32(dfd, 0);
+
+        if (hasAlpha)
+        {
+            append_u32(dfd, 0 | (63 << 16) | (KHR_DF_CHANNEL_BC3_ALPHA << 24));
+            append_u32(dfd, 0);
+            append_u32(dfd, 0);
+            append_u32(dfd, UINT32_MAX);
+        }
+
+        append_u32(dfd, (hasAlpha ? 64 : 0) | (63 << 16) | (KHR_DF_CHANNEL_COLOR << 24));
+        append_u32(dfd, 0);
+        append_u32(dfd, 0);
+        append_u32(dfd, UINT32_MAX);
+
+        return dfd;
+    }
+
+
+    bool has_alpha(const Image& image) noexcept
+    {
+        const uint64_t texels = static_cast<uint64_t>(image.width) * image.height;
+
+        for (uint64_t i = 0; i < texels; ++i)
+            if (image.pixels[i * 4 + 3] != 255)
+                return true;
+
+        return false;
+    }
+}
+
+
+
+bool TextureCooker::cook(const std::filesystem::path& source, const std::filesystem::path& output, bool linear) noexcept
+{
+    Image image;
+
+    if ( ! image.loadFromFile(source.string().c_str()) )
+    {
+        fprintf(stderr, "star_dust_cook: cannot decode %s\n", source.string().c_str());
+        return false;
+    }
+
+    uint32_t mipLevels = 1;
+
+    for (uint32_t size = (image.width > image.height) ? image.width : image.height; size > 1; size >>= 1)
+        ++mipLevels;
+
+    if (mipLevels > 1 && ! image.generateMipmaps(mipLevels))
+        return false;
+
+    const bool alpha = has_alpha(image);
+
+    VkFormat format;
+
+    if (alpha)
+        format = linear ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+    else
+        format = linear ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+
+    std::vector<Level> levels(mipLevels);
+
+    {// Compress every level, the chain after the base level is packed in image.mipChain
+        const uint8_t* pixels = image.pixels;
+        uint32_t width  = image.width;
+        uint32_t height = image.height;
+
+        for (uint32_t i = 0; i < mipLevels; ++i)
+        {
+            if (alpha)
+                BlockEncoder::encodeBC3(pixels, width, height, levels[i].blocks);
+            else
+                BlockEncoder::encodeBC1(pixels, width, height, levels[i].blocks);
+
+            pixels = (i == 0) ? image.mipChain.data() : pixels + static_cast<size_t>(width) * height * 4;
+            width  = (width > 1)  ? width / 2  : 1;
+            height = (height > 1) ? height / 2 : 1;
+        }
+    }
+
+    const std::vector<uint8_t> dfd = build_data_format_descriptor(alpha, linear);
+    const uint32_t dfdOffset = KTX2_HEADER_SIZE + KTX2_LEVEL_STRIDE * mipLevels;
+
+//  KTX2 keeps the smallest level first in the file
+    uint64_t offset = dfdOffset + dfd.size();
+
+    for (uint32_t i = mipLevels; i-- > 0; )
+    {
+        offset = (offset + KTX2_LEVEL_ALIGNMENT - 1) & ~static_cast<uint64_t>(KTX2_LEVEL_ALIGNMENT - 1);
+        levels[i].offset = offset;
+        offset += levels[i].blocks.size();
+    }
+
+    std::vector<uint8_t> file(KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+    append_u32(file, static_cast<uint32_t>(format));
+    append_u32(file, 1); // typeSize
+    append_u32(file, image.width);
+    append_u32(file, image.height);
+    append_u32(file, 0); // pixelDepth
+    append_u32(file, 0); // layerCount
+    append_u32(file, 1); // faceCount
+    append_u32(file, mipLevels);
+    append_u32(file, 0); // no supercompression
+    append_u32(file, dfdOffset);
+    append_u32(file, static_cast<uint32_t>(dfd.size()));
+    append_u32(file, 0); // no key/value data
+    append_u32(file, 0);
+    append_u64(file, 0); // no supercompression global data
+    append_u64(file, 0);
+
+    for (const auto& level : levels)
+    {
+        append_u64(file, level.offset);
+        append_u64(file, level.blocks.size());
+        append_u64(file, level.blocks.size());
+    }
+
+    file.insert(file.end(), dfd.begin(), dfd.end());
+
+    for (uint32_t i = mipLevels; i-- > 0; )
+    {
+        file.resize(static_cast<size_t>(levels[i].offset));
+        file.insert(file.end(), levels[i].blocks.begin(), levels[i].blocks.end());
+    }
+
+    FILE* out = fopen(output.string().c_str(), "wb");
+
+    if ( ! out )
+        return false;
+
+    const bool result = (fwrite(file.data(), 1, file.size(), out) == file.size());
+    fclose(out);
+
+    return result;
+}
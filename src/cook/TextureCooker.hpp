@@ -0,0 +1,14 @@
+#ifndef TEXTURE_COOKER_HPP
+#define TEXTURE_COOKER_HPP
+
+#include <filesystem>
+
+
+// Decodes a source image, builds the full mip chain and writes it as a block-compressed KTX2 file.
+// Opaque images become BC1, images with alpha become BC3
+struct TextureCooker
+{
+    static bool cook(const std::filesystem::path& source, const std::filesystem::path& output, bool linear) noexcept;
+};
+
+#endif // !TEXTURE_COOKER_HPP
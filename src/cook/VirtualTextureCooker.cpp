@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "texture/Image.hpp"
+#include "texture/VirtualTextureFile.hpp"
+#include "VirtualTextureCooker.hpp"
+
+
+namespace
+{
+    constexpr uint32_t TILE_SIZE   = 128;
+    constexpr uint32_t TILE_BORDER = 4; // enough for bilinear and 4x anisotropic footprints at the page edge
+
+
+    bool is_power_of_two(uint32_t value) noexcept
+    {
+        return value && ! (value & (value - 1));
+    }
+
+
+//  Copies one bordered page out of a level, texels outside the level repeat its edge
+    void extract_tile(const uint8_t* level, uint32_t width, uint32_t height, uint32_t pageX, uint32_t pageY, uint8_t* tile) noexcept
+    {
+        const int32_t paddedSize = TILE_SIZE + 2 * TILE_BORDER;
+        const int32_t originX = static_cast<int32_t>(pageX * TILE_SIZE) - TILE_BORDER;
+        const int32_t originY = static_cast<int32_t>(pageY * TILE_SIZE) - TILE_BORDER;
+
+        for (int32_t y = 0; y < paddedSize; ++y)
+        {
+            const int32_t srcY = std::clamp(originY + y, 0, static_cast<int32_t>(height) - 1);
+            const uint8_t* row = level + static_cast<size_t>(srcY) * width * 4;
+
+            for (int32_t x = 0; x < paddedSize; ++x)
+            {
+                const int32_t srcX = std::clamp(originX + x, 0, static_cast<int32_t>(width) - 1);
+                memcpy(tile + (static_cast<size_t>(y) * paddedSize + x) * 4, row + static_cast<size_t>(srcX) * 4, 4);
+            }
+        }
+    }
+}
+
+
+bool VirtualTextureCooker::cook(const std::filesystem::path& source, const std::filesystem::path& output, bool linear) noexcept
+{
+    Image image;
+
+    if ( ! image.loadFromFile(source.string().c_str()) )
+    {
+        fprintf(stderr, "star_dust_cook: cannot decode %s\n", source.string().c_str());
+        return false;
+    }
+
+//  Power-of-two levels halve exactly, so a page of level n + 1 covers exactly 2x2 pages of level n
+//  and the shader finds the fallback page of a missing one by shifting its coordinates
+    if ( ! is_power_of_two(image.width) || ! is_power_of_two(image.height) || image.width < TILE_SIZE || image.height < TILE_SIZE )
+    {
+        fprintf(stderr, "star_dust_cook: %s is %ux%u, virtual textures need power-of-two sizes of at least %u\n",
+                source.string().c_str(), image.width, image.height, TILE_SIZE);
+        return false;
+    }
+
+    VirtualTextureFile::Header header =
+    {
+        .magic      = VirtualTextureFile::MAGIC,
+        .version    = VirtualTextureFile::VERSION,
+        .width      = image.width,
+        .height     = image.height,
+        .tileSize   = TILE_SIZE,
+        .border     = TILE_BORDER,
+        .levelCount = 1,
+        .format     = static_cast<uint32_t>(linear ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB),
+        .dataOffset = sizeof(VirtualTextureFile::Header)
+    };
+
+    while (VirtualTextureFile::getPagesX(header, header.levelCount - 1) > 1 || VirtualTextureFile::getPagesY(header, header.levelCount - 1) > 1)
+        ++header.levelCount;
+
+    if (header.levelCount > VirtualTextureFile::MAX_LEVELS)
+    {
+        fprintf(stderr, "star_dust_cook: %s is too large for a virtual texture\n", source.string().c_str());
+        return false;
+    }
+
+    if (header.levelCount > 1 && ! image.generateMipmaps(header.levelCount))
+        return false;
+
+    std::vector<uint8_t> tile;
+
+    try
+    {
+        tile.resize(static_cast<size_t>(VirtualTextureFile::getTileBytes(header)));
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    FILE* out = fopen(output.string().c_str(), "wb");
+
+    if ( ! out )
+        return false;
+
+    bool result = (fwrite(&header, sizeof(header), 1, out) == 1);
+
+    const uint8_t* level = image.pixels;
+    const uint8_t* chain = image.mipChain.data();
+    uint32_t width  = image.width;
+    uint32_t height = image.height;
+
+    for (uint32_t i = 0; i < header.levelCount && result; ++i)
+    {
+        const uint32_t pagesX = VirtualTextureFile::getPagesX(header, i);
+        const uint32_t pagesY = VirtualTextureFile::getPagesY(header, i);
+
+        for (uint32_t y = 0; y < pagesY && result; ++y)
+        {
+            for (uint32_t x = 0; x < pagesX && result; ++x)
+            {
+                extract_tile(level, width, height, x, y, tile.data());
+                result = (fwrite(tile.data(), 1, tile.size(), out) == tile.size());
+            }
+        }
+
+//  Levels [1, levelCount) are packed one after another in the mip chain
+        if (i > 0)
+            chain += static_cast<size_t>(width) * height * 4;
+
+        width  = (width > 1)  ? width / 2  : 1;
+        height = (height > 1) ? height / 2 : 1;
+        level  = chain;
+    }
+
+    fclose(out);
+
+    return result;
+}
@@ -0,0 +1,14 @@
+#ifndef VIRTUAL_TEXTURE_COOKER_HPP
+#define VIRTUAL_TEXTURE_COOKER_HPP
+
+#include <filesystem>
+
+
+// Decodes a large source image, builds its mip chain and cuts every level into bordered pages,
+// written in the tiled VirtualTextureFile layout the run-time page loader reads from
+struct VirtualTextureCooker
+{
+    static bool cook(const std::filesystem::path& source, const std::filesystem::path& output, bool linear) noexcept;
+};
+
+#endif // !VIRTUAL_TEXTURE_COOKER_HPP
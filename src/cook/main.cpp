@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "ContentHash.hpp"
+#include "TextureCooker.hpp"
+#include "MeshCooker.hpp"
+#include "VirtualTextureCooker.hpp"
+#include "PackWriter.hpp"
+
+
+// Bump when the output of any cooker changes, every asset is re-cooked on the next run
+static constexpr uint64_t COOKER_VERSION = 2;
+
+namespace fs = std::filesystem;
+
+
+static bool is_texture(const fs::path& path) noexcept;
+static bool is_mesh(const fs::path& path) noexcept;
+
+
+// Usage: star_dust_cook <source_dir> <output_dir> [--force]
+//  <source_dir>/textures/*.jpg|png|tga|bmp -> <output_dir>/textures/*.ktx2 (names ending in _linear stay UNORM)
+//  <source_dir>/meshes/*.obj               -> <output_dir>/meshes/*.mesh
+//
+// Usage: star_dust_cook --pack <pack_file> <root_dir>
+//  every file under <root_dir> -> one AssetPack, entries named by their path relative to <root_dir>
+//
+// Usage: star_dust_cook --vt <image> <output_file>
+//  one large image -> bordered pages of a virtual texture (names ending in _linear stay UNORM)
+int main(int argc, char* argv[])
+{
+    const bool pack = (argc > 1 && strcmp(argv[1], "--pack") == 0);
+    const bool virtual_texture = (argc > 1 && strcmp(argv[1], "--vt") == 0);
+
+    if (argc < 3 || ((pack || virtual_texture) && argc < 4))
+    {
+        fprintf(stderr, "usage: star_dust_cook <source_dir> <output_dir> [--force]\n"
+                        "       star_dust_cook --pack <pack_file> <root_dir>\n"
+                        "       star_dust_cook --vt <image> <output_file>\n");
+        return 1;
+    }
+
+    if (pack)
+        return PackWriter::write(argv[3], argv[2]) ? 0 : 1;
+
+    if (virtual_texture)
+    {
+        const fs::path source = argv[2];
+        const bool linear = source.stem().string().ends_with("_linear");
+
+        return VirtualTextureCooker::cook(source, argv[3], linear) ? 0 : 1;
+    }
+
+    const fs::path sourceDir = argv[1];
+    const fs::path outputDir = argv[2];
+    const bool force = (argc > 3 && strcmp(argv[3], "--force") == 0);
+
+    std::error_code error;
+
+    if ( ! fs::is_directory(sourceDir, error) )
+    {
+        fprintf(stderr, "star_dust_cook: %s is not a directory\n", sourceDir.string().c_str());
+        return 1;
+    }
+
+    uint32_t cooked  = 0;
+    uint32_t skipped = 0;
+    uint32_t failed  = 0;
+
+    for (const auto& entry : fs::recursive_directory_iterator(sourceDir, error))
+    {
+        if ( ! entry.is_regular_file() )
+            continue;
+
+        const fs::path& source = entry.path();
+        const bool texture = is_texture(source);
+
+        if ( ! texture && ! is_mesh(source) )
+            continue;
+
+        fs::path output = outputDir / fs::relative(source, sourceDir, error);
+        output.replace_extension(texture ? ".ktx2" : ".mesh");
+
+        const bool linear = texture && source.stem().string().ends_with("_linear");
+        const uint64_t seed = (COOKER_VERSION << 1) | (linear ? 1 : 0);
+
+        uint64_t hash = 0;
+
+        if ( ! ContentHash::hashFile(source, seed, &hash) )
+        {
+            fprintf(stderr, "star_dust_cook: cannot read %s\n", source.string().c_str());
+            ++failed;
+            continue;
+        }
+
+        if ( ! force && ContentHash::isUpToDate(output, hash) )
+        {
+            ++skipped;
+            continue;
+        }
+
+        fs::create_directories(output.parent_path(), error);
+
+        const bool result = texture ? TextureCooker::cook(source, output, linear) : MeshCooker::cook(source, output);
+
+        if (result && ContentHash::writeStamp(output, hash))
+        {
+            printf("star_dust_cook: %s -> %s\n", source.string().c_str(), output.string().c_str());
+            ++cooked;
+        }
+        else
+        {
+            fprintf(stderr, "star_dust_cook: failed to cook %s\n", source.string().c_str());
+            ++failed;
+        }
+    }
+
+    printf("star_dust_cook: %u cooked, %u up to date, %u failed\n", cooked, skipped, failed);
+
+    return failed ? 1 : 0;
+}
+
+
+bool is_texture(const fs::path& path) noexcept
+{
+    const std::string extension = path.extension().string();
+
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+}
+
+
+bool is_mesh(const fs::path& path) noexcept
+{
+    return path.extension() == ".obj";
+}
@@ -2,6 +2,22 @@
 #include "VulkanApi.hpp"
 
 
+// Texture handles go out as the generation of their slot over its index
+static uint64_t to_api_handle(ResourceManager::TextureHandle texture) noexcept
+{
+    if (texture.index == ResourceManager::INVALID_HANDLE)
+        return VulkanApi::INVALID_TEXTURE;
+
+    return (static_cast<uint64_t>(texture.generation) << 32) | texture.index;
+}
+
+
+static ResourceManager::TextureHandle from_api_handle(uint64_t texture) noexcept
+{
+    return { static_cast<uint32_t>(texture), static_cast<uint32_t>(texture >> 32) };
+}
+
+
 VulkanApi::VulkanApi() noexcept
 {
 
@@ -59,6 +75,19 @@ bool VulkanApi::init() noexcept
 }
 
 
+bool VulkanApi::startRenderThread() noexcept
+{
+    if (m_engine)
+    {
+        auto engine = std::static_pointer_cast<Engine>(m_engine);
+
+        return engine->startRenderThread();
+    }
+
+    return false;
+}
+
+
 void VulkanApi::drawFrame() const noexcept
 {
     if (auto engine = std::static_pointer_cast<Engine>(m_engine))
@@ -73,6 +102,7 @@ void VulkanApi::processMouseMovement(float xpos, float ypos) const noexcept
     if (auto engine = std::static_pointer_cast<Engine>(m_engine))
     {
         engine->camera.processMouseMovement(xpos, ypos);
+        engine->publishCamera();
     }
 }
 
@@ -82,6 +112,7 @@ void VulkanApi::processKeyboard(int direction, float deltaTime) const noexcept
     if (auto engine = std::static_pointer_cast<Engine>(m_engine))
     {
         engine->camera.processKeyboard((Camera::Direction)direction, deltaTime);
+        engine->publishCamera();
     }
 }
 
@@ -93,3 +124,257 @@ void VulkanApi::resize(int width, int height) const noexcept
         engine->resize(width, height);
     }
 }
+
+
+uint32_t VulkanApi::createNode(uint32_t parent, float x, float y, float z, float angle, float scale) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->createNode(parent, { x, y, z }, angle, scale);
+    }
+
+    return UINT32_MAX;
+}
+
+
+void VulkanApi::setNodeTransform(uint32_t node, float x, float y, float z, float angle, float scale) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->setNode(node, { x, y, z }, angle, scale);
+    }
+}
+
+
+void VulkanApi::destroyNode(uint32_t node) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->destroyNode(node);
+    }
+}
+
+
+static_assert(VulkanApi::PICKED_NODE == Engine::PICKED_NODE, "node ids returned by pick() are flagged by the engine");
+
+
+uint32_t VulkanApi::pick(float x, float y) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->pick(x, y);
+    }
+
+    return UINT32_MAX;
+}
+
+
+void VulkanApi::setLateLatching(bool enabled) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->lateLatch = enabled;
+    }
+}
+
+
+void VulkanApi::setCommandCaching(bool enabled) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->commandCaching = enabled;
+    }
+}
+
+
+void VulkanApi::setOcclusionCulling(bool enabled) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->occlusionCulling = enabled;
+        engine->requestFrame();
+    }
+}
+
+
+void VulkanApi::setSoftwareOcclusion(bool enabled) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->softwareOcclusion = enabled;
+        engine->requestFrame();
+    }
+}
+
+
+void VulkanApi::setLevelOfDetail(bool enabled, float pixelError) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->levelSelection = enabled;
+        engine->lodPixelError  = pixelError;
+        engine->requestFrame();
+    }
+}
+
+
+void VulkanApi::setOnDemandRendering(bool enabled, float keepAliveSeconds) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->onDemand.enabled   = enabled;
+        engine->onDemand.keepAlive = keepAliveSeconds;
+    }
+}
+
+
+void VulkanApi::setAnimating(bool animating) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->onDemand.animating = animating;
+    }
+}
+
+
+void VulkanApi::requestFrame() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->requestFrame();
+    }
+}
+
+
+bool VulkanApi::needsFrame() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->needsFrame();
+    }
+
+    return false;
+}
+
+
+float VulkanApi::getIdleTimeout() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->getIdleTimeout();
+    }
+
+    return 0.f;
+}
+
+
+uint64_t VulkanApi::getRenderedFrames() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->onDemand.framesRendered;
+    }
+
+    return 0;
+}
+
+
+uint64_t VulkanApi::getSkippedFrames() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        return engine->onDemand.framesSkipped;
+    }
+
+    return 0;
+}
+
+
+VulkanApi::DrawStats VulkanApi::getDrawStats() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        RenderQueue::Stats stats;
+
+        if (engine->drawStats.read(stats))
+        {
+            return
+            {
+                .draws    = stats.draws,
+                .unsorted = { stats.submitted.pipelines, stats.submitted.materials, stats.submitted.meshes },
+                .sorted   = { stats.sorted.pipelines, stats.sorted.materials, stats.sorted.meshes }
+            };
+        }
+    }
+
+    return {};
+}
+
+
+VulkanApi::StartupStats VulkanApi::getStartupStats() const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        StartupStats stats = { .initTime = engine->startup.initTime };
+
+        if (engine->startup.firstFramePresented.load(std::memory_order_acquire))
+            stats.timeToFirstFrame = engine->startup.timeToFirstFrame;
+
+        return stats;
+    }
+
+    return {};
+}
+
+
+uint64_t VulkanApi::loadTexture(const char* filepath, bool srgb) const noexcept
+{
+    uint64_t texture = INVALID_TEXTURE;
+    loadTextures(&filepath, 1, &texture, srgb);
+
+    return texture;
+}
+
+
+void VulkanApi::loadTextures(const char* const* filepaths, uint32_t count, uint64_t* textures, bool srgb) const noexcept
+{
+    for (uint32_t i = 0; i < count; ++i)
+        textures[i] = INVALID_TEXTURE;
+
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        std::vector<ResourceManager::TextureHandle> handles;
+
+        try
+        {
+            handles.resize(count);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return;
+        }
+
+        engine->resources.loadTextures({ filepaths, count }, handles, srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM);
+
+        for (uint32_t i = 0; i < count; ++i)
+            textures[i] = to_api_handle(handles[i]);
+    }
+}
+
+
+void VulkanApi::setSceneTexture(uint64_t texture) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->setSceneTexture(from_api_handle(texture));
+    }
+}
+
+
+void VulkanApi::releaseTexture(uint64_t texture) const noexcept
+{
+    if (auto engine = std::static_pointer_cast<Engine>(m_engine))
+    {
+        engine->resources.release(from_api_handle(texture));
+    }
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef VULKAN_API_HPP
 #define VULKAN_API_HPP
 
+#include <cstdint>
 #include <memory>
 
 #include "Export.hpp"
@@ -16,6 +17,7 @@ public:
     bool createMainView(uint64_t windowHandle) noexcept;
 
     bool init() noexcept;
+    bool startRenderThread() noexcept;
 
     void drawFrame() const noexcept;
 
@@ -24,6 +26,96 @@ public:
 
     void resize(int width, int height) const noexcept;
 
+//  Parented objects drawn with the scene mesh (ships with turrets, planets with moons). 'parent' UINT32_MAX makes a root,
+//  'angle' turns the node in degrees around the scene's rotation axis, relative to its parent. Destroying a node destroys
+//  its subtree. Only a moved node and its descendants are recomputed
+    uint32_t createNode(uint32_t parent, float x, float y, float z, float angle = 0.f, float scale = 1.f) const noexcept;
+    void setNodeTransform(uint32_t node, float x, float y, float z, float angle = 0.f, float scale = 1.f) const noexcept;
+    void destroyNode(uint32_t node) const noexcept;
+
+//  Object under a point of the window ('x' and 'y' in [0, 1] from the top left corner) as drawn in the last frame,
+//  UINT32_MAX for none. Nodes come back as their createNode() id with PICKED_NODE set
+    static constexpr uint32_t PICKED_NODE = 0x80000000u;
+
+    uint32_t pick(float x, float y) const noexcept;
+
+//  Camera matrices are written after command recording, right before submission (on by default)
+    void setLateLatching(bool enabled) const noexcept;
+
+//  Scene draws are recorded once and replayed until the scene, descriptors or view change (on by default)
+    void setCommandCaching(bool enabled) const noexcept;
+
+//  GPU occlusion culling against a depth pyramid (off by default). Draws become indirect and bypass the command cache.
+//  Ignored when the depth format cannot be sampled
+    void setOcclusionCulling(bool enabled) const noexcept;
+
+//  CPU occlusion culling (off by default): the nearest objects are rasterized into a small depth buffer on the worker
+//  threads and everything is tested against it before recording. Overrides GPU culling, bypasses the command cache
+//  and late latching
+    void setSoftwareOcclusion(bool enabled) const noexcept;
+
+//  Levels of detail (on by default): every object draws the coarsest level of its mesh whose error stays within
+//  'pixelError' pixels on screen, very distant ones a textured quad. GPU culled draws keep the full mesh
+    void setLevelOfDetail(bool enabled, float pixelError = 1.f) const noexcept;
+
+//  On-demand rendering (off by default): drawFrame() skips frames while the camera, scene, resources and window are
+//  unchanged and no animation runs. A frame is still produced every 'keepAliveSeconds' unless that is 0.
+//  An idle caller can block on window events for getIdleTimeout() seconds instead of spinning
+    void setOnDemandRendering(bool enabled, float keepAliveSeconds = 1.f) const noexcept;
+    void setAnimating(bool animating) const noexcept;
+    void requestFrame() const noexcept;
+    bool needsFrame() const noexcept;
+    float getIdleTimeout() const noexcept;
+
+    uint64_t getRenderedFrames() const noexcept;
+    uint64_t getSkippedFrames() const noexcept;
+
+//  State binds of the last recorded scene. A recorder binding only what changed between draws needs 'unsorted' binds
+//  in submission order and 'sorted' ones after the render queue sort, one binding everything per draw needs 'draws'
+    struct BindCounts
+    {
+        uint32_t pipelines = 0;
+        uint32_t materials = 0;
+        uint32_t meshes    = 0;
+    };
+
+    struct DrawStats
+    {
+        uint32_t   draws = 0;
+        BindCounts unsorted;
+        BindCounts sorted;
+    };
+
+    DrawStats getDrawStats() const noexcept;
+
+//  Milliseconds spent in init() and from the start of init() to the first presented frame, the latter stays 0
+//  until that frame is out
+    struct StartupStats
+    {
+        float initTime         = 0.f;
+        float timeToFirstFrame = 0.f;
+    };
+
+    StartupStats getStartupStats() const noexcept;
+
+//  Shared textures, loadable from any thread while frames are drawn. Loading a file that is already resident returns
+//  its handle with one more reference. A handle is never reused: once its texture is freed it matches nothing.
+//  INVALID_TEXTURE on failure
+    static constexpr uint64_t INVALID_TEXTURE = UINT64_MAX;
+
+    uint64_t loadTexture(const char* filepath, bool srgb = true) const noexcept;
+
+//  Loads 'count' files at once, their reading, decoding and upload run in parallel on the worker threads.
+//  'textures' receives one handle per file
+    void loadTextures(const char* const* filepaths, uint32_t count, uint64_t* textures, bool srgb = true) const noexcept;
+
+//  The scene is drawn with a loaded texture instead of its own, INVALID_TEXTURE goes back to the latter.
+//  The scene keeps a reference of its own, so the handle may be released right away
+    void setSceneTexture(uint64_t texture) const noexcept;
+
+//  The last release frees the texture once the frames in flight no longer use it
+    void releaseTexture(uint64_t texture) const noexcept;
+
 private:
     std::shared_ptr<void> m_engine;
 };
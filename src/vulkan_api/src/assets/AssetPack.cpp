@@ -0,0 +1,243 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef DEBUG
+#include <cstdio>
+#endif
+#include <cstring>
+
+#include "assets/LZ4.hpp"
+#include "assets/AssetPack.hpp"
+
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+
+bool AssetPack::open(const char* filepath) noexcept
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+
+    if ( ! GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 )
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if ( ! mapping )
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if ( ! view )
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file    = file;
+    m_mapping = mapping;
+    m_data    = static_cast<const uint8_t*>(view);
+    m_size    = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+    const int file = ::open(filepath, O_RDONLY);
+
+    if (file < 0)
+        return false;
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+//  The mapping keeps its own reference to the file
+    ::close(file);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    madvise(view, static_cast<size_t>(info.st_size), MADV_WILLNEED);
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<uint64_t>(info.st_size);
+#endif
+
+    Header header;
+
+    if (m_size < sizeof(Header))
+    {
+        close();
+        return false;
+    }
+
+    memcpy(&header, m_data, sizeof(Header));
+
+    const bool valid = header.magic == MAGIC && 
+                       header.version == VERSION && 
+                       header.indexOffset % alignof(Entry) == 0 &&
+                       header.indexOffset <= m_size &&
+                       static_cast<uint64_t>(header.entryCount) * sizeof(Entry) <= m_size - header.indexOffset;
+
+    if ( ! valid )
+    {
+#ifdef DEBUG
+        fprintf(stderr, "Invalid asset pack: %s\n", filepath);
+#endif
+        close();
+        return false;
+    }
+
+    m_entries    = reinterpret_cast<const Entry*>(m_data + header.indexOffset);
+    m_entryCount = header.entryCount;
+
+    for (uint32_t i = 0; i < m_entryCount; ++i)
+    {
+        const Entry& entry = m_entries[i];
+
+//      Uncompressed entries are read straight from the mapping, so their whole size has to be stored
+        if (entry.offset > m_size || entry.storedSize > m_size - entry.offset || entry.prefixSize > entry.storedSize || entry.prefixSize > entry.size ||
+            (entry.compression == Uncompressed && entry.storedSize != entry.size))
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void AssetPack::close() noexcept
+{
+    if ( ! m_data )
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    CloseHandle(static_cast<HANDLE>(m_file));
+
+    m_file    = nullptr;
+    m_mapping = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+#endif
+
+    m_data       = nullptr;
+    m_size       = 0;
+    m_entries    = nullptr;
+    m_entryCount = 0;
+}
+
+
+bool AssetPack::isOpen() const noexcept
+{
+    return m_data != nullptr;
+}
+
+
+const AssetPack::Entry* AssetPack::find(std::string_view name) const noexcept
+{
+    const uint64_t hash = hashName(name);
+
+    uint32_t first = 0;
+    uint32_t count = m_entryCount;
+
+    while (count > 0)
+    {
+        const uint32_t step = count / 2;
+
+        if (m_entries[first + step].nameHash < hash)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else count = step;
+    }
+
+    if (first < m_entryCount && m_entries[first].nameHash == hash)
+        return &m_entries[first];
+
+    return nullptr;
+}
+
+
+std::span<const uint8_t> AssetPack::getPrefix(const Entry& entry) const noexcept
+{
+    const uint64_t size = (entry.compression == Uncompressed) ? entry.size : entry.prefixSize;
+
+    return { m_data + entry.offset, static_cast<size_t>(size) };
+}
+
+
+std::span<const uint8_t> AssetPack::getStoredBody(const Entry& entry) const noexcept
+{
+    return { m_data + entry.offset + entry.prefixSize, static_cast<size_t>(entry.storedSize - entry.prefixSize) };
+}
+
+
+bool AssetPack::readBody(const Entry& entry, void* dst) const noexcept
+{
+    const std::span<const uint8_t> body = getStoredBody(entry);
+    const uint64_t size = entry.size - entry.prefixSize;
+
+    if (entry.compression == LZ4Block)
+        return LZ4::decompress(body.data(), body.size(), static_cast<uint8_t*>(dst), size);
+
+    if (entry.compression != Uncompressed || body.size() != size)
+        return false;
+
+    memcpy(dst, body.data(), body.size());
+
+    return true;
+}
+
+
+bool AssetPack::read(const Entry& entry, void* dst) const noexcept
+{
+    memcpy(dst, m_data + entry.offset, entry.prefixSize);
+
+    return readBody(entry, static_cast<uint8_t*>(dst) + entry.prefixSize);
+}
+
+
+uint64_t AssetPack::hashName(std::string_view name) noexcept
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
@@ -0,0 +1,92 @@
+#ifndef ASSET_PACK_HPP
+#define ASSET_PACK_HPP
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+
+// Read-only archive produced by star_dust_cook --pack. The file is mapped once,
+// payloads are 4K-aligned and are read straight from the mapping (page cache backed)
+class AssetPack
+{
+public:
+    static constexpr uint32_t MAGIC             = 0x4B504453; // "SDPK"
+    static constexpr uint32_t VERSION           = 1;
+    static constexpr uint64_t PAYLOAD_ALIGNMENT = 4096;
+
+    enum Format : uint32_t
+    {
+        Raw,
+        SpirV,
+        Texture,
+        Mesh
+    };
+
+    enum Compression : uint32_t
+    {
+        Uncompressed,
+        LZ4Block
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t indexOffset;
+    };
+
+//  Index entries are sorted by name hash. The first prefixSize bytes of a compressed payload
+//  are stored as they are, so a format header can be parsed without decompressing anything
+    struct Entry
+    {
+        uint64_t nameHash;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        uint32_t format;
+        uint32_t compression;
+        uint32_t prefixSize;
+        uint32_t reserved;
+    };
+
+    AssetPack() noexcept = default;
+    AssetPack(const AssetPack&)              = delete;
+    AssetPack& operator = (const AssetPack&) = delete;
+    ~AssetPack();
+
+    bool open(const char* filepath) noexcept;
+    void close() noexcept;
+    bool isOpen() const noexcept;
+
+    const Entry* find(std::string_view name) const noexcept;
+
+//  The whole payload of an uncompressed entry, or only the stored prefix of a compressed one
+    std::span<const uint8_t> getPrefix(const Entry& entry) const noexcept;
+
+//  Payload bytes after the prefix, compressed or not
+    std::span<const uint8_t> getStoredBody(const Entry& entry) const noexcept;
+
+//  Copies or decompresses everything after the prefix into dst, which holds entry.size - entry.prefixSize bytes
+    bool readBody(const Entry& entry, void* dst) const noexcept;
+
+//  Copies or decompresses the whole payload into dst, which holds entry.size bytes
+    bool read(const Entry& entry, void* dst) const noexcept;
+
+    static uint64_t hashName(std::string_view name) noexcept;
+
+private:
+    const uint8_t* m_data = nullptr;
+    uint64_t       m_size = 0;
+    const Entry*   m_entries = nullptr;
+    uint32_t       m_entryCount = 0;
+
+#ifdef _WIN32
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif // !ASSET_PACK_HPP
@@ -0,0 +1,180 @@
+#include <cstring>
+
+#include "assets/LZ4.hpp"
+
+
+namespace
+{
+    constexpr uint32_t MIN_MATCH     = 4;
+    constexpr uint32_t LAST_LITERALS = 5;  // the last 5 bytes are always literals
+    constexpr uint32_t MATCH_LIMIT   = 12; // the last match must start at least 12 bytes before the end
+    constexpr uint32_t MAX_OFFSET    = 65535;
+    constexpr uint32_t HASH_BITS     = 16;
+
+
+    uint32_t read_u32(const uint8_t* ptr) noexcept
+    {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+
+        return value;
+    }
+
+
+    uint32_t hash_sequence(uint32_t sequence) noexcept
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+
+    void write_length(std::vector<uint8_t>& dst, uint64_t length) 
+    {
+        while (length >= 255)
+        {
+            dst.push_back(255);
+            length -= 255;
+        }
+
+        dst.push_back(static_cast<uint8_t>(length));
+    }
+
+
+    void write_sequence(std::vector<uint8_t>& dst, const uint8_t* literals, uint64_t literalCount, uint32_t offset, uint64_t matchLength) 
+    {
+        const uint64_t matchCode = (matchLength >= MIN_MATCH) ? matchLength - MIN_MATCH : 0;
+
+        const uint8_t token = static_cast<uint8_t>(((literalCount < 15) ? literalCount : 15) << 4 | ((matchCode < 15) ? matchCode : 15));
+        dst.push_back(token);
+
+        if (literalCount >= 15)
+            write_length(dst, literalCount - 15);
+
+        dst.insert(dst.end(), literals, literals + literalCount);
+
+        if (matchLength == 0) // last sequence, literals only
+            return;
+
+        dst.push_back(static_cast<uint8_t>(offset & 0xFF));
+        dst.push_back(static_cast<uint8_t>(offset >> 8));
+
+        if (matchCode >= 15)
+            write_length(dst, matchCode - 15);
+    }
+
+
+    bool read_length(const uint8_t*& src, const uint8_t* end, uint64_t& length) noexcept
+    {
+        uint8_t byte;
+
+        do
+        {
+            if (src >= end)
+                return false;
+
+            byte = *src++;
+            length += byte;
+        } 
+        while (byte == 255);
+
+        return true;
+    }
+}
+
+
+
+void LZ4::compress(const uint8_t* src, uint64_t srcSize, std::vector<uint8_t>& dst)
+{
+    dst.clear();
+    dst.reserve(static_cast<size_t>(srcSize + srcSize / 255 + 16));
+
+    std::vector<uint32_t> table(1u << HASH_BITS, UINT32_MAX);
+
+    uint64_t anchor = 0;
+    uint64_t position = 0;
+
+    if (srcSize > MATCH_LIMIT)
+    {
+        const uint64_t matchEnd = srcSize - LAST_LITERALS;
+        const uint64_t searchEnd = srcSize - MATCH_LIMIT;
+
+        while (position < searchEnd)
+        {
+            const uint32_t sequence = read_u32(src + position);
+            const uint32_t hash = hash_sequence(sequence);
+            const uint32_t candidate = table[hash];
+
+            table[hash] = static_cast<uint32_t>(position);
+
+            if (candidate == UINT32_MAX || position - candidate > MAX_OFFSET || read_u32(src + candidate) != sequence)
+            {
+                ++position;
+                continue;
+            }
+
+            uint64_t length = MIN_MATCH;
+
+            while (position + length < matchEnd && src[candidate + length] == src[position + length])
+                ++length;
+
+            write_sequence(dst, src + anchor, position - anchor, static_cast<uint32_t>(position - candidate), length);
+
+            position += length;
+            anchor = position;
+        }
+    }
+
+    write_sequence(dst, src + anchor, srcSize - anchor, 0, 0);
+}
+
+
+bool LZ4::decompress(const uint8_t* src, uint64_t srcSize, uint8_t* dst, uint64_t dstSize) noexcept
+{
+    const uint8_t* in = src;
+    const uint8_t* inEnd = src + srcSize;
+    uint64_t out = 0;
+
+    while (in < inEnd)
+    {
+        const uint8_t token = *in++;
+
+        uint64_t literalCount = token >> 4;
+
+        if (literalCount == 15 && ! read_length(in, inEnd, literalCount))
+            return false;
+
+        if (literalCount > static_cast<uint64_t>(inEnd - in) || literalCount > dstSize - out)
+            return false;
+
+        memcpy(dst + out, in, static_cast<size_t>(literalCount));
+        in  += literalCount;
+        out += literalCount;
+
+        if (in == inEnd) // the last sequence has no match
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+
+        const uint32_t offset = static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8);
+        in += 2;
+
+        if (offset == 0 || offset > out)
+            return false;
+
+        uint64_t matchLength = token & 0xF;
+
+        if (matchLength == 15 && ! read_length(in, inEnd, matchLength))
+            return false;
+
+        matchLength += MIN_MATCH;
+
+        if (matchLength > dstSize - out)
+            return false;
+
+    //  Byte by byte: matches may overlap their own output
+        for (uint64_t i = 0; i < matchLength; ++i, ++out)
+            dst[out] = dst[out - offset];
+    }
+
+    return out == dstSize;
+}
@@ -0,0 +1,19 @@
+#ifndef LZ4_HPP
+#define LZ4_HPP
+
+#include <cstdint>
+#include <vector>
+
+
+// LZ4 block format (no frame header). Decompression writes straight into caller memory,
+// so a payload can be expanded directly into a mapped staging buffer
+struct LZ4
+{
+//  Greedy single-probe compressor, used offline by star_dust_cook
+    static void compress(const uint8_t* src, uint64_t srcSize, std::vector<uint8_t>& dst);
+
+//  Returns false on malformed input or when the output does not have exactly dstSize bytes
+    static bool decompress(const uint8_t* src, uint64_t srcSize, uint8_t* dst, uint64_t dstSize) noexcept;
+};
+
+#endif // !LZ4_HPP
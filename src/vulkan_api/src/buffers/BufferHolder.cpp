@@ -1,6 +1,29 @@
 #include "buffers/BufferHolder.hpp"
 
 
+Buffer BufferHolder::create(VkDeviceSize size, uint32_t elementCount, VkBufferUsageFlags usage, const VulkanContext* context) noexcept
+{
+    BufferHolder::Data bufferData = { VK_NULL_HANDLE, VK_NULL_HANDLE, elementCount };
+
+    bufferData.handle = vktools::create_buffer(
+                                               size, 
+                                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, 
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+                                               &bufferData.memory, 
+                                               context->device, 
+                                               context->GPU);
+
+    if(bufferData.handle)
+    {
+        m_buffers.push_back(bufferData);
+
+        return { bufferData.handle, bufferData.size };
+    }
+
+    return {};
+}
+
+
 void BufferHolder::destroy(VkDevice device) noexcept
 {
     for(const auto& data : m_buffers)
@@ -8,4 +31,6 @@ void BufferHolder::destroy(VkDevice device) noexcept
         vkDestroyBuffer(device, data.handle, VK_NULL_HANDLE);
         vkFreeMemory(device, data.memory, VK_NULL_HANDLE);
     }
+
+    m_buffers.clear();
 }
\ No newline at end of file
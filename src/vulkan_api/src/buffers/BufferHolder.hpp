@@ -7,6 +7,7 @@
 
 #include "utils/Tools.hpp"
 #include "context/Context.hpp"
+#include "buffers/UploadBatch.hpp"
 
 
 struct Buffer
@@ -75,6 +76,35 @@ struct BufferHolder
         return {};
     }
 
+//  Creates the device buffer right away, the data is copied when the batch is submitted
+    template<class T>
+    Buffer allocate(std::span<const T> rawData, VkBufferUsageFlagBits flag, const VulkanContext* context, UploadBatch& batch) noexcept
+    {
+        BufferHolder::Data bufferData = { VK_NULL_HANDLE, VK_NULL_HANDLE, static_cast<uint32_t>(rawData.size()) };
+        VkDeviceSize bufferSize = sizeof(T) * rawData.size();
+
+        bufferData.handle = vktools::create_buffer(
+                                                   bufferSize, 
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | flag, 
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+                                                   &bufferData.memory, 
+                                                   context->device, 
+                                                   context->GPU);
+
+        if(bufferData.handle)
+        {
+            batch.addBuffer(bufferData.handle, rawData.data(), bufferSize);
+            m_buffers.push_back(bufferData);
+
+            return { bufferData.handle, bufferData.size };
+        }
+
+        return {};
+    }
+
+//  Device-local buffer of 'size' bytes holding 'elementCount' elements, the caller records the upload
+    Buffer create(VkDeviceSize size, uint32_t elementCount, VkBufferUsageFlags usage, const VulkanContext* context) noexcept;
+
     void destroy(VkDevice device) noexcept;
 
     struct Data
@@ -0,0 +1,47 @@
+#include "utils/Tools.hpp"
+#include "context/Context.hpp"
+#include "buffers/MappedBuffer.hpp"
+
+
+bool MappedBuffer::create(VkDeviceSize bufferSize, VkBufferUsageFlags usage, const VulkanContext* context) noexcept
+{
+    handle = vktools::create_buffer(
+                                    bufferSize, 
+                                    usage, 
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
+                                    &memory, 
+                                    context->device, 
+                                    context->GPU);
+
+    if (!handle)
+        return false;
+
+    if (vkMapMemory(context->device, memory, 0, bufferSize, 0, &data) != VK_SUCCESS)
+    {
+        destroy(context->device);
+
+        return false;
+    }
+
+    size = bufferSize;
+
+    return true;
+}
+
+
+void MappedBuffer::destroy(VkDevice device) noexcept
+{
+    if (data)
+        vkUnmapMemory(device, memory);
+
+    if (handle)
+        vkDestroyBuffer(device, handle, VK_NULL_HANDLE);
+
+    if (memory)
+        vkFreeMemory(device, memory, VK_NULL_HANDLE);
+
+    handle = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+    data   = nullptr;
+    size   = 0;
+}
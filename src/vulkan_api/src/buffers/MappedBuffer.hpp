@@ -0,0 +1,19 @@
+#ifndef MAPPED_BUFFER_HPP
+#define MAPPED_BUFFER_HPP
+
+#include <vulkan/vulkan.h>
+
+
+// Host-visible, host-coherent buffer that stays mapped for its whole lifetime
+struct MappedBuffer
+{
+    bool create(VkDeviceSize bufferSize, VkBufferUsageFlags usage, const struct VulkanContext* context) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+    VkBuffer       handle = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void*          data   = nullptr;
+    VkDeviceSize   size   = 0;
+};
+
+#endif // !MAPPED_BUFFER_HPP
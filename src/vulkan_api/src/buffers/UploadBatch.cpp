@@ -0,0 +1,377 @@
+#include <atomic>
+#include <cstring>
+
+#include "utils/Tools.hpp"
+#include "jobs/JobSystem.hpp"
+#include "context/Context.hpp"
+#include "buffers/UploadBatch.hpp"
+
+
+namespace
+{
+    constexpr VkDeviceSize STAGING_ALIGNMENT = 16; // satisfies the texel size and 4-byte rules of vkCmdCopyBufferToImage
+
+
+    VkImageMemoryBarrier image_barrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, uint32_t baseMipLevel, uint32_t levelCount) noexcept
+    {
+        const VkImageMemoryBarrier barrier = 
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = srcAccess,
+            .dstAccessMask       = dstAccess,
+            .oldLayout           = oldLayout,
+            .newLayout           = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    = 
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = baseMipLevel,
+                .levelCount     = levelCount,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        return barrier;
+    }
+
+
+//  Expects the whole image in TRANSFER_DST_OPTIMAL with the base level filled, leaves it in SHADER_READ_ONLY_OPTIMAL
+    void record_mipmap_chain(VkCommandBuffer cmd, VkImage image, VkExtent2D extent, uint32_t mipLevels) noexcept
+    {
+        int32_t width  = static_cast<int32_t>(extent.width);
+        int32_t height = static_cast<int32_t>(extent.height);
+
+        for (uint32_t i = 1; i < mipLevels; ++i)
+        {
+            const VkImageMemoryBarrier toSource = image_barrier(image, 
+                                                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+                                                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+                                                                VK_ACCESS_TRANSFER_WRITE_BIT, 
+                                                                VK_ACCESS_TRANSFER_READ_BIT, 
+                                                                i - 1, 1);
+
+            vkCmdPipelineBarrier(cmd, 
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                                 0, 
+                                 0, VK_NULL_HANDLE, 
+                                 0, VK_NULL_HANDLE, 
+                                 1, &toSource);
+
+            const int32_t nextWidth  = (width > 1)  ? width / 2  : 1;
+            const int32_t nextHeight = (height > 1) ? height / 2 : 1;
+
+            const VkImageBlit blit = 
+            {
+                .srcSubresource = 
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = i - 1,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1
+                },
+                .srcOffsets = { { 0, 0, 0 }, { width, height, 1 } },
+                .dstSubresource = 
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = i,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1
+                },
+                .dstOffsets = { { 0, 0, 0 }, { nextWidth, nextHeight, 1 } }
+            };
+
+            vkCmdBlitImage(cmd, 
+                           image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+                           image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+                           1, &blit, 
+                           VK_FILTER_LINEAR);
+
+            const VkImageMemoryBarrier toShader = image_barrier(image, 
+                                                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+                                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
+                                                                VK_ACCESS_TRANSFER_READ_BIT, 
+                                                                VK_ACCESS_SHADER_READ_BIT, 
+                                                                i - 1, 1);
+
+            vkCmdPipelineBarrier(cmd, 
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 
+                                 0, 
+                                 0, VK_NULL_HANDLE, 
+                                 0, VK_NULL_HANDLE, 
+                                 1, &toShader);
+
+            width  = nextWidth;
+            height = nextHeight;
+        }
+
+        const VkImageMemoryBarrier lastLevel = image_barrier(image, 
+                                                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+                                                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
+                                                             VK_ACCESS_TRANSFER_WRITE_BIT, 
+                                                             VK_ACCESS_SHADER_READ_BIT, 
+                                                             mipLevels - 1, 1);
+
+        vkCmdPipelineBarrier(cmd, 
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 
+                             0, 
+                             0, VK_NULL_HANDLE, 
+                             0, VK_NULL_HANDLE, 
+                             1, &lastLevel);
+    }
+}
+
+
+
+void UploadBatch::addBuffer(VkBuffer dst, const void* data, VkDeviceSize size) noexcept
+{
+    m_buffers.push_back({ dst, data, size, reserve(size), nullptr });
+}
+
+
+void UploadBatch::addBuffer(VkBuffer dst, VkDeviceSize size, std::function<bool(void*)> writer) noexcept
+{
+    m_buffers.push_back({ dst, nullptr, size, reserve(size), std::move(writer) });
+}
+
+
+void UploadBatch::addImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels, const void* data, VkDeviceSize size) noexcept
+{
+    const ImageLevel base = { data, size, extent };
+
+    m_images.push_back({ dst, mipLevels, (mipLevels > 1), { { base, reserve(size) } }, 0, nullptr });
+}
+
+
+void UploadBatch::addImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels, VkDeviceSize size, std::function<bool(void*)> writer) noexcept
+{
+    const ImageLevel base = { nullptr, size, extent };
+    const VkDeviceSize offset = reserve(size);
+
+    m_images.push_back({ dst, mipLevels, (mipLevels > 1), { { base, offset } }, offset, std::move(writer) });
+}
+
+
+void UploadBatch::addImage(VkImage dst, std::span<const ImageLevel> levels) noexcept
+{
+    ImageUpload upload = { dst, static_cast<uint32_t>(levels.size()), false, {}, 0, nullptr };
+
+    for (const auto& level : levels)
+        upload.levels.push_back({ level, reserve(level.size) });
+
+    m_images.push_back(std::move(upload));
+}
+
+
+void UploadBatch::addImage(VkImage dst, std::span<const ImageLevel> levels, VkDeviceSize size, std::function<bool(void*)> writer) noexcept
+{
+    const VkDeviceSize offset = reserve(size);
+
+    ImageUpload upload = { dst, static_cast<uint32_t>(levels.size()), false, {}, offset, std::move(writer) };
+
+    for (const auto& level : levels)
+        upload.levels.push_back({ level, offset + level.offset });
+
+    m_images.push_back(std::move(upload));
+}
+
+
+bool UploadBatch::submit(const VulkanContext* context, VkCommandPool pool, JobSystem* jobs) noexcept
+{
+    if (empty())
+        return true;
+
+    VkDevice device = context->device;
+
+    VkDeviceMemory stagingBufferMemory;
+    VkBuffer stagingBuffer = vktools::create_buffer(
+                                                    m_stagingSize, 
+                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
+                                                    &stagingBufferMemory, 
+                                                    device, 
+                                                    context->GPU);
+
+    if (!stagingBuffer)
+        return false;
+
+    struct BufferMemoryDeleter
+    {
+        ~BufferMemoryDeleter() 
+        {
+            vkDestroyBuffer(device, buffer, VK_NULL_HANDLE);
+            vkFreeMemory(device, memory, VK_NULL_HANDLE);
+        }
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkBuffer buffer       = VK_NULL_HANDLE;
+        VkDevice device       = VK_NULL_HANDLE;
+    } guard = { stagingBufferMemory, stagingBuffer, device };
+
+    if (void* ptr; vkMapMemory(device, stagingBufferMemory, 0, m_stagingSize, 0, &ptr) == VK_SUCCESS)
+    {
+        auto* staging = static_cast<uint8_t*>(ptr);
+
+        struct Write
+        {
+            const std::function<bool(void*)>* writer;
+            uint8_t* dst;
+        };
+
+        std::vector<Write> writes;
+
+        for (const auto& upload : m_buffers)
+        {
+            if (upload.writer)
+                writes.push_back({ &upload.writer, staging + upload.offset });
+            else
+                memcpy(staging + upload.offset, upload.data, static_cast<size_t>(upload.size));
+        }
+
+        for (const auto& upload : m_images)
+        {
+            if (upload.writer)
+            {
+                writes.push_back({ &upload.writer, staging + upload.writerOffset });
+                continue;
+            }
+
+            for (const auto& level : upload.levels)
+                memcpy(staging + level.offset, level.level.data, static_cast<size_t>(level.level.size));
+        }
+
+        std::atomic<bool> written = true;
+
+        auto run_writes = [&writes, &written](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                if ( ! (*writes[i].writer)(writes[i].dst) )
+                    written = false;
+        };
+
+        if (jobs)
+            jobs->parallelFor(static_cast<uint32_t>(writes.size()), 1, run_writes);
+        else
+            run_writes(0, static_cast<uint32_t>(writes.size()));
+
+        vkUnmapMemory(device, stagingBufferMemory);
+
+        if ( ! written )
+            return false;
+    }
+    else return false;
+
+    VkCommandBuffer cmd = vktools::begin_single_time_commands(device, pool);
+
+    if (!cmd)
+        return false;
+
+    for (const auto& upload : m_buffers)
+    {
+        const VkBufferCopy copyRegion = 
+        {
+            .srcOffset = upload.offset,
+            .dstOffset = 0,
+            .size      = upload.size
+        };
+
+        vkCmdCopyBuffer(cmd, stagingBuffer, upload.dst, 1, &copyRegion);
+    }
+
+    if (!m_images.empty())
+    {
+        std::vector<VkImageMemoryBarrier> barriers;
+        barriers.reserve(m_images.size());
+
+        for (const auto& upload : m_images)
+            barriers.push_back(image_barrier(upload.dst, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_NONE, VK_ACCESS_TRANSFER_WRITE_BIT, 0, upload.mipLevels));
+
+        vkCmdPipelineBarrier(cmd, 
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                             0, 
+                             0, VK_NULL_HANDLE, 
+                             0, VK_NULL_HANDLE, 
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkBufferImageCopy> regions;
+
+        for (const auto& upload : m_images)
+        {
+            regions.clear();
+
+            for (uint32_t i = 0; i < upload.levels.size(); ++i)
+            {
+                const auto& level = upload.levels[i];
+
+                const VkBufferImageCopy region = 
+                {
+                    .bufferOffset      = level.offset,
+                    .bufferRowLength   = 0,
+                    .bufferImageHeight = 0,
+                    .imageSubresource  = 
+                    {
+                        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .mipLevel       = i,
+                        .baseArrayLayer = 0,
+                        .layerCount     = 1
+                    },
+                    .imageOffset = { 0, 0, 0 },
+                    .imageExtent = { level.level.extent.width, level.level.extent.height, 1 }
+                };
+
+                regions.push_back(region);
+            }
+
+            vkCmdCopyBufferToImage(cmd, stagingBuffer, upload.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        }
+
+        barriers.clear();
+
+        for (const auto& upload : m_images)
+        {
+            if (upload.generateMipmaps)
+                record_mipmap_chain(cmd, upload.dst, upload.levels[0].level.extent, upload.mipLevels);
+            else
+                barriers.push_back(image_barrier(upload.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 0, upload.mipLevels));
+        }
+
+        if (!barriers.empty())
+            vkCmdPipelineBarrier(cmd, 
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 
+                                 0, 
+                                 0, VK_NULL_HANDLE, 
+                                 0, VK_NULL_HANDLE, 
+                                 static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    const bool submitted = vktools::end_single_time_commands(cmd, context, pool);
+
+    m_buffers.clear();
+    m_images.clear();
+    m_stagingSize = 0;
+
+    return submitted;
+}
+
+
+bool UploadBatch::empty() const noexcept
+{
+    return m_buffers.empty() && m_images.empty();
+}
+
+
+VkDeviceSize UploadBatch::reserve(VkDeviceSize size) noexcept
+{
+    const VkDeviceSize offset = (m_stagingSize + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    m_stagingSize = offset + size;
+
+    return offset;
+}
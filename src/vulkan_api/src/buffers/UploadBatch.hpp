@@ -0,0 +1,79 @@
+#ifndef UPLOAD_BATCH_HPP
+#define UPLOAD_BATCH_HPP
+
+#include <functional>
+#include <vector>
+#include <span>
+
+#include <vulkan/vulkan.h>
+
+
+// Collects buffer and image uploads and sends all of them to the GPU through one staging buffer
+// and one command buffer submission. The source memory must stay valid until submit() returns
+class UploadBatch
+{
+public:
+    struct ImageLevel
+    {
+        const void*  data;
+        VkDeviceSize size;
+        VkExtent2D   extent;
+        VkDeviceSize offset = 0; // inside the writer's slice, levels without data only
+    };
+
+    void addBuffer(VkBuffer dst, const void* data, VkDeviceSize size) noexcept;
+
+//  The writer fills its slice of the mapped staging buffer during submit(),
+//  so packed payloads can be decompressed straight into staging memory
+    void addBuffer(VkBuffer dst, VkDeviceSize size, std::function<bool(void*)> writer) noexcept;
+
+//  Uploads the base level, levels [1, mipLevels) are generated on the GPU with a chain of linear blits
+    void addImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels, const void* data, VkDeviceSize size) noexcept;
+
+//  Same as above, but the base level is produced by the writer straight into its staging slice
+    void addImage(VkImage dst, VkExtent2D extent, uint32_t mipLevels, VkDeviceSize size, std::function<bool(void*)> writer) noexcept;
+
+//  Uploads every level as given (CPU-generated or pre-compressed mip chains)
+    void addImage(VkImage dst, std::span<const ImageLevel> levels) noexcept;
+
+//  Same as above, but one writer fills a slice of 'size' bytes holding every level at its offset
+    void addImage(VkImage dst, std::span<const ImageLevel> levels, VkDeviceSize size, std::function<bool(void*)> writer) noexcept;
+
+//  With a job system the writers run in parallel on its workers before the copies are recorded
+    bool submit(const struct VulkanContext* context, VkCommandPool pool, class JobSystem* jobs = nullptr) noexcept;
+    bool empty() const noexcept;
+
+private:
+    VkDeviceSize reserve(VkDeviceSize size) noexcept;
+
+    struct BufferUpload
+    {
+        VkBuffer     dst;
+        const void*  data;
+        VkDeviceSize size;
+        VkDeviceSize offset;
+        std::function<bool(void*)> writer;
+    };
+
+    struct LevelUpload
+    {
+        ImageLevel   level;
+        VkDeviceSize offset;
+    };
+
+    struct ImageUpload
+    {
+        VkImage                  dst;
+        uint32_t                 mipLevels;
+        bool                     generateMipmaps;
+        std::vector<LevelUpload> levels;
+        VkDeviceSize             writerOffset;
+        std::function<bool(void*)> writer;
+    };
+
+    std::vector<BufferUpload> m_buffers;
+    std::vector<ImageUpload>  m_images;
+    VkDeviceSize              m_stagingSize = 0;
+};
+
+#endif // !UPLOAD_BATCH_HPP
@@ -6,6 +6,9 @@ static const float YAW         = -90.0f;
 static const float PITCH       =  0.0f;
 static const float SPEED       =  2.5f;
 static const float SENSITIVITY =  0.1f;
+static const float FOV         =  60.0f;
+static const float ZNEAR       =  0.1f;
+static const float ZFAR        =  100.0f;
 
 
 static void update_camera_vectors(Camera* camera)
@@ -35,6 +38,11 @@ Camera::Camera() noexcept
     yaw   = YAW;
     pitch = PITCH;
 
+    fieldOfView = FOV;
+    aspect      = 1.f;
+    nearPlane   = ZNEAR;
+    farPlane    = ZFAR;
+
     movementSpeed    = SPEED; 
     mouseSensitivity = SENSITIVITY; 
 
@@ -54,8 +62,10 @@ void Camera::processKeyboard(Camera::Direction direction, float deltaTime) noexc
         case Camera::RIGHT:    glm_vec3_muladds(right.raw, velocity, position.raw); break;
         
         default:
-            break;
+            return;
     }
+
+    markViewDirty();
 }
 
 
@@ -76,12 +86,136 @@ void Camera::processMouseMovement(float xoffset, float yoffset) noexcept
 
 //  update Front, Right and Up Vectors using the updated Euler angles
     update_camera_vectors(this);
+    markViewDirty();
+}
+
+
+void Camera::setPosition(vec3s newPosition) noexcept
+{
+    position = newPosition;
+    markViewDirty();
+}
+
+
+void Camera::setOrientation(float newYaw, float newPitch) noexcept
+{
+    yaw   = newYaw;
+    pitch = glm_clamp(newPitch, -89.f, 89.f);
+
+    update_camera_vectors(this);
+    markViewDirty();
+}
+
+
+void Camera::setPerspective(float fov, float aspectRatio, float zNear, float zFar) noexcept
+{
+    fieldOfView = fov;
+    aspect      = aspectRatio;
+    nearPlane   = zNear;
+    farPlane    = zFar;
+
+    markProjectionDirty();
+}
+
+
+void Camera::setAspectRatio(float aspectRatio) noexcept
+{
+//  Called every frame with the view extent, only a resize invalidates anything
+    if (aspectRatio == aspect)
+        return;
+
+    aspect = aspectRatio;
+    markProjectionDirty();
+}
+
+
+const mat4s& Camera::getViewMatrix() noexcept
+{
+    updateMatrices();
+
+    return m_view;
+}
+
+
+const mat4s& Camera::getProjectionMatrix() noexcept
+{
+    updateMatrices();
+
+    return m_projection;
+}
+
+
+const mat4s& Camera::getViewProjectionMatrix() noexcept
+{
+    updateMatrices();
+
+    return m_viewProjection;
+}
+
+
+const Frustum& Camera::getFrustum() noexcept
+{
+    updateMatrices();
+
+    return m_frustum;
 }
 
 
-mat4s Camera::getViewMatrix() noexcept
+uint64_t Camera::getVersion() const noexcept
 {
-    vec3s center = glms_vec3_add(position, front);
+    return m_version;
+}
+
+
+void Camera::getPickRay(float x, float y, vec3s* origin, vec3s* direction) noexcept
+{
+//  Vulkan NDC has y pointing down, so the top of the view is -1. Depth runs from -1 (near) to 1 (far) with this projection
+    const mat4s inverse = glms_mat4_inv(getViewProjectionMatrix());
+    const float ndcX    = 2.f * x - 1.f;
+    const float ndcY    = 2.f * y - 1.f;
+
+    vec4s nearPoint = glms_mat4_mulv(inverse, vec4s{ ndcX, ndcY, -1.f, 1.f });
+    vec4s farPoint  = glms_mat4_mulv(inverse, vec4s{ ndcX, ndcY,  1.f, 1.f });
+
+    const vec3s start = glms_vec3_divs(glms_vec3(nearPoint), nearPoint.w);
+    const vec3s end   = glms_vec3_divs(glms_vec3(farPoint), farPoint.w);
+
+    *origin    = start;
+    *direction = glms_vec3_normalize(glms_vec3_sub(end, start));
+}
+
+
+void Camera::markViewDirty() noexcept
+{
+    m_viewDirty = true;
+    ++m_version;
+}
+
+
+void Camera::markProjectionDirty() noexcept
+{
+    m_projectionDirty = true;
+    ++m_version;
+}
+
+
+void Camera::updateMatrices() noexcept
+{
+    if ( ! (m_viewDirty || m_projectionDirty) )
+        return;
+
+    if (m_viewDirty)
+    {
+        vec3s center = glms_vec3_add(position, front);
+        m_view = glms_lookat(position, center, up);
+    }
+
+    if (m_projectionDirty)
+        m_projection = glms_perspective(glm_rad(fieldOfView), aspect, nearPlane, farPlane);
+
+    m_viewProjection = glms_mat4_mul(m_projection, m_view);
+    m_frustum.extract(m_viewProjection);
 
-    return glms_lookat(position, center, up);
+    m_viewDirty       = false;
+    m_projectionDirty = false;
 }
\ No newline at end of file
@@ -1,11 +1,19 @@
 #ifndef CAMERA_HPP
 #define CAMERA_HPP
 
+#include <cstdint>
+
 #include <cglm/struct/vec3.h>
 #include <cglm/struct/mat4.h>
 #include <cglm/struct/cam.h>
 #include <cglm/util.h>
 
+#include "camera/Frustum.hpp"
+
+
+// View, projection, view-projection and frustum are cached and rebuilt on the first read after a change.
+// Every change bumps the version, so culling results and recorded commands can be keyed on it.
+// Attributes are public for reading, writes go through the setters or the input handlers
 struct Camera
 {
     enum Direction
@@ -20,7 +28,23 @@ struct Camera
 
     void processKeyboard(Camera::Direction direction, float deltaTime) noexcept;
     void processMouseMovement(float xoffset, float yoffset) noexcept;
-    mat4s getViewMatrix() noexcept;
+
+    void setPosition(vec3s newPosition) noexcept;
+    void setOrientation(float newYaw, float newPitch) noexcept;
+
+//  Vertical field of view in degrees
+    void setPerspective(float fov, float aspectRatio, float zNear, float zFar) noexcept;
+    void setAspectRatio(float aspectRatio) noexcept;
+
+    const mat4s&   getViewMatrix() noexcept;
+    const mat4s&   getProjectionMatrix() noexcept;
+    const mat4s&   getViewProjectionMatrix() noexcept;
+    const Frustum& getFrustum() noexcept;
+    uint64_t       getVersion() const noexcept;
+
+//  Ray from the near plane through a point of the view, 'x' and 'y' in [0, 1] from the top left corner.
+//  The direction is normalized
+    void getPickRay(float x, float y, vec3s* origin, vec3s* direction) noexcept;
 
 //  camera Attributes
     vec3s position;
@@ -33,9 +57,28 @@ struct Camera
     float yaw;
     float pitch;
 
+//  projection
+    float fieldOfView;
+    float aspect;
+    float nearPlane;
+    float farPlane;
+
 //  camera options
     float movementSpeed;
     float mouseSensitivity;
+
+private:
+    void markViewDirty() noexcept;
+    void markProjectionDirty() noexcept;
+    void updateMatrices() noexcept;
+
+    mat4s    m_view;
+    mat4s    m_projection;
+    mat4s    m_viewProjection;
+    Frustum  m_frustum;
+    uint64_t m_version         = 0;
+    bool     m_viewDirty       = true;
+    bool     m_projectionDirty = true;
 };
 
-#endif // !CAMERA_HPP
\ No newline at end of file
+#endif // !CAMERA_HPP
@@ -0,0 +1,60 @@
+#include <cmath>
+
+#include "camera/Frustum.hpp"
+
+
+void Frustum::extract(const mat4s& viewProjection) noexcept
+{
+//  cglm is column-major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const auto& m = viewProjection.raw;
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            planes[i * 2    ].raw[column] = m[column][3] + m[column][i];
+            planes[i * 2 + 1].raw[column] = m[column][3] - m[column][i];
+        }
+    }
+
+//  The near plane assumes clip depth from -w, which also holds (loosely) for a zero to one depth range
+    for (auto& plane : planes)
+    {
+        const float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+        if (length > 0.f)
+        {
+            plane.x /= length;
+            plane.y /= length;
+            plane.z /= length;
+            plane.w /= length;
+        }
+    }
+}
+
+
+bool Frustum::intersectsSphere(vec3s center, float radius) const noexcept
+{
+    for (const auto& plane : planes)
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+            return false;
+
+    return true;
+}
+
+
+bool Frustum::intersectsBox(vec3s min, vec3s max) const noexcept
+{
+//  Only the corner furthest along the plane normal needs testing
+    for (const auto& plane : planes)
+    {
+        const float x = (plane.x >= 0.f) ? max.x : min.x;
+        const float y = (plane.y >= 0.f) ? max.y : min.y;
+        const float z = (plane.z >= 0.f) ? max.z : min.z;
+
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.f)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <cglm/struct/vec3.h>
+#include <cglm/struct/vec4.h>
+#include <cglm/struct/mat4.h>
+
+
+// Six inward facing planes taken from a view-projection matrix (Gribb/Hartmann).
+// xyz is the normalized plane normal and w the distance, a point p lies inside a plane when dot(xyz, p) + w >= 0
+struct Frustum
+{
+    enum Plane
+    {
+        PLANE_LEFT,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        PLANE_COUNT
+    };
+
+    void extract(const mat4s& viewProjection) noexcept;
+
+//  Conservative: false only when the volume is entirely outside one plane
+    bool intersectsSphere(vec3s center, float radius) const noexcept;
+    bool intersectsBox(vec3s min, vec3s max) const noexcept;
+
+    vec4s planes[PLANE_COUNT];
+};
+
+#endif // !FRUSTUM_HPP
@@ -0,0 +1,125 @@
+#include "command_pool/CommandCache.hpp"
+
+
+namespace
+{
+    bool same_key(const CommandCache::Key& a, const CommandCache::Key& b) noexcept
+    {
+        return a.pipeline          == b.pipeline          &&
+               a.descriptorSet     == b.descriptorSet     &&
+               a.descriptorVersion == b.descriptorVersion &&
+               a.instanceCount     == b.instanceCount     &&
+               a.extent.width      == b.extent.width      &&
+               a.extent.height     == b.extent.height     &&
+               a.colorFormat       == b.colorFormat       &&
+               a.drawRanges        == b.drawRanges;
+    }
+}
+
+
+bool CommandCache::create(VkDevice device, uint32_t queueFamilyIndex, VkFormat depthFormat) noexcept
+{
+    m_depthFormat = depthFormat;
+
+    const VkCommandPoolCreateInfo poolInfo = 
+    {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext            = VK_NULL_HANDLE,
+        .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = queueFamilyIndex
+    };
+
+    if (vkCreateCommandPool(device, &poolInfo, VK_NULL_HANDLE, &handle) != VK_SUCCESS)
+        return false;
+
+    const VkCommandBufferAllocateInfo allocInfo = 
+    {
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext              = VK_NULL_HANDLE,
+        .commandPool        = handle,
+        .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = static_cast<uint32_t>(commandBuffers.size())
+    };
+
+    return (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) == VK_SUCCESS);
+}
+
+
+void CommandCache::destroy(VkDevice device) noexcept
+{
+    vkDestroyCommandPool(device, handle, VK_NULL_HANDLE);
+    handle = VK_NULL_HANDLE;
+    invalidate();
+}
+
+
+bool CommandCache::isValid(uint32_t frame, const Key& key) const noexcept
+{
+    return m_valid[frame] && same_key(m_keys[frame], key);
+}
+
+
+VkCommandBuffer CommandCache::begin(uint32_t frame, const Key& key) noexcept
+{
+    VkCommandBuffer cmd = commandBuffers[frame];
+
+    m_valid[frame] = false;
+    m_keys[frame]  = key;
+
+    if (vkResetCommandBuffer(cmd, 0) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+
+//  Formats must match the rendering begun by the primary buffer
+    const VkCommandBufferInheritanceRenderingInfo renderingInfo = 
+    {
+        .sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .pNext                   = VK_NULL_HANDLE,
+        .flags                   = 0,
+        .viewMask                = 0,
+        .colorAttachmentCount    = 1,
+        .pColorAttachmentFormats = &m_keys[frame].colorFormat,
+        .depthAttachmentFormat   = m_depthFormat,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples    = VK_SAMPLE_COUNT_1_BIT
+    };
+
+    const VkCommandBufferInheritanceInfo inheritanceInfo = 
+    {
+        .sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext                = &renderingInfo,
+        .renderPass           = VK_NULL_HANDLE,
+        .subpass              = 0,
+        .framebuffer          = VK_NULL_HANDLE,
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags           = 0,
+        .pipelineStatistics   = 0
+    };
+
+//  Not one-time: the same recording is submitted again every time the slot comes round
+    const VkCommandBufferBeginInfo beginInfo = 
+    {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = VK_NULL_HANDLE,
+        .flags            = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo
+    };
+
+    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+
+    return cmd;
+}
+
+
+bool CommandCache::end(uint32_t frame) noexcept
+{
+    m_valid[frame] = (vkEndCommandBuffer(commandBuffers[frame]) == VK_SUCCESS);
+
+    return m_valid[frame];
+}
+
+
+void CommandCache::invalidate() noexcept
+{
+    m_valid.fill(false);
+}
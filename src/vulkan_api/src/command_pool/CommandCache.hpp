@@ -0,0 +1,48 @@
+#ifndef COMMAND_CACHE_HPP
+#define COMMAND_CACHE_HPP
+
+#include <array>
+
+#include <vulkan/vulkan.h>
+
+// Scene draws recorded into one secondary command buffer per frame slot and replayed with vkCmdExecuteCommands.
+// A buffer is re-recorded only when its key changes: the pipeline, a descriptor write to the slot's set,
+// the number of instances, the ranges of the levels of detail or the attachments. The camera and the instance matrices are read from buffers,
+// so a static scene seen by a moving camera keeps replaying the same commands.
+// The buffers do not reference the swapchain image (the primary begins rendering), one per frame slot is enough
+struct CommandCache
+{
+    struct Key
+    {
+        VkPipeline      pipeline          = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet     = VK_NULL_HANDLE;
+        uint64_t        descriptorVersion = 0; // bumped on every write to the set
+        uint32_t        instanceCount     = 0;
+        VkExtent2D      extent            = { 0, 0 };
+        VkFormat        colorFormat       = VK_FORMAT_UNDEFINED;
+        uint64_t        drawRanges        = 0; // hash of the draw list range of every level, 0 without a draw list
+    };
+
+    bool create(VkDevice device, uint32_t queueFamilyIndex, VkFormat depthFormat) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+//  Whether the buffer of 'frame' was recorded for 'key'
+    bool isValid(uint32_t frame, const Key& key) const noexcept;
+
+//  Starts re-recording the buffer of 'frame', it stays invalid until end() succeeds.
+//  Call once the fence of 'frame' has been waited on
+    VkCommandBuffer begin(uint32_t frame, const Key& key) noexcept;
+    bool end(uint32_t frame) noexcept;
+
+    void invalidate() noexcept;
+
+    VkCommandPool handle = VK_NULL_HANDLE;
+    std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT> commandBuffers = {};
+
+private:
+    std::array<Key, MAX_FRAMES_IN_FLIGHT>  m_keys;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> m_valid = {};
+    VkFormat                               m_depthFormat = VK_FORMAT_UNDEFINED;
+};
+
+#endif // !COMMAND_CACHE_HPP
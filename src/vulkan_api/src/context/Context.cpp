@@ -188,6 +188,16 @@ bool VulkanContext::createDevice() noexcept
     if (supportedFeatures.fillModeNonSolid)
         enabledFeatures.fillModeNonSolid = VK_TRUE;
 
+//  Block-compressed texture families, CompressedImage checks the format itself before upload
+    if (supportedFeatures.textureCompressionBC)
+        enabledFeatures.textureCompressionBC = VK_TRUE;
+
+    if (supportedFeatures.textureCompressionETC2)
+        enabledFeatures.textureCompressionETC2 = VK_TRUE;
+
+    if (supportedFeatures.textureCompressionASTC_LDR)
+        enabledFeatures.textureCompressionASTC_LDR = VK_TRUE;
+
     {// Find main queue family index
         uint32_t queueFamilyCount;
         vkGetPhysicalDeviceQueueFamilyProperties(GPU, &queueFamilyCount, VK_NULL_HANDLE);
@@ -281,7 +291,10 @@ bool VulkanContext::createDevice() noexcept
 void VulkanContext::destroy() noexcept
 {
     if(device)
+    {
+        samplers.destroy(device);
         vkDestroyDevice(device, VK_NULL_HANDLE);
+    }
 
     if(instance)
         vkDestroyInstance(instance, VK_NULL_HANDLE);
@@ -1,8 +1,12 @@
 #ifndef VULKAN_CONTEXT_HPP
 #define VULKAN_CONTEXT_HPP
 
+#include <mutex>
+
 #include <vulkan/vulkan.h>
 
+#include "texture/SamplerCache.hpp"
+
 class VulkanContext
 {
 public:
@@ -16,6 +20,13 @@ public:
     VkDevice         device               = nullptr;
     VkQueue          queue                = nullptr;
     uint32_t         mainQueueFamilyIndex = 0;
+
+//  'queue' needs external synchronization: vkQueueSubmit, vkQueuePresentKHR and vkDeviceWaitIdle take this lock,
+//  so loader threads can submit uploads while the render thread draws
+    mutable std::mutex queueLock;
+
+//  Thread-safe, so it may be used through the const context every loader receives
+    mutable SamplerCache samplers;
 };
 
 #endif // !VULKAN_CONTEXT_HPP
\ No newline at end of file
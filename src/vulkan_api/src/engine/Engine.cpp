@@ -1,24 +1,79 @@
 #ifdef DEBUG
 #include <cstdio>
 #endif
+#include <new>
+#include <cmath>
+#include <algorithm>
 #include <array>
+#include <iterator>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
-#include <cglm/struct/affine-pre.h>
+#include <cglm/struct/quat.h>
 
 #include "context/Context.hpp"
+#include "texture/Image.hpp"
+#include "texture/CompressedImage.hpp"
+#include "mesh/MeshBlob.hpp"
+#include "mesh/MeshSimplifier.hpp"
+#include "assets/AssetPack.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "utils/Tools.hpp"
 #include "engine/Engine.hpp"
 
 
 static bool init_vulkan(Engine* app) noexcept;
-static void update_matrices(Engine* app, vec3s position, float angle) noexcept;
-static void write_command_buffer(Engine* app, VkCommandBuffer cmd, VkDescriptorSet descriptorSet) noexcept;
-static void draw_frame(Engine* app) noexcept;
+static bool update_instances(Engine* app, uint32_t frame) noexcept;
+static bool update_scene_bounds(Engine* app) noexcept;
+static bool update_frustum_culling(Engine* app, Camera& camera) noexcept;
+static void write_command_buffer(Engine* app, VkCommandBuffer cmd, uint32_t frame) noexcept;
+static bool update_software_occlusion(Engine* app, Camera& camera) noexcept;
+static bool update_draw_list(Engine* app, uint32_t frame, Camera& camera, bool lod) noexcept;
+static void write_draw_list_commands(Engine* app, VkCommandBuffer cmd, uint32_t frame) noexcept;
+static bool update_culling(Engine* app, uint32_t frame, bool occlusion, bool drawList) noexcept;
+static void write_culled_commands(Engine* app, VkCommandBuffer cmd, uint32_t frame, OcclusionCuller::Phase phase) noexcept;
+static bool record_occlusion(Engine* app, VkCommandBuffer cmd, uint32_t frame, uint32_t imageIndex) noexcept;
+static void write_camera_uniforms(Engine* app, uint32_t frame, Camera& camera) noexcept;
+static void update_streaming(Engine* app, VkCommandBuffer cmd, uint32_t frame, const Camera& camera) noexcept;
+static void update_texture_binding(Engine* app, uint32_t frame) noexcept;
+static uint32_t get_scene_texture_version(const Engine* app) noexcept;
+static const Texture2D& get_bound_texture(const Engine* app) noexcept;
+static bool record_scene(Engine* app, uint32_t frame, bool drawList) noexcept;
+static void draw_frame(Engine* app, Camera& camera) noexcept;
+static bool recreate_swapchain(Engine* app) noexcept;
+static Aabb instance_bounds(const mat4s& matrix) noexcept;
+static uint64_t hash_draw_ranges(const std::array<LevelOfDetail::Range, LevelOfDetail::MAX_LEVELS>& ranges) noexcept;
 
 
 // TODO remove magic numbers
 static float lastX = 400;
 static float lastY = 300;
 
+static const vec3s ROTATION_AXIS = { 1.0f, 0.3f, 0.5f }; // every cube spins around it
+static const float CUBE_RADIUS   = 0.8660254f;             // half diagonal of the unit cube, bounds it at any rotation
+static const float PICK_DISTANCE = 1000.f;
+
+static const uint32_t OCCLUSION_WIDTH  = 320; // software occlusion buffer, a tenth of a 1080p view is plenty for whole objects
+static const uint32_t OCCLUSION_HEIGHT = 192;
+static const uint32_t MAX_OCCLUDERS    = 64;  // nearest objects in view, the rest is only tested
+static const float    MAX_LOD_ERROR    = 0.05f; // coarsest level of the source mesh may stray this far (in object units)
+
+// The cube every instance draws, as an occluder: corners and two triangles per face
+static const float occluderCorners[8][3] = 
+{
+    { -0.5f, -0.5f, -0.5f }, {  0.5f, -0.5f, -0.5f }, {  0.5f,  0.5f, -0.5f }, { -0.5f,  0.5f, -0.5f },
+    { -0.5f, -0.5f,  0.5f }, {  0.5f, -0.5f,  0.5f }, {  0.5f,  0.5f,  0.5f }, { -0.5f,  0.5f,  0.5f }
+};
+
+static const uint32_t occluderIndices[36] = 
+{
+    0, 1, 2, 0, 2, 3,  4, 6, 5, 4, 7, 6,
+    0, 4, 5, 0, 5, 1,  3, 2, 6, 3, 6, 7,
+    0, 3, 7, 0, 7, 4,  1, 5, 6, 1, 6, 2
+};
+
 
 // world space positions of our cubes
 static const vec3s cubePositions[10] = 
@@ -67,16 +122,237 @@ bool Engine::createMainView(uint64_t windowHandle) noexcept
 
 bool Engine::init() noexcept
 {
-	modelViewProjectionMatrix = glms_mat4_identity();
+	startup.initStarted = std::chrono::steady_clock::now();
+
+	if (!jobs.init())
+		return false;
+
+	instances.clear();
+
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		const TransformHandle handle = transforms.create(cubePositions[i], glms_quatv(glm_rad(20.f * i), ROTATION_AXIS), glms_vec3_one());
+
+		if ( ! transforms.isValid(handle) )
+			return false;
+
+		instances.push_back(handle);
+	}
+
+	if (!init_vulkan(this))
+		return false;
+
+	startup.initTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startup.initStarted).count();
+
+	return true;
+}
+
 
-	return init_vulkan(this);
+bool Engine::startRenderThread() noexcept
+{
+	return renderThread.start(this);
 }
 
 
 void Engine::drawFrame() noexcept
 {
-	draw_frame(this);
-	vkDeviceWaitIdle(context.device);
+	if (onDemand.enabled && !needsFrame())
+	{
+		++onDemand.framesSkipped;
+
+		return;
+	}
+
+	if (camera.getVersion() != m_drawnCameraVersion)
+		requestFrame();
+
+	m_drawnCameraVersion = camera.getVersion();
+	m_lastFrameTime      = std::chrono::steady_clock::now();
+
+	if (m_redrawFrames > 0)
+		--m_redrawFrames;
+
+	++onDemand.framesRendered;
+
+	FramePacket& packet = renderThread.isRunning() ? renderThread.beginPacket() : m_inlinePacket;
+
+	packet.camera  = camera;
+	packet.extent  = m_requestedExtent;
+	packet.resized = m_resizeRequested;
+	packet.instanceDeltas.swap(m_instanceDeltas);
+	packet.requests.swap(m_requests);
+
+	m_resizeRequested = false;
+
+	if (renderThread.isRunning())
+	{
+		renderThread.publishPacket();
+	}
+	else
+	{
+		renderPacket(packet);
+		packet.clear();
+	}
+}
+
+
+void Engine::setInstance(uint32_t index, vec3s position, float angle) noexcept
+{
+	m_instanceDeltas.push_back({ index, position, angle });
+	requestFrame();
+}
+
+
+void Engine::publishCamera() noexcept
+{
+	cameraLatch.write(camera);
+}
+
+
+uint32_t Engine::createNode(uint32_t parent, vec3s position, float angle, float scale) noexcept
+{
+	const uint32_t node     = m_nodeCount++;
+	const versors  rotation = glms_quatv(glm_rad(angle), ROTATION_AXIS);
+	const vec3s    scales   = { scale, scale, scale };
+
+//  Requests run in order, so a parent created earlier already has its handle
+	enqueueRequest([node, parent, position, rotation, scales](Engine* engine)
+	{
+		std::vector<NodeHandle>& handles = engine->nodeHandles;
+		const NodeHandle parentHandle = (parent < handles.size()) ? handles[parent] : NodeHandle{};
+
+		try
+		{
+			if (handles.size() <= node)
+				handles.resize(node + 1);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return;
+		}
+
+		handles[node] = engine->hierarchy.create(parentHandle, position, rotation, scales);
+	});
+
+	return node;
+}
+
+
+void Engine::setNode(uint32_t node, vec3s position, float angle, float scale) noexcept
+{
+	const versors rotation = glms_quatv(glm_rad(angle), ROTATION_AXIS);
+	const vec3s   scales   = { scale, scale, scale };
+
+	enqueueRequest([node, position, rotation, scales](Engine* engine)
+	{
+		if (node < engine->nodeHandles.size())
+			engine->hierarchy.setLocal(engine->nodeHandles[node], position, rotation, scales);
+	});
+}
+
+
+void Engine::destroyNode(uint32_t node) noexcept
+{
+	enqueueRequest([node](Engine* engine)
+	{
+		if (node < engine->nodeHandles.size())
+			engine->hierarchy.destroy(engine->nodeHandles[node]);
+	});
+}
+
+
+void Engine::enqueueRequest(std::function<void(Engine*)> request) noexcept
+{
+	m_requests.push_back(std::move(request));
+	requestFrame();
+}
+
+
+void Engine::setSceneTexture(ResourceManager::TextureHandle texture) noexcept
+{
+//  The reference is taken now, so the caller may release its own before the renderer picks the request up
+	const bool retained = resources.retain(texture);
+
+	enqueueRequest([texture, retained](Engine* app)
+	{
+		app->resources.release(app->sceneTexture);
+		app->sceneTexture = retained ? texture : ResourceManager::TextureHandle{};
+		++app->sceneTextureVersion;
+	});
+}
+
+
+uint32_t Engine::pick(float x, float y) noexcept
+{
+	vec3s origin, direction;
+	camera.getPickRay(x, y, &origin, &direction);
+
+//  Bounds of the last frame the renderer drew
+	std::lock_guard<std::mutex> lock(sceneLock);
+
+	const auto hit = sceneBounds.raycast(origin, direction, PICK_DISTANCE);
+
+	if (hit.proxy == BoundingVolumeHierarchy::INVALID_PROXY)
+		return UINT32_MAX;
+
+	const uint32_t instance = sceneBounds.getUserData(hit.proxy);
+
+	return (instance < sceneObjects.size()) ? sceneObjects[instance] : UINT32_MAX;
+}
+
+
+void Engine::requestFrame() noexcept
+{
+//  Streaming requests made by a frame reach the application thread a frame later, the extra frames pick them up
+	m_redrawFrames = MAX_FRAMES_IN_FLIGHT + 1;
+}
+
+
+bool Engine::needsFrame() const noexcept
+{
+	if (!onDemand.enabled || onDemand.animating || m_redrawFrames > 0 || streamingActive.load(std::memory_order_relaxed))
+		return true;
+
+	if (camera.getVersion() != m_drawnCameraVersion)
+		return true;
+
+	return (onDemand.keepAlive > 0.f && getIdleTimeout() <= 0.f);
+}
+
+
+float Engine::getIdleTimeout() const noexcept
+{
+	if (onDemand.keepAlive <= 0.f)
+		return 1.f; // no keep-alive frames, only wake up now and then to check for changes
+
+	const auto elapsed = std::chrono::steady_clock::now() - m_lastFrameTime;
+
+	return std::max(onDemand.keepAlive - std::chrono::duration<float>(elapsed).count(), 0.f);
+}
+
+
+void Engine::renderPacket(FramePacket& packet) noexcept
+{
+	if (packet.resized)
+	{
+		m_width  = static_cast<int32_t>(packet.extent.width);
+		m_height = static_cast<int32_t>(packet.extent.height);
+		m_framebufferResized = true;
+	}
+
+	for (const auto& delta : packet.instanceDeltas)
+	{
+		if (delta.index < instances.size())
+		{
+			transforms.setPosition(instances[delta.index], delta.position);
+			transforms.setRotation(instances[delta.index], glms_quatv(glm_rad(delta.angle), ROTATION_AXIS));
+		}
+	}
+
+	for (auto& request : packet.requests)
+		request(this);
+
+	draw_frame(this, packet.camera);
 }
 
 
@@ -84,47 +360,130 @@ void Engine::destroy() noexcept
 {
 	VkDevice device = context.device;
 
+	renderThread.stop();
+	sceneBounds.waitRebuild();
+	jobs.shutdown();
+
+	{
+		std::lock_guard<std::mutex> lock(context.queueLock);
+		vkDeviceWaitIdle(device);
+	}
+
+	for (auto& buffer : cameraBuffers)
+		buffer.destroy(device);
+
+	for (auto& buffer : instanceBuffers)
+		buffer.destroy(device);
+
+	for (auto& buffer : drawLists)
+		buffer.destroy(device);
+
+	occlusionCuller.destroy(device);
+	depthPyramid.destroy(device);
+	resources.destroy(device);
 	bufferHolder.destroy(device);
 	texture.destroy(device);
+	textureStreamer.destroy(device);
+	deletionQueue.flushAll(device);
 	sync.destroy(device);
 	commandPool.destroy(device);
+	commandCache.destroy(device);
 	descriptorPool.destroy(device);
 	pipeline.destroy(device);
+	context.samplers.release(textureSampler, device);
 
 	view.destroy();
 	context.destroy();
+	assets.close();
 }
 
 
 void Engine::resize(int width, int height) noexcept
 {
-	m_width = width;
-	m_height = height;
-	m_framebufferResized = true;
+	m_requestedExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	m_resizeRequested = true;
+	requestFrame();
+
+//  Copies handed to the render thread then carry a projection that is already up to date
+	if (height > 0)
+		camera.setAspectRatio(width / static_cast<float>(height));
 }
 
 
 bool init_vulkan(Engine* app) noexcept
 {
 	VkDevice device = app->context.device;
+	JobSystem& jobs = app->jobs;
 
-	{// Pipeline
-		std::array<Shader, 2> shaders = { Shader(device), Shader(device) };
+//  Startup as a dependency graph: file reads, image decoding and pipeline compilation run on the workers
+//  while this thread creates the remaining objects, then every GPU upload goes out in a single submission
+	std::atomic<bool> failed = false;
 
-		if(!shaders[0].loadFromFile("res/shaders/vertex_shader.spv", VK_SHADER_STAGE_VERTEX_BIT))
-			return false;
+//  One file open and one mapping for every packed asset, loose files are the fallback
+	const AssetPack* pack = app->assets.open("res/assets.pack") ? &app->assets : nullptr;
 
-		if(!shaders[1].loadFromFile("res/shaders/fragment_shader.spv", VK_SHADER_STAGE_FRAGMENT_BIT))
-			return false;
+//  Baked into the descriptor set layout, so it has to exist before the pipeline job starts
+	app->textureSampler = app->context.samplers.acquire(SamplerCache::getDefaultInfo(app->context.GPU), device);
+
+	if(!app->textureSampler)
+		return false;
+
+	std::array<Shader, 2> shaders = { Shader(device), Shader(device) };
+	std::array<Shader, 2> computeShaders = { Shader(device), Shader(device) }; // depth reduction, occlusion culling
+	Image containerImage;
+	MeshBlob cookedMesh;
+	bool useCookedImage = false;
+	bool useCookedMesh  = false;
+
+	Job* vertexShaderJob = jobs.createJob([pack, &shaders, &failed]()
+	{
+		const bool loaded = pack ? shaders[0].loadFromPack(*pack, "shaders/vertex_shader.spv", VK_SHADER_STAGE_VERTEX_BIT) 
+		                         : shaders[0].loadFromFile("res/shaders/vertex_shader.spv", VK_SHADER_STAGE_VERTEX_BIT);
+		if(!loaded)
+			failed = true;
+	});
+
+	Job* fragmentShaderJob = jobs.createJob([pack, &shaders, &failed]()
+	{
+		const bool loaded = pack ? shaders[1].loadFromPack(*pack, "shaders/fragment_shader.spv", VK_SHADER_STAGE_FRAGMENT_BIT) 
+		                         : shaders[1].loadFromFile("res/shaders/fragment_shader.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		if(!loaded)
+			failed = true;
+	});
+
+	Job* computeShaderJob = jobs.createJob([pack, &computeShaders, &failed]()
+	{
+		const bool loaded = pack ? computeShaders[0].loadFromPack(*pack, "shaders/depth_reduce.spv", VK_SHADER_STAGE_COMPUTE_BIT) &&
+		                           computeShaders[1].loadFromPack(*pack, "shaders/occlusion_cull.spv", VK_SHADER_STAGE_COMPUTE_BIT)
+		                         : computeShaders[0].loadFromFile("res/shaders/depth_reduce.spv", VK_SHADER_STAGE_COMPUTE_BIT) &&
+		                           computeShaders[1].loadFromFile("res/shaders/occlusion_cull.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		if(!loaded)
+			failed = true;
+	});
+
+//  Cooked assets from star_dust_cook are preferred, the source files are the fallback
+	Job* meshJob = jobs.createJob([pack, &cookedMesh, &useCookedMesh]()
+	{
+		useCookedMesh = pack ? cookedMesh.loadFromPack(*pack, "meshes/cube.mesh") 
+		                     : cookedMesh.loadFromFile("res/cooked/meshes/cube.mesh");
+	});
+
+	Job* pipelineJob = jobs.createJob([app, &shaders, &failed, &useCookedMesh]()
+	{
+		if (failed)
+			return;
 
         std::array<const VertexInputState::AttributeType, 2> attributes =
         {
-            VertexInputState::Float3,
-            VertexInputState::Float2
+            useCookedMesh ? VertexInputState::Half4 : VertexInputState::Float3,
+            useCookedMesh ? VertexInputState::Half2 : VertexInputState::Float2
         };
 
         DescriptorSetLayout uniformDescriptors;
-        uniformDescriptors.addDescriptor(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+        uniformDescriptors.addImmutableSampler(app->textureSampler, VK_SHADER_STAGE_FRAGMENT_BIT);
+        uniformDescriptors.addDescriptor(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+        uniformDescriptors.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+        uniformDescriptors.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT); // occlusion culling draw list
 
         GraphicsPipeline::State pipelineState;
         pipelineState.setupShaderStages(shaders, attributes);
@@ -135,55 +494,75 @@ bool init_vulkan(Engine* app) noexcept
         pipelineState.setupColorBlending(VK_FALSE);
         pipelineState.layoutInfo = uniformDescriptors;
 
-        bool result = app->pipeline.create(pipelineState, app->view);
-            
-		if(!result)
-			return false;
-	}
+		if(!app->pipeline.create(pipelineState, app->view))
+			failed = true;
+	});
 
-	{// Descriptors
-		std::array<VkDescriptorPoolSize, 1> poolSizes = 
+//  The cooked texture is kept by the engine, its finer levels are read again whenever they are streamed in
+	Job* decodeJob = jobs.createJob([app, pack, &containerImage, &useCookedImage, &failed]()
+	{
+		CompressedImage& cookedImage = app->streamedImage;
+
+		useCookedImage = (pack ? cookedImage.loadFromPack(*pack, "textures/container.ktx2") 
+		                       : cookedImage.loadFromFile("res/cooked/textures/container.ktx2")) && cookedImage.isSupported(app->context.GPU);
+
+		if(!useCookedImage && !containerImage.loadFromFile("res/textures/container.jpg"))
+			failed = true;
+	});
+
+	jobs.addDependency(pipelineJob, vertexShaderJob);
+	jobs.addDependency(pipelineJob, fragmentShaderJob);
+	jobs.addDependency(pipelineJob, meshJob);
+
+	jobs.run(pipelineJob);
+	jobs.run(meshJob);
+	jobs.run(vertexShaderJob);
+	jobs.run(fragmentShaderJob);
+	jobs.run(computeShaderJob);
+	jobs.run(decodeJob);
+
+	bool result = true;
+
+	app->deletionQueue.init(&app->context);
+
+	{// Descriptor pool, command pool and synchronization objects do not depend on any job
+		std::array<VkDescriptorPoolSize, 3> poolSizes = 
 		{
 			VkDescriptorPoolSize
 			{
 				.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 				.descriptorCount = MAX_FRAMES_IN_FLIGHT
+			},
+			VkDescriptorPoolSize
+			{
+				.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorCount = MAX_FRAMES_IN_FLIGHT
+			},
+			VkDescriptorPoolSize
+			{
+				.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 2 * MAX_FRAMES_IN_FLIGHT
 			}
 		};
 
-		if(!app->descriptorPool.create(poolSizes, device))
-			return false;
-
-		VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT] = 
-		{ 
-			app->pipeline.descriptorSetLayout, 
-			app->pipeline.descriptorSetLayout 
-		};
-
-		if(!app->descriptorPool.allocateDescriptorSets(app->descriptorSets, layouts, device))
-			return false;	
-	}
+		result = app->descriptorPool.create(poolSizes, device) &&
+		         app->commandPool.create(device, app->context.mainQueueFamilyIndex) &&
+		         app->commandCache.create(device, app->context.mainQueueFamilyIndex, vktools::find_depth_format(app->context.GPU)) &&
+		         app->sync.create(device) &&
+		         app->resources.init(&app->context, &app->deletionQueue, &app->jobs);
 
-	if(!app->commandPool.create(device, app->context.mainQueueFamilyIndex))
-        return false;
+		for (auto& buffer : app->cameraBuffers)
+			result = result && buffer.create(sizeof(CameraUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &app->context);
 
-	if(!app->sync.create(device))
-		return false;
+		const VkDeviceSize instanceBytes = static_cast<VkDeviceSize>(std::max(app->transforms.getCount() + app->hierarchy.getCount(), 1u)) * sizeof(mat4s);
 
-	{
-        if(!app->texture.loadFromFile("res/textures/container.jpg", &app->context, app->commandPool.handle))
-            return false;
-                
-        const VkDescriptorImageInfo imageInfo = 
-        {
-            .sampler     = app->texture.sampler,
-            .imageView   = app->texture.imageView,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-        };
+		for (auto& buffer : app->instanceBuffers)
+			result = result && buffer.create(instanceBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &app->context);
+	}
 
-		app->descriptorPool.writeCombinedImageSampler(&imageInfo, app->descriptorSets[0], 0, device);
-		app->descriptorPool.writeCombinedImageSampler(&imageInfo, app->descriptorSets[1], 0, device);
-    }
+	UploadBatch uploads;
+	MeshSimplifier::Level meshLevels[MeshBlob::MAX_LODS] = {};
+	uint32_t meshLevelCount = 0;
 
 	{
 	    constexpr std::array<float, 120> vertices = 
@@ -229,117 +608,854 @@ bool init_vulkan(Engine* app) noexcept
             20, 21, 22, 22, 23, 20   // bottom
         };
 
-		app->vertices = app->bufferHolder.allocate<float>(vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &app->context, app->commandPool.handle);
-		app->indices = app->bufferHolder.allocate<uint32_t>(indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &app->context, app->commandPool.handle);
+	//  Camera facing quad of the impostor level, in the vertex format of the scene mesh (half floats when cooked)
+		constexpr std::array<float, 20> impostorVertices = 
+		{
+			-0.5f, -0.5f, 0.f, 0.f, 0.f,
+			 0.5f, -0.5f, 0.f, 1.f, 0.f,
+			 0.5f,  0.5f, 0.f, 1.f, 1.f,
+			-0.5f,  0.5f, 0.f, 0.f, 1.f
+		};
 
-		if(!app->vertices.handle)
-			return false;
+		constexpr std::array<uint16_t, 24> impostorHalfVertices = 
+		{
+			0xB800, 0xB800, 0x0000, 0x3C00, 0x0000, 0x0000,
+			0x3800, 0xB800, 0x0000, 0x3C00, 0x3C00, 0x0000,
+			0x3800, 0x3800, 0x0000, 0x3C00, 0x3C00, 0x3C00,
+			0xB800, 0x3800, 0x0000, 0x3C00, 0x0000, 0x3C00
+		};
 
-		if(!app->indices.handle)
-			return false;
-	}
+		constexpr std::array<uint32_t, 6> impostorIndices = { 0, 1, 2, 2, 3, 0 };
 
-	return true;
-}
+		std::vector<uint32_t> lodIndices; // read when the uploads are submitted
 
+		jobs.wait(meshJob);
 
-void update_matrices(Engine* app, vec3s position, float angle) noexcept
-{
-	vec3s axis = { 1.0f, 0.3f, 0.5f };
+		if(useCookedMesh)
+		{
+		//  Vertices and indices share one buffer, the body is copied or decompressed right into staging
+			const VkDeviceSize bodySize = cookedMesh.getBodySize();
+			const Buffer geometry = app->bufferHolder.create(bodySize, cookedMesh.header.vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &app->context);
 
-    mat4s model = glms_translate(glms_mat4_identity(), position);
-    model       = glms_rotate(model, glm_rad(angle), axis);
-    mat4s modelView  = app->camera.getViewMatrix();
-    mat4s projection = glms_perspective(glm_rad(60.f), app->m_width / (float)app->m_height, 0.1f, 100.f);
+			if(geometry.handle)
+				uploads.addBuffer(geometry.handle, bodySize, [&cookedMesh](void* staging) { return cookedMesh.readBody(staging); });
 
-    app->modelViewProjectionMatrix = glms_mat4_mul(glms_mat4_mul(projection, modelView), model);
-}
+		//  'indices' covers level 0 only, the coarser levels follow it in the same buffer
+			app->vertices    = geometry;
+			app->indices     = { geometry.handle, cookedMesh.header.lods[0].indexCount };
+			app->indexOffset = static_cast<VkDeviceSize>(cookedMesh.header.vertexCount) * cookedMesh.header.vertexStride;
+			app->indexType   = (cookedMesh.header.indexSize == 2) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
+			meshLevelCount = cookedMesh.header.lodCount;
 
-void write_command_buffer(Engine* app, VkCommandBuffer cmd, VkDescriptorSet descriptorSet) noexcept
-{
-    VkDeviceSize offsets[] = {0};
-    VkBuffer vertexBuffers[] = {app->vertices.handle};
+			for (uint32_t i = 0; i < meshLevelCount; ++i)
+				meshLevels[i] = { cookedMesh.header.lods[i].firstIndex, cookedMesh.header.lods[i].indexCount, cookedMesh.header.lods[i].error };
 
-    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(cmd, app->indices.handle, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdPushConstants(cmd, app->pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4s), app->modelViewProjectionMatrix.raw);
-    vkCmdDrawIndexed(cmd, app->indices.size, 1, 0, 0, 0);
-}
+			const float* boundsMin = cookedMesh.header.boundsMin;
+			const float* boundsMax = cookedMesh.header.boundsMax;
 
+			app->impostorSize     = std::max({ boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] });
+			app->impostorVertices = app->bufferHolder.allocate<uint16_t>(impostorHalfVertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &app->context, uploads);
+		}
+		else
+		{
+		//  The source mesh is simplified here, star_dust_cook does the same for cooked ones
+			meshLevelCount = MeshSimplifier::buildLevels(vertices.data(), 5 * sizeof(float), static_cast<uint32_t>(vertices.size() / 5), indices,
+			                                             MeshBlob::MAX_LODS, MAX_LOD_ERROR, lodIndices, meshLevels);
 
-void draw_frame(Engine* app) noexcept
-{
-    uint32_t frame  = app->sync.currentFrame;
-    VkDevice device = app->context.device;
-    VkQueue  queue  = app->context.queue;
+			app->vertices = app->bufferHolder.allocate<float>(vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &app->context, uploads);
+			app->indices  = app->bufferHolder.allocate<uint32_t>(lodIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &app->context, uploads);
+			app->indices.size = meshLevels[0].indexCount;
 
-    VkResult result = vkWaitForFences(device, 1, &app->sync.inFlightFences[frame], VK_TRUE, UINT64_MAX);
+			app->impostorVertices = app->bufferHolder.allocate<float>(impostorVertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &app->context, uploads);
+		}
 
-	if (result != VK_SUCCESS)
-    {
-#ifdef DEBUG
-        printf("failed to wait for fences!\n");
-#endif
-		return;
-    }
+		app->impostorIndices = app->bufferHolder.allocate<uint32_t>(impostorIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &app->context, uploads);
 
-    uint32_t imageIndex;
-    result = vkAcquireNextImageKHR(device, app->view.swapchain, UINT64_MAX, app->sync.imageAvailableSemaphores[frame], VK_NULL_HANDLE, &imageIndex);
+		if(!app->vertices.handle || !app->indices.handle || !app->impostorVertices.handle || !app->impostorIndices.handle || meshLevelCount == 0)
+			result = false;
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
-    {
-        vkDeviceWaitIdle(app->context.device);
-		app->view.recreate(true);
+		jobs.wait(decodeJob);
 
-        return;
-    }
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-    {
-#ifdef DEBUG
-        printf("failed to acquire swap chain image!\n");
-#endif
-		return;
-    }
+		if(result && !failed && useCookedImage)
+		{
+		//  Only the mip tail is uploaded now, the rest streams in once the texture shows up on screen
+			result = app->textureStreamer.init(&app->context, &app->jobs, &app->deletionQueue, TextureStreamer::Settings());
 
-    result = vkResetFences(device, 1, &app->sync.inFlightFences[frame]);
+		//  A texture compressed in the pack cannot be read again level by level, its whole chain is expanded into staging now
+			if(result && app->streamedImage.hasLevelData())
+			{
+				app->streamedTexture = app->textureStreamer.add(&app->streamedImage, uploads);
+				result = (app->streamedTexture != TextureStreamer::INVALID_TEXTURE);
+			}
+			else if(result)
+			{
+				result = app->texture.loadFromCompressed(app->streamedImage, &app->context, uploads);
+			}
+		}
+		else if(result && !failed)
+		{
+			result = app->texture.loadFromImage(containerImage, &app->context, uploads);
+		}
 
-	if (result != VK_SUCCESS)
-    {
-#ifdef DEBUG
-        printf("failed to reset fences!\n");
-#endif
-		return;
-    }
+		if(result && !failed)
+			result = uploads.submit(&app->context, app->commandPool.handle);
+	}
 
-    VkCommandBuffer commandBuffer = app->commandPool.commandBuffers[frame];
-    VkDescriptorSet descriptorSet = app->descriptorSets[frame];
+//  The shaders, the decoded image and the cooked assets live on this stack frame, never leave before the jobs are done
+	jobs.wait(pipelineJob);
+	jobs.wait(decodeJob);
+	jobs.wait(computeShaderJob);
 
-    result = vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+	if(!result || failed)
+		return false;
 
-	if (result != VK_SUCCESS)
-    {
-#ifdef DEBUG
-        printf("failed to reset command buffers!\n");
-#endif
-		return;
-    }
+	{// Occlusion culling, off until enabled but its draw list is always bound
+		const uint32_t instanceCount = app->transforms.getCount() + app->hierarchy.getCount();
 
-    if(!app->renderer.begin(commandBuffer, &app->view, imageIndex))
-        return;
+		if(!app->depthPyramid.create(&app->context, computeShaders[0], &app->deletionQueue) ||
+		   !app->occlusionCuller.create(&app->context, computeShaders[1], app->depthPyramid, &app->deletionQueue) ||
+		   !app->occlusionCuller.reserve(instanceCount))
+			return false;
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.handle);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->pipeline.layout, 0, 1, &descriptorSet, 0, VK_NULL_HANDLE);
+		if(!app->occlusionRasterizer.create(OCCLUSION_WIDTH, OCCLUSION_HEIGHT))
+			return false;
+	}
 
-    for (uint32_t i = 0; i < 10; ++i)
-    {
-        const float angle = 20.f * i;
-        update_matrices(app, cubePositions[i], angle);
-        write_command_buffer(app, commandBuffer, descriptorSet);
-    }
+	{// Descriptors
+		VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT] = 
+		{ 
+			app->pipeline.descriptorSetLayout, 
+			app->pipeline.descriptorSetLayout 
+		};
 
-    if(!app->renderer.end(commandBuffer, &app->view, imageIndex))
-        return;
+		if(!app->descriptorPool.allocateDescriptorSets(app->descriptorSets, layouts, device))
+			return false;	
+
+        const Texture2D& texture = get_bound_texture(app);
+
+        const VkDescriptorImageInfo imageInfo = 
+        {
+            .sampler     = texture.sampler,
+            .imageView   = texture.imageView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			const VkDescriptorBufferInfo bufferInfo = 
+			{
+				.buffer = app->cameraBuffers[i].handle,
+				.offset = 0,
+				.range  = sizeof(CameraUniforms)
+			};
+
+			const VkDescriptorBufferInfo instanceInfo = 
+			{
+				.buffer = app->instanceBuffers[i].handle,
+				.offset = 0,
+				.range  = VK_WHOLE_SIZE
+			};
+
+			const VkDescriptorBufferInfo drawListInfo = 
+			{
+				.buffer = app->occlusionCuller.getDrawList(i),
+				.offset = 0,
+				.range  = VK_WHOLE_SIZE
+			};
+
+			app->descriptorPool.writeCombinedImageSampler(&imageInfo, app->descriptorSets[i], 0, device);
+			app->descriptorPool.writeUniformBuffer(&bufferInfo, app->descriptorSets[i], 1, device);
+			app->descriptorPool.writeStorageBuffer(&instanceInfo, app->descriptorSets[i], 2, device);
+			app->descriptorPool.writeStorageBuffer(&drawListInfo, app->descriptorSets[i], 3, device);
+			app->drawListVersions[i] = app->occlusionCuller.getVersion();
+
+			if (app->streamedTexture != TextureStreamer::INVALID_TEXTURE)
+				app->textureVersions[i] = app->textureStreamer.getVersion(app->streamedTexture);
+
+			app->sceneTextureVersions[i] = get_scene_texture_version(app);
+		}
+	}
+
+	{// Render queue states, draws refer to them by id
+		app->scenePipeline = app->renderQueue.addPipeline(app->pipeline.handle, app->pipeline.layout);
+		app->sceneMaterial = app->renderQueue.addMaterial(app->descriptorSets);
+
+	//  One mesh per level of detail, all of them share the vertices. Level 0 is also the mesh of the GPU culled draws
+		const VkDeviceSize indexSize = (app->indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+		float errors[MeshBlob::MAX_LODS];
+
+		for (uint32_t i = 0; i < meshLevelCount; ++i)
+		{
+			app->sceneLevels[i] = app->renderQueue.addMesh(
+			{
+				.vertices     = app->vertices.handle,
+				.vertexOffset = 0,
+				.indices      = app->indices.handle,
+				.indexOffset  = app->indexOffset + meshLevels[i].firstIndex * indexSize,
+				.indexType    = app->indexType,
+				.indexCount   = meshLevels[i].indexCount
+			});
+
+			errors[i] = meshLevels[i].error;
+
+			if (app->sceneLevels[i] == RenderQueue::INVALID_ID)
+				return false;
+		}
+
+		app->sceneLevels[meshLevelCount] = app->renderQueue.addMesh(
+		{
+			.vertices     = app->impostorVertices.handle,
+			.vertexOffset = 0,
+			.indices      = app->impostorIndices.handle,
+			.indexOffset  = 0,
+			.indexType    = VK_INDEX_TYPE_UINT32,
+			.indexCount   = app->impostorIndices.size
+		});
+
+		app->sceneMesh = app->sceneLevels[0];
+
+		if (app->scenePipeline == RenderQueue::INVALID_ID || app->sceneMaterial == RenderQueue::INVALID_ID || app->sceneLevels[meshLevelCount] == RenderQueue::INVALID_ID)
+			return false;
+
+		if (!app->levelOfDetail.setLevels({ errors, meshLevelCount }, CUBE_RADIUS))
+			return false;
+	}
+
+	app->publishCamera();
+
+	return true;
+}
+
+
+bool update_instances(Engine* app, uint32_t frame) noexcept
+{
+//  Only the subtrees that changed since the last frame are recomputed
+    app->hierarchy.update(&app->jobs);
+
+    const uint32_t flatCount = app->transforms.getCount();
+
+    MappedBuffer& buffer = app->instanceBuffers[frame];
+    const VkDeviceSize required = static_cast<VkDeviceSize>(flatCount + app->hierarchy.getCount()) * sizeof(mat4s);
+
+//  The scene outgrew the buffer: frames in flight keep the old one, this slot's descriptor set is free to rewrite
+    if (buffer.size < required)
+    {
+        app->deletionQueue.destroyBuffer(buffer.handle, buffer.memory);
+        buffer = {};
+
+        if (!buffer.create(required * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &app->context))
+            return false;
+
+        const VkDescriptorBufferInfo instanceInfo = 
+        {
+            .buffer = buffer.handle,
+            .offset = 0,
+            .range  = VK_WHOLE_SIZE
+        };
+
+        app->descriptorPool.writeStorageBuffer(&instanceInfo, app->descriptorSets[frame], 2, app->context.device);
+        ++app->descriptorVersions[frame];
+        app->hierarchyVersions[frame] = UINT64_MAX;
+    }
+
+    mat4s* matrices = static_cast<mat4s*>(buffer.data);
+
+//  Four matrices at a time on every worker. Mapped memory is uncached and the scene bounds are taken from every
+//  matrix, so they are built in system memory and copied
+    try
+    {
+        app->worldMatrices.resize(flatCount + app->hierarchy.getCount());
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    app->transforms.computeWorldMatrices(app->worldMatrices.data(), &app->jobs);
+    memcpy(matrices, app->worldMatrices.data(), flatCount * sizeof(mat4s));
+    memcpy(app->worldMatrices.data() + flatCount, app->hierarchy.getWorldMatrices(), app->hierarchy.getCount() * sizeof(mat4s));
+
+//  The hierarchy is already laid out contiguously, the copy is skipped while this slot holds its current version
+    if (app->hierarchyVersions[frame] != app->hierarchy.getVersion() || app->hierarchyOffsets[frame] != flatCount)
+    {
+        memcpy(matrices + flatCount, app->hierarchy.getWorldMatrices(), app->hierarchy.getCount() * sizeof(mat4s));
+
+        app->hierarchyVersions[frame] = app->hierarchy.getVersion();
+        app->hierarchyOffsets[frame]  = flatCount;
+    }
+
+    return true;
+}
+
+
+bool update_scene_bounds(Engine* app) noexcept
+{
+    const uint32_t flatCount     = app->transforms.getCount();
+    const uint32_t instanceCount = flatCount + app->hierarchy.getCount();
+
+    std::vector<uint32_t>& proxies = app->sceneProxies;
+    std::vector<uint32_t>& objects = app->sceneObjects;
+
+    try
+    {
+        app->instanceBounds.resize(instanceCount);
+        proxies.reserve(instanceCount);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+//  Boxes of the transformed cube on the workers, the tree itself only changes on this thread
+    const mat4s* matrices = app->worldMatrices.data();
+    Aabb*        bounds   = app->instanceBounds.data();
+    const uint32_t grain  = std::max(256u, instanceCount / ((app->jobs.getWorkerCount() + 1) * 8));
+
+    app->jobs.parallelFor(instanceCount, grain, [matrices, bounds](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+            bounds[i] = instance_bounds(matrices[i]);
+    });
+
+    BoundingVolumeHierarchy& tree = app->sceneBounds;
+
+    std::lock_guard<std::mutex> lock(app->sceneLock);
+
+    while (proxies.size() > instanceCount)
+    {
+        tree.remove(proxies.back());
+        proxies.pop_back();
+    }
+
+    for (uint32_t i = static_cast<uint32_t>(proxies.size()); i < instanceCount; ++i)
+    {
+        const uint32_t proxy = tree.insert(bounds[i], i);
+
+        if (proxy == BoundingVolumeHierarchy::INVALID_PROXY)
+            return false;
+
+        proxies.push_back(proxy);
+    }
+
+//  Only what moved is refitted, rebuilds run on a thread of their own
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+        if (memcmp(&tree.getBox(proxies[i]), &bounds[i], sizeof(Aabb)) != 0)
+            tree.move(proxies[i], bounds[i]);
+    }
+
+    tree.update();
+
+//  Ids for pick(): instances by their setInstance() index, nodes by their createNode() id
+    const bool resized = (objects.size() != instanceCount);
+
+    if (resized)
+    {
+        try
+        {
+            objects.assign(instanceCount, UINT32_MAX);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < app->instances.size(); ++i)
+        {
+            const uint32_t dense = app->transforms.getDenseIndex(app->instances[i]);
+
+            if (dense < flatCount)
+                objects[dense] = i;
+        }
+    }
+
+    if (resized || app->sceneObjectsVersion != app->hierarchy.getVersion())
+    {
+        std::fill(objects.begin() + flatCount, objects.end(), UINT32_MAX);
+
+        for (uint32_t node = 0; node < app->nodeHandles.size(); ++node)
+        {
+            const uint32_t world = app->hierarchy.getWorldIndex(app->nodeHandles[node]);
+
+            if (world < instanceCount - flatCount)
+                objects[flatCount + world] = Engine::PICKED_NODE | node;
+        }
+
+        app->sceneObjectsVersion = app->hierarchy.getVersion();
+    }
+
+    return true;
+}
+
+
+bool update_frustum_culling(Engine* app, Camera& camera) noexcept
+{
+    const uint32_t instanceCount = app->transforms.getCount() + app->hierarchy.getCount();
+
+    try
+    {
+        app->inView.resize(instanceCount);
+        app->visibility.assign(instanceCount, 0);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+//  Every instance has one proxy, so the query cannot return more than there is room for
+    uint32_t* inView = app->inView.data();
+
+    {
+        std::lock_guard<std::mutex> lock(app->sceneLock);
+
+        app->inViewCount = std::min(app->sceneBounds.queryFrustum(camera.getFrustum(), inView, instanceCount), instanceCount);
+
+        for (uint32_t i = 0; i < app->inViewCount; ++i)
+            inView[i] = app->sceneBounds.getUserData(inView[i]);
+    }
+
+    for (uint32_t i = 0; i < app->inViewCount; ++i)
+        app->visibility[inView[i]] = 1;
+
+    return true;
+}
+
+
+void write_command_buffer(Engine* app, VkCommandBuffer cmd, uint32_t frame) noexcept
+{
+    RenderQueue& queue = app->renderQueue;
+    const uint32_t instanceCount = app->transforms.getCount() + app->hierarchy.getCount();
+    const DrawConstants constants = { .useDrawList = 0, .impostorFirst = UINT32_MAX, .impostorSize = app->impostorSize };
+
+    queue.clear();
+
+//  Every object shares the cube mesh and the one material, a single instanced draw covers them all
+    queue.push(0, false, app->scenePipeline, app->sceneMaterial, app->sceneMesh, 0.f, 0, instanceCount);
+    queue.sort();
+
+    vkCmdPushConstants(cmd, app->pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    queue.record(cmd, frame);
+    app->drawStats.write(queue.getStats());
+}
+
+
+bool update_software_occlusion(Engine* app, Camera& camera) noexcept
+{
+    OcclusionRasterizer& rasterizer = app->occlusionRasterizer;
+
+    const mat4s*    matrices       = app->worldMatrices.data();
+    const Aabb*     bounds         = app->instanceBounds.data();
+    const uint32_t* inView         = app->inView.data();
+    const uint32_t  inViewCount    = app->inViewCount;
+    const mat4s&    viewProjection = camera.getViewProjectionMatrix();
+
+    app->occluderCandidates.clear();
+
+//  Occluders: the objects in view closest to the camera, by clip space w (the view depth)
+    for (uint32_t k = 0; k < inViewCount; ++k)
+    {
+        const uint32_t i    = inView[k];
+        const mat4s& matrix = matrices[i];
+
+        const float depth = viewProjection.raw[0][3] * matrix.raw[3][0] + viewProjection.raw[1][3] * matrix.raw[3][1] +
+                            viewProjection.raw[2][3] * matrix.raw[3][2] + viewProjection.raw[3][3];
+
+        try
+        {
+            app->occluderCandidates.emplace_back(depth, i);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+    }
+
+    auto& candidates = app->occluderCandidates;
+
+    if (candidates.size() > MAX_OCCLUDERS)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + MAX_OCCLUDERS, candidates.end());
+        candidates.resize(MAX_OCCLUDERS);
+    }
+
+    rasterizer.begin(viewProjection);
+
+    for (const auto& [depth, instance] : candidates)
+    {
+        const OcclusionRasterizer::Occluder occluder = 
+        {
+            .positions  = occluderCorners[0],
+            .stride     = sizeof(occluderCorners[0]),
+            .indices    = occluderIndices,
+            .indexCount = static_cast<uint32_t>(std::size(occluderIndices)),
+            .model      = matrices[instance]
+        };
+
+        if (!rasterizer.addOccluder(occluder))
+            return false;
+    }
+
+    rasterizer.render(&app->jobs);
+
+//  Every object in view, occluders included, against the finished buffer
+    uint8_t* visibility = app->visibility.data();
+
+//  About eight chunks per thread, so a million instances stay far below the job pool size
+    const uint32_t grain = std::max(256u, inViewCount / ((app->jobs.getWorkerCount() + 1) * 8));
+
+    app->jobs.parallelFor(inViewCount, grain, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t k = begin; k < end; ++k)
+            visibility[inView[k]] = rasterizer.isVisible(bounds[inView[k]]);
+    });
+
+    return true;
+}
+
+
+bool update_draw_list(Engine* app, uint32_t frame, Camera& camera, bool lod) noexcept
+{
+    const uint32_t instanceCount = app->transforms.getCount() + app->hierarchy.getCount();
+    const uint8_t* visibility    = app->visibility.data();
+
+    MappedBuffer& list = app->drawLists[frame];
+    const VkDeviceSize required = static_cast<VkDeviceSize>(std::max(instanceCount, 1u)) * sizeof(uint32_t);
+
+//  Same growth as the instance buffers, the new list is bound by update_culling()
+    if (list.size < required)
+    {
+        app->deletionQueue.destroyBuffer(list.handle, list.memory);
+        list = {};
+
+        if (!list.create(required * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &app->context))
+            return false;
+
+        app->drawListVersions[frame] = UINT64_MAX;
+    }
+
+    auto* indices = static_cast<uint32_t*>(list.data);
+
+    app->drawRanges = {};
+
+    if (lod)
+    {
+        LevelOfDetail& levels = app->levelOfDetail;
+
+        if (!levels.reserve(instanceCount))
+            return false;
+
+//      The projection scales an object unit at depth 1 to clip units, half the viewport height makes them pixels
+        const float pixelScale = camera.getProjectionMatrix().raw[1][1] * app->m_height * 0.5f;
+
+        levels.settings.pixelError = app->lodPixelError;
+        levels.select(app->worldMatrices.data(), instanceCount, visibility, camera.getViewProjectionMatrix(), pixelScale, indices, &app->jobs);
+
+        for (uint32_t level = 0; level <= levels.getImpostorLevel(); ++level)
+            app->drawRanges[level] = levels.getRange(level);
+    }
+    else
+    {
+        uint32_t count = 0;
+
+        for (uint32_t i = 0; i < instanceCount; ++i)
+            if (visibility[i])
+                indices[count++] = i;
+
+        app->drawRanges[0] = { 0, count };
+    }
+
+    return true;
+}
+
+
+void write_draw_list_commands(Engine* app, VkCommandBuffer cmd, uint32_t frame) noexcept
+{
+    RenderQueue& queue = app->renderQueue;
+    const uint32_t impostor = app->levelOfDetail.getImpostorLevel();
+    const LevelOfDetail::Range& impostors = app->drawRanges[impostor];
+
+    const DrawConstants constants = 
+    {
+        .useDrawList   = 1,
+        .impostorFirst = impostors.count ? impostors.first : UINT32_MAX,
+        .impostorSize  = app->impostorSize
+    };
+
+    queue.clear();
+
+//  One instanced draw per level, gl_InstanceIndex walks the level's range of the draw list
+    for (uint32_t level = 0; level <= impostor; ++level)
+    {
+        const LevelOfDetail::Range& range = app->drawRanges[level];
+
+        if (range.count)
+            queue.push(0, false, app->scenePipeline, app->sceneMaterial, app->sceneLevels[level], 0.f, range.first, range.count);
+    }
+
+    queue.sort();
+
+    vkCmdPushConstants(cmd, app->pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    queue.record(cmd, frame);
+    app->drawStats.write(queue.getStats());
+}
+
+
+bool update_culling(Engine* app, uint32_t frame, bool occlusion, bool drawList) noexcept
+{
+    OcclusionCuller& culler = app->occlusionCuller;
+
+    if (occlusion)
+    {
+        if (!culler.reserve(app->transforms.getCount() + app->hierarchy.getCount()))
+            return false;
+
+        if (!app->depthPyramid.prepare(frame, app->view))
+            return false;
+
+//      Visibility left over from before culling was turned off no longer matches the scene
+        if (!app->occlusionActive)
+            culler.resetVisibility();
+    }
+
+//  Binding 3 is statically used by the vertex shader, it must follow the culler even while culling is off
+    if (app->drawListVersions[frame] != culler.getVersion() || app->drawListBound[frame] != drawList)
+    {
+        const VkDescriptorBufferInfo drawListInfo = 
+        {
+            .buffer = drawList ? app->drawLists[frame].handle : culler.getDrawList(frame),
+            .offset = 0,
+            .range  = VK_WHOLE_SIZE
+        };
+
+        app->descriptorPool.writeStorageBuffer(&drawListInfo, app->descriptorSets[frame], 3, app->context.device);
+        app->drawListVersions[frame] = culler.getVersion();
+        app->drawListBound[frame]    = drawList;
+        ++app->descriptorVersions[frame];
+    }
+
+    return true;
+}
+
+
+void write_culled_commands(Engine* app, VkCommandBuffer cmd, uint32_t frame, OcclusionCuller::Phase phase) noexcept
+{
+    RenderQueue& queue = app->renderQueue;
+    const OcclusionCuller& culler = app->occlusionCuller;
+    const DrawConstants constants = { .useDrawList = 1, .impostorFirst = UINT32_MAX, .impostorSize = app->impostorSize };
+
+    queue.clear();
+
+//  Instance count and range were written by the culling pass of this phase
+    queue.pushIndirect(0, false, app->scenePipeline, app->sceneMaterial, app->sceneMesh, 0.f, culler.getDrawCommands(frame), culler.getDrawOffset(phase));
+    queue.sort();
+
+    vkCmdPushConstants(cmd, app->pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    queue.record(cmd, frame);
+    app->drawStats.write(queue.getStats());
+}
+
+
+bool record_occlusion(Engine* app, VkCommandBuffer cmd, uint32_t frame, uint32_t imageIndex) noexcept
+{
+    OcclusionCuller& culler = app->occlusionCuller;
+    DepthPyramid& pyramid   = app->depthPyramid;
+
+    const OcclusionCuller::Inputs inputs = 
+    {
+        .camera         = app->cameraBuffers[frame].handle,
+        .instances      = app->instanceBuffers[frame].handle,
+        .instanceCount  = app->transforms.getCount() + app->hierarchy.getCount(),
+        .boundingRadius = CUBE_RADIUS
+    };
+
+    culler.begin(cmd, frame, app->indices.size);
+    culler.cull(cmd, frame, OcclusionCuller::PHASE_EARLY, inputs, pyramid);
+
+//  Early phase: what was visible last frame, its depth is kept for the pyramid
+    if (!app->renderer.begin(cmd, &app->view, imageIndex))
+        return false;
+
+    write_culled_commands(app, cmd, frame, OcclusionCuller::PHASE_EARLY);
+    app->renderer.suspend(cmd);
+
+//  Late phase: whatever the early depth does not hide and was not drawn yet
+    pyramid.build(cmd, frame, app->view);
+    culler.cull(cmd, frame, OcclusionCuller::PHASE_LATE, inputs, pyramid);
+
+    if (!app->renderer.resume(cmd, &app->view, imageIndex))
+        return false;
+
+    write_culled_commands(app, cmd, frame, OcclusionCuller::PHASE_LATE);
+
+    return true;
+}
+
+
+bool record_scene(Engine* app, uint32_t frame, bool drawList) noexcept
+{
+    const CommandCache::Key key = 
+    {
+        .pipeline          = app->pipeline.handle,
+        .descriptorSet     = app->descriptorSets[frame],
+        .descriptorVersion = app->descriptorVersions[frame],
+        .instanceCount     = app->transforms.getCount() + app->hierarchy.getCount(),
+        .extent            = app->view.extent,
+        .colorFormat       = app->view.format,
+        .drawRanges        = drawList ? hash_draw_ranges(app->drawRanges) : 0
+    };
+
+    if (app->commandCache.isValid(frame, key))
+        return true;
+
+    VkCommandBuffer cmd = app->commandCache.begin(frame, key);
+
+    if (cmd == VK_NULL_HANDLE)
+        return false;
+
+//  Dynamic state is not inherited from the primary buffer
+    app->renderer.setViewport(cmd, key.extent);
+
+    if (drawList)
+        write_draw_list_commands(app, cmd, frame);
+    else
+        write_command_buffer(app, cmd, frame);
+
+    return app->commandCache.end(frame);
+}
+
+
+void draw_frame(Engine* app, Camera& camera) noexcept
+{
+    uint32_t frame  = app->sync.currentFrame;
+    VkDevice device = app->context.device;
+    VkQueue  queue  = app->context.queue;
+
+    if (app->m_width == 0 || app->m_height == 0)
+        return; // minimized, nothing to present
+
+    VkResult result = vkWaitForFences(device, 1, &app->sync.inFlightFences[frame], VK_TRUE, UINT64_MAX);
+
+	if (result != VK_SUCCESS)
+    {
+#ifdef DEBUG
+        printf("failed to wait for fences!\n");
+#endif
+		return;
+    }
+
+    app->view.releaseRetired(app->sync.completedFrames());
+    app->deletionQueue.flush(device, app->sync.frameNumber, app->sync.completedFrames());
+
+    uint32_t imageIndex;
+    result = vkAcquireNextImageKHR(device, app->view.swapchain, UINT64_MAX, app->sync.imageAvailableSemaphores[frame], VK_NULL_HANDLE, &imageIndex);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        recreate_swapchain(app);
+
+        return;
+    }
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+#ifdef DEBUG
+        printf("failed to acquire swap chain image!\n");
+#endif
+		return;
+    }
+
+    VkCommandBuffer commandBuffer = app->commandPool.commandBuffers[frame];
+
+    result = vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+
+	if (result != VK_SUCCESS)
+    {
+#ifdef DEBUG
+        printf("failed to reset command buffers!\n");
+#endif
+		return;
+    }
+
+//  CPU culling decides what is drawn with this camera, the uniforms cannot change after it ran
+    const bool software = app->softwareOcclusion;
+
+    if (!app->lateLatch || software)
+        write_camera_uniforms(app, frame, camera);
+
+    if(!app->renderer.open(commandBuffer))
+        return;
+
+//  World matrices first, the texture feedback reads them
+    if(!update_instances(app, frame) || !update_scene_bounds(app))
+        return;
+
+    update_streaming(app, commandBuffer, frame, camera);
+    update_texture_binding(app, frame);
+
+    if (app->streamedTexture != TextureStreamer::INVALID_TEXTURE)
+        app->streamingActive.store(!app->textureStreamer.isSettled(), std::memory_order_relaxed);
+
+//  Both culling phases and the pyramid between them are recorded inline, the command cache is bypassed.
+//  Otherwise the CPU writes the draw list whenever it culls or picks levels of detail
+    const bool occlusion = !software && app->occlusionCulling && app->view.depth.sampled;
+    const bool lod       = !occlusion && app->levelSelection;
+    const bool drawList  = software || lod;
+    const bool cached    = app->commandCaching && !occlusion && !software;
+
+//  Whatever the CPU draws is culled against the frustum through the scene bounds first
+    if(drawList && !update_frustum_culling(app, camera))
+        return;
+
+    if(software && !update_software_occlusion(app, camera))
+        return;
+
+    if(drawList && !update_draw_list(app, frame, camera, lod))
+        return;
+
+    if(!update_culling(app, frame, occlusion, drawList))
+        return;
+
+    app->renderer.keepDepth = occlusion;
+    app->occlusionActive    = occlusion;
+
+    if (occlusion)
+    {
+        if (!record_occlusion(app, commandBuffer, frame, imageIndex))
+            return;
+    }
+    else
+    {
+        if(!app->renderer.begin(commandBuffer, &app->view, imageIndex, cached ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0))
+            return;
+
+        if (cached)
+        {
+//          Re-recorded only when the slot's key changed, otherwise the previous recording is replayed
+            if (!record_scene(app, frame, drawList))
+                return;
+
+            vkCmdExecuteCommands(commandBuffer, 1, &app->commandCache.commandBuffers[frame]);
+        }
+        else if (drawList)
+        {
+            write_draw_list_commands(app, commandBuffer, frame);
+        }
+        else
+        {
+            write_command_buffer(app, commandBuffer, frame);
+        }
+    }
+
+    if(!app->renderer.end(commandBuffer, &app->view, imageIndex))
+        return;
+
+    if (app->lateLatch && !software)
+    {
+//      Recording is done: pick up whatever input arrived in the meantime
+        Camera latest = camera;
+        app->cameraLatch.read(latest);
+        write_camera_uniforms(app, frame, latest);
+    }
 
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 	
@@ -356,7 +1472,22 @@ void draw_frame(Engine* app) noexcept
 		.pSignalSemaphores    = &app->sync.renderFinishedSemaphores[frame]
 	};
 
-	result = vkQueueSubmit(queue, 1, &submitInfo, app->sync.inFlightFences[frame]);
+//  Reset only now: any earlier return would leave the fence unsignaled and the next wait on this slot would never end
+    result = vkResetFences(device, 1, &app->sync.inFlightFences[frame]);
+
+	if (result != VK_SUCCESS)
+    {
+#ifdef DEBUG
+        printf("failed to reset fences!\n");
+#endif
+		return;
+    }
+
+//  Loads on other threads submit uploads to the same queue
+    {
+        std::lock_guard<std::mutex> lock(app->context.queueLock);
+        result = vkQueueSubmit(queue, 1, &submitInfo, app->sync.inFlightFences[frame]);
+    }
 
     if (result != VK_SUCCESS)
     {
@@ -366,6 +1497,8 @@ void draw_frame(Engine* app) noexcept
 		return;
     }
 
+    ++app->sync.frameNumber;
+
     const VkPresentInfoKHR presentInfo = 
 	{
 		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -378,13 +1511,31 @@ void draw_frame(Engine* app) noexcept
 		.pResults           = VK_NULL_HANDLE
 	};
 
-    result = vkQueuePresentKHR(queue, &presentInfo);
+    {
+        std::lock_guard<std::mutex> lock(app->context.queueLock);
+        result = vkQueuePresentKHR(queue, &presentInfo);
+    }
+
+    if (!app->startup.firstFramePresented.load(std::memory_order_relaxed) && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR))
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - app->startup.initStarted;
+
+        app->startup.timeToFirstFrame = std::chrono::duration<float, std::milli>(elapsed).count();
+        app->startup.firstFramePresented.store(true, std::memory_order_release);
+#ifdef DEBUG
+        printf("first frame presented %.2f ms after init\n", app->startup.timeToFirstFrame);
+
+        const RenderQueue::Stats& stats = app->renderQueue.getStats();
+        printf("%u draws, binds unsorted/sorted: pipelines %u/%u, materials %u/%u, meshes %u/%u\n", stats.draws,
+               stats.submitted.pipelines, stats.sorted.pipelines, stats.submitted.materials, stats.sorted.materials,
+               stats.submitted.meshes, stats.sorted.meshes);
+#endif
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || app->m_framebufferResized)
     {
-        app->m_framebufferResized = false;
-        vkDeviceWaitIdle(app->context.device);
-		app->view.recreate(true);
+        if (recreate_swapchain(app))
+            app->m_framebufferResized = false;
     }
     else if (result != VK_SUCCESS)
     {
@@ -395,4 +1546,127 @@ void draw_frame(Engine* app) noexcept
     }
 
     app->sync.currentFrame = (frame + 1) % MAX_FRAMES_IN_FLIGHT;
-}
\ No newline at end of file
+}
+
+
+void write_camera_uniforms(Engine* app, uint32_t frame, Camera& camera) noexcept
+{
+//  The fence of this frame slot has been waited on, the GPU is done reading the buffer
+    auto* uniforms = static_cast<CameraUniforms*>(app->cameraBuffers[frame].data);
+
+    camera.setAspectRatio(app->m_width / (float)app->m_height);
+
+//  Cached by the camera, rebuilt only when it moved, turned or the view was resized
+    uniforms->view           = camera.getViewMatrix();
+    uniforms->projection     = camera.getProjectionMatrix();
+    uniforms->viewProjection = camera.getViewProjectionMatrix();
+
+    memcpy(uniforms->frustum, camera.getFrustum().planes, sizeof(uniforms->frustum));
+}
+
+
+void update_streaming(Engine* app, VkCommandBuffer cmd, uint32_t frame, const Camera& camera) noexcept
+{
+    if (app->streamedTexture == TextureStreamer::INVALID_TEXTURE)
+        return;
+
+//  Screen-space feedback: a unit cube face at distance d covers about height / (2 * tan(fov / 2) * d) pixels
+    const float pixelsPerUnit = app->m_height / (2.f * tanf(glm_rad(camera.fieldOfView) * 0.5f));
+
+//  Every drawn cube counts, flat instances and hierarchy nodes alike, scaled by the longest axis of its world matrix
+    for (const mat4s& matrix : app->worldMatrices)
+    {
+        float scale = 0.f;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+            scale = std::max(scale, matrix.raw[axis][0] * matrix.raw[axis][0] + matrix.raw[axis][1] * matrix.raw[axis][1] + matrix.raw[axis][2] * matrix.raw[axis][2]);
+
+        const vec3s position = { matrix.raw[3][0], matrix.raw[3][1], matrix.raw[3][2] };
+        const float distance = glms_vec3_distance(position, camera.position);
+
+        app->textureStreamer.requestSize(app->streamedTexture, pixelsPerUnit * std::sqrt(scale) / glm_max(distance, 0.1f));
+    }
+
+    app->textureStreamer.update(cmd, app->sync.frameNumber, app->sync.completedFrames());
+}
+
+
+void update_texture_binding(Engine* app, uint32_t frame) noexcept
+{
+//  The fence of this slot has been waited on, so its descriptor set is not in use and may be rewritten
+    const uint32_t streamVersion = (app->streamedTexture != TextureStreamer::INVALID_TEXTURE) ? app->textureStreamer.getVersion(app->streamedTexture) : 0;
+    const uint32_t sceneVersion  = get_scene_texture_version(app);
+
+    if (app->textureVersions[frame] == streamVersion && app->sceneTextureVersions[frame] == sceneVersion)
+        return;
+
+    const Texture2D& texture = get_bound_texture(app);
+
+    const VkDescriptorImageInfo imageInfo = 
+    {
+        .sampler     = texture.sampler,
+        .imageView   = texture.imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+
+    app->descriptorPool.writeCombinedImageSampler(&imageInfo, app->descriptorSets[frame], 0, app->context.device);
+    app->textureVersions[frame]      = streamVersion;
+    app->sceneTextureVersions[frame] = sceneVersion;
+    ++app->descriptorVersions[frame];
+}
+
+
+uint32_t get_scene_texture_version(const Engine* app) noexcept
+{
+//  A scene texture still loading on another thread is bound once it is ready
+    return app->sceneTextureVersion * 2 + (app->resources.getTexture(app->sceneTexture) ? 1 : 0);
+}
+
+
+const Texture2D& get_bound_texture(const Engine* app) noexcept
+{
+    if (const Texture2D* texture = app->resources.getTexture(app->sceneTexture))
+        return *texture;
+
+    return (app->streamedTexture != TextureStreamer::INVALID_TEXTURE) ? app->textureStreamer.getTexture(app->streamedTexture) 
+                                                                      : app->texture;
+}
+
+
+bool recreate_swapchain(Engine* app) noexcept
+{
+    const VkExtent2D extent = { static_cast<uint32_t>(app->m_width), static_cast<uint32_t>(app->m_height) };
+
+//  No vkDeviceWaitIdle here: the old swapchain is passed as oldSwapchain and its images
+//  are released by MainView::releaseRetired() once the frames using them have signaled their fences
+    return app->view.resize(extent, app->sync.frameNumber);
+}
+
+
+Aabb instance_bounds(const mat4s& matrix) noexcept
+{
+//  Box around the transformed cube: each axis reaches half the summed absolute weights of that row
+    vec3s extent;
+
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        extent.raw[axis] = 0.5f * (std::fabs(matrix.raw[0][axis]) + std::fabs(matrix.raw[1][axis]) + std::fabs(matrix.raw[2][axis]));
+
+    const vec3s center = { matrix.raw[3][0], matrix.raw[3][1], matrix.raw[3][2] };
+
+    return { glms_vec3_sub(center, extent), glms_vec3_add(center, extent) };
+}
+
+
+uint64_t hash_draw_ranges(const std::array<LevelOfDetail::Range, LevelOfDetail::MAX_LEVELS>& ranges) noexcept
+{
+//  FNV-1a over the counts, the firsts follow from them
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (const LevelOfDetail::Range& range : ranges)
+    {
+        hash ^= range.count;
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
@@ -1,14 +1,55 @@
 #ifndef ENGINE_HPP
 #define ENGINE_HPP
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
 #include "pipeline/descriptors/DescriptorPool.hpp"
 #include "pipeline/GraphicsPipeline.hpp"
 #include "command_pool/CommandBufferPool.hpp"
+#include "command_pool/CommandCache.hpp"
 #include "sync/SyncManager.hpp"
+#include "sync/DeletionQueue.hpp"
 #include "texture/Texture2D.hpp"
+#include "texture/CompressedImage.hpp"
+#include "texture/TextureStreamer.hpp"
 #include "buffers/BufferHolder.hpp"
+#include "buffers/MappedBuffer.hpp"
 #include "render/Renderer.hpp"
+#include "render/RenderQueue.hpp"
+#include "render/RenderThread.hpp"
+#include "render/DepthPyramid.hpp"
+#include "render/OcclusionCuller.hpp"
+#include "render/OcclusionRasterizer.hpp"
+#include "render/LevelOfDetail.hpp"
+#include "render/TripleBuffer.hpp"
 #include "camera/Camera.hpp"
+#include "jobs/JobSystem.hpp"
+#include "assets/AssetPack.hpp"
+#include "resources/ResourceManager.hpp"
+#include "scene/TransformStore.hpp"
+#include "scene/TransformHierarchy.hpp"
+#include "scene/BoundingVolumeHierarchy.hpp"
+
+
+// Layout of the camera uniform buffer read by vertex_shader.vert and occlusion_cull.comp
+struct CameraUniforms
+{
+    mat4s view;
+    mat4s projection;
+    mat4s viewProjection; // multiplied once per frame instead of once per vertex
+    vec4s frustum[Frustum::PLANE_COUNT];
+};
+
+
+// Push constants of vertex_shader.vert
+struct DrawConstants
+{
+    uint32_t useDrawList;   // instance indices come from binding 3
+    uint32_t impostorFirst; // gl_InstanceIndex from which instances are camera facing quads, UINT32_MAX for none
+    float    impostorSize;  // edge of those quads in object units
+};
 
 
 class Engine
@@ -19,10 +60,41 @@ public:
 
 
     bool init() noexcept;
+    bool startRenderThread() noexcept;
     void drawFrame() noexcept;
     void destroy() noexcept;
     void resize(int width, int height) noexcept;
 
+//  Application thread: changes are collected here and handed to the renderer with the next frame packet
+    void setInstance(uint32_t index, vec3s position, float angle) noexcept;
+    void publishCamera() noexcept;
+
+//  Nodes of 'hierarchy' by application-side id, the hierarchy itself is changed by the renderer with the next packet
+    uint32_t createNode(uint32_t parent, vec3s position, float angle, float scale) noexcept;
+    void setNode(uint32_t node, vec3s position, float angle, float scale) noexcept;
+    void destroyNode(uint32_t node) noexcept;
+
+    void enqueueRequest(std::function<void(Engine*)> request) noexcept;
+
+//  Application thread: the scene is drawn with a texture of 'resources' instead of its own, an invalid handle
+//  goes back to the latter. The scene holds a reference until the next texture replaces it
+    void setSceneTexture(ResourceManager::TextureHandle texture) noexcept;
+
+//  Object under a point of the view ('x' and 'y' in [0, 1] from the top left corner): a setInstance() index or
+//  PICKED_NODE with a createNode() id, UINT32_MAX for none
+    uint32_t pick(float x, float y) noexcept;
+
+//  On-demand rendering: drawFrame() only produces a frame when needsFrame() is true.
+//  Getting the idle timeout tells how long the caller may block on window events before the keep-alive frame is due
+    void requestFrame() noexcept;
+    bool needsFrame() const noexcept;
+    float getIdleTimeout() const noexcept;
+
+//  Render thread (or the caller of drawFrame when no render thread is running)
+    void renderPacket(FramePacket& packet) noexcept;
+
+    JobSystem        jobs;   // shared worker pool for every subsystem
+    AssetPack        assets; // mapped for the engine lifetime, textures and shaders may point into it
     VulkanContext    context;
     MainView         view;
     GraphicsPipeline pipeline;
@@ -31,22 +103,145 @@ public:
     DescriptorPool descriptorPool;
 
     CommandBufferPool commandPool;
+    CommandCache      commandCache;                            // scene draws replayed while nothing they depend on changed
+    std::atomic<bool> commandCaching = true;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> descriptorVersions = {}; // bumped on every write to the descriptor set of a slot
     SyncManager sync;
+    DeletionQueue deletionQueue; // resources released at run time, destroyed once their last frame has retired
 
     Texture2D texture;
+    VkSampler textureSampler = VK_NULL_HANDLE; // immutable sampler of binding 0, the same cached sampler every texture gets
+
+//  Cooked textures are streamed, 'texture' is only used for the source image fallback
+    TextureStreamer textureStreamer;
+    CompressedImage streamedImage;
+    uint32_t        streamedTexture = TextureStreamer::INVALID_TEXTURE;
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> textureVersions = {}; // streamer version written to each descriptor set
+    std::atomic<bool> streamingActive = false; // levels still on their way, keeps on-demand rendering going
 
+    ResourceManager resources; // shared, deduplicated assets loaded after startup
+    ResourceManager::TextureHandle sceneTexture;                         // drawn instead of the scene's own texture when valid
+    uint32_t sceneTextureVersion = 0;                                    // bumped whenever sceneTexture changes
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> sceneTextureVersions = {}; // scene texture state written to each descriptor set
     BufferHolder bufferHolder;
     Buffer vertices;
     Buffer indices;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType  indexType   = VK_INDEX_TYPE_UINT32;
 
     Renderer renderer;
+    RenderQueue renderQueue; // sorted by state every time the scene is recorded
+    TripleBuffer<RenderQueue::Stats> drawStats; // binds of the last recording, read by the application thread
+    uint32_t    scenePipeline = RenderQueue::INVALID_ID;
+    uint32_t    sceneMaterial = RenderQueue::INVALID_ID;
+    uint32_t    sceneMesh     = RenderQueue::INVALID_ID;
+    RenderThread renderThread;
 
-    bool    m_framebufferResized;
-    int32_t m_width;
-    int32_t m_height;
+//  Every object of the scene, 'instances' maps the indices used by setInstance() to transform handles
+    TransformStore               transforms;
+    std::vector<TransformHandle> instances;
+
+//  Parented objects, their world matrices follow the ones of 'transforms' in the instance buffers.
+//  'nodeHandles' maps the ids of createNode() to hierarchy handles and belongs to the renderer as well
+    TransformHierarchy      hierarchy;
+    std::vector<NodeHandle> nodeHandles;
+
+//  Renderer: bounds of everything drawn, in instance buffer order (transforms, then hierarchy nodes), refreshed from the
+//  world matrices every frame for frustum culling. pick() reads them on the application thread under 'sceneLock'.
+//  'sceneProxies' maps instance buffer indices to proxies, 'sceneObjects' maps them to the ids pick() returns
+    static constexpr uint32_t PICKED_NODE = 0x80000000u; // flags pick() results that are createNode() ids
+
+    BoundingVolumeHierarchy sceneBounds;
+    std::vector<uint32_t>   sceneProxies;
+    std::vector<uint32_t>   sceneObjects;
+    uint64_t                sceneObjectsVersion = UINT64_MAX; // hierarchy version the node ids were taken from
+    std::mutex              sceneLock;
+
+//  World matrices of the transforms in dense order, read by the vertex shader through gl_InstanceIndex
+    std::array<MappedBuffer, MAX_FRAMES_IN_FLIGHT> instanceBuffers;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT>     hierarchyVersions = {}; // hierarchy version held by each instance buffer
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT>     hierarchyOffsets  = {};
+
+//  GPU occlusion culling: each frame draws what was visible in the last one, builds a depth pyramid from it and draws
+//  whatever that pyramid reveals. Draws turn indirect and are recorded inline, the depth attachment is stored
+    DepthPyramid      depthPyramid;
+    OcclusionCuller   occlusionCuller;
+    std::atomic<bool> occlusionCulling = false; // only takes effect with a depth format that can be sampled
+    bool              occlusionActive  = false; // culling ran in the previous frame, its visibility is still valid
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> drawListVersions = {}; // culler version bound at binding 3 of each descriptor set
+    std::array<bool, MAX_FRAMES_IN_FLIGHT>     drawListBound    = {}; // binding 3 holds 'drawLists' instead of the culler's list
+
+//  CPU occlusion culling: the nearest objects are rasterized as occluders on the workers and every object is tested
+//  against them before recording, so the visible set belongs to the frame being drawn. Takes precedence over GPU
+//  culling, bypasses the command cache and late latching (the uniforms must match the culling camera)
+    OcclusionRasterizer occlusionRasterizer;
+    std::atomic<bool>   softwareOcclusion = false;
+
+//  Levels of detail of the scene mesh (simplified by star_dust_cook or at load time) picked per instance on the CPU.
+//  GPU culled draws are not affected and stay at level 0
+    LevelOfDetail      levelOfDetail;
+    std::atomic<bool>  levelSelection = true;
+    std::atomic<float> lodPixelError  = 1.f;
+    std::array<uint32_t, LevelOfDetail::MAX_LEVELS> sceneLevels; // RenderQueue mesh of every level, the impostor quad last
+    Buffer             impostorVertices;
+    Buffer             impostorIndices;
+    float              impostorSize = 1.f; // edge of the quad in object units, the cube seen face on
+
+//  Instance indices read at binding 3 whenever the CPU decides what is drawn, grouped by level
+    std::array<MappedBuffer, MAX_FRAMES_IN_FLIGHT>              drawLists;
+    std::array<LevelOfDetail::Range, LevelOfDetail::MAX_LEVELS> drawRanges = {};
+
+//  Scratch of the CPU passes, kept to avoid allocations. World matrices of every instance are gathered here
+//  because the mapped instance buffers are slow to read back
+    std::vector<mat4s>                       worldMatrices;
+    std::vector<Aabb>                        instanceBounds;     // world boxes of the same instances
+    std::vector<uint32_t>                    inView;             // instances the frustum query returned, 'inViewCount' of them
+    uint32_t                                 inViewCount = 0;
+    std::vector<std::pair<float, uint32_t>>  occluderCandidates; // view depth and instance
+    std::vector<uint8_t>                     visibility;
+
+    bool    m_framebufferResized = false;
+    int32_t m_width  = 0;
+    int32_t m_height = 0;
 
     Camera camera;
-    mat4s modelViewProjectionMatrix;
+
+//  One persistently mapped camera UBO per frame slot. With late latching the freshest camera
+//  from the application thread is written after recording, right before vkQueueSubmit
+    std::array<MappedBuffer, MAX_FRAMES_IN_FLIGHT> cameraBuffers;
+    TripleBuffer<Camera> cameraLatch;
+    std::atomic<bool>    lateLatch = true;
+
+//  Application thread. While 'animating' every frame is drawn, 'keepAlive' is the longest gap between frames in seconds (0 for none)
+    struct
+    {
+        bool     enabled   = false;
+        bool     animating = false;
+        float    keepAlive = 1.f;
+        uint64_t framesRendered = 0;
+        uint64_t framesSkipped  = 0;
+    } onDemand;
+
+    struct
+    {
+        std::chrono::steady_clock::time_point initStarted;
+        float initTime         = 0.f; // milliseconds spent in init()
+        float timeToFirstFrame = 0.f; // milliseconds from init() to the first presented frame
+        std::atomic<bool> firstFramePresented = false; // set by the renderer once timeToFirstFrame is written
+    } startup;
+
+private:
+    FramePacket m_inlinePacket; // used when drawFrame renders on the calling thread
+
+    std::vector<FramePacket::InstanceDelta> m_instanceDeltas;
+    std::vector<std::function<void(Engine*)>> m_requests;
+    uint32_t   m_nodeCount       = 0; // ids handed out by createNode()
+    VkExtent2D m_requestedExtent = { 0, 0 };
+    bool       m_resizeRequested = false;
+
+    uint32_t                              m_redrawFrames       = 0; // frames still owed to the last change
+    uint64_t                              m_drawnCameraVersion = UINT64_MAX;
+    std::chrono::steady_clock::time_point m_lastFrameTime;
 };
 
 #endif // !ENGINE_HPP
\ No newline at end of file
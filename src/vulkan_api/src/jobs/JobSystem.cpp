@@ -0,0 +1,318 @@
+#include <cstring>
+
+#include "jobs/JobSystem.hpp"
+
+
+namespace
+{
+    constexpr uint32_t QUEUE_CAPACITY       = 4096; // power of two
+    constexpr uint32_t CONTINUATIONS_CLOSED = 0x80000000u;
+
+    thread_local const JobSystem* t_jobSystem   = nullptr;
+    thread_local uint32_t         t_workerIndex = 0;
+}
+
+
+
+JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+
+bool JobSystem::init(uint32_t workerCount) noexcept
+{
+    if (m_running.load(std::memory_order_acquire))
+        return true;
+
+    if (workerCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+    }
+
+    m_jobPool = std::make_unique<Job[]>(MAX_JOBS);
+    m_allocatedJobs.store(0, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i <= workerCount; ++i)
+        m_workers.push_back(std::make_unique<Worker>(QUEUE_CAPACITY));
+
+    t_jobSystem   = this;
+    t_workerIndex = 0;
+
+    m_running.store(true, std::memory_order_release);
+
+    for (uint32_t i = 1; i <= workerCount; ++i)
+        m_workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+
+    return true;
+}
+
+
+void JobSystem::shutdown() noexcept
+{
+    if (!m_running.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_all();
+
+    for (auto& worker : m_workers)
+        if (worker->thread.joinable())
+            worker->thread.join();
+
+    m_workers.clear();
+    m_sharedQueue.clear();
+    m_sharedCount.store(0, std::memory_order_relaxed);
+    m_jobPool.reset();
+
+    if (t_jobSystem == this)
+        t_jobSystem = nullptr;
+}
+
+
+uint32_t JobSystem::getWorkerCount() const noexcept
+{
+    return m_workers.empty() ? 0 : static_cast<uint32_t>(m_workers.size() - 1);
+}
+
+
+Job* JobSystem::createJob(JobFunction function, const void* data, size_t size, Job* parent) noexcept
+{
+    Job* job = nullptr;
+
+//  The pool is walked as a ring, slots whose job is still pending or running are skipped.
+//  If a whole lap finds none free, other jobs are run until one finishes
+    for (uint32_t attempt = 1; ; ++attempt)
+    {
+        const uint32_t index = m_allocatedJobs.fetch_add(1, std::memory_order_relaxed) & (MAX_JOBS - 1);
+        bool allocated = false;
+
+        if (m_jobPool[index].allocated.compare_exchange_strong(allocated, true, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            job = &m_jobPool[index];
+            break;
+        }
+
+        if (attempt % MAX_JOBS == 0)
+        {
+            if (Job* next = getJob())
+                execute(next);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    job->function = function;
+    job->parent   = parent;
+    job->unfinishedJobs.store(1, std::memory_order_relaxed);
+    job->pendingDependencies.store(1, std::memory_order_relaxed); // released by run()
+    job->continuationCount.store(0, std::memory_order_relaxed);
+
+    for (auto& continuation : job->continuations)
+        continuation.store(nullptr, std::memory_order_relaxed);
+
+    if (size)
+        memcpy(job->data, data, size);
+
+    if (parent)
+        parent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+    return job;
+}
+
+
+void JobSystem::addDependency(Job* job, Job* dependency) noexcept
+{
+    job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t count = dependency->continuationCount.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        if (count & CONTINUATIONS_CLOSED)
+            break; // the dependency has already finished
+
+        if (count == Job::MAX_CONTINUATIONS)
+        {
+            wait(dependency);
+            break;
+        }
+
+        if (dependency->continuationCount.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            dependency->continuations[count].store(job, std::memory_order_release);
+
+            return;
+        }
+    }
+
+    job->pendingDependencies.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+void JobSystem::run(Job* job) noexcept
+{
+    if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        schedule(job);
+}
+
+
+void JobSystem::wait(const Job* job) noexcept
+{
+//  Help with other work instead of blocking the calling thread
+    while (!isFinished(job))
+    {
+        if (Job* next = getJob())
+            execute(next);
+        else
+            std::this_thread::yield();
+    }
+}
+
+
+bool JobSystem::isFinished(const Job* job) const noexcept
+{
+    return (job->unfinishedJobs.load(std::memory_order_acquire) == 0);
+}
+
+
+void JobSystem::workerLoop(uint32_t index) noexcept
+{
+    t_jobSystem   = this;
+    t_workerIndex = index;
+
+    while (m_running.load(std::memory_order_acquire))
+    {
+        if (Job* job = getJob())
+        {
+            execute(job);
+            continue;
+        }
+
+//      Read the wakeup counter before the last look at the queues, so a job scheduled in between is not missed
+        const uint32_t wakeups = m_wakeups.load(std::memory_order_acquire);
+
+        if (Job* job = getJob())
+        {
+            execute(job);
+            continue;
+        }
+
+        if (!m_running.load(std::memory_order_acquire))
+            break;
+
+        m_wakeups.wait(wakeups, std::memory_order_acquire);
+    }
+}
+
+
+void JobSystem::execute(Job* job) noexcept
+{
+    if (job->function)
+        job->function(job, job->data);
+
+    finish(job);
+}
+
+
+void JobSystem::finish(Job* job) noexcept
+{
+    if (job->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    Job* parent = job->parent;
+
+    const uint32_t count = job->continuationCount.exchange(CONTINUATIONS_CLOSED, std::memory_order_acq_rel);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Job* continuation = nullptr;
+
+//      The slot was reserved by addDependency, its pointer may still be on the way
+        while (!(continuation = job->continuations[i].load(std::memory_order_acquire)))
+            std::this_thread::yield();
+
+        run(continuation);
+    }
+
+//  Nothing of the job is read past this point, the slot may be handed out again
+    job->allocated.store(false, std::memory_order_release);
+
+    if (parent)
+        finish(parent);
+}
+
+
+void JobSystem::schedule(Job* job) noexcept
+{
+    if (getWorkerCount() == 0)
+    {
+        execute(job);
+
+        return;
+    }
+
+    if (Worker* worker = currentWorker())
+    {
+        if (!worker->queue.push(job))
+        {
+            execute(job);
+
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_sharedLock);
+        m_sharedQueue.push_back(job);
+        m_sharedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+}
+
+
+Job* JobSystem::getJob() noexcept
+{
+    Worker* worker = currentWorker();
+
+    if (worker)
+        if (Job* job = worker->queue.pop())
+            return job;
+
+    if (m_sharedCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sharedLock);
+
+        if (!m_sharedQueue.empty())
+        {
+            Job* job = m_sharedQueue.front();
+            m_sharedQueue.pop_front();
+            m_sharedCount.fetch_sub(1, std::memory_order_relaxed);
+
+            return job;
+        }
+    }
+
+    const uint32_t workerCount = static_cast<uint32_t>(m_workers.size());
+    const uint32_t first       = worker ? t_workerIndex + 1 : 0;
+
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        Worker* victim = m_workers[(first + i) % workerCount].get();
+
+        if (victim != worker)
+            if (Job* job = victim->queue.steal())
+                return job;
+    }
+
+    return nullptr;
+}
+
+
+JobSystem::Worker* JobSystem::currentWorker() const noexcept
+{
+    return (t_jobSystem == this) ? m_workers[t_workerIndex].get() : nullptr;
+}
@@ -0,0 +1,157 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "jobs/WorkStealingQueue.hpp"
+
+
+struct Job;
+using JobFunction = void(*)(Job* job, const void* data);
+
+
+// A unit of work. Jobs are handed out by JobSystem::createJob from a fixed pool: a slot is reused only once its job
+// has finished and MAX_JOBS more jobs have been created, so handles must not be kept across frames
+struct alignas(64) Job
+{
+    static constexpr uint32_t MAX_CONTINUATIONS = 8;
+    static constexpr uint32_t DATA_SIZE         = 64;
+
+    JobFunction function;
+    Job*        parent;
+
+    std::atomic<int32_t>  unfinishedJobs;      // this job plus its unfinished children
+    std::atomic<int32_t>  pendingDependencies; // jobs that have to finish before this one may run
+    std::atomic<uint32_t> continuationCount;
+    std::atomic<Job*>     continuations[MAX_CONTINUATIONS];
+    std::atomic<bool>     allocated;           // owned by a job that has not finished yet
+
+    alignas(16) unsigned char data[DATA_SIZE];
+};
+
+
+class JobSystem
+{
+public:
+    static constexpr uint32_t MAX_JOBS = 4096; // power of two, jobs that have not finished yet
+
+    JobSystem() noexcept = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator = (const JobSystem&) = delete;
+    ~JobSystem();
+
+//  workerCount == 0 picks one worker per hardware thread besides the calling one
+    bool init(uint32_t workerCount = 0) noexcept;
+    void shutdown() noexcept;
+
+    uint32_t getWorkerCount() const noexcept;
+
+    Job* createJob(JobFunction function, const void* data = nullptr, size_t size = 0, Job* parent = nullptr) noexcept;
+
+//  Stores a copy of a small trivially copyable callable (usually a lambda capturing pointers) inside the job
+    template<class F>
+    Job* createJob(const F& function, Job* parent = nullptr) noexcept
+    {
+        static_assert(sizeof(F) <= Job::DATA_SIZE, "job closure is too large, capture a pointer instead");
+        static_assert(std::is_trivially_copyable_v<F>, "job closure must be trivially copyable");
+
+        return createJob([](Job*, const void* data)
+        {
+            (*static_cast<const F*>(data))();
+        }, &function, sizeof(F), parent);
+    }
+
+//  'job' runs only after 'dependency' has finished. Must be called before run(job)
+    void addDependency(Job* job, Job* dependency) noexcept;
+
+    void run(Job* job) noexcept;
+    void wait(const Job* job) noexcept;
+    bool isFinished(const Job* job) const noexcept;
+
+//  Calls function(begin, end) over [0, count) split into ranges of at least 'grain' elements and waits for all of them.
+//  The ranges grow when more than MAX_CHUNKS_PER_THREAD of them would go to each thread
+    template<class F>
+    void parallelFor(uint32_t count, uint32_t grain, const F& function) noexcept
+    {
+        if (count == 0)
+            return;
+
+        if (grain == 0)
+            grain = 1;
+
+        const uint32_t maxChunks = std::min((getWorkerCount() + 1) * MAX_CHUNKS_PER_THREAD, MAX_JOBS / 4);
+
+        if (count / grain >= maxChunks)
+            grain = static_cast<uint32_t>((static_cast<uint64_t>(count) + maxChunks - 1) / maxChunks);
+
+        if (getWorkerCount() == 0 || count <= grain)
+        {
+            function(0u, count);
+
+            return;
+        }
+
+        Job* root = createJob(JobFunction{});
+
+        for (uint32_t begin = 0; begin < count; begin += grain)
+        {
+            const uint32_t end = (count - begin > grain) ? begin + grain : count;
+            const F* callable  = &function;
+
+            run(createJob([callable, begin, end]()
+            {
+                (*callable)(begin, end);
+            }, root));
+        }
+
+        run(root);
+        wait(root);
+    }
+
+private:
+    static constexpr uint32_t MAX_CHUNKS_PER_THREAD = 8; // enough to balance uneven ranges, far below MAX_JOBS
+
+    struct Worker
+    {
+        explicit Worker(uint32_t capacity) noexcept:
+            queue(capacity)
+        {
+
+        }
+
+        WorkStealingQueue<Job> queue;
+        std::thread thread;
+    };
+
+    void workerLoop(uint32_t index) noexcept;
+    void execute(Job* job) noexcept;
+    void finish(Job* job) noexcept;
+    void schedule(Job* job) noexcept;
+    Job* getJob() noexcept;
+
+    Worker* currentWorker() const noexcept;
+
+    std::vector<std::unique_ptr<Worker>> m_workers; // [0] belongs to the thread that called init
+
+    std::unique_ptr<Job[]> m_jobPool;
+    std::atomic<uint32_t>  m_allocatedJobs = 0;
+
+//  Jobs submitted by threads that own no deque (the render thread, for instance)
+    std::mutex            m_sharedLock;
+    std::deque<Job*>      m_sharedQueue;
+    std::atomic<uint32_t> m_sharedCount = 0;
+
+    std::atomic<uint32_t> m_wakeups = 0;
+    std::atomic<bool>     m_running = false;
+};
+
+#endif // !JOB_SYSTEM_HPP
@@ -0,0 +1,91 @@
+#ifndef WORK_STEALING_QUEUE_HPP
+#define WORK_STEALING_QUEUE_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+
+// Chase-Lev deque with a fixed power-of-two capacity:
+// the owning worker pushes and pops at the bottom, any other thread steals from the top
+template<class T>
+class WorkStealingQueue
+{
+public:
+    explicit WorkStealingQueue(uint32_t capacity) noexcept:
+        m_buffer(std::make_unique<std::atomic<T*>[]>(capacity)),
+        m_mask(static_cast<int64_t>(capacity) - 1)
+    {
+
+    }
+
+    bool push(T* item) noexcept
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top    = m_top.load(std::memory_order_acquire);
+
+        if (bottom - top > m_mask)
+            return false; // full, the caller runs the item inline
+
+        m_buffer[bottom & m_mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    T* pop() noexcept
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+            return nullptr;
+        }
+
+        T* item = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+
+        if (top == bottom)
+        {
+//          Last item: race against the thieves for it
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    T* steal() noexcept
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+            return nullptr;
+
+        T* item = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr; // lost the race against the owner or another thief
+
+        return item;
+    }
+
+private:
+    std::unique_ptr<std::atomic<T*>[]> m_buffer;
+    const int64_t m_mask;
+
+    alignas(64) std::atomic<int64_t> m_top    = 0;
+    alignas(64) std::atomic<int64_t> m_bottom = 0;
+};
+
+#endif // !WORK_STEALING_QUEUE_HPP
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "mesh/MeshBlob.hpp"
+
+
+bool MeshBlob::loadFromFile(const char* filepath) noexcept
+{
+    FILE* file = fopen(filepath, "rb");
+
+    if ( ! file )
+        return false;
+
+    m_pack  = nullptr;
+    m_entry = nullptr;
+
+    bool result = (fread(&header, sizeof(Header), 1, file) == 1) && validateHeader();
+
+    if (result)
+    {
+        const size_t size = static_cast<size_t>(getBodySize());
+
+        try
+        {
+            data.resize(size);
+            result = (fread(data.data(), 1, size, file) == size);
+        }
+        catch (const std::bad_alloc&)
+        {
+            result = false;
+        }
+    }
+
+    fclose(file);
+
+#ifdef DEBUG
+    if ( ! result )
+        fprintf(stderr, "Invalid mesh blob: %s\n", filepath);
+#endif
+
+    return result;
+}
+
+
+bool MeshBlob::loadFromPack(const AssetPack& pack, std::string_view name) noexcept
+{
+    const AssetPack::Entry* entry = pack.find(name);
+
+    if ( ! entry || entry->format != AssetPack::Mesh )
+        return false;
+
+    const auto prefix = pack.getPrefix(*entry);
+
+    if (prefix.size() < sizeof(Header))
+        return false;
+
+    memcpy(&header, prefix.data(), sizeof(Header));
+
+    if ( ! validateHeader() || entry->size != sizeof(Header) + getBodySize() )
+        return false;
+
+//  The cooker stores exactly the header uncompressed, so the body starts right after the prefix
+    if (entry->compression != AssetPack::Uncompressed && entry->prefixSize != sizeof(Header))
+        return false;
+
+    data.clear();
+    m_pack  = &pack;
+    m_entry = entry;
+
+    return true;
+}
+
+
+uint64_t MeshBlob::getBodySize() const noexcept
+{
+    return static_cast<uint64_t>(header.vertexCount) * header.vertexStride + static_cast<uint64_t>(header.indexCount) * header.indexSize;
+}
+
+
+bool MeshBlob::readBody(void* dst) const noexcept
+{
+    if ( ! m_pack )
+    {
+        memcpy(dst, data.data(), data.size());
+        return true;
+    }
+
+    if (m_entry->compression != AssetPack::Uncompressed)
+        return m_pack->readBody(*m_entry, dst);
+
+    memcpy(dst, m_pack->getPrefix(*m_entry).data() + sizeof(Header), static_cast<size_t>(getBodySize()));
+
+    return true;
+}
+
+
+bool MeshBlob::validateHeader() const noexcept
+{
+    if (header.magic != MAGIC || 
+        header.version != VERSION || 
+        header.vertexStride != sizeof(Vertex) || 
+        (header.indexSize != 2 && header.indexSize != 4) ||
+        header.lodCount == 0 || header.lodCount > MAX_LODS)
+        return false;
+
+    for (uint32_t i = 0; i < header.lodCount; ++i)
+        if (static_cast<uint64_t>(header.lods[i].firstIndex) + header.lods[i].indexCount > header.indexCount)
+            return false;
+
+    return true;
+}
+
+
+std::span<const uint8_t> MeshBlob::getVertices() const noexcept
+{
+    return { data.data(), static_cast<size_t>(header.vertexCount) * header.vertexStride };
+}
+
+
+std::span<const uint16_t> MeshBlob::getIndices16() const noexcept
+{
+    if (header.indexSize != 2)
+        return {};
+
+    return { reinterpret_cast<const uint16_t*>(data.data() + getVertices().size()), header.indexCount };
+}
+
+
+std::span<const uint32_t> MeshBlob::getIndices32() const noexcept
+{
+    if (header.indexSize != 4)
+        return {};
+
+    return { reinterpret_cast<const uint32_t*>(data.data() + getVertices().size()), header.indexCount };
+}
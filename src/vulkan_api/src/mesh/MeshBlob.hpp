@@ -0,0 +1,71 @@
+#ifndef MESH_BLOB_HPP
+#define MESH_BLOB_HPP
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <string_view>
+
+#include "assets/AssetPack.hpp"
+
+
+// Cooked mesh written by star_dust_cook: a header followed by the vertex and index data
+// in exactly the layout the GPU reads, so loading is a file read and an upload.
+// Levels of detail share the vertices, each one is a range of the index data
+struct MeshBlob
+{
+    static constexpr uint32_t MAGIC    = 0x48534D53; // "SMSH"
+    static constexpr uint32_t VERSION  = 2;
+    static constexpr uint32_t MAX_LODS = 4;
+
+//  Positions and texture coordinates are IEEE half floats (R16G16B16A16_SFLOAT, R16G16_SFLOAT)
+    struct Vertex
+    {
+        uint16_t position[4];
+        uint16_t texCoord[2];
+    };
+
+    struct Lod
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float    error; // in position units, 0 for the full mesh
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t vertexStride;
+        uint32_t indexSize; // 2 or 4 bytes
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint32_t lodCount; // level 0 is the full mesh
+        Lod      lods[MAX_LODS];
+    };
+
+    bool loadFromFile(const char* filepath) noexcept;
+
+//  Reads only the header, the body stays in the pack until readBody() copies or decompresses it
+    bool loadFromPack(const AssetPack& pack, std::string_view name) noexcept;
+
+    std::span<const uint8_t>  getVertices()  const noexcept;
+    std::span<const uint16_t> getIndices16() const noexcept;
+    std::span<const uint32_t> getIndices32() const noexcept;
+
+    uint64_t getBodySize() const noexcept;
+    bool readBody(void* dst) const noexcept;
+
+    Header header = {};
+    std::vector<uint8_t> data; // vertices, then indices (empty for packed meshes)
+
+private:
+    bool validateHeader() const noexcept;
+
+    const AssetPack*        m_pack  = nullptr;
+    const AssetPack::Entry* m_entry = nullptr;
+};
+
+#endif // !MESH_BLOB_HPP
@@ -0,0 +1,495 @@
+#include <new>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "mesh/MeshSimplifier.hpp"
+
+
+namespace
+{
+    constexpr double BORDER_WEIGHT = 10.0; // planes through open edges, relative to the area weight of the faces
+
+
+//  Symmetric 4x4 matrix of the summed squared plane distances, with the summed weight to turn it into a mean
+    struct Quadric
+    {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double   cost;
+    };
+
+
+    struct PositionKey
+    {
+        float position[3];
+
+        bool operator == (const PositionKey& other) const noexcept
+        {
+            return memcmp(position, other.position, sizeof(position)) == 0;
+        }
+    };
+
+
+    struct PositionHash
+    {
+        size_t operator () (const PositionKey& key) const noexcept
+        {
+            uint64_t hash = 0xCBF29CE484222325ull;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(key.position);
+
+            for (size_t i = 0; i < sizeof(key.position); ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 0x100000001B3ull;
+            }
+
+            return static_cast<size_t>(hash);
+        }
+    };
+
+
+    void add_plane(Quadric& q, const double n[3], double d, double weight) noexcept
+    {
+        q.a00 += weight * n[0] * n[0];
+        q.a11 += weight * n[1] * n[1];
+        q.a22 += weight * n[2] * n[2];
+        q.a01 += weight * n[0] * n[1];
+        q.a02 += weight * n[0] * n[2];
+        q.a12 += weight * n[1] * n[2];
+        q.b0  += weight * n[0] * d;
+        q.b1  += weight * n[1] * d;
+        q.b2  += weight * n[2] * d;
+        q.c   += weight * d * d;
+        q.weight += weight;
+    }
+
+
+    Quadric add_quadrics(const Quadric& a, const Quadric& b) noexcept
+    {
+        return
+        {
+            a.a00 + b.a00, a.a11 + b.a11, a.a22 + b.a22, a.a01 + b.a01, a.a02 + b.a02, a.a12 + b.a12,
+            a.b0 + b.b0, a.b1 + b.b1, a.b2 + b.b2,
+            a.c + b.c,
+            a.weight + b.weight
+        };
+    }
+
+
+//  Mean squared distance of 'p' from the planes
+    double evaluate(const Quadric& q, const float* p) noexcept
+    {
+        const double x = p[0], y = p[1], z = p[2];
+
+        const double sum = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+                           2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+                           2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+        return (q.weight > 0.0) ? std::fabs(sum) / q.weight : 0.0;
+    }
+
+
+    void triangle_normal(const float* p0, const float* p1, const float* p2, double n[3]) noexcept
+    {
+        const double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+        const double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+
+    uint64_t edge_key(uint32_t a, uint32_t b) noexcept
+    {
+        return (a < b) ? (static_cast<uint64_t>(a) << 32 | b) : (static_cast<uint64_t>(b) << 32 | a);
+    }
+}
+
+
+
+bool MeshSimplifier::simplify(const float* positions, size_t stride, uint32_t vertexCount, std::span<const uint32_t> indices,
+                              uint32_t targetIndexCount, float maxError, std::vector<uint32_t>& result, float* error) noexcept
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(positions);
+
+    auto position = [bytes, stride](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(bytes + vertex * stride);
+    };
+
+    *error = 0.f;
+
+    try
+    {
+        result.assign(indices.begin(), indices.end());
+
+        if (result.size() <= targetIndexCount || maxError <= 0.f)
+            return true;
+
+//      Position groups: the first vertex at a position stands for every vertex there
+        std::vector<uint32_t> group(vertexCount);
+        std::vector<uint32_t> memberOffsets(vertexCount + 1, 0);
+        std::vector<uint32_t> members(vertexCount);
+
+        {
+            std::unordered_map<PositionKey, uint32_t, PositionHash> first;
+            first.reserve(vertexCount);
+
+            for (uint32_t v = 0; v < vertexCount; ++v)
+            {
+                const float* p = position(v);
+                const PositionKey key = { { p[0] + 0.f, p[1] + 0.f, p[2] + 0.f } }; // -0 and 0 weld
+
+                group[v] = first.try_emplace(key, v).first->second;
+                ++memberOffsets[group[v] + 1];
+            }
+
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                memberOffsets[v + 1] += memberOffsets[v];
+
+            std::vector<uint32_t> fill(memberOffsets.begin(), memberOffsets.end() - 1);
+
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                members[fill[group[v]]++] = v;
+        }
+
+        std::vector<Quadric>  quadrics(vertexCount, Quadric{});
+        std::vector<uint64_t> edges;
+        std::vector<uint64_t> borderEdges;
+
+        auto collect_edges = [&]()
+        {
+            edges.clear();
+
+            for (size_t i = 0; i < result.size(); i += 3)
+                for (uint32_t k = 0; k < 3; ++k)
+                    edges.push_back(edge_key(group[result[i + k]], group[result[i + (k + 1) % 3]]));
+
+            std::sort(edges.begin(), edges.end());
+        };
+
+//      Face planes weighted by area, plus planes standing on the open edges so borders keep their shape
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const float* p[3] = { position(result[i]), position(result[i + 1]), position(result[i + 2]) };
+
+            double n[3];
+            triangle_normal(p[0], p[1], p[2], n);
+
+            const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            if (length <= 0.0)
+                continue;
+
+            n[0] /= length, n[1] /= length, n[2] /= length;
+
+            const double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+
+            for (uint32_t k = 0; k < 3; ++k)
+                add_plane(quadrics[group[result[i + k]]], n, d, length * 0.5);
+        }
+
+        collect_edges();
+
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t a = result[i + k];
+                const uint32_t b = result[i + (k + 1) % 3];
+                const uint32_t c = result[i + (k + 2) % 3];
+                const uint64_t key = edge_key(group[a], group[b]);
+
+                if (std::upper_bound(edges.begin(), edges.end(), key) - std::lower_bound(edges.begin(), edges.end(), key) != 1)
+                    continue;
+
+                const float* pa = position(a);
+                const float* pb = position(b);
+
+                double n[3];
+                triangle_normal(pa, pb, position(c), n);
+
+                const double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+                double m[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+
+                const double length = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+
+                if (length <= 0.0)
+                    continue;
+
+                m[0] /= length, m[1] /= length, m[2] /= length;
+
+                const double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                const double weight = BORDER_WEIGHT * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+
+                add_plane(quadrics[group[a]], m, d, weight);
+                add_plane(quadrics[group[b]], m, d, weight);
+            }
+        }
+
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint32_t> targets(vertexCount);
+        std::vector<uint8_t>  border(vertexCount);
+        std::vector<uint8_t>  locked(vertexCount);
+        std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+        std::vector<uint32_t> triangles;
+        std::vector<Collapse> collapses;
+        double worst = 0.0;
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            remap[v] = v;
+
+        auto corner = [&](uint32_t triangle, uint32_t k)
+        {
+            return remap[result[triangle * 3 + k]];
+        };
+
+//      Every vertex of 'from' needs a triangle shared with a vertex of 'to' (its own chart continues there),
+//      and none of its other triangles may turn over. Returns the triangles the collapse removes, -1 when invalid
+        auto check_collapse = [&](uint32_t from, uint32_t to) -> int64_t
+        {
+            int64_t removed = 0;
+
+            for (uint32_t m = memberOffsets[from]; m < memberOffsets[from + 1]; ++m)
+            {
+                const uint32_t vertex = members[m];
+
+                if (triangleOffsets[vertex] == triangleOffsets[vertex + 1])
+                    continue;
+
+                targets[vertex] = UINT32_MAX;
+
+                for (uint32_t t = triangleOffsets[vertex]; t < triangleOffsets[vertex + 1]; ++t)
+                {
+                    for (uint32_t k = 0; k < 3; ++k)
+                    {
+                        if (group[corner(triangles[t], k)] == to)
+                        {
+                            targets[vertex] = corner(triangles[t], k);
+                            ++removed;
+                        }
+                    }
+                }
+
+                if (targets[vertex] == UINT32_MAX)
+                    return -1;
+
+                for (uint32_t t = triangleOffsets[vertex]; t < triangleOffsets[vertex + 1]; ++t)
+                {
+                    const uint32_t c[3] = { corner(triangles[t], 0), corner(triangles[t], 1), corner(triangles[t], 2) };
+
+                    if (group[c[0]] == to || group[c[1]] == to || group[c[2]] == to)
+                        continue;
+
+                    const float* before[3] = { position(c[0]), position(c[1]), position(c[2]) };
+                    const float* after[3]  = { before[0], before[1], before[2] };
+
+                    for (uint32_t k = 0; k < 3; ++k)
+                        if (c[k] == vertex)
+                            after[k] = position(to);
+
+                    double n0[3], n1[3];
+                    triangle_normal(before[0], before[1], before[2], n0);
+                    triangle_normal(after[0], after[1], after[2], n1);
+
+                    const double facing = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+
+                    if (facing <= 0.0 && (n0[0] != 0.0 || n0[1] != 0.0 || n0[2] != 0.0))
+                        return -1;
+                }
+            }
+
+            return removed;
+        };
+
+        while (result.size() > targetIndexCount)
+        {
+            const uint32_t triangleCount = static_cast<uint32_t>(result.size() / 3);
+
+//          Open edges are used once, edges of more than two triangles lock their ends for good measure
+            collect_edges();
+            borderEdges.clear();
+            std::fill(border.begin(), border.end(), 0);
+            std::fill(locked.begin(), locked.end(), 0);
+
+            for (size_t i = 0; i < edges.size();)
+            {
+                size_t j = i;
+
+                while (j < edges.size() && edges[j] == edges[i])
+                    ++j;
+
+                const uint32_t a = static_cast<uint32_t>(edges[i] >> 32);
+                const uint32_t b = static_cast<uint32_t>(edges[i]);
+
+                if (j - i == 1)
+                {
+                    border[a] = border[b] = 1;
+                    borderEdges.push_back(edges[i]);
+                }
+                else if (j - i > 2)
+                {
+                    locked[a] = locked[b] = 1;
+                }
+
+                i = j;
+            }
+
+//          Triangles around every vertex
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+
+            for (uint32_t index : result)
+                ++triangleOffsets[index + 1];
+
+            for (uint32_t v = 0; v < vertexCount; ++v)
+                triangleOffsets[v + 1] += triangleOffsets[v];
+
+            triangles.resize(result.size());
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+
+            for (size_t i = 0; i < result.size(); ++i)
+                triangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+
+//          Every edge in both directions, the surviving end keeps its position
+            collapses.clear();
+
+            for (uint32_t t = 0; t < triangleCount; ++t)
+            {
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t a = group[result[t * 3 + k]];
+                    const uint32_t b = group[result[t * 3 + (k + 1) % 3]];
+                    const Quadric  q = add_quadrics(quadrics[a], quadrics[b]);
+
+                    collapses.push_back({ a, b, evaluate(q, position(b)) });
+                    collapses.push_back({ b, a, evaluate(q, position(a)) });
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+            {
+                return a.cost < b.cost;
+            });
+
+//          Cheapest first, each position takes part in one collapse per pass
+            const double maxCost = static_cast<double>(maxError) * maxError;
+            const size_t excess  = result.size() - targetIndexCount;
+            size_t   removed = 0;
+            uint32_t applied = 0;
+
+            for (const Collapse& collapse : collapses)
+            {
+                if (collapse.cost > maxCost || removed >= excess)
+                    break;
+
+                if (locked[collapse.from] || locked[collapse.to])
+                    continue;
+
+                if (border[collapse.from] && ! std::binary_search(borderEdges.begin(), borderEdges.end(), edge_key(collapse.from, collapse.to)))
+                    continue;
+
+                const int64_t triangleRemoved = check_collapse(collapse.from, collapse.to);
+
+                if (triangleRemoved < 0)
+                    continue;
+
+                for (uint32_t m = memberOffsets[collapse.from]; m < memberOffsets[collapse.from + 1]; ++m)
+                {
+                    const uint32_t vertex = members[m];
+
+                    if (triangleOffsets[vertex] != triangleOffsets[vertex + 1])
+                        remap[vertex] = targets[vertex];
+                }
+
+                quadrics[collapse.to] = add_quadrics(quadrics[collapse.to], quadrics[collapse.from]);
+                locked[collapse.from] = locked[collapse.to] = 1;
+
+                worst    = std::max(worst, collapse.cost);
+                removed += static_cast<size_t>(triangleRemoved) * 3;
+                ++applied;
+            }
+
+            if (applied == 0)
+                break;
+
+//          Triangles with two corners at one position are gone
+            size_t count = 0;
+
+            for (uint32_t t = 0; t < triangleCount; ++t)
+            {
+                const uint32_t c[3] = { corner(t, 0), corner(t, 1), corner(t, 2) };
+
+                if (group[c[0]] == group[c[1]] || group[c[1]] == group[c[2]] || group[c[2]] == group[c[0]])
+                    continue;
+
+                result[count++] = c[0];
+                result[count++] = c[1];
+                result[count++] = c[2];
+            }
+
+            result.resize(count);
+        }
+
+        *error = static_cast<float>(std::sqrt(worst));
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+uint32_t MeshSimplifier::buildLevels(const float* positions, size_t stride, uint32_t vertexCount, std::span<const uint32_t> indices,
+                                     uint32_t maxLevels, float maxError, std::vector<uint32_t>& result, Level* levels) noexcept
+{
+    if (maxLevels == 0 || indices.empty())
+        return 0;
+
+    std::vector<uint32_t> simplified;
+    uint32_t count = 1;
+
+    try
+    {
+        levels[0] = { static_cast<uint32_t>(result.size()), static_cast<uint32_t>(indices.size()), 0.f };
+        result.insert(result.end(), indices.begin(), indices.end());
+
+        while (count < maxLevels)
+        {
+            const Level& last = levels[count - 1];
+            const std::span<const uint32_t> source(result.data() + last.firstIndex, last.indexCount);
+
+//          Errors add up from level to level, the budget shrinks accordingly
+            float error = 0.f;
+
+            if ( ! simplify(positions, stride, vertexCount, source, (last.indexCount / 6) * 3, maxError - last.error, simplified, &error) )
+                break;
+
+            if (simplified.empty() || simplified.size() * 5 > static_cast<size_t>(last.indexCount) * 4)
+                break;
+
+            levels[count] = { static_cast<uint32_t>(result.size()), static_cast<uint32_t>(simplified.size()), last.error + error };
+            result.insert(result.end(), simplified.begin(), simplified.end());
+            ++count;
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        return 0;
+    }
+
+    return count;
+}
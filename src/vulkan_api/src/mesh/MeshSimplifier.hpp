@@ -0,0 +1,34 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// Quadric error metric edge collapse (Garland and Heckbert 1997) that keeps the original vertices: a collapse moves
+// every vertex at one position onto a neighbouring position, so all levels share the vertex buffer of the full mesh.
+// Vertices at the same position (attribute seams) only move onto a neighbour of their own chart, border vertices only
+// along the border, and collapses that would flip a triangle are skipped. Used by star_dust_cook and at load time
+struct MeshSimplifier
+{
+    struct Level
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float    error; // estimated distance from the full mesh in position units
+    };
+
+//  'positions' are xyz floats 'stride' bytes apart. Collapses the cheapest edges until 'result' holds no more than
+//  'targetIndexCount' indices or the next collapse would move the surface further than 'maxError'.
+//  '*error' receives the largest error that was accepted
+    static bool simplify(const float* positions, size_t stride, uint32_t vertexCount, std::span<const uint32_t> indices,
+                         uint32_t targetIndexCount, float maxError, std::vector<uint32_t>& result, float* error) noexcept;
+
+//  Level 0 is 'indices' itself, every further level aims at half the triangles of the one before. Stops after
+//  'maxLevels' or once a level saves less than a fifth of its predecessor. Index lists are appended to 'result'
+    static uint32_t buildLevels(const float* positions, size_t stride, uint32_t vertexCount, std::span<const uint32_t> indices,
+                                uint32_t maxLevels, float maxError, std::vector<uint32_t>& result, Level* levels) noexcept;
+};
+
+#endif // !MESH_SIMPLIFIER_HPP
@@ -0,0 +1,63 @@
+#include "pipeline/ComputePipeline.hpp"
+
+
+bool ComputePipeline::create(const Shader& shader, const DescriptorSetLayout& layoutInfo, uint32_t pushConstantSize, VkDevice device) noexcept
+{
+    destroy(device); // for recreate case
+
+    const VkDescriptorSetLayoutCreateInfo setLayoutInfo = layoutInfo.getInfo();
+
+    if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, VK_NULL_HANDLE, &descriptorSetLayout) != VK_SUCCESS)
+        return false;
+
+    const VkPushConstantRange pushConstantRange = 
+    {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = pushConstantSize
+    };
+
+    const VkPipelineLayoutCreateInfo pipelineLayoutInfo = 
+    {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext                  = VK_NULL_HANDLE,
+        .flags                  = 0,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &descriptorSetLayout,
+        .pushConstantRangeCount = pushConstantSize ? 1u : 0u,
+        .pPushConstantRanges    = pushConstantSize ? &pushConstantRange : VK_NULL_HANDLE
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, VK_NULL_HANDLE, &layout) != VK_SUCCESS)
+        return false;
+
+    const VkComputePipelineCreateInfo pipelineInfo = 
+    {
+        .sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext              = VK_NULL_HANDLE,
+        .flags              = 0,
+        .stage              = shader.getInfo(),
+        .layout             = layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex  = 0
+    };
+
+    return (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_NULL_HANDLE, &handle) == VK_SUCCESS);
+}
+
+
+void ComputePipeline::destroy(VkDevice device) noexcept
+{
+    if(handle)
+        vkDestroyPipeline(device, handle, VK_NULL_HANDLE);
+
+    if(layout)
+        vkDestroyPipelineLayout(device, layout, VK_NULL_HANDLE);
+
+    if(descriptorSetLayout)
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, VK_NULL_HANDLE);
+
+    handle              = VK_NULL_HANDLE;
+    layout              = VK_NULL_HANDLE;
+    descriptorSetLayout = VK_NULL_HANDLE;
+}
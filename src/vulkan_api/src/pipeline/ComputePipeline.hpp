@@ -0,0 +1,21 @@
+#ifndef COMPUTE_PIPELINE_HPP
+#define COMPUTE_PIPELINE_HPP
+
+#include <cstdint>
+
+#include "pipeline/stages/shader/Shader.hpp"
+#include "pipeline/stages/uniform/DescriptorSetLayout.hpp"
+
+
+// A compute shader with one descriptor set and an optional push constant block
+struct ComputePipeline
+{
+    bool create(const Shader& shader, const DescriptorSetLayout& layoutInfo, uint32_t pushConstantSize, VkDevice device) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout      layout              = VK_NULL_HANDLE;
+    VkPipeline            handle              = VK_NULL_HANDLE;
+};
+
+#endif // !COMPUTE_PIPELINE_HPP
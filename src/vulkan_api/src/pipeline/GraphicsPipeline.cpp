@@ -90,7 +90,7 @@ bool GraphicsPipeline::create(const GraphicsPipeline::State& state, const MainVi
     VkDevice         device = view.context->device;
     destroy(device); // for recreate case
 
-    const VkFormat colorFormat = view.format;
+    const VkFormat colorFormat = (state.colorFormat != VK_FORMAT_UNDEFINED) ? state.colorFormat : view.format;
     const VkFormat depthFormat = vktools::find_depth_format(GPU);
 
     const VkPipelineVertexInputStateCreateInfo vertexInput = state.vertexInputState.getInfo();
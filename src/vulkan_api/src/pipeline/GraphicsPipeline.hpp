@@ -29,6 +29,7 @@ struct GraphicsPipeline
         VkPipelineMultisampleStateCreateInfo         multisampling;
         VkPipelineColorBlendAttachmentState          colorBlending;
         DescriptorSetLayout                          layoutInfo;
+        VkFormat                                     colorFormat = VK_FORMAT_UNDEFINED; // the swapchain format when undefined
     };
 
     bool create(const State& state, const MainView& view) noexcept;
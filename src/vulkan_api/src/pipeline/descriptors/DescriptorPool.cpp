@@ -1,14 +1,14 @@
 #include "pipeline/descriptors/DescriptorPool.hpp"
 
 
-bool DescriptorPool::create(std::span<const VkDescriptorPoolSize> poolSizes, VkDevice device) noexcept
+bool DescriptorPool::create(std::span<const VkDescriptorPoolSize> poolSizes, VkDevice device, uint32_t maxSets) noexcept
 {
     const VkDescriptorPoolCreateInfo poolInfo = 
     {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext         = VK_NULL_HANDLE,
         .flags         = 0,
-        .maxSets       = MAX_FRAMES_IN_FLIGHT,
+        .maxSets       = maxSets,
         .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
         .pPoolSizes    = poolSizes.data()
     };
@@ -62,6 +62,66 @@ void DescriptorPool::writeCombinedImageSampler(const VkDescriptorImageInfo* imag
 }
 
 
+void DescriptorPool::writeUniformBuffer(const VkDescriptorBufferInfo* bufferInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept
+{
+    const VkWriteDescriptorSet descriptorWrite = 
+    {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = VK_NULL_HANDLE,
+        .dstSet           = descriptorSet,
+        .dstBinding       = dstBinding,
+        .dstArrayElement  = 0,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .pImageInfo       = VK_NULL_HANDLE,
+        .pBufferInfo      = bufferInfo,
+        .pTexelBufferView = VK_NULL_HANDLE
+    };
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, VK_NULL_HANDLE);
+}
+
+
+void DescriptorPool::writeStorageBuffer(const VkDescriptorBufferInfo* bufferInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept
+{
+    const VkWriteDescriptorSet descriptorWrite = 
+    {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = VK_NULL_HANDLE,
+        .dstSet           = descriptorSet,
+        .dstBinding       = dstBinding,
+        .dstArrayElement  = 0,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pImageInfo       = VK_NULL_HANDLE,
+        .pBufferInfo      = bufferInfo,
+        .pTexelBufferView = VK_NULL_HANDLE
+    };
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, VK_NULL_HANDLE);
+}
+
+
+void DescriptorPool::writeStorageImage(const VkDescriptorImageInfo* imageInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept
+{
+    const VkWriteDescriptorSet descriptorWrite = 
+    {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = VK_NULL_HANDLE,
+        .dstSet           = descriptorSet,
+        .dstBinding       = dstBinding,
+        .dstArrayElement  = 0,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .pImageInfo       = imageInfo,
+        .pBufferInfo      = VK_NULL_HANDLE,
+        .pTexelBufferView = VK_NULL_HANDLE
+    };
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, VK_NULL_HANDLE);
+}
+
+
 void DescriptorPool::destroy(VkDevice device) noexcept
 {
     vkDestroyDescriptorPool(device, handle, VK_NULL_HANDLE);
@@ -8,9 +8,12 @@
 
 struct DescriptorPool
 {
-    bool create(std::span<const VkDescriptorPoolSize> poolSizes, VkDevice device) noexcept;
+    bool create(std::span<const VkDescriptorPoolSize> poolSizes, VkDevice device, uint32_t maxSets = MAX_FRAMES_IN_FLIGHT) noexcept;
     bool allocateDescriptorSets(std::span<VkDescriptorSet> descriptorSets, const VkDescriptorSetLayout* layouts, VkDevice device) noexcept;
     void writeCombinedImageSampler(const VkDescriptorImageInfo* imageInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept;
+    void writeUniformBuffer(const VkDescriptorBufferInfo* bufferInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept;
+    void writeStorageBuffer(const VkDescriptorBufferInfo* bufferInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept;
+    void writeStorageImage(const VkDescriptorImageInfo* imageInfo, VkDescriptorSet descriptorSet, uint32_t dstBinding, VkDevice device) noexcept;
     void destroy(VkDevice device) noexcept;
 
     VkDescriptorPool handle = VK_NULL_HANDLE;
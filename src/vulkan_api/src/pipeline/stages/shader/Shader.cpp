@@ -1,15 +1,22 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <new>
 
+#include "assets/AssetPack.hpp"
 #include "pipeline/stages/shader/Shader.hpp"
 
 
+// Compressed SPIR-V up to this size is expanded on the caller's stack (64 KiB)
+static constexpr size_t SHADER_STACK_WORDS = 16384;
+
 // Helper function to read a file into a buffer
 static size_t read_shader_file(const char* filename, char** buffer) noexcept;
 
 // Function to create a shader module from SPIR-V data
 static VkShaderModule create_shader_module(VkDevice device, const char* filename) noexcept;
+static VkShaderModule create_shader_module(VkDevice device, const uint32_t* code, size_t codeSize) noexcept;
 
 
 Shader::Shader(VkDevice device) noexcept:
@@ -42,6 +49,56 @@ bool Shader::loadFromFile(const char* filePath, VkShaderStageFlagBits stage) noe
 }
 
 
+bool Shader::loadFromMemory(const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stage) noexcept
+{
+    if(auto shaderModule = create_shader_module(m_device, code, codeSize))
+    {
+        m_module = shaderModule;
+        m_stage = stage;
+
+        return true;
+    }
+        
+    return false;
+}
+
+
+bool Shader::loadFromPack(const AssetPack& pack, std::string_view name, VkShaderStageFlagBits stage) noexcept
+{
+    const AssetPack::Entry* entry = pack.find(name);
+
+    if ( ! entry || entry->size % sizeof(uint32_t) != 0 )
+        return false;
+
+//  Payloads are 4K-aligned, so stored SPIR-V goes to the driver straight from the mapping
+    if (entry->compression == AssetPack::Uncompressed)
+    {
+        const auto payload = pack.getPrefix(*entry);
+
+        return loadFromMemory(reinterpret_cast<const uint32_t*>(payload.data()), payload.size(), stage);
+    }
+
+//  The driver copies the code when the module is created, so it is expanded on the stack unless it is unusually large
+    uint32_t local[SHADER_STACK_WORDS];
+    std::unique_ptr<uint32_t[]> large;
+    uint32_t* code = local;
+
+    if (entry->size > sizeof(local))
+    {
+        large.reset(new (std::nothrow) uint32_t[static_cast<size_t>(entry->size / sizeof(uint32_t))]);
+        code = large.get();
+
+        if ( ! code )
+            return false;
+    }
+
+    if ( ! pack.read(*entry, code) )
+        return false;
+
+    return loadFromMemory(code, static_cast<size_t>(entry->size), stage);
+}
+
+
 VkPipelineShaderStageCreateInfo Shader::getInfo() const noexcept
 {
     const VkPipelineShaderStageCreateInfo info =
@@ -134,5 +191,25 @@ VkShaderModule create_shader_module(VkDevice device, const char* filename) noexc
 
     free(code);
 
+    return shaderModule;
+}
+
+
+VkShaderModule create_shader_module(VkDevice device, const uint32_t* code, size_t codeSize) noexcept
+{
+    const VkShaderModuleCreateInfo createInfo = 
+    {
+        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .pNext    = VK_NULL_HANDLE,
+        .flags    = 0,
+        .codeSize = codeSize,
+        .pCode    = code
+    };
+
+    VkShaderModule shaderModule;
+
+    if (vkCreateShaderModule(device, &createInfo, NULL, &shaderModule) != VK_SUCCESS) 
+        return VK_NULL_HANDLE;
+
     return shaderModule;
 }
\ No newline at end of file
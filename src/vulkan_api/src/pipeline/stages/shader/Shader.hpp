@@ -1,6 +1,8 @@
 #ifndef SHADER_MODULE_HPP
 #define SHADER_MODULE_HPP
 
+#include <string_view>
+
 #include <vulkan/vulkan.h>
 
 class Shader
@@ -14,6 +16,8 @@ public:
     ~Shader();
 
     bool loadFromFile(const char* filePath, VkShaderStageFlagBits stage) noexcept;
+    bool loadFromMemory(const uint32_t* code, size_t codeSize, VkShaderStageFlagBits stage) noexcept;
+    bool loadFromPack(const class AssetPack& pack, std::string_view name, VkShaderStageFlagBits stage) noexcept;
 
     VkPipelineShaderStageCreateInfo getInfo() const noexcept;
 
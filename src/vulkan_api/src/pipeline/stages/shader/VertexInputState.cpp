@@ -57,6 +57,7 @@ uint32_t shader_attribute_type_to_component_count(const VertexInputState::Attrib
 
         case VertexInputState::Float2:
         case VertexInputState::Int2:
+        case VertexInputState::Half2:
             return 2;
 
         case VertexInputState::Float3:
@@ -65,6 +66,7 @@ uint32_t shader_attribute_type_to_component_count(const VertexInputState::Attrib
 
         case VertexInputState::Float4:
         case VertexInputState::Int4:
+        case VertexInputState::Half4:
             return 4;
     }
 
@@ -87,6 +89,10 @@ size_t shader_attribute_type_sizeof(const VertexInputState::AttributeType type)
         case VertexInputState::Int3:
         case VertexInputState::Int4:
             return sizeof(int32_t) * shader_attribute_type_to_component_count(type);
+
+        case VertexInputState::Half2:
+        case VertexInputState::Half4:
+            return sizeof(uint16_t) * shader_attribute_type_to_component_count(type);
     }
 
     return 0;
@@ -106,6 +112,9 @@ VkFormat shader_attribute_type_to_vk_format(const VertexInputState::AttributeTyp
         case VertexInputState::Int2: return VK_FORMAT_R32G32_SINT;
         case VertexInputState::Int3: return VK_FORMAT_R32G32B32_SINT;
         case VertexInputState::Int4: return VK_FORMAT_R32G32B32A32_SINT;
+
+        case VertexInputState::Half2: return VK_FORMAT_R16G16_SFLOAT;
+        case VertexInputState::Half4: return VK_FORMAT_R16G16B16A16_SFLOAT;
     }
 
     return VK_FORMAT_UNDEFINED;
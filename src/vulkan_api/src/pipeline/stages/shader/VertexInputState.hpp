@@ -17,7 +17,9 @@ struct VertexInputState
         Int1,
         Int2,
         Int3,
-        Int4
+        Int4,
+        Half2,
+        Half4
     };
 
     void create(std::span<const VertexInputState::AttributeType> attributes) noexcept;
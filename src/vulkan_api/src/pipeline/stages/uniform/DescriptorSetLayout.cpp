@@ -19,11 +19,22 @@ void DescriptorSetLayout::addDescriptor(VkDescriptorType type, VkShaderStageFlag
     };
 
     m_bindings.push_back(nextBinding);
+    m_samplers.push_back(VK_NULL_HANDLE);
+}
+
+
+void DescriptorSetLayout::addImmutableSampler(VkSampler sampler, VkShaderStageFlagBits shaderStage) noexcept
+{
+    addDescriptor(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, shaderStage);
+    m_samplers.back() = sampler;
 }
 
 
 VkDescriptorSetLayoutCreateInfo DescriptorSetLayout::getInfo() const noexcept
 {
+    for (size_t i = 0; i < m_bindings.size(); ++i)
+        m_bindings[i].pImmutableSamplers = m_samplers[i] ? &m_samplers[i] : VK_NULL_HANDLE;
+
     const VkDescriptorSetLayoutCreateInfo info = 
     {
         .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
@@ -10,10 +10,18 @@ struct DescriptorSetLayout
 {
 public:
     void addDescriptor(VkDescriptorType type, VkShaderStageFlagBits shaderStage) noexcept;
+
+//  Combined image sampler whose sampler is baked into the layout (and so into the pipeline),
+//  descriptor writes for this binding only need the image view. The sampler must outlive the layout
+    void addImmutableSampler(VkSampler sampler, VkShaderStageFlagBits shaderStage) noexcept;
+
+//  The returned info points into this object
     VkDescriptorSetLayoutCreateInfo getInfo() const noexcept;
 
 private:
-    std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+//  pImmutableSamplers are pointed at m_samplers by getInfo(), so copies of the layout stay valid
+    mutable std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+    std::vector<VkSampler> m_samplers; // one per binding, VK_NULL_HANDLE for the regular ones
 };
 
 #endif // !DESCRIPTOR_SET_LAYOUT_HPP
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <new>
 #include <memory>
 #include <cstring>
 
@@ -90,10 +91,18 @@ namespace
 
         if(depthFormat != VK_FORMAT_UNDEFINED)
         {
+//          Read back by the depth pyramid of occlusion culling, where the format allows it
+            view->depth.sampled = (vktools::find_supported_format(&depthFormat, 1, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT, view->context->GPU) == depthFormat);
+
+            VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+            if (view->depth.sampled)
+                usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
             result = vktools::create_image_2D(view->extent, 
                                               depthFormat, 
                                               VK_IMAGE_TILING_OPTIMAL, 
-                                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
+                                              usage, 
                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
                                               &view->depth.image, 
                                               &view->depth.imageMemory, 
@@ -152,87 +161,65 @@ bool MainView::createSurface(uint64_t windowHandle) noexcept
 
 bool MainView::recreate(bool useDepth) noexcept
 {
-    if (surface)
-    {
-        VkDevice device = context->device;
+    if (!surface)
+        return true;
 
-        if (swapchain)
-        {
-            for(const auto imageView : imageViews)
-                vkDestroyImageView(device, imageView, VK_NULL_HANDLE);
+    auto swapChainSupport = query_swapchain_support(this);
+    const VkSurfaceFormatKHR surfaceFormat = swapChainSupport->getSurfaceFormat();
 
-            vkDestroySwapchainKHR(device, swapchain, VK_NULL_HANDLE);
-            swapchain = VK_NULL_HANDLE;
-        }
+    format      = surfaceFormat.format;
+    colorSpace  = surfaceFormat.colorSpace;
+    presentMode = swapChainSupport->getPresentMode();
+    m_useDepth  = useDepth;
 
-        auto swapChainSupport = query_swapchain_support(this);
-        const uint32_t minImageCount = swapChainSupport->capabilities.minImageCount;
+    return create_swapchain(choose_swap_extent(swapChainSupport.get(), &extent), swapChainSupport->capabilities, 0);
+}
 
-        format = swapChainSupport->getSurfaceFormat().format;
-        extent = choose_swap_extent(swapChainSupport.get(), &extent);
 
-        const VkSwapchainCreateInfoKHR swapchainInfo = 
-        {
-            .sType                 = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-            .pNext                 = VK_NULL_HANDLE,
-            .flags                 = 0,
-            .surface               = surface,
-            .minImageCount         = minImageCount,
-            .imageFormat           = format,
-            .imageColorSpace       = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-            .imageExtent           = extent,
-            .imageArrayLayers      = 1,
-            .imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-            .imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE,
-            .queueFamilyIndexCount = 0,
-            .pQueueFamilyIndices   = VK_NULL_HANDLE,
-            .preTransform          = swapChainSupport->capabilities.currentTransform,
-            .compositeAlpha        = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-            .presentMode           = swapChainSupport->getPresentMode(),
-            .clipped               = VK_TRUE,
-            .oldSwapchain          = swapchain
-        };
-
-        if (vkCreateSwapchainKHR(device, &swapchainInfo, VK_NULL_HANDLE, &swapchain) == VK_SUCCESS)
-        {
-            uint32_t imageCount = 0;
-            
-            if(vkGetSwapchainImagesKHR(device, swapchain, &imageCount, VK_NULL_HANDLE) != VK_SUCCESS)
-                return false;
+bool MainView::resize(VkExtent2D newExtent, uint64_t frameNumber) noexcept
+{
+    if (!surface)
+        return true;
 
-            if(images.empty())
-                images.resize(imageCount);
-            
-            if(imageViews.empty())
-                imageViews.resize(imageCount);
-            
-            if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data()) == VK_SUCCESS)
-            {
-                for (uint32_t i = 0; i < imageViews.size(); ++i)
-                {
-                    if (!vktools::create_image_view_2D(device, images[i], format, VK_IMAGE_ASPECT_COLOR_BIT, &imageViews[i]))
-                        return false;  
-                }
-
-                if (useDepth)
-                {
-                    if (depth.imageView)
-                        vkDestroyImageView(device, depth.imageView, VK_NULL_HANDLE);
-
-                    if (depth.image)
-                        vkDestroyImage(device, depth.image, VK_NULL_HANDLE);
-
-                    if (depth.imageMemory)
-                        vkFreeMemory(device, depth.imageMemory, VK_NULL_HANDLE);
-
-                    if(!create_depth_resources(this))
-                        return false;
-                }
-            }
-        }
-    }
+//  Format, color space and present mode were chosen once in recreate(), only the extent changes here
+    SwapChainSupportDetails details;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context->GPU, surface, &details.capabilities);
 
-    return true;
+    const VkExtent2D actualExtent = choose_swap_extent(&details, &newExtent);
+
+    if (actualExtent.width == 0 || actualExtent.height == 0)
+        return false; // minimized, keep the current swapchain until the window is restored
+
+    return create_swapchain(actualExtent, details.capabilities, frameNumber);
+}
+
+
+void MainView::releaseRetired(uint64_t completedFrames) noexcept
+{
+    VkDevice device = context->device;
+
+    std::erase_if(m_retired, [device, completedFrames](const RetiredResources& retired)
+    {
+        if (retired.frameNumber > completedFrames)
+            return false;
+
+        for (const auto imageView : retired.imageViews)
+            vkDestroyImageView(device, imageView, VK_NULL_HANDLE);
+
+        if (retired.swapchain)
+            vkDestroySwapchainKHR(device, retired.swapchain, VK_NULL_HANDLE);
+
+        if (retired.depthView)
+            vkDestroyImageView(device, retired.depthView, VK_NULL_HANDLE);
+
+        if (retired.depthImage)
+            vkDestroyImage(device, retired.depthImage, VK_NULL_HANDLE);
+
+        if (retired.depthMemory)
+            vkFreeMemory(device, retired.depthMemory, VK_NULL_HANDLE);
+
+        return true;
+    });
 }
 
 
@@ -240,6 +227,8 @@ void MainView::destroy() noexcept
 {
     VkDevice device = context->device;
 
+    releaseRetired(UINT64_MAX);
+
     if(swapchain)
     {
         for(const auto imageView : imageViews)
@@ -259,4 +248,111 @@ void MainView::destroy() noexcept
 
     if(surface)
         vkDestroySurfaceKHR(context->instance, surface, VK_NULL_HANDLE);
+}
+
+
+bool MainView::create_swapchain(VkExtent2D newExtent, const VkSurfaceCapabilitiesKHR& capabilities, uint64_t frameNumber) noexcept
+{
+    VkDevice device = context->device;
+
+    uint32_t minImageCount = capabilities.minImageCount + 1;
+
+    if (capabilities.maxImageCount > 0 && minImageCount > capabilities.maxImageCount)
+        minImageCount = capabilities.maxImageCount;
+
+    const VkSwapchainCreateInfoKHR swapchainInfo = 
+    {
+        .sType                 = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .pNext                 = VK_NULL_HANDLE,
+        .flags                 = 0,
+        .surface               = surface,
+        .minImageCount         = minImageCount,
+        .imageFormat           = format,
+        .imageColorSpace       = colorSpace,
+        .imageExtent           = newExtent,
+        .imageArrayLayers      = 1,
+        .imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = VK_NULL_HANDLE,
+        .preTransform          = capabilities.currentTransform,
+        .compositeAlpha        = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        .presentMode           = presentMode,
+        .clipped               = VK_TRUE,
+        .oldSwapchain          = swapchain
+    };
+
+//  Room for the old objects is made first, so nothing can fail between retiring them and handing them over
+    try
+    {
+        m_retired.emplace_back();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    VkSwapchainKHR newSwapchain = VK_NULL_HANDLE;
+
+    if (vkCreateSwapchainKHR(device, &swapchainInfo, VK_NULL_HANDLE, &newSwapchain) != VK_SUCCESS)
+    {
+        m_retired.pop_back();
+
+        return false;
+    }
+
+//  The old swapchain is retired now, but frames in flight may still reference its images:
+//  hand it over to releaseRetired() instead of waiting for the device to go idle.
+//  Views created below before a failure stay in 'imageViews' and are retired by the next attempt
+    RetiredResources& retired = m_retired.back();
+    retired.frameNumber = frameNumber;
+    retired.swapchain   = swapchain;
+    retired.imageViews  = std::move(imageViews);
+
+    swapchain = newSwapchain;
+    extent    = newExtent;
+    imageViews.clear();
+
+    uint32_t imageCount = 0;
+    
+    if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, VK_NULL_HANDLE) != VK_SUCCESS)
+        return false;
+
+    images.resize(imageCount);
+    imageViews.resize(imageCount, VK_NULL_HANDLE);
+    
+    if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data()) != VK_SUCCESS)
+        return false;
+
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        if (!vktools::create_image_view_2D(device, images[i], format, VK_IMAGE_ASPECT_COLOR_BIT, &imageViews[i]))
+            return false;  
+    }
+
+    if (m_useDepth)
+    {
+//      A depth image at least as large as the render area can stay, the render area is clipped by the extent
+        const bool depthFits = depth.image &&
+                               extent.width  <= depth.capacity.width &&
+                               extent.height <= depth.capacity.height;
+
+        if (!depthFits)
+        {
+            retired.depthView   = depth.imageView;
+            retired.depthImage  = depth.image;
+            retired.depthMemory = depth.imageMemory;
+
+            depth.imageView   = VK_NULL_HANDLE;
+            depth.image       = VK_NULL_HANDLE;
+            depth.imageMemory = VK_NULL_HANDLE;
+
+            if (!create_depth_resources(this))
+                return false;
+
+            depth.capacity = extent;
+        }
+    }
+
+    return true;
 }
\ No newline at end of file
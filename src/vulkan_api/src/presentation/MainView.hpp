@@ -11,6 +11,8 @@ class MainView
 public:
     bool createSurface(uint64_t windowHandle) noexcept;
     bool recreate(bool useDepth) noexcept;
+    bool resize(VkExtent2D newExtent, uint64_t frameNumber) noexcept;
+    void releaseRetired(uint64_t completedFrames) noexcept;
     void destroy() noexcept;
 
     const VulkanContext* context = nullptr;
@@ -26,10 +28,31 @@ public:
         VkImage        image       = nullptr;
         VkDeviceMemory imageMemory = nullptr;
         VkImageView    imageView   = nullptr;
+        VkExtent2D     capacity    = { 0, 0 };
+        bool           sampled     = false; // usable as a sampled image, required by occlusion culling
     } depth;
 
-    VkFormat   format;
-    VkExtent2D extent;
+    VkFormat         format      = VK_FORMAT_UNDEFINED;
+    VkColorSpaceKHR  colorSpace  = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkExtent2D       extent      = { 0, 0 };
+
+private:
+    bool create_swapchain(VkExtent2D newExtent, const VkSurfaceCapabilitiesKHR& capabilities, uint64_t frameNumber) noexcept;
+
+//  Swapchain and depth objects replaced by a resize, destroyed once every frame that used them has retired
+    struct RetiredResources
+    {
+        VkSwapchainKHR           swapchain   = VK_NULL_HANDLE;
+        std::vector<VkImageView> imageViews;
+        VkImage                  depthImage  = VK_NULL_HANDLE;
+        VkDeviceMemory           depthMemory = VK_NULL_HANDLE;
+        VkImageView              depthView   = VK_NULL_HANDLE;
+        uint64_t                 frameNumber = 0;
+    };
+
+    std::vector<RetiredResources> m_retired;
+    bool m_useDepth = false;
 };
 
 #endif // !MAIN_VIEW_HPP
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include <algorithm>
+
+#include "context/Context.hpp"
+#include "presentation/MainView.hpp"
+#include "sync/DeletionQueue.hpp"
+#include "utils/Tools.hpp"
+#include "render/DepthPyramid.hpp"
+
+
+namespace
+{
+    constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+    constexpr uint32_t GROUP_SIZE     = 8; // local_size of depth_reduce.comp
+
+
+    uint32_t previous_power_of_two(uint32_t value) noexcept
+    {
+        uint32_t result = 1;
+
+        while (result * 2 <= value)
+            result *= 2;
+
+        return result;
+    }
+
+
+    bool create_level_view(VkDevice device, VkImage image, uint32_t level, VkImageView* imageView) noexcept
+    {
+        const VkImageViewCreateInfo viewInfo =
+        {
+            .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext      = VK_NULL_HANDLE,
+            .flags      = 0,
+            .image      = image,
+            .viewType   = VK_IMAGE_VIEW_TYPE_2D,
+            .format     = PYRAMID_FORMAT,
+            .components =
+            {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = level,
+                .levelCount     = 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        return (vkCreateImageView(device, &viewInfo, VK_NULL_HANDLE, imageView) == VK_SUCCESS);
+    }
+
+
+    VkImageMemoryBarrier depth_barrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess) noexcept
+    {
+        const VkImageMemoryBarrier barrier =
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = srcAccess,
+            .dstAccessMask       = dstAccess,
+            .oldLayout           = oldLayout,
+            .newLayout           = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .baseMipLevel   = 0,
+                .levelCount     = 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        return barrier;
+    }
+}
+
+
+
+bool DepthPyramid::create(const VulkanContext* context, const Shader& reduceShader, DeletionQueue* deletionQueue) noexcept
+{
+    VkDevice device = context->device;
+
+    m_context       = context;
+    m_deletionQueue = deletionQueue;
+
+//  Only texelFetch reads through it, so neither filtering nor the reduction mode matter
+    VkSamplerCreateInfo samplerInfo = SamplerCache::getDefaultInfo(context->GPU);
+    samplerInfo.magFilter        = VK_FILTER_NEAREST;
+    samplerInfo.minFilter        = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy    = 1.f;
+
+    m_sampler = context->samplers.acquire(samplerInfo, device);
+
+    if (!m_sampler)
+        return false;
+
+    DescriptorSetLayout layoutInfo;
+    layoutInfo.addImmutableSampler(m_sampler, VK_SHADER_STAGE_COMPUTE_BIT);       // source level or depth attachment
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT); // target level
+
+    if (!m_pipeline.create(reduceShader, layoutInfo, sizeof(Reduction), device))
+        return false;
+
+    constexpr uint32_t SET_COUNT = MAX_LEVELS * MAX_FRAMES_IN_FLIGHT;
+
+    const std::array<VkDescriptorPoolSize, 2> poolSizes =
+    {
+        VkDescriptorPoolSize
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = SET_COUNT
+        },
+        VkDescriptorPoolSize
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = SET_COUNT
+        }
+    };
+
+    if (!m_descriptorPool.create(poolSizes, device, SET_COUNT))
+        return false;
+
+    std::array<VkDescriptorSetLayout, MAX_LEVELS> layouts;
+    layouts.fill(m_pipeline.descriptorSetLayout);
+
+    for (auto& sets : m_descriptorSets)
+        if (!m_descriptorPool.allocateDescriptorSets(sets, layouts.data(), device))
+            return false;
+
+    return true;
+}
+
+
+void DepthPyramid::destroy(VkDevice device) noexcept
+{
+    for (auto& levelView : m_levelViews)
+        if (levelView)
+            vkDestroyImageView(device, levelView, VK_NULL_HANDLE);
+
+    if (m_view)
+        vkDestroyImageView(device, m_view, VK_NULL_HANDLE);
+
+    if (m_image)
+        vkDestroyImage(device, m_image, VK_NULL_HANDLE);
+
+    if (m_memory)
+        vkFreeMemory(device, m_memory, VK_NULL_HANDLE);
+
+    m_levelViews = {};
+    m_view       = VK_NULL_HANDLE;
+    m_image      = VK_NULL_HANDLE;
+    m_memory     = VK_NULL_HANDLE;
+
+    m_descriptorPool.destroy(device);
+    m_pipeline.destroy(device);
+
+    if (m_sampler)
+        m_context->samplers.release(m_sampler, device);
+
+    m_sampler = VK_NULL_HANDLE;
+}
+
+
+bool DepthPyramid::prepare(uint32_t frame, const MainView& view) noexcept
+{
+    if (view.extent.width != m_viewExtent.width || view.extent.height != m_viewExtent.height)
+        if (!resize(view.extent))
+            return false;
+
+//  The slot's fence has been waited on, its sets are free to rewrite
+    if (m_setVersions[frame] != m_version || m_setSources[frame] != view.depth.imageView)
+        writeDescriptors(frame, view.depth.imageView);
+
+    return true;
+}
+
+
+void DepthPyramid::build(VkCommandBuffer cmd, uint32_t frame, const MainView& view) const noexcept
+{
+    const VkImageMemoryBarrier startBarriers[] =
+    {
+        depth_barrier(view.depth.image,
+                      VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                      VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                      VK_ACCESS_SHADER_READ_BIT),
+
+    //  The previous contents were read by the last frame's culling, they are overwritten entirely
+        VkImageMemoryBarrier
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = VK_ACCESS_NONE,
+            .dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = m_image,
+            .subresourceRange    =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = 0,
+                .levelCount     = m_levelCount,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        }
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         VK_NULL_HANDLE,
+                         0,
+                         VK_NULL_HANDLE,
+                         2,
+                         startBarriers);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.handle);
+
+    Reduction reduction = { m_viewExtent, m_extent };
+
+    for (uint32_t level = 0; level < m_levelCount; ++level)
+    {
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.layout, 0, 1, &m_descriptorSets[frame][level], 0, VK_NULL_HANDLE);
+        vkCmdPushConstants(cmd, m_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Reduction), &reduction);
+        vkCmdDispatch(cmd, (reduction.target.width + GROUP_SIZE - 1) / GROUP_SIZE, (reduction.target.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+//      The next level reads this one, the culling pass reads all of them
+        const VkImageMemoryBarrier levelBarrier =
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = m_image,
+            .subresourceRange    =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = level,
+                .levelCount     = 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        vkCmdPipelineBarrier(cmd,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             0,
+                             VK_NULL_HANDLE,
+                             0,
+                             VK_NULL_HANDLE,
+                             1,
+                             &levelBarrier);
+
+        reduction.source = reduction.target;
+        reduction.target = { std::max(reduction.target.width / 2, 1u), std::max(reduction.target.height / 2, 1u) };
+    }
+
+//  Rendering continues on top of this depth
+    const VkImageMemoryBarrier endBarrier = depth_barrier(view.depth.image,
+                                                          VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                          VK_ACCESS_NONE,
+                                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         0,
+                         0,
+                         VK_NULL_HANDLE,
+                         0,
+                         VK_NULL_HANDLE,
+                         1,
+                         &endBarrier);
+}
+
+
+VkImageView DepthPyramid::getView() const noexcept
+{
+    return m_view;
+}
+
+
+VkSampler DepthPyramid::getSampler() const noexcept
+{
+    return m_sampler;
+}
+
+
+VkExtent2D DepthPyramid::getExtent() const noexcept
+{
+    return m_extent;
+}
+
+
+uint64_t DepthPyramid::getVersion() const noexcept
+{
+    return m_version;
+}
+
+
+bool DepthPyramid::resize(VkExtent2D viewExtent) noexcept
+{
+    VkDevice device = m_context->device;
+
+    release();
+
+//  Power of two levels halve exactly, only the reduction from the view itself covers uneven footprints
+    m_viewExtent = viewExtent;
+    m_extent     = { previous_power_of_two(viewExtent.width), previous_power_of_two(viewExtent.height) };
+    m_levelCount = std::min(vktools::get_mip_levels(m_extent), MAX_LEVELS);
+    ++m_version;
+
+    if (!vktools::create_image_2D(m_extent,
+                                  PYRAMID_FORMAT,
+                                  VK_IMAGE_TILING_OPTIMAL,
+                                  VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &m_image,
+                                  &m_memory,
+                                  m_context->GPU,
+                                  device,
+                                  m_levelCount))
+    {
+        m_viewExtent = { 0, 0 }; // retried next frame
+
+        return false;
+    }
+
+    bool result = vktools::create_image_view_2D(device, m_image, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, &m_view, m_levelCount);
+
+    for (uint32_t level = 0; result && level < m_levelCount; ++level)
+        result = create_level_view(device, m_image, level, &m_levelViews[level]);
+
+    if (!result)
+    {
+        release();
+        m_viewExtent = { 0, 0 };
+    }
+
+    return result;
+}
+
+
+void DepthPyramid::release() noexcept
+{
+//  Frames in flight may still read the old image
+    for (auto& levelView : m_levelViews)
+        if (levelView)
+            m_deletionQueue->destroyImageView(levelView);
+
+    if (m_view)
+        m_deletionQueue->destroyImageView(m_view);
+
+    if (m_image)
+        m_deletionQueue->destroyImage(m_image, m_memory);
+
+    m_levelViews = {};
+    m_view       = VK_NULL_HANDLE;
+    m_image      = VK_NULL_HANDLE;
+    m_memory     = VK_NULL_HANDLE;
+}
+
+
+void DepthPyramid::writeDescriptors(uint32_t frame, VkImageView depthView) noexcept
+{
+    VkDevice device = m_context->device;
+
+    for (uint32_t level = 0; level < m_levelCount; ++level)
+    {
+        const VkDescriptorImageInfo sourceInfo =
+        {
+            .sampler     = VK_NULL_HANDLE,
+            .imageView   = level ? m_levelViews[level - 1] : depthView,
+            .imageLayout = level ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+        };
+
+        const VkDescriptorImageInfo targetInfo =
+        {
+            .sampler     = VK_NULL_HANDLE,
+            .imageView   = m_levelViews[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        m_descriptorPool.writeCombinedImageSampler(&sourceInfo, m_descriptorSets[frame][level], 0, device);
+        m_descriptorPool.writeStorageImage(&targetInfo, m_descriptorSets[frame][level], 1, device);
+    }
+
+    m_setVersions[frame] = m_version;
+    m_setSources[frame]  = depthView;
+}
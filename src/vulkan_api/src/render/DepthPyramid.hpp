@@ -0,0 +1,69 @@
+#ifndef DEPTH_PYRAMID_HPP
+#define DEPTH_PYRAMID_HPP
+
+#include <cstdint>
+#include <array>
+
+#include "pipeline/ComputePipeline.hpp"
+#include "pipeline/descriptors/DescriptorPool.hpp"
+
+
+// Hierarchical depth (Hi-Z) built from the depth attachment of the main view with one compute dispatch per level.
+// Level 0 is the view reduced to the previous power of two in each dimension, every further level halves it.
+// A texel holds the farthest depth of the area it covers, so anything whose nearest depth lies behind every
+// texel it overlaps is hidden. The image is rebuilt every frame and reallocated when the view is resized
+class DepthPyramid
+{
+public:
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+    bool create(const class VulkanContext* context, const Shader& reduceShader, class DeletionQueue* deletionQueue) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+//  Before anything of the frame refers to the pyramid: follows the view size and the depth attachment.
+//  Call once the fence of 'frame' has been waited on
+    bool prepare(uint32_t frame, const class MainView& view) noexcept;
+
+//  Outside of rendering, after the depth attachment was written. The attachment goes back to
+//  DEPTH_ATTACHMENT_OPTIMAL with its contents kept, the pyramid is left in GENERAL layout for compute shaders
+    void build(VkCommandBuffer cmd, uint32_t frame, const MainView& view) const noexcept;
+
+    VkImageView getView() const noexcept; // every level
+    VkSampler   getSampler() const noexcept; // nearest, clamped, for texelFetch from the pyramid or the depth attachment
+    VkExtent2D  getExtent() const noexcept; // of level 0
+    uint64_t    getVersion() const noexcept; // bumped whenever the image is replaced
+
+private:
+    struct Reduction
+    {
+        VkExtent2D source;
+        VkExtent2D target;
+    };
+
+    bool resize(VkExtent2D viewExtent) noexcept;
+    void release() noexcept;
+    void writeDescriptors(uint32_t frame, VkImageView depthView) noexcept;
+
+    const VulkanContext* m_context       = nullptr;
+    DeletionQueue*       m_deletionQueue = nullptr;
+
+    ComputePipeline m_pipeline;
+    DescriptorPool  m_descriptorPool;
+    VkSampler       m_sampler = VK_NULL_HANDLE;
+
+    VkImage                                 m_image      = VK_NULL_HANDLE;
+    VkDeviceMemory                          m_memory     = VK_NULL_HANDLE;
+    VkImageView                             m_view       = VK_NULL_HANDLE;
+    std::array<VkImageView, MAX_LEVELS>     m_levelViews = {};
+    VkExtent2D                              m_extent     = { 0, 0 };
+    VkExtent2D                              m_viewExtent = { 0, 0 };
+    uint32_t                                m_levelCount = 0;
+    uint64_t                                m_version    = 0;
+
+//  One set per level and frame slot, rewritten by the slot itself once the image or the depth attachment changed
+    std::array<std::array<VkDescriptorSet, MAX_LEVELS>, MAX_FRAMES_IN_FLIGHT> m_descriptorSets = {};
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT>    m_setVersions = {};
+    std::array<VkImageView, MAX_FRAMES_IN_FLIGHT> m_setSources  = {};
+};
+
+#endif // !DEPTH_PYRAMID_HPP
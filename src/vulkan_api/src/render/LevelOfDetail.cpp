@@ -0,0 +1,147 @@
+#include <new>
+#include <cmath>
+#include <algorithm>
+
+#include "jobs/JobSystem.hpp"
+#include "render/LevelOfDetail.hpp"
+
+
+bool LevelOfDetail::setLevels(std::span<const float> errors, float radius) noexcept
+{
+    if (errors.empty() || errors.size() > m_errors.size())
+        return false;
+
+    std::copy(errors.begin(), errors.end(), m_errors.begin());
+
+    m_levelCount = static_cast<uint32_t>(errors.size());
+    m_radius     = radius;
+
+    std::fill(m_levels.begin(), m_levels.end(), 0);
+
+    return true;
+}
+
+
+bool LevelOfDetail::reserve(uint32_t instanceCount) noexcept
+{
+    try
+    {
+        m_levels.resize(instanceCount, 0);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+void LevelOfDetail::select(const mat4s* matrices, uint32_t instanceCount, const uint8_t* visible, const mat4s& viewProjection,
+                           float pixelScale, uint32_t* drawList, JobSystem* jobs) noexcept
+{
+    const uint32_t impostor = m_levelCount;
+    const Settings current  = settings;
+    uint8_t* levels = m_levels.data();
+
+    auto choose = [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (visible && ! visible[i])
+                continue;
+
+            const mat4s& m = matrices[i];
+
+//          Clip space w of the origin is its view depth
+            const float depth = viewProjection.raw[0][3] * m.raw[3][0] + viewProjection.raw[1][3] * m.raw[3][1] +
+                                viewProjection.raw[2][3] * m.raw[3][2] + viewProjection.raw[3][3];
+
+            float scale = 0.f;
+
+            for (uint32_t axis = 0; axis < 3; ++axis)
+                scale = std::max(scale, m.raw[axis][0] * m.raw[axis][0] + m.raw[axis][1] * m.raw[axis][1] + m.raw[axis][2] * m.raw[axis][2]);
+
+//          Bounding sphere radius in world units, scaled the way occlusion_cull.comp does
+            const float unit   = std::sqrt(scale);
+            const float radius = m_radius * unit;
+
+            if (depth - radius <= 0.f)
+            {
+                levels[i] = 0;
+                continue;
+            }
+
+//          Pixels covered by one object unit at the nearest point of the bounding sphere
+            const float pixels   = pixelScale * unit / (depth - radius);
+            const uint32_t previous = levels[i];
+
+            auto margin = [&](uint32_t level)
+            {
+                return (level > previous) ? 1.f - current.hysteresis : 1.f;
+            };
+
+            if (current.impostorPixels > 0.f && m_radius * pixels <= current.impostorPixels * margin(impostor))
+            {
+                levels[i] = static_cast<uint8_t>(impostor);
+                continue;
+            }
+
+            uint32_t level = 0;
+
+            for (uint32_t l = m_levelCount - 1; l > 0; --l)
+            {
+                if (m_errors[l] * pixels <= current.pixelError * margin(l))
+                {
+                    level = l;
+                    break;
+                }
+            }
+
+            levels[i] = static_cast<uint8_t>(level);
+        }
+    };
+
+    if (jobs)
+        jobs->parallelFor(instanceCount, 1024, choose);
+    else
+        choose(0, instanceCount);
+
+//  Counting sort by level, instances keep their order within a level
+    std::array<uint32_t, MAX_LEVELS> counts = {};
+
+    for (uint32_t i = 0; i < instanceCount; ++i)
+        if (! visible || visible[i])
+            ++counts[levels[i]];
+
+    uint32_t first = 0;
+
+    for (uint32_t level = 0; level < MAX_LEVELS; ++level)
+    {
+        m_ranges[level] = { first, counts[level] };
+        first += counts[level];
+        counts[level] = m_ranges[level].first;
+    }
+
+    for (uint32_t i = 0; i < instanceCount; ++i)
+        if (! visible || visible[i])
+            drawList[counts[levels[i]]++] = i;
+}
+
+
+LevelOfDetail::Range LevelOfDetail::getRange(uint32_t level) const noexcept
+{
+    return (level < MAX_LEVELS) ? m_ranges[level] : Range{};
+}
+
+
+uint32_t LevelOfDetail::getLevelCount() const noexcept
+{
+    return m_levelCount;
+}
+
+
+uint32_t LevelOfDetail::getImpostorLevel() const noexcept
+{
+    return m_levelCount;
+}
@@ -0,0 +1,64 @@
+#ifndef LEVEL_OF_DETAIL_HPP
+#define LEVEL_OF_DETAIL_HPP
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
+
+#include <cglm/struct/mat4.h>
+
+#include "mesh/MeshBlob.hpp"
+
+
+// Discrete levels of detail chosen per instance from the projected error: the coarsest mesh level whose error
+// covers at most 'pixelError' pixels is drawn. Going coarser than the previous choice needs a 'hysteresis' margin
+// below the threshold, so an object sitting right at it does not flip every frame. An object whose bounding sphere
+// shrinks below 'impostorPixels' is drawn as a camera facing quad instead.
+// The instances are grouped by level in a draw list, one instanced draw per level reads its range
+class LevelOfDetail
+{
+public:
+    static constexpr uint32_t MAX_LEVELS = MeshBlob::MAX_LODS + 1; // mesh levels and the impostor
+
+    struct Settings
+    {
+        float pixelError     = 1.f;   // largest error allowed on screen
+        float hysteresis     = 0.25f; // fraction below a threshold needed to go coarser
+        float impostorPixels = 2.f;   // projected radius below which the impostor is drawn, 0 for none
+    };
+
+    struct Range
+    {
+        uint32_t first = 0; // in the draw list, the firstInstance of the draw
+        uint32_t count = 0;
+    };
+
+//  Errors of the mesh levels in object units, finest first. 'radius' bounds the mesh around its origin
+    bool setLevels(std::span<const float> errors, float radius) noexcept;
+
+//  Keeps the previous level of every instance, new instances start at the finest one
+    bool reserve(uint32_t instanceCount) noexcept;
+
+//  'matrices' are the world matrices of the instances, 'visible' (optional) excludes instances with a zero entry.
+//  'pixelScale' turns object size over view depth into pixels: projection[1][1] * viewport height / 2.
+//  Writes the instance indices grouped by level to 'drawList', which has room for every instance
+    void select(const mat4s* matrices, uint32_t instanceCount, const uint8_t* visible, const mat4s& viewProjection,
+                float pixelScale, uint32_t* drawList, class JobSystem* jobs) noexcept;
+
+    Range    getRange(uint32_t level) const noexcept; // of the last select()
+    uint32_t getLevelCount() const noexcept;          // mesh levels, the impostor comes right after them
+    uint32_t getImpostorLevel() const noexcept;
+
+    Settings settings;
+
+private:
+    std::array<float, MeshBlob::MAX_LODS> m_errors = {};
+    uint32_t m_levelCount = 1;
+    float    m_radius     = 0.f;
+
+    std::vector<uint8_t>              m_levels; // per instance, kept from frame to frame
+    std::array<Range, MAX_LEVELS>     m_ranges = {};
+};
+
+#endif // !LEVEL_OF_DETAIL_HPP
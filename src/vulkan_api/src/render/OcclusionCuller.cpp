@@ -0,0 +1,319 @@
+#include <algorithm>
+
+#include "context/Context.hpp"
+#include "sync/DeletionQueue.hpp"
+#include "utils/Tools.hpp"
+#include "render/DepthPyramid.hpp"
+#include "render/OcclusionCuller.hpp"
+
+
+namespace
+{
+    constexpr uint32_t GROUP_SIZE   = 64; // local_size_x of occlusion_cull.comp
+    constexpr uint32_t MIN_CAPACITY = 64;
+
+    enum Binding
+    {
+        BINDING_CAMERA,
+        BINDING_INSTANCES,
+        BINDING_VISIBILITY,
+        BINDING_DRAW_COMMANDS,
+        BINDING_DRAW_LIST,
+        BINDING_PYRAMID
+    };
+
+
+    VkBuffer create_device_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceMemory* memory, const VulkanContext* context) noexcept
+    {
+        return vktools::create_buffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory, context->device, context->GPU);
+    }
+}
+
+
+
+bool OcclusionCuller::create(const VulkanContext* context, const Shader& cullShader, const DepthPyramid& pyramid, DeletionQueue* deletionQueue) noexcept
+{
+    VkDevice device = context->device;
+
+    m_context       = context;
+    m_deletionQueue = deletionQueue;
+
+    DescriptorSetLayout layoutInfo;
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    layoutInfo.addDescriptor(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    layoutInfo.addImmutableSampler(pyramid.getSampler(), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if (!m_pipeline.create(cullShader, layoutInfo, sizeof(Constants), device))
+        return false;
+
+    const std::array<VkDescriptorPoolSize, 3> poolSizes =
+    {
+        VkDescriptorPoolSize
+        {
+            .type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = MAX_FRAMES_IN_FLIGHT
+        },
+        VkDescriptorPoolSize
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 4 * MAX_FRAMES_IN_FLIGHT
+        },
+        VkDescriptorPoolSize
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = MAX_FRAMES_IN_FLIGHT
+        }
+    };
+
+    if (!m_descriptorPool.create(poolSizes, device))
+        return false;
+
+    std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+    layouts.fill(m_pipeline.descriptorSetLayout);
+
+    return m_descriptorPool.allocateDescriptorSets(m_descriptorSets, layouts.data(), device);
+}
+
+
+void OcclusionCuller::destroy(VkDevice device) noexcept
+{
+    auto destroy_buffer = [device](VkBuffer& buffer, VkDeviceMemory& memory)
+    {
+        if (buffer)
+            vkDestroyBuffer(device, buffer, VK_NULL_HANDLE);
+
+        if (memory)
+            vkFreeMemory(device, memory, VK_NULL_HANDLE);
+
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+    };
+
+    destroy_buffer(m_visibility, m_visibilityMemory);
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        destroy_buffer(m_drawCommands[i], m_drawCommandsMemory[i]);
+        destroy_buffer(m_drawLists[i], m_drawListsMemory[i]);
+    }
+
+    m_capacity = 0;
+
+    m_descriptorPool.destroy(device);
+    m_pipeline.destroy(device);
+}
+
+
+bool OcclusionCuller::reserve(uint32_t instanceCount) noexcept
+{
+    if (instanceCount <= m_capacity)
+        return true;
+
+    release();
+
+    const uint32_t capacity = std::max({ instanceCount, m_capacity * 2, MIN_CAPACITY });
+
+    m_visibility = create_device_buffer(capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &m_visibilityMemory, m_context);
+
+    bool result = (m_visibility != VK_NULL_HANDLE);
+
+    for (uint32_t i = 0; result && i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        m_drawCommands[i] = create_device_buffer(PHASE_COUNT * sizeof(VkDrawIndexedIndirectCommand),
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 &m_drawCommandsMemory[i],
+                                                 m_context);
+
+        m_drawLists[i] = create_device_buffer(PHASE_COUNT * capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &m_drawListsMemory[i], m_context);
+
+        result = m_drawCommands[i] && m_drawLists[i];
+    }
+
+    if (!result)
+    {
+        release();
+
+        return false;
+    }
+
+    m_capacity        = capacity;
+    m_resetVisibility = true;
+    ++m_version;
+
+    return true;
+}
+
+
+void OcclusionCuller::resetVisibility() noexcept
+{
+    m_resetVisibility = true;
+}
+
+
+void OcclusionCuller::begin(VkCommandBuffer cmd, uint32_t frame, uint32_t indexCount) noexcept
+{
+    const VkDrawIndexedIndirectCommand draws[PHASE_COUNT] =
+    {
+        { indexCount, 0, 0, 0, 0 },
+        { indexCount, 0, 0, 0, m_capacity }
+    };
+
+    vkCmdUpdateBuffer(cmd, m_drawCommands[frame], 0, sizeof(draws), draws);
+
+    if (m_resetVisibility)
+    {
+        vkCmdFillBuffer(cmd, m_visibility, 0, VK_WHOLE_SIZE, 1);
+        m_resetVisibility = false;
+    }
+
+//  Also orders the visibility written by the previous frame's late phase before this frame reads it
+    const VkMemoryBarrier barrier =
+    {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = VK_NULL_HANDLE,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         VK_NULL_HANDLE,
+                         0,
+                         VK_NULL_HANDLE);
+}
+
+
+void OcclusionCuller::cull(VkCommandBuffer cmd, uint32_t frame, Phase phase, const Inputs& inputs, const DepthPyramid& pyramid) noexcept
+{
+    const Bindings& bound = m_bindings[frame];
+
+    if (bound.camera != inputs.camera || bound.instances != inputs.instances || bound.version != m_version || bound.pyramidVersion != pyramid.getVersion())
+        writeDescriptors(frame, inputs, pyramid);
+
+    const VkExtent2D pyramidExtent = pyramid.getExtent();
+
+    const Constants constants =
+    {
+        .instanceCount  = std::min(inputs.instanceCount, m_capacity),
+        .phase          = static_cast<uint32_t>(phase),
+        .lateOffset     = m_capacity,
+        .boundingRadius = inputs.boundingRadius,
+        .pyramidWidth   = static_cast<float>(pyramidExtent.width),
+        .pyramidHeight  = static_cast<float>(pyramidExtent.height)
+    };
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.handle);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline.layout, 0, 1, &m_descriptorSets[frame], 0, VK_NULL_HANDLE);
+    vkCmdPushConstants(cmd, m_pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &constants);
+    vkCmdDispatch(cmd, (constants.instanceCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+    const VkMemoryBarrier barrier =
+    {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = VK_NULL_HANDLE,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         VK_NULL_HANDLE,
+                         0,
+                         VK_NULL_HANDLE);
+}
+
+
+VkBuffer OcclusionCuller::getDrawCommands(uint32_t frame) const noexcept
+{
+    return m_drawCommands[frame];
+}
+
+
+VkDeviceSize OcclusionCuller::getDrawOffset(Phase phase) const noexcept
+{
+    return static_cast<VkDeviceSize>(phase) * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+
+VkBuffer OcclusionCuller::getDrawList(uint32_t frame) const noexcept
+{
+    return m_drawLists[frame];
+}
+
+
+uint32_t OcclusionCuller::getCapacity() const noexcept
+{
+    return m_capacity;
+}
+
+
+uint64_t OcclusionCuller::getVersion() const noexcept
+{
+    return m_version;
+}
+
+
+void OcclusionCuller::release() noexcept
+{
+//  Frames in flight may still draw from the old buffers
+    auto release_buffer = [this](VkBuffer& buffer, VkDeviceMemory& memory)
+    {
+        if (buffer)
+            m_deletionQueue->destroyBuffer(buffer, memory);
+
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+    };
+
+    release_buffer(m_visibility, m_visibilityMemory);
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        release_buffer(m_drawCommands[i], m_drawCommandsMemory[i]);
+        release_buffer(m_drawLists[i], m_drawListsMemory[i]);
+    }
+
+    m_capacity = 0;
+}
+
+
+void OcclusionCuller::writeDescriptors(uint32_t frame, const Inputs& inputs, const DepthPyramid& pyramid) noexcept
+{
+    VkDevice device = m_context->device;
+    VkDescriptorSet set = m_descriptorSets[frame];
+
+    const VkDescriptorBufferInfo cameraInfo     = { inputs.camera, 0, VK_WHOLE_SIZE };
+    const VkDescriptorBufferInfo instancesInfo  = { inputs.instances, 0, VK_WHOLE_SIZE };
+    const VkDescriptorBufferInfo visibilityInfo = { m_visibility, 0, VK_WHOLE_SIZE };
+    const VkDescriptorBufferInfo commandsInfo   = { m_drawCommands[frame], 0, VK_WHOLE_SIZE };
+    const VkDescriptorBufferInfo drawListInfo   = { m_drawLists[frame], 0, VK_WHOLE_SIZE };
+
+    const VkDescriptorImageInfo pyramidInfo =
+    {
+        .sampler     = VK_NULL_HANDLE,
+        .imageView   = pyramid.getView(),
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+    };
+
+    m_descriptorPool.writeUniformBuffer(&cameraInfo, set, BINDING_CAMERA, device);
+    m_descriptorPool.writeStorageBuffer(&instancesInfo, set, BINDING_INSTANCES, device);
+    m_descriptorPool.writeStorageBuffer(&visibilityInfo, set, BINDING_VISIBILITY, device);
+    m_descriptorPool.writeStorageBuffer(&commandsInfo, set, BINDING_DRAW_COMMANDS, device);
+    m_descriptorPool.writeStorageBuffer(&drawListInfo, set, BINDING_DRAW_LIST, device);
+    m_descriptorPool.writeCombinedImageSampler(&pyramidInfo, set, BINDING_PYRAMID, device);
+
+    m_bindings[frame] = { inputs.camera, inputs.instances, m_version, pyramid.getVersion() };
+}
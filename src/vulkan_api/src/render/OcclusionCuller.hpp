@@ -0,0 +1,103 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+#include <cstdint>
+#include <array>
+
+#include "pipeline/ComputePipeline.hpp"
+#include "pipeline/descriptors/DescriptorPool.hpp"
+
+
+// GPU culling of instances against the frustum and a depth pyramid, in two phases per frame.
+// Early: instances that were visible last frame and are in the frustum are drawn, their depth builds the pyramid.
+// Late: every instance in the frustum is tested against that pyramid. Visible ones the early phase skipped are
+// drawn on top, and the result is kept for the next frame. Whatever comes into view is drawn in the frame it
+// appears, so nothing pops in a frame late.
+// Each phase fills one VkDrawIndexedIndirectCommand and a list of instance indices the vertex shader reads
+// through gl_InstanceIndex: early entries start at 0, late ones at the capacity (the late draw's firstInstance)
+class OcclusionCuller
+{
+public:
+    enum Phase
+    {
+        PHASE_EARLY,
+        PHASE_LATE,
+        PHASE_COUNT
+    };
+
+    struct Inputs
+    {
+        VkBuffer camera         = VK_NULL_HANDLE; // CameraUniforms, frustum planes included
+        VkBuffer instances      = VK_NULL_HANDLE; // world matrices
+        uint32_t instanceCount  = 0;
+        float    boundingRadius = 0.f;            // of the mesh around its origin, scaled by each matrix
+    };
+
+    bool create(const class VulkanContext* context, const Shader& cullShader, const class DepthPyramid& pyramid, class DeletionQueue* deletionQueue) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+//  Grows the buffers to hold 'instanceCount' instances. Replaced buffers go through the deletion queue,
+//  the version changes and every instance counts as visible again
+    bool reserve(uint32_t instanceCount) noexcept;
+
+//  The next early phase draws every instance in the frustum, for the first frame after culling was off
+    void resetVisibility() noexcept;
+
+//  Outside of rendering, before the early phase: resets both draws of 'frame' to no instances of 'indexCount' indices.
+//  Call once the fence of 'frame' has been waited on
+    void begin(VkCommandBuffer cmd, uint32_t frame, uint32_t indexCount) noexcept;
+
+//  Outside of rendering. The late phase reads the pyramid, build it from the early phase depth first
+    void cull(VkCommandBuffer cmd, uint32_t frame, Phase phase, const Inputs& inputs, const DepthPyramid& pyramid) noexcept;
+
+    VkBuffer     getDrawCommands(uint32_t frame) const noexcept;
+    VkDeviceSize getDrawOffset(Phase phase) const noexcept;
+    VkBuffer     getDrawList(uint32_t frame) const noexcept;
+    uint32_t     getCapacity() const noexcept;
+    uint64_t     getVersion() const noexcept; // bumped whenever the buffers are replaced
+
+private:
+//  Matches the push constants of occlusion_cull.comp
+    struct Constants
+    {
+        uint32_t instanceCount;
+        uint32_t phase;
+        uint32_t lateOffset;
+        float    boundingRadius;
+        float    pyramidWidth;
+        float    pyramidHeight;
+    };
+
+    struct Bindings
+    {
+        VkBuffer camera         = VK_NULL_HANDLE;
+        VkBuffer instances      = VK_NULL_HANDLE;
+        uint64_t version        = 0;
+        uint64_t pyramidVersion = 0;
+    };
+
+    void release() noexcept;
+    void writeDescriptors(uint32_t frame, const Inputs& inputs, const DepthPyramid& pyramid) noexcept;
+
+    const VulkanContext* m_context       = nullptr;
+    DeletionQueue*       m_deletionQueue = nullptr;
+
+    ComputePipeline m_pipeline;
+    DescriptorPool  m_descriptorPool;
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> m_descriptorSets = {};
+    std::array<Bindings, MAX_FRAMES_IN_FLIGHT>        m_bindings;
+
+//  Visibility is carried from frame to frame, the draws are per frame slot
+    VkBuffer       m_visibility       = VK_NULL_HANDLE;
+    VkDeviceMemory m_visibilityMemory = VK_NULL_HANDLE;
+    std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT>       m_drawCommands       = {};
+    std::array<VkDeviceMemory, MAX_FRAMES_IN_FLIGHT> m_drawCommandsMemory = {};
+    std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT>       m_drawLists          = {};
+    std::array<VkDeviceMemory, MAX_FRAMES_IN_FLIGHT> m_drawListsMemory    = {};
+
+    uint32_t m_capacity        = 0;
+    uint64_t m_version         = 0;
+    bool     m_resetVisibility = true;
+};
+
+#endif // !OCCLUSION_CULLER_HPP
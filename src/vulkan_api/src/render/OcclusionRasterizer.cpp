@@ -0,0 +1,545 @@
+#include <new>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define OCCLUSION_AVX2_TARGET
+#else
+#define OCCLUSION_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#define OCCLUSION_RASTERIZER_AVX2
+#endif
+
+#include "jobs/JobSystem.hpp"
+#include "scene/BoundingVolumeHierarchy.hpp"
+#include "render/OcclusionRasterizer.hpp"
+
+
+namespace
+{
+    constexpr float    INF       = INFINITY;
+    constexpr uint32_t FULL_ROW  = UINT32_MAX;
+    constexpr float    MIN_AREA  = 1e-6f; // twice the area in pixels, below that a triangle covers nothing
+
+
+    struct ClipVertex
+    {
+        float x, y, z, w;
+    };
+
+
+    ClipVertex transform(const mat4s& m, float x, float y, float z) noexcept
+    {
+        return
+        {
+            m.raw[0][0] * x + m.raw[1][0] * y + m.raw[2][0] * z + m.raw[3][0],
+            m.raw[0][1] * x + m.raw[1][1] * y + m.raw[2][1] * z + m.raw[3][1],
+            m.raw[0][2] * x + m.raw[1][2] * y + m.raw[2][2] * z + m.raw[3][2],
+            m.raw[0][3] * x + m.raw[1][3] * y + m.raw[2][3] * z + m.raw[3][3]
+        };
+    }
+
+
+//  Bits [first, last] of a tile row, first and last already clamped to [0, 32] and [-1, 31]
+    uint32_t span_mask(int32_t first, int32_t last) noexcept
+    {
+        if (first > last)
+            return 0;
+
+        return (FULL_ROW << first) & (FULL_ROW >> (31 - last));
+    }
+
+
+//  Pixel i of a tile is covered when its center x0 + i + 0.5 lies in [left, right]
+    void row_span(float left, float right, float x0, int32_t* first, int32_t* last) noexcept
+    {
+        *first = static_cast<int32_t>(std::clamp(std::ceil(left - 0.5f) - x0, 0.f, 32.f));
+        *last  = static_cast<int32_t>(std::clamp(std::floor(right - 0.5f) - x0, -1.f, 31.f));
+    }
+}
+
+
+
+bool OcclusionRasterizer::create(uint32_t width, uint32_t height) noexcept
+{
+    if (width == 0 || height == 0)
+        return false;
+
+    m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_width  = m_tilesX * TILE_WIDTH;
+    m_height = m_tilesY * TILE_HEIGHT;
+
+    const uint32_t tileCount = m_tilesX * m_tilesY;
+
+    try
+    {
+        m_masks.assign(tileCount * TILE_HEIGHT, 0);
+        m_reference.assign(tileCount, 0.f);
+        m_working.assign(tileCount, 0.f);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    m_useAvx2 = supportsAvx2();
+
+    return true;
+}
+
+
+void OcclusionRasterizer::setBackend(Backend backend) noexcept
+{
+    m_useAvx2 = (backend == BACKEND_AVX2) && supportsAvx2();
+}
+
+
+OcclusionRasterizer::Backend OcclusionRasterizer::getBackend() const noexcept
+{
+    return m_useAvx2 ? BACKEND_AVX2 : BACKEND_SCALAR;
+}
+
+
+bool OcclusionRasterizer::supportsAvx2() noexcept
+{
+#if defined(OCCLUSION_RASTERIZER_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+//  The OS has to save the YMM registers too, not only the CPU support them
+    int info[4];
+    __cpuid(info, 1);
+
+    if ( ! (info[2] & (1 << 27)) || ! (info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6 )
+        return false;
+
+    __cpuidex(info, 7, 0);
+
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(OCCLUSION_RASTERIZER_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+
+void OcclusionRasterizer::begin(const mat4s& viewProjection) noexcept
+{
+    m_viewProjection = viewProjection;
+
+    std::fill(m_masks.begin(), m_masks.end(), 0);
+    std::fill(m_reference.begin(), m_reference.end(), 0.f);
+    std::fill(m_working.begin(), m_working.end(), 0.f);
+
+    m_triangles.clear();
+    m_stats = {};
+}
+
+
+bool OcclusionRasterizer::addOccluder(const Occluder& occluder) noexcept
+{
+    const mat4s mvp = glms_mat4_mul(m_viewProjection, occluder.model);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(occluder.positions);
+
+    ++m_stats.occluders;
+
+    for (uint32_t i = 0; i + 2 < occluder.indexCount; i += 3)
+    {
+        float x[3], y[3], z[3];
+        bool  clipped = false;
+
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            const float* p = reinterpret_cast<const float*>(bytes + static_cast<size_t>(occluder.indices[i + corner]) * occluder.stride);
+            const ClipVertex v = transform(mvp, p[0], p[1], p[2]);
+
+//          Whatever the GPU clips at the near plane must not occlude here, such triangles are left out entirely
+            if ( ! (v.w > 0.f) || v.z < 0.f )
+            {
+                clipped = true;
+                break;
+            }
+
+            const float invW = 1.f / v.w;
+
+            x[corner] = (v.x * invW * 0.5f + 0.5f) * m_width;
+            y[corner] = (v.y * invW * 0.5f + 0.5f) * m_height;
+            z[corner] = invW;
+        }
+
+        if (clipped)
+        {
+            ++m_stats.rejected;
+            continue;
+        }
+
+        Triangle triangle;
+        triangle.minX     = std::min({ x[0], x[1], x[2] });
+        triangle.maxX     = std::max({ x[0], x[1], x[2] });
+        triangle.minY     = std::min({ y[0], y[1], y[2] });
+        triangle.maxY     = std::max({ y[0], y[1], y[2] });
+        triangle.farthest = std::min({ z[0], z[1], z[2] });
+
+        const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+        if (std::fabs(area) < MIN_AREA || triangle.maxX < 0.f || triangle.minX > m_width || triangle.maxY < 0.f || triangle.minY > m_height)
+        {
+            ++m_stats.rejected;
+            continue;
+        }
+
+//      Edge functions a * x + b * y + c, positive inside whatever the winding. Edges with a > 0 bound
+//      a row's span from the left, a < 0 from the right, horizontal ones are covered by the y range
+        const float sign = (area > 0.f) ? 1.f : -1.f;
+        uint32_t leftCount = 0, rightCount = 0;
+
+        for (auto& bound : triangle.left)
+            bound[0] = 0.f, bound[1] = -INF;
+
+        for (auto& bound : triangle.right)
+            bound[0] = 0.f, bound[1] = INF;
+
+        for (uint32_t edge = 0; edge < 3; ++edge)
+        {
+            const uint32_t next = (edge + 1) % 3;
+
+            const float a = sign * (y[edge] - y[next]);
+            const float b = sign * (x[next] - x[edge]);
+            const float c = sign * (x[edge] * y[next] - x[next] * y[edge]);
+
+            if (a > 0.f && leftCount < 2)
+            {
+                triangle.left[leftCount][0] = -b / a;
+                triangle.left[leftCount][1] = -c / a;
+                ++leftCount;
+            }
+            else if (a < 0.f && rightCount < 2)
+            {
+                triangle.right[rightCount][0] = -b / a;
+                triangle.right[rightCount][1] = -c / a;
+                ++rightCount;
+            }
+        }
+
+//      1/w is linear in screen space
+        triangle.depthX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        triangle.depthY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+        triangle.depth0 = z[0] - triangle.depthX * x[0] - triangle.depthY * y[0];
+
+        try
+        {
+            m_triangles.push_back(triangle);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        ++m_stats.triangles;
+    }
+
+    return true;
+}
+
+
+void OcclusionRasterizer::render(JobSystem* jobs) noexcept
+{
+    auto rasterize = [this](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t tileRow = begin; tileRow < end; ++tileRow)
+        {
+            if (m_useAvx2)
+                rasterizeRowAvx2(tileRow);
+            else
+                rasterizeRow(tileRow);
+        }
+    };
+
+//  Tile rows share nothing, each job owns its tiles outright
+    if (jobs)
+        jobs->parallelFor(m_tilesY, 1, rasterize);
+    else
+        rasterize(0, m_tilesY);
+}
+
+
+bool OcclusionRasterizer::isVisible(const Aabb& box) const noexcept
+{
+    float minX = INF, maxX = -INF, minY = INF, maxY = -INF, nearest = 0.f;
+
+    for (uint32_t corner = 0; corner < 8; ++corner)
+    {
+        const ClipVertex v = transform(m_viewProjection,
+                                       (corner & 1) ? box.max.x : box.min.x,
+                                       (corner & 2) ? box.max.y : box.min.y,
+                                       (corner & 4) ? box.max.z : box.min.z);
+
+//      Reaches in front of the near plane, nothing can hide it
+        if ( ! (v.w > 0.f) || v.z < 0.f )
+            return true;
+
+        const float invW = 1.f / v.w;
+        const float x = (v.x * invW * 0.5f + 0.5f) * m_width;
+        const float y = (v.y * invW * 0.5f + 0.5f) * m_height;
+
+        minX    = std::min(minX, x);
+        maxX    = std::max(maxX, x);
+        minY    = std::min(minY, y);
+        maxY    = std::max(maxY, y);
+        nearest = std::max(nearest, invW);
+    }
+
+    if (maxX < 0.f || minX > m_width || maxY < 0.f || minY > m_height)
+        return false;
+
+//  Clamped before the conversion: a box far off screen maps beyond the range of uint32_t
+    const float width  = static_cast<float>(m_width);
+    const float height = static_cast<float>(m_height);
+
+    const uint32_t firstX = std::min(static_cast<uint32_t>(std::clamp(minX, 0.f, width)) / TILE_WIDTH, m_tilesX - 1);
+    const uint32_t firstY = std::min(static_cast<uint32_t>(std::clamp(minY, 0.f, height)) / TILE_HEIGHT, m_tilesY - 1);
+    const uint32_t lastX  = std::min(static_cast<uint32_t>(std::clamp(maxX, 0.f, width)) / TILE_WIDTH, m_tilesX - 1);
+    const uint32_t lastY  = std::min(static_cast<uint32_t>(std::clamp(maxY, 0.f, height)) / TILE_HEIGHT, m_tilesY - 1);
+
+    for (uint32_t tileY = firstY; tileY <= lastY; ++tileY)
+    {
+        const float* reference = m_reference.data() + tileY * m_tilesX;
+        uint32_t tileX = firstX;
+
+#ifdef OCCLUSION_RASTERIZER_AVX2
+        if (m_useAvx2)
+        {
+            tileX = firstVisibleTileAvx2(reference, firstX, lastX, nearest);
+
+            if (tileX <= lastX)
+                return true;
+
+            continue;
+        }
+#endif
+        for (; tileX <= lastX; ++tileX)
+            if (nearest >= reference[tileX])
+                return true;
+    }
+
+    return false;
+}
+
+
+const OcclusionRasterizer::Stats& OcclusionRasterizer::getStats() const noexcept
+{
+    return m_stats;
+}
+
+
+uint32_t OcclusionRasterizer::getWidth() const noexcept
+{
+    return m_width;
+}
+
+
+uint32_t OcclusionRasterizer::getHeight() const noexcept
+{
+    return m_height;
+}
+
+
+void OcclusionRasterizer::rasterizeRow(uint32_t tileRow) noexcept
+{
+    const float rowY = static_cast<float>(tileRow * TILE_HEIGHT);
+
+    for (const Triangle& triangle : m_triangles)
+    {
+//      No pixel center of this tile row inside the triangle's height
+        if (triangle.maxY < rowY + 0.5f || triangle.minY > rowY + TILE_HEIGHT - 0.5f)
+            continue;
+
+        float left[TILE_HEIGHT], right[TILE_HEIGHT];
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        {
+            const float y = rowY + row + 0.5f;
+
+            if (y < triangle.minY || y > triangle.maxY)
+            {
+                left[row]  = INF;
+                right[row] = -INF;
+
+                continue;
+            }
+
+            left[row]  = std::max(triangle.left[0][0] * y + triangle.left[0][1], triangle.left[1][0] * y + triangle.left[1][1]);
+            right[row] = std::min(triangle.right[0][0] * y + triangle.right[0][1], triangle.right[1][0] * y + triangle.right[1][1]);
+        }
+
+        const uint32_t firstTile = static_cast<uint32_t>(std::max(triangle.minX, 0.f)) / TILE_WIDTH;
+        const uint32_t lastTile  = std::min(static_cast<uint32_t>(std::max(triangle.maxX, 0.f)) / TILE_WIDTH, m_tilesX - 1);
+
+        for (uint32_t tileX = firstTile; tileX <= lastTile; ++tileX)
+        {
+            const float x0 = static_cast<float>(tileX * TILE_WIDTH);
+            uint32_t coverage[TILE_HEIGHT];
+            uint32_t any = 0;
+
+            for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+            {
+                int32_t first, last;
+                row_span(left[row], right[row], x0, &first, &last);
+
+                coverage[row] = span_mask(first, last);
+                any |= coverage[row];
+            }
+
+            if (any)
+                updateTile(tileRow * m_tilesX + tileX, coverage, tileDepth(triangle, x0, rowY));
+        }
+    }
+}
+
+
+#ifdef OCCLUSION_RASTERIZER_AVX2
+
+//  Same arithmetic as rasterizeRow() (no FMA), lane i of every register is row i of the tile
+OCCLUSION_AVX2_TARGET void OcclusionRasterizer::rasterizeRowAvx2(uint32_t tileRow) noexcept
+{
+    const float rowY = static_cast<float>(tileRow * TILE_HEIGHT);
+
+    const __m256  y        = _mm256_add_ps(_mm256_set1_ps(rowY), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+    const __m256  half     = _mm256_set1_ps(0.5f);
+    const __m256  inf      = _mm256_set1_ps(INF);
+    const __m256  zero     = _mm256_setzero_ps();
+    const __m256  width    = _mm256_set1_ps(32.f);
+    const __m256  lastBit  = _mm256_set1_ps(31.f);
+    const __m256  none     = _mm256_set1_ps(-1.f);
+    const __m256i ones     = _mm256_set1_epi32(-1);
+    const __m256i shift31  = _mm256_set1_epi32(31);
+
+    for (const Triangle& triangle : m_triangles)
+    {
+        if (triangle.maxY < rowY + 0.5f || triangle.minY > rowY + TILE_HEIGHT - 0.5f)
+            continue;
+
+        const __m256 outside = _mm256_or_ps(_mm256_cmp_ps(y, _mm256_set1_ps(triangle.minY), _CMP_LT_OQ),
+                                            _mm256_cmp_ps(y, _mm256_set1_ps(triangle.maxY), _CMP_GT_OQ));
+
+        __m256 left = _mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.left[0][0]), y), _mm256_set1_ps(triangle.left[0][1])),
+                                    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.left[1][0]), y), _mm256_set1_ps(triangle.left[1][1])));
+        __m256 right = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.right[0][0]), y), _mm256_set1_ps(triangle.right[0][1])),
+                                     _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.right[1][0]), y), _mm256_set1_ps(triangle.right[1][1])));
+
+        left  = _mm256_round_ps(_mm256_sub_ps(_mm256_blendv_ps(left, inf, outside), half), _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+        right = _mm256_round_ps(_mm256_sub_ps(_mm256_blendv_ps(right, _mm256_sub_ps(zero, inf), outside), half), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+
+        const uint32_t firstTile = static_cast<uint32_t>(std::max(triangle.minX, 0.f)) / TILE_WIDTH;
+        const uint32_t lastTile  = std::min(static_cast<uint32_t>(std::max(triangle.maxX, 0.f)) / TILE_WIDTH, m_tilesX - 1);
+
+        for (uint32_t tileX = firstTile; tileX <= lastTile; ++tileX)
+        {
+            const __m256 x0 = _mm256_set1_ps(static_cast<float>(tileX * TILE_WIDTH));
+
+            const __m256i first = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(left, x0), zero), width));
+            const __m256i last  = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(right, x0), none), lastBit));
+
+//          Shifts by 32 or more give 0, which covers empty and one-sided spans
+            const __m256i coverage = _mm256_and_si256(_mm256_sllv_epi32(ones, first), _mm256_srlv_epi32(ones, _mm256_sub_epi32(shift31, last)));
+
+            if (_mm256_testz_si256(coverage, coverage))
+                continue;
+
+            alignas(32) uint32_t rows[TILE_HEIGHT];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(rows), coverage);
+
+            updateTile(tileRow * m_tilesX + tileX, rows, tileDepth(triangle, static_cast<float>(tileX * TILE_WIDTH), rowY));
+        }
+    }
+}
+
+
+OCCLUSION_AVX2_TARGET uint32_t OcclusionRasterizer::firstVisibleTileAvx2(const float* reference, uint32_t first, uint32_t last, float nearest) const noexcept
+{
+    const __m256 depth = _mm256_set1_ps(nearest);
+    uint32_t tileX = first;
+
+    for (; tileX + 8 <= last + 1; tileX += 8)
+    {
+        const int visible = _mm256_movemask_ps(_mm256_cmp_ps(depth, _mm256_loadu_ps(reference + tileX), _CMP_GE_OQ));
+
+        if (visible)
+            return tileX + static_cast<uint32_t>(std::countr_zero(static_cast<uint32_t>(visible)));
+    }
+
+    for (; tileX <= last; ++tileX)
+        if (nearest >= reference[tileX])
+            return tileX;
+
+    return last + 1;
+}
+
+#else
+
+void OcclusionRasterizer::rasterizeRowAvx2(uint32_t tileRow) noexcept
+{
+    rasterizeRow(tileRow);
+}
+
+#endif
+
+
+void OcclusionRasterizer::updateTile(uint32_t tile, const uint32_t* coverage, float depth) noexcept
+{
+    float& reference = m_reference[tile];
+    float& working   = m_working[tile];
+    uint32_t* mask   = m_masks.data() + tile * TILE_HEIGHT;
+
+//  No nearer than what already bounds the whole tile
+    if (depth <= reference)
+        return;
+
+    uint32_t covered = 0;
+
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        covered |= mask[row];
+
+//  A triangle far in front of the working layer starts a new one, merging would drag its depth back
+    if (covered && depth - working > working - reference)
+    {
+        std::fill(mask, mask + TILE_HEIGHT, 0);
+        covered = 0;
+    }
+
+    working = covered ? std::min(working, depth) : depth;
+
+    uint32_t full = FULL_ROW;
+
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+    {
+        mask[row] |= coverage[row];
+        full &= mask[row];
+    }
+
+//  Every pixel lies on or in front of the working layer, it becomes the new bound of the tile
+    if (full == FULL_ROW)
+    {
+        reference = working;
+        std::fill(mask, mask + TILE_HEIGHT, 0);
+    }
+}
+
+
+float OcclusionRasterizer::tileDepth(const Triangle& triangle, float x0, float y0) const noexcept
+{
+//  The plane is farthest at one corner of the tile clipped to the triangle's bounds, but never beyond its vertices
+    const float minX = std::max(x0, triangle.minX);
+    const float maxX = std::min(x0 + TILE_WIDTH, triangle.maxX);
+    const float minY = std::max(y0, triangle.minY);
+    const float maxY = std::min(y0 + TILE_HEIGHT, triangle.maxY);
+
+    const float x = (triangle.depthX >= 0.f) ? minX : maxX;
+    const float y = (triangle.depthY >= 0.f) ? minY : maxY;
+
+    return std::max(triangle.depthX * x + triangle.depthY * y + triangle.depth0, triangle.farthest);
+}
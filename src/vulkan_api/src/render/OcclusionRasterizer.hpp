@@ -0,0 +1,103 @@
+#ifndef OCCLUSION_RASTERIZER_HPP
+#define OCCLUSION_RASTERIZER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <cglm/struct/mat4.h>
+
+
+// Software occlusion culling on the CPU in the style of Masked Software Occlusion Culling (Hasselgren et al. 2016).
+// Occluder triangles are rasterized at low resolution into tiles of 32x8 pixels. A tile keeps a coverage bit per
+// pixel and two depths instead of a depth per pixel: the reference layer bounds the whole tile, the working layer
+// bounds the pixels covered so far and replaces the reference once the tile is full. Depth is 1/w, so larger means
+// nearer and every stored value is a conservative far bound.
+// Rendering runs one tile row per job, with AVX2 computing the spans of all eight rows of a tile at once when the
+// CPU has it. Boxes are tested against the reference layer only, so the answer errs on the visible side
+class OcclusionRasterizer
+{
+public:
+    static constexpr uint32_t TILE_WIDTH  = 32;
+    static constexpr uint32_t TILE_HEIGHT = 8;
+
+    enum Backend
+    {
+        BACKEND_SCALAR,
+        BACKEND_AVX2
+    };
+
+//  Triangle list in object space, read during addOccluder() only
+    struct Occluder
+    {
+        const float*    positions  = nullptr; // xyz floats
+        uint32_t        stride     = 0;       // bytes from one position to the next
+        const uint32_t* indices    = nullptr;
+        uint32_t        indexCount = 0;
+        mat4s           model;
+    };
+
+    struct Stats
+    {
+        uint32_t occluders = 0;
+        uint32_t triangles = 0; // set up for rasterization
+        uint32_t rejected  = 0; // degenerate, off screen or crossing the near plane
+    };
+
+//  Rounded up to whole tiles
+    bool create(uint32_t width, uint32_t height) noexcept;
+
+//  AVX2 is only used when the CPU supports it, BACKEND_SCALAR forces the portable path
+    void    setBackend(Backend backend) noexcept;
+    Backend getBackend() const noexcept;
+    static bool supportsAvx2() noexcept;
+
+//  Starts a frame: clears the tiles and the occluders. Clip space follows Vulkan, 0 <= z <= w
+    void begin(const mat4s& viewProjection) noexcept;
+    bool addOccluder(const Occluder& occluder) noexcept;
+
+//  Rasterizes every occluder, tile rows are spread across the workers
+    void render(class JobSystem* jobs) noexcept;
+
+//  False when the world space box is hidden behind the occluders or outside the view. Thread-safe after render()
+    bool isVisible(const struct Aabb& box) const noexcept;
+
+    const Stats& getStats() const noexcept;
+    uint32_t     getWidth() const noexcept;
+    uint32_t     getHeight() const noexcept;
+
+private:
+//  Screen space setup: the span of a pixel row at height y is [max(left), min(right)], each bound k * y + m
+    struct Triangle
+    {
+        float left[2][2];
+        float right[2][2];
+        float minX, maxX;
+        float minY, maxY;
+        float depthX, depthY, depth0; // plane of 1/w
+        float farthest;               // smallest 1/w of the vertices
+    };
+
+    void rasterizeRow(uint32_t tileRow) noexcept;
+    void rasterizeRowAvx2(uint32_t tileRow) noexcept;
+    uint32_t firstVisibleTileAvx2(const float* reference, uint32_t first, uint32_t last, float nearest) const noexcept; // last + 1 when none
+    void updateTile(uint32_t tile, const uint32_t* coverage, float depth) noexcept;
+    float tileDepth(const Triangle& triangle, float x0, float y0) const noexcept;
+
+    uint32_t m_width       = 0;
+    uint32_t m_height      = 0;
+    uint32_t m_tilesX      = 0;
+    uint32_t m_tilesY      = 0;
+    bool     m_useAvx2     = false;
+
+    mat4s m_viewProjection;
+
+//  Per tile: TILE_HEIGHT row masks of the working layer, bit i of a row is pixel i of the tile
+    std::vector<uint32_t> m_masks;
+    std::vector<float>    m_reference;
+    std::vector<float>    m_working;
+
+    std::vector<Triangle> m_triangles;
+    Stats                 m_stats;
+};
+
+#endif // !OCCLUSION_RASTERIZER_HPP
@@ -0,0 +1,300 @@
+#include <new>
+#include <utility>
+
+#include "render/RenderQueue.hpp"
+
+
+namespace
+{
+    constexpr uint32_t DEPTH_BITS    = 21;
+    constexpr uint32_t MESH_BITS     = 16;
+    constexpr uint32_t MATERIAL_BITS = 14;
+    constexpr uint32_t PIPELINE_BITS = 10;
+
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t RADIX      = 1u << RADIX_BITS;
+    constexpr uint32_t DIGITS     = 64 / RADIX_BITS;
+
+
+    uint64_t quantize_depth(float depth) noexcept
+    {
+        constexpr float MAX_DEPTH = static_cast<float>((1u << DEPTH_BITS) - 1);
+
+        if ( ! (depth > 0.f) ) // also catches NaN
+            return 0;
+
+        if (depth >= 1.f)
+            return (1u << DEPTH_BITS) - 1;
+
+        return static_cast<uint64_t>(depth * MAX_DEPTH);
+    }
+}
+
+
+
+uint32_t RenderQueue::addPipeline(VkPipeline pipeline, VkPipelineLayout layout) noexcept
+{
+    if (m_pipelines.size() == MAX_PIPELINES)
+        return INVALID_ID;
+
+    try
+    {
+        m_pipelines.push_back({ pipeline, layout });
+    }
+    catch (const std::bad_alloc&)
+    {
+        return INVALID_ID;
+    }
+
+    return static_cast<uint32_t>(m_pipelines.size()) - 1;
+}
+
+
+uint32_t RenderQueue::addMaterial(const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets) noexcept
+{
+    if (m_materials.size() == MAX_MATERIALS)
+        return INVALID_ID;
+
+    try
+    {
+        m_materials.push_back(descriptorSets);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return INVALID_ID;
+    }
+
+    return static_cast<uint32_t>(m_materials.size()) - 1;
+}
+
+
+uint32_t RenderQueue::addMesh(const Mesh& mesh) noexcept
+{
+    if (m_meshes.size() == MAX_MESHES)
+        return INVALID_ID;
+
+    try
+    {
+        m_meshes.push_back(mesh);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return INVALID_ID;
+    }
+
+    return static_cast<uint32_t>(m_meshes.size()) - 1;
+}
+
+
+void RenderQueue::clear() noexcept
+{
+    m_draws.clear();
+    m_keys.clear();
+    m_order.clear();
+    m_stats = {};
+}
+
+
+bool RenderQueue::push(uint32_t pass, bool translucent, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth,
+                       uint32_t firstInstance, uint32_t instanceCount) noexcept
+{
+    return insert(pass, translucent, depth, { pipeline, material, mesh, firstInstance, instanceCount, VK_NULL_HANDLE, 0 });
+}
+
+
+bool RenderQueue::pushIndirect(uint32_t pass, bool translucent, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth,
+                               VkBuffer commands, VkDeviceSize offset) noexcept
+{
+    return insert(pass, translucent, depth, { pipeline, material, mesh, 0, 0, commands, offset });
+}
+
+
+void RenderQueue::sort() noexcept
+{
+    const uint32_t count = static_cast<uint32_t>(m_keys.size());
+
+    m_stats.draws     = count;
+    m_stats.submitted = countBinds(m_order.data());
+
+    if (count > 1)
+    {
+        try
+        {
+            m_keysScratch.resize(count);
+            m_orderScratch.resize(count);
+        }
+        catch (const std::bad_alloc&)
+        {
+            m_stats.sorted = m_stats.submitted; // recorded in push order
+
+            return;
+        }
+
+//  All eight histograms in one read of the keys
+        uint32_t histograms[DIGITS][RADIX] = {};
+
+        for (uint64_t key : m_keys)
+            for (uint32_t digit = 0; digit < DIGITS; ++digit)
+                ++histograms[digit][(key >> (digit * RADIX_BITS)) & (RADIX - 1)];
+
+        uint64_t* keys         = m_keys.data();
+        uint32_t* order        = m_order.data();
+        uint64_t* keysScratch  = m_keysScratch.data();
+        uint32_t* orderScratch = m_orderScratch.data();
+
+//  Least significant digit first, each pass is stable. Digits every key shares (unused ids, a single pass) are skipped
+        for (uint32_t digit = 0; digit < DIGITS; ++digit)
+        {
+            uint32_t* histogram = histograms[digit];
+            const uint32_t shift = digit * RADIX_BITS;
+
+            if (histogram[(keys[0] >> shift) & (RADIX - 1)] == count)
+                continue;
+
+            uint32_t offset = 0;
+
+            for (uint32_t i = 0; i < RADIX; ++i)
+            {
+                const uint32_t bucket = histogram[i];
+                histogram[i] = offset;
+                offset += bucket;
+            }
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint32_t slot = histogram[(keys[i] >> shift) & (RADIX - 1)]++;
+
+                keysScratch[slot]  = keys[i];
+                orderScratch[slot] = order[i];
+            }
+
+            std::swap(keys, keysScratch);
+            std::swap(order, orderScratch);
+        }
+
+//  An odd number of passes leaves the result in the scratch buffers
+        if (keys != m_keys.data())
+        {
+            m_keys.swap(m_keysScratch);
+            m_order.swap(m_orderScratch);
+        }
+    }
+
+    m_stats.sorted = countBinds(m_order.data());
+}
+
+
+void RenderQueue::record(VkCommandBuffer cmd, uint32_t frame) const noexcept
+{
+    uint32_t         pipeline = INVALID_ID;
+    uint32_t         material = INVALID_ID;
+    uint32_t         mesh     = INVALID_ID;
+    VkPipelineLayout layout   = VK_NULL_HANDLE;
+
+    for (uint32_t index : m_order)
+    {
+        const Draw& draw = m_draws[index];
+
+        if (draw.pipeline != pipeline)
+        {
+            const Pipeline& bound = m_pipelines[draw.pipeline];
+
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bound.handle);
+            pipeline = draw.pipeline;
+
+//  Sets stay bound across pipelines with the same layout
+            if (bound.layout != layout)
+            {
+                layout   = bound.layout;
+                material = INVALID_ID;
+            }
+        }
+
+        if (draw.material != material)
+        {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &m_materials[draw.material][frame], 0, VK_NULL_HANDLE);
+            material = draw.material;
+        }
+
+        const Mesh& geometry = m_meshes[draw.mesh];
+
+        if (draw.mesh != mesh)
+        {
+            vkCmdBindVertexBuffers(cmd, 0, 1, &geometry.vertices, &geometry.vertexOffset);
+            vkCmdBindIndexBuffer(cmd, geometry.indices, geometry.indexOffset, geometry.indexType);
+            mesh = draw.mesh;
+        }
+
+        if (draw.commands)
+            vkCmdDrawIndexedIndirect(cmd, draw.commands, draw.commandOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+        else
+            vkCmdDrawIndexed(cmd, geometry.indexCount, draw.instanceCount, 0, 0, draw.firstInstance);
+    }
+}
+
+
+const RenderQueue::Stats& RenderQueue::getStats() const noexcept
+{
+    return m_stats;
+}
+
+
+bool RenderQueue::insert(uint32_t pass, bool translucent, float depth, const Draw& draw) noexcept
+{
+    if (pass >= MAX_PASSES || draw.pipeline >= m_pipelines.size() || draw.material >= m_materials.size() || draw.mesh >= m_meshes.size())
+        return false;
+
+    uint64_t key = (static_cast<uint64_t>(pass) << 62) | (static_cast<uint64_t>(translucent) << 61);
+
+    if (translucent)
+    {
+//  Blending needs back to front, so depth outranks every state and is inverted
+        const uint64_t state = (static_cast<uint64_t>(draw.pipeline) << (MATERIAL_BITS + MESH_BITS)) | (static_cast<uint64_t>(draw.material) << MESH_BITS) | draw.mesh;
+
+        key |= (((1u << DEPTH_BITS) - 1 - quantize_depth(depth)) << (PIPELINE_BITS + MATERIAL_BITS + MESH_BITS)) | state;
+    }
+    else
+    {
+//  State first, front to back within equal state for early depth rejection
+        key |= (static_cast<uint64_t>(draw.pipeline) << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS)) |
+               (static_cast<uint64_t>(draw.material) << (MESH_BITS + DEPTH_BITS)) |
+               (static_cast<uint64_t>(draw.mesh) << DEPTH_BITS) |
+               quantize_depth(depth);
+    }
+
+    try
+    {
+        m_draws.push_back(draw);
+        m_keys.push_back(key);
+        m_order.push_back(static_cast<uint32_t>(m_order.size()));
+    }
+    catch (const std::bad_alloc&)
+    {
+        m_draws.resize(m_order.size());
+        m_keys.resize(m_order.size());
+
+        return false;
+    }
+
+    return true;
+}
+
+
+RenderQueue::Binds RenderQueue::countBinds(const uint32_t* order) const noexcept
+{
+    Binds binds;
+    const Draw* previous = nullptr;
+
+    for (uint32_t i = 0; i < m_draws.size(); ++i)
+    {
+        const Draw& draw = m_draws[order[i]];
+
+        binds.pipelines += ( ! previous || previous->pipeline != draw.pipeline );
+        binds.materials += ( ! previous || previous->material != draw.material );
+        binds.meshes    += ( ! previous || previous->mesh     != draw.mesh );
+
+        previous = &draw;
+    }
+
+    return binds;
+}
@@ -0,0 +1,108 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+
+// Draws of a frame packed into 64-bit sort keys, radix sorted and recorded with only the binds that
+// differ from the previous draw. Pipelines, materials (one descriptor set per frame slot) and meshes are
+// registered once and referenced by the ids stored in the key.
+// Opaque key, most significant first: pass 2 | 0 | pipeline 10 | material 14 | mesh 16 | depth 21 (front to back)
+// Translucent:                        pass 2 | 1 | depth 21 (back to front) | pipeline 10 | material 14 | mesh 16
+class RenderQueue
+{
+public:
+    static constexpr uint32_t INVALID_ID    = UINT32_MAX;
+    static constexpr uint32_t MAX_PASSES    = 1u << 2;
+    static constexpr uint32_t MAX_PIPELINES = 1u << 10;
+    static constexpr uint32_t MAX_MATERIALS = 1u << 14;
+    static constexpr uint32_t MAX_MESHES    = 1u << 16;
+
+    struct Mesh
+    {
+        VkBuffer     vertices     = VK_NULL_HANDLE;
+        VkDeviceSize vertexOffset = 0;
+        VkBuffer     indices      = VK_NULL_HANDLE;
+        VkDeviceSize indexOffset  = 0;
+        VkIndexType  indexType    = VK_INDEX_TYPE_UINT32;
+        uint32_t     indexCount   = 0;
+    };
+
+//  Binds issued for one order of the draws, by state
+    struct Binds
+    {
+        uint32_t pipelines = 0;
+        uint32_t materials = 0;
+        uint32_t meshes    = 0;
+    };
+
+//  Binds needed when only changed state is bound, in push order ('submitted') and in sorted order ('sorted').
+//  A recorder that binds everything per draw issues 'draws' of each, the rest of those are redundant
+    struct Stats
+    {
+        uint32_t draws = 0;
+        Binds    submitted;
+        Binds    sorted;
+    };
+
+    uint32_t addPipeline(VkPipeline pipeline, VkPipelineLayout layout) noexcept;
+    uint32_t addMaterial(const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& descriptorSets) noexcept;
+    uint32_t addMesh(const Mesh& mesh) noexcept;
+
+    void clear() noexcept;
+
+//  'depth' is the view distance normalized to [0, 1]. Returns false for unknown ids or when out of memory
+    bool push(uint32_t pass, bool translucent, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth,
+              uint32_t firstInstance, uint32_t instanceCount) noexcept;
+
+//  The instance count and range come from a VkDrawIndexedIndirectCommand at 'offset' in 'commands', filled on the GPU.
+//  Its index count must match the mesh
+    bool pushIndirect(uint32_t pass, bool translucent, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth,
+                      VkBuffer commands, VkDeviceSize offset) noexcept;
+
+    void sort() noexcept;
+    void record(VkCommandBuffer cmd, uint32_t frame) const noexcept;
+
+    const Stats& getStats() const noexcept;
+
+private:
+    struct Pipeline
+    {
+        VkPipeline       handle;
+        VkPipelineLayout layout;
+    };
+
+    struct Draw
+    {
+        uint32_t     pipeline;
+        uint32_t     material;
+        uint32_t     mesh;
+        uint32_t     firstInstance;
+        uint32_t     instanceCount;
+        VkBuffer     commands; // indirect when set
+        VkDeviceSize commandOffset;
+    };
+
+    bool  insert(uint32_t pass, bool translucent, float depth, const Draw& draw) noexcept;
+    Binds countBinds(const uint32_t* order) const noexcept;
+
+    std::vector<Pipeline> m_pipelines;
+    std::vector<std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>> m_materials;
+    std::vector<Mesh>     m_meshes;
+
+    std::vector<Draw>     m_draws;
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_order; // draw indices, sorted by key after sort()
+
+//  Radix sort ping-pong buffers
+    std::vector<uint64_t> m_keysScratch;
+    std::vector<uint32_t> m_orderScratch;
+
+    Stats m_stats;
+};
+
+#endif // !RENDER_QUEUE_HPP
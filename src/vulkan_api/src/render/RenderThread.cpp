@@ -0,0 +1,97 @@
+#include "engine/Engine.hpp"
+#include "render/RenderThread.hpp"
+
+
+bool RenderThread::start(Engine* engine) noexcept
+{
+    if (m_thread.joinable())
+        return true;
+
+    m_engine    = engine;
+    m_writeSlot = 0;
+    m_readSlot  = 0;
+
+    for (auto& state : m_states)
+        state.store(Free, std::memory_order_relaxed);
+
+    for (auto& packet : m_packets)
+    {
+        packet.clear();
+        packet.shutdown = false;
+    }
+
+    m_thread = std::thread(&RenderThread::run, this);
+
+    return m_thread.joinable();
+}
+
+
+void RenderThread::stop() noexcept
+{
+    if (!m_thread.joinable())
+        return;
+
+    FramePacket& packet = beginPacket();
+    packet.clear();
+    packet.shutdown = true;
+    publishPacket();
+
+    m_thread.join();
+}
+
+
+bool RenderThread::isRunning() const noexcept
+{
+    return m_thread.joinable();
+}
+
+
+FramePacket& RenderThread::beginPacket() noexcept
+{
+    auto& state = m_states[m_writeSlot];
+
+//  The render thread still owns this slot only if the application is a full frame ahead
+    for (uint32_t value = state.load(std::memory_order_acquire); value != Free; value = state.load(std::memory_order_acquire))
+        state.wait(value, std::memory_order_acquire);
+
+    return m_packets[m_writeSlot];
+}
+
+
+void RenderThread::publishPacket() noexcept
+{
+    auto& state = m_states[m_writeSlot];
+
+    state.store(Ready, std::memory_order_release);
+    state.notify_one();
+
+    m_writeSlot ^= 1;
+}
+
+
+void RenderThread::run() noexcept
+{
+    for (;;)
+    {
+        auto& state = m_states[m_readSlot];
+
+        for (uint32_t value = state.load(std::memory_order_acquire); value != Ready; value = state.load(std::memory_order_acquire))
+            state.wait(value, std::memory_order_acquire);
+
+        FramePacket& packet = m_packets[m_readSlot];
+        const bool shutdown = packet.shutdown;
+
+        if (!shutdown)
+            m_engine->renderPacket(packet);
+
+        packet.clear();
+
+        state.store(Free, std::memory_order_release);
+        state.notify_one();
+
+        m_readSlot ^= 1;
+
+        if (shutdown)
+            break;
+    }
+}
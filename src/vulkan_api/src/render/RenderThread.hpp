@@ -0,0 +1,75 @@
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+#include "camera/Camera.hpp"
+
+class Engine;
+
+// Everything the render thread needs to produce one frame, built by the application thread
+struct FramePacket
+{
+    struct InstanceDelta
+    {
+        uint32_t index;
+        vec3s    position;
+        float    angle;
+    };
+
+    void clear() noexcept
+    {
+        resized = false;
+        instanceDeltas.clear();
+        requests.clear();
+    }
+
+    Camera     camera;
+    VkExtent2D extent   = { 0, 0 };
+    bool       resized  = false;
+    bool       shutdown = false;
+
+    std::vector<InstanceDelta> instanceDeltas;
+    std::vector<std::function<void(Engine*)>> requests; // resource requests, executed on the render thread before recording
+};
+
+
+// Double-buffered single-producer/single-consumer handoff: while the render thread records and submits
+// one packet, the application thread fills the other one
+class RenderThread
+{
+public:
+    bool start(Engine* engine) noexcept;
+    void stop() noexcept;
+    bool isRunning() const noexcept;
+
+//  Producer side, called from the application thread only
+    FramePacket& beginPacket() noexcept;
+    void publishPacket() noexcept;
+
+private:
+    void run() noexcept;
+
+    enum SlotState : uint32_t
+    {
+        Free,
+        Ready
+    };
+
+    std::array<FramePacket, 2> m_packets;
+    std::array<std::atomic<uint32_t>, 2> m_states = { Free, Free };
+
+    uint32_t m_writeSlot = 0; // owned by the producer
+    uint32_t m_readSlot  = 0; // owned by the consumer
+
+    Engine* m_engine = nullptr;
+    std::thread m_thread;
+};
+
+#endif // !RENDER_THREAD_HPP
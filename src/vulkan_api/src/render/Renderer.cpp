@@ -2,8 +2,61 @@
 #include "render/Renderer.hpp"
 
 
-// TODO add clear color value
-bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIndex) noexcept
+namespace
+{
+    void begin_rendering(VkCommandBuffer cmd, const MainView* view, uint32_t imageIndex, VkRenderingFlags flags, VkAttachmentLoadOp loadOp, VkClearValue clearColor, bool keepDepth) noexcept
+    {
+        VkExtent2D extent = view->extent;
+
+        const VkRenderingAttachmentInfoKHR colorAttachmentInfo = 
+        {
+            .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+            .pNext              = VK_NULL_HANDLE,
+            .imageView          = view->imageViews[imageIndex],
+            .imageLayout        = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL_KHR,
+            .resolveMode        = VK_RESOLVE_MODE_NONE,
+            .resolveImageView   = VK_NULL_HANDLE,
+            .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .loadOp             = loadOp,
+            .storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
+            .clearValue         = clearColor
+        };
+
+        const VkRenderingAttachmentInfoKHR depthAttachmentInfo = 
+        {
+            .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+            .pNext              = VK_NULL_HANDLE,
+            .imageView          = view->depth.imageView,
+            .imageLayout        = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            .resolveMode        = VK_RESOLVE_MODE_NONE,
+            .resolveImageView   = VK_NULL_HANDLE,
+            .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .loadOp             = loadOp,
+            .storeOp            = keepDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .clearValue         = { 1.f, 0.f }
+        };
+
+        const VkRenderingInfoKHR renderingInfo =
+        {
+            .sType                = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+            .pNext                = VK_NULL_HANDLE,
+            .flags                = flags,
+            .renderArea           = { { 0, 0 }, extent },
+            .layerCount           = 1,
+            .viewMask             = 0,
+            .colorAttachmentCount = 1,
+            .pColorAttachments    = &colorAttachmentInfo,
+            .pDepthAttachment     = &depthAttachmentInfo,
+            .pStencilAttachment   = VK_NULL_HANDLE
+        };
+
+        vkCmdBeginRendering(cmd, &renderingInfo);
+    }
+}
+
+
+
+bool Renderer::open(VkCommandBuffer cmd) noexcept
 {
     const VkCommandBufferBeginInfo beginInfo = 
     {
@@ -13,11 +66,13 @@ bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIn
         .pInheritanceInfo = VK_NULL_HANDLE
     };
 
-    VkResult result = vkBeginCommandBuffer(cmd, &beginInfo);
+    return (vkBeginCommandBuffer(cmd, &beginInfo) == VK_SUCCESS);
+}
 
-    if (result != VK_SUCCESS)
-        return false;
 
+// TODO add clear color value
+bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIndex, VkRenderingFlags flags) noexcept
+{
     const VkImageMemoryBarrier imageMemoryBarrier =
     {
         .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -55,7 +110,7 @@ bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIn
     {
         .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext               = VK_NULL_HANDLE,
-        .srcAccessMask       = VK_ACCESS_NONE,
+        .srcAccessMask       = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
         .dstAccessMask       = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
         .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
         .newLayout           = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
@@ -72,8 +127,9 @@ bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIn
         }
     };
 
+//  Waits for the previous frame's depth writes, and for the depth pyramid built from them (its last barrier ends in these stages)
     vkCmdPipelineBarrier(cmd,
-                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
                          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
                          0, 
                          0, 
@@ -83,52 +139,17 @@ bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIn
                          1, 
                          &depthBufferBarrier);
 
-    VkExtent2D extent = view->extent;
+    begin_rendering(cmd, view, imageIndex, flags, VK_ATTACHMENT_LOAD_OP_CLEAR, clearColor, keepDepth);
 
-    const VkRenderingAttachmentInfoKHR colorAttachmentInfo = 
-    {
-        .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
-        .pNext              = VK_NULL_HANDLE,
-        .imageView          = view->imageViews[imageIndex],
-        .imageLayout        = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL_KHR,
-        .resolveMode        = VK_RESOLVE_MODE_NONE,
-        .resolveImageView   = VK_NULL_HANDLE,
-        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
-        .clearValue         = clearColor
-    };
+    if ( ! (flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) )
+        setViewport(cmd, view->extent);
 
-    const VkRenderingAttachmentInfoKHR depthAttachmentInfo = 
-    {
-        .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
-        .pNext              = VK_NULL_HANDLE,
-        .imageView          = view->depth.imageView,
-        .imageLayout        = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-        .resolveMode        = VK_RESOLVE_MODE_NONE,
-        .resolveImageView   = VK_NULL_HANDLE,
-        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp            = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .clearValue         = { 1.f, 0.f }
-    };
-
-    const VkRenderingInfoKHR renderingInfo =
-    {
-        .sType                = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
-        .pNext                = VK_NULL_HANDLE,
-        .flags                = 0,
-        .renderArea           = { { 0, 0 }, extent },
-        .layerCount           = 1,
-        .viewMask             = 0,
-        .colorAttachmentCount = 1,
-        .pColorAttachments    = &colorAttachmentInfo,
-        .pDepthAttachment     = &depthAttachmentInfo,
-        .pStencilAttachment   = VK_NULL_HANDLE
-    };
+    return true;
+}
 
-    vkCmdBeginRendering(cmd, &renderingInfo);
 
+void Renderer::setViewport(VkCommandBuffer cmd, VkExtent2D extent) const noexcept
+{
     const VkViewport viewport = 
     {
         .x        = 0.f,
@@ -148,6 +169,42 @@ bool Renderer::begin(VkCommandBuffer cmd, const MainView* view, uint32_t imageIn
     };
 
     vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+
+void Renderer::suspend(VkCommandBuffer cmd) const noexcept
+{
+    vkCmdEndRendering(cmd);
+}
+
+
+bool Renderer::resume(VkCommandBuffer cmd, const MainView* view, uint32_t imageIndex, VkRenderingFlags flags) noexcept
+{
+//  Color stays in its attachment layout, it only needs the draws before the suspension to land first.
+//  The depth dependency comes from whoever read it in between
+    const VkMemoryBarrier colorBarrier =
+    {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = VK_NULL_HANDLE,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         0,
+                         1,
+                         &colorBarrier,
+                         0,
+                         VK_NULL_HANDLE,
+                         0,
+                         VK_NULL_HANDLE);
+
+    begin_rendering(cmd, view, imageIndex, flags, VK_ATTACHMENT_LOAD_OP_LOAD, clearColor, keepDepth);
+
+    if ( ! (flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) )
+        setViewport(cmd, view->extent);
 
     return true;
 }
@@ -5,10 +5,18 @@
 
 struct Renderer
 {
-    bool begin(VkCommandBuffer cmd, const struct MainView* view, uint32_t imageIndex) noexcept;
+//  Starts recording. Transfers that must not happen inside rendering (texture streaming) go between open() and begin()
+    bool open(VkCommandBuffer cmd) noexcept;
+//  With VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT the draws come from secondary buffers, which set their own viewport
+    bool begin(VkCommandBuffer cmd, const struct MainView* view, uint32_t imageIndex, VkRenderingFlags flags = 0) noexcept;
+    void setViewport(VkCommandBuffer cmd, VkExtent2D extent) const noexcept;
+//  Interrupts rendering for compute work that reads the attachments (keepDepth must be set), resume() continues on top of them
+    void suspend(VkCommandBuffer cmd) const noexcept;
+    bool resume(VkCommandBuffer cmd, const struct MainView* view, uint32_t imageIndex, VkRenderingFlags flags = 0) noexcept;
     bool end(VkCommandBuffer cmd, const struct MainView* view, uint32_t imageIndex) noexcept;
 
     VkClearValue clearColor = { 0.f, 0.f, 0.f, 1.f };
+    bool         keepDepth  = false; // depth is stored instead of discarded at the end of rendering
 };
 
 #endif // !RENDERER_HPP
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+// Lock-free single-producer/single-consumer "latest value" slot: the writer never waits and
+// the reader always gets the most recent complete value
+template<class T>
+class TripleBuffer
+{
+public:
+    void write(const T& value) noexcept
+    {
+        m_buffers[m_back] = value;
+
+        const uint32_t previous = m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+    }
+
+//  Returns false while nothing has been written yet, 'value' is left untouched then
+    bool read(T& value) noexcept
+    {
+        if (m_middle.load(std::memory_order_acquire) & DIRTY)
+        {
+            const uint32_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front    = previous & INDEX_MASK;
+            m_hasValue = true;
+        }
+
+        if (m_hasValue)
+            value = m_buffers[m_front];
+
+        return m_hasValue;
+    }
+
+private:
+    static constexpr uint32_t INDEX_MASK = 3;
+    static constexpr uint32_t DIRTY      = 4;
+
+    std::array<T, 3>      m_buffers;
+    std::atomic<uint32_t> m_middle   = 1;
+    uint32_t              m_back     = 0;     // owned by the writer
+    uint32_t              m_front    = 2;     // owned by the reader
+    bool                  m_hasValue = false; // owned by the reader
+};
+
+#endif // !TRIPLE_BUFFER_HPP
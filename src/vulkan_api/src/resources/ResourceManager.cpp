@@ -0,0 +1,625 @@
+#include <cstring>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef DEBUG
+#include <cstdio>
+#endif
+
+#include "utils/Tools.hpp"
+#include "utils/XXHash.hpp"
+#include "context/Context.hpp"
+#include "sync/DeletionQueue.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "texture/Image.hpp"
+#include "texture/CompressedImage.hpp"
+#include "texture/TextureLoader.hpp"
+#include "resources/ResourceManager.hpp"
+
+
+namespace
+{
+//  The same file reached through different relative paths or links maps to one key
+    std::string make_texture_key(const char* filepath, VkFormat format) noexcept
+    {
+        std::error_code error;
+        const auto canonical = std::filesystem::weakly_canonical(filepath, error);
+
+        try
+        {
+            std::string key = error ? std::string(filepath) : canonical.generic_string();
+            key += '#';
+            key += std::to_string(static_cast<int32_t>(format));
+
+            return key;
+        }
+        catch (const std::bad_alloc&)
+        {
+            return {};
+        }
+    }
+
+
+//  Reuses a free slot or appends a new one, expects the manager lock to be held
+    template<class Entry>
+    uint32_t allocate_slot(std::vector<std::unique_ptr<Entry>>& entries, std::vector<uint32_t>& generations, std::vector<uint32_t>& freeSlots) noexcept
+    {
+        try
+        {
+            if ( ! freeSlots.empty() )
+            {
+                const uint32_t index = freeSlots.back();
+                entries[index] = std::make_unique<Entry>();
+                freeSlots.pop_back();
+
+                return index;
+            }
+
+            generations.reserve(entries.size() + 1);
+            entries.push_back(std::make_unique<Entry>());
+            generations.push_back(0);
+
+            return static_cast<uint32_t>(entries.size() - 1);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return ResourceManager::INVALID_HANDLE;
+        }
+    }
+}
+
+
+
+bool ResourceManager::init(const VulkanContext* context, DeletionQueue* deletionQueue, JobSystem* jobs) noexcept
+{
+    m_context       = context;
+    m_deletionQueue = deletionQueue;
+    m_jobs          = jobs;
+
+    return (m_context != nullptr && m_deletionQueue != nullptr && m_jobs != nullptr);
+}
+
+
+void ResourceManager::destroy(VkDevice device) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    for (auto& entry : m_textures)
+        if (entry && entry->state == State::Ready)
+            entry->texture.destroy(device);
+
+    for (auto& entry : m_buffers)
+    {
+        if (entry && entry->state == State::Ready)
+        {
+            vkDestroyBuffer(device, entry->handle, VK_NULL_HANDLE);
+            vkFreeMemory(device, entry->memory, VK_NULL_HANDLE);
+        }
+    }
+
+    m_textures.clear();
+    m_textureGenerations.clear();
+    m_freeTextures.clear();
+    m_textureIndex.clear();
+
+    m_buffers.clear();
+    m_bufferGenerations.clear();
+    m_freeBuffers.clear();
+    m_bufferIndex.clear();
+
+    std::lock_guard<std::mutex> poolLock(m_poolLock);
+
+    for (const auto pool : m_pools)
+        vkDestroyCommandPool(device, pool, VK_NULL_HANDLE);
+
+    m_pools.clear();
+    m_freePools.clear();
+}
+
+
+ResourceManager::TextureHandle ResourceManager::loadTexture(const char* filepath, VkFormat format) noexcept
+{
+    TextureHandle texture;
+    loadTextures({ &filepath, 1 }, { &texture, 1 }, format);
+
+    return texture;
+}
+
+
+void ResourceManager::loadTextures(std::span<const char* const> filepaths, std::span<TextureHandle> textures, VkFormat format) noexcept
+{
+    const size_t count = std::min(filepaths.size(), textures.size());
+
+    for (auto& texture : textures)
+        texture = {};
+
+    std::vector<std::string>   keys;
+    std::vector<uint32_t>      indices; // entry of every path, INVALID_HANDLE when it could not be registered
+    std::vector<size_t>        created; // paths whose entry this call loads, the others are shared
+    std::vector<TextureEntry*> entries;
+    std::vector<uint8_t>       loaded;
+    std::vector<const char*>   batchPaths;
+    std::vector<Texture2D>     batchTextures;
+
+    try
+    {
+        keys.reserve(count);
+        indices.assign(count, INVALID_HANDLE);
+        created.reserve(count);
+        entries.assign(count, nullptr);
+        loaded.assign(count, 0);
+        batchPaths.reserve(count);
+        batchTextures.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+            keys.push_back(make_texture_key(filepaths[i], format));
+    }
+    catch (const std::bad_alloc&)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (keys[i].empty())
+            continue;
+
+//      Resident, loading on another thread, or requested twice in this call: one more reference to the same entry
+        if (auto found = m_textureIndex.find(keys[i]); found != m_textureIndex.end())
+        {
+            indices[i] = found->second;
+            ++m_textures[found->second]->refCount;
+
+            continue;
+        }
+
+        const uint32_t index = allocate_slot(m_textures, m_textureGenerations, m_freeTextures);
+
+        if (index == INVALID_HANDLE)
+            continue;
+
+        TextureEntry* entry = m_textures[index].get();
+        entry->refCount = 1;
+
+        try
+        {
+            m_textureIndex.emplace(keys[i], index);
+            entry->key = std::move(keys[i]);
+        }
+        catch (const std::bad_alloc&)
+        {
+            m_textures[index].reset();
+            m_freeTextures.push_back(index);
+
+            continue;
+        }
+
+        indices[i] = index;
+        entries[i] = entry;
+        created.push_back(i);
+    }
+
+    lock.unlock();
+
+//  Decoding runs unlocked, so loads of different files overlap. Block-compressed files are uploaded one by one
+    for (const size_t i : created)
+    {
+        if (CompressedImage::isCompressedFile(filepaths[i]))
+            loaded[i] = uploadTexture(entries[i]->texture, filepaths[i]);
+        else
+            batchPaths.push_back(filepaths[i]);
+    }
+
+    if ( ! batchPaths.empty() )
+    {
+        batchTextures.resize(batchPaths.size());
+
+        VkCommandPool pool = acquirePool();
+        const bool batched = pool && TextureLoader::loadFromFiles(batchPaths, batchTextures, m_context, pool, *m_jobs, format);
+
+        if (pool)
+            releasePool(pool);
+
+        for (size_t i = 0, texture = 0; i < created.size(); ++i)
+        {
+            const size_t path = created[i];
+
+            if (CompressedImage::isCompressedFile(filepaths[path]))
+                continue;
+
+            entries[path]->texture = batchTextures[texture++];
+            loaded[path] = batched;
+        }
+
+#ifdef DEBUG
+        if ( ! batched )
+            fprintf(stderr, "Failed to load a batch of %zu textures\n", batchPaths.size());
+#endif
+    }
+
+    lock.lock();
+
+    for (const size_t i : created)
+        entries[i]->state = loaded[i] ? State::Ready : State::Failed;
+
+    m_loaded.notify_all();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t index = indices[i];
+
+        if (index == INVALID_HANDLE)
+            continue;
+
+//      Somebody else is loading it right now, share that load
+        TextureEntry* entry = m_textures[index].get();
+        m_loaded.wait(lock, [entry]() { return entry->state != State::Loading; });
+
+        if (entry->state == State::Ready)
+            textures[i] = { index, m_textureGenerations[index] };
+        else
+            releaseTexture(index);
+    }
+}
+
+
+ResourceManager::BufferHandle ResourceManager::loadBuffer(const void* data, VkDeviceSize size, uint32_t elementCount, VkBufferUsageFlags usage) noexcept
+{
+    if ( ! data || size == 0 )
+        return {};
+
+//  Hashing runs before the lock is taken, and the comparison on a match after it is dropped
+    const BufferKey key = { XXHash::hash64(data, static_cast<size_t>(size)), size, usage };
+
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    bool collision = false;
+
+    if (auto found = m_bufferIndex.find(key); found != m_bufferIndex.end())
+    {
+        const uint32_t index = found->second;
+        BufferEntry* entry   = m_buffers[index].get();
+
+        ++entry->refCount;
+
+        m_loaded.wait(lock, [entry]() { return entry->state != State::Loading; });
+
+        if (entry->state == State::Ready)
+        {
+//          The reference keeps the entry and its copy of the contents alive
+            lock.unlock();
+            const bool equal = (memcmp(entry->bytes.data(), data, static_cast<size_t>(size)) == 0);
+            lock.lock();
+
+            if (equal)
+                return { index, m_bufferGenerations[index] };
+
+            collision = true;
+        }
+
+        releaseBuffer(index);
+
+        if ( ! collision )
+            return {};
+    }
+
+    const uint32_t index = allocate_slot(m_buffers, m_bufferGenerations, m_freeBuffers);
+
+    if (index == INVALID_HANDLE)
+        return {};
+
+    BufferEntry* entry  = m_buffers[index].get();
+    entry->key          = key;
+    entry->elementCount = elementCount;
+    entry->refCount     = 1;
+
+//  Same hash, other contents: the entry is never shared and the index keeps pointing at the first one
+    if ( ! collision )
+    {
+        try
+        {
+            m_bufferIndex.emplace(key, index);
+        }
+        catch (const std::bad_alloc&)
+        {
+            m_buffers[index].reset();
+            m_freeBuffers.push_back(index);
+
+            return {};
+        }
+    }
+
+    lock.unlock();
+
+    bool loaded = false;
+
+    try
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        entry->bytes.assign(bytes, bytes + size);
+
+        loaded = uploadBuffer(*entry, data);
+    }
+    catch (const std::bad_alloc&)
+    {
+        loaded = false;
+    }
+
+    lock.lock();
+
+    entry->state = loaded ? State::Ready : State::Failed;
+    m_loaded.notify_all();
+
+    if (loaded)
+        return { index, m_bufferGenerations[index] };
+
+    releaseBuffer(index);
+
+    return {};
+}
+
+
+bool ResourceManager::retain(TextureHandle texture) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    TextureEntry* entry = findTexture(texture);
+
+    if ( ! entry )
+        return false;
+
+    ++entry->refCount;
+
+    return true;
+}
+
+
+bool ResourceManager::retain(BufferHandle buffer) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    BufferEntry* entry = findBuffer(buffer);
+
+    if ( ! entry )
+        return false;
+
+    ++entry->refCount;
+
+    return true;
+}
+
+
+void ResourceManager::release(TextureHandle texture) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (findTexture(texture))
+        releaseTexture(texture.index);
+}
+
+
+void ResourceManager::release(BufferHandle buffer) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (findBuffer(buffer))
+        releaseBuffer(buffer.index);
+}
+
+
+const Texture2D* ResourceManager::getTexture(TextureHandle texture) const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const TextureEntry* entry = findTexture(texture);
+
+    if ( ! entry || entry->state != State::Ready )
+        return nullptr;
+
+    return &entry->texture;
+}
+
+
+Buffer ResourceManager::getBuffer(BufferHandle buffer) const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const BufferEntry* entry = findBuffer(buffer);
+
+    if ( ! entry || entry->state != State::Ready )
+        return {};
+
+    return { entry->handle, entry->elementCount };
+}
+
+
+bool ResourceManager::uploadTexture(Texture2D& texture, const char* filepath) noexcept
+{
+    Image decoded;
+    CompressedImage compressed;
+    UploadBatch batch;
+
+    if ( ! compressed.loadFromFile(filepath) )
+        return false;
+
+    bool created = false;
+
+    if (compressed.isSupported(m_context->GPU))
+    {
+        created = texture.loadFromCompressed(compressed, m_context, batch);
+    }
+    else
+    {
+        VkFormat decodedFormat;
+        created = compressed.decompress(decoded, &decodedFormat) && texture.loadFromImage(decoded, m_context, batch, decodedFormat);
+    }
+
+    const bool submitted = created && submit(batch);
+
+    if ( ! submitted )
+    {
+        texture.destroy(m_context->device);
+        texture = {};
+#ifdef DEBUG
+        fprintf(stderr, "Failed to load texture: %s\n", filepath);
+#endif
+    }
+
+    return submitted;
+}
+
+
+bool ResourceManager::uploadBuffer(BufferEntry& entry, const void* data) noexcept
+{
+    VkDevice device = m_context->device;
+
+    entry.handle = vktools::create_buffer(
+                                          entry.key.size, 
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | entry.key.usage, 
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+                                          &entry.memory, 
+                                          device, 
+                                          m_context->GPU);
+
+    if ( ! entry.handle )
+        return false;
+
+    UploadBatch batch;
+    batch.addBuffer(entry.handle, data, entry.key.size);
+
+    const bool submitted = submit(batch);
+
+    if ( ! submitted )
+    {
+        vkDestroyBuffer(device, entry.handle, VK_NULL_HANDLE);
+        vkFreeMemory(device, entry.memory, VK_NULL_HANDLE);
+
+        entry.handle = VK_NULL_HANDLE;
+        entry.memory = VK_NULL_HANDLE;
+    }
+
+    return submitted;
+}
+
+
+bool ResourceManager::submit(UploadBatch& batch) noexcept
+{
+    VkCommandPool pool = acquirePool();
+
+    if ( ! pool )
+        return false;
+
+//  The batch takes VulkanContext::queueLock for the submission itself
+    const bool submitted = batch.submit(m_context, pool);
+
+    releasePool(pool);
+
+    return submitted;
+}
+
+
+VkCommandPool ResourceManager::acquirePool() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_poolLock);
+
+    VkCommandPool pool = VK_NULL_HANDLE;
+
+    try
+    {
+        m_freePools.reserve(m_pools.size() + 1); // the pool can always be handed back by releasePool()
+
+        if ( ! m_freePools.empty() )
+        {
+            pool = m_freePools.back();
+            m_freePools.pop_back();
+
+            return pool;
+        }
+
+        const VkCommandPoolCreateInfo poolInfo = 
+        {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = VK_NULL_HANDLE,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = m_context->mainQueueFamilyIndex
+        };
+
+        m_pools.reserve(m_pools.size() + 1);
+
+        if (vkCreateCommandPool(m_context->device, &poolInfo, VK_NULL_HANDLE, &pool) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        m_pools.push_back(pool);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    return pool;
+}
+
+
+void ResourceManager::releasePool(VkCommandPool pool) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_poolLock);
+    m_freePools.push_back(pool);
+}
+
+
+ResourceManager::TextureEntry* ResourceManager::findTexture(TextureHandle texture) const noexcept
+{
+    if (texture.index >= m_textures.size() || m_textureGenerations[texture.index] != texture.generation)
+        return nullptr;
+
+    return m_textures[texture.index].get();
+}
+
+
+ResourceManager::BufferEntry* ResourceManager::findBuffer(BufferHandle buffer) const noexcept
+{
+    if (buffer.index >= m_buffers.size() || m_bufferGenerations[buffer.index] != buffer.generation)
+        return nullptr;
+
+    return m_buffers[buffer.index].get();
+}
+
+
+void ResourceManager::releaseTexture(uint32_t index) noexcept
+{
+    TextureEntry& entry = *m_textures[index];
+
+//  A load in progress keeps its entry, the loader drops its own reference when it is done
+    if (--entry.refCount > 0 || entry.state == State::Loading)
+        return;
+
+    if (entry.state == State::Ready)
+        m_deletionQueue->destroyTexture(entry.texture);
+
+    m_textureIndex.erase(entry.key);
+    m_textures[index].reset();
+    m_freeTextures.push_back(index);
+    ++m_textureGenerations[index];
+}
+
+
+void ResourceManager::releaseBuffer(uint32_t index) noexcept
+{
+    BufferEntry& entry = *m_buffers[index];
+
+    if (--entry.refCount > 0 || entry.state == State::Loading)
+        return;
+
+    if (entry.state == State::Ready)
+        m_deletionQueue->destroyBuffer(entry.handle, entry.memory);
+
+//  An entry that lost a hash collision is not in the index
+    if (auto found = m_bufferIndex.find(entry.key); found != m_bufferIndex.end() && found->second == index)
+        m_bufferIndex.erase(found);
+
+    m_buffers[index].reset();
+    m_freeBuffers.push_back(index);
+    ++m_bufferGenerations[index];
+}
@@ -0,0 +1,152 @@
+#ifndef RESOURCE_MANAGER_HPP
+#define RESOURCE_MANAGER_HPP
+
+#include <span>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+
+#include "buffers/BufferHolder.hpp"
+#include "texture/Texture2D.hpp"
+
+
+// Loads every asset once and hands out reference-counted handles to it.
+// Textures are deduplicated by canonical path plus the decode format, buffers by an XXH64 hash of
+// their contents plus size and usage, confirmed against a host copy of the contents. A request for an asset
+// that is still loading on another thread waits for that load instead of starting a second one.
+// A handle carries the generation of its slot, so one kept after its asset was freed matches nothing.
+// Loads may run on any thread. Each load in progress records on a command pool of its own and submits under
+// VulkanContext::queueLock, the same lock the render thread takes for its submit and present
+class ResourceManager
+{
+public:
+    static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+    struct TextureHandle
+    {
+        uint32_t index      = INVALID_HANDLE;
+        uint32_t generation = 0;
+    };
+
+    struct BufferHandle
+    {
+        uint32_t index      = INVALID_HANDLE;
+        uint32_t generation = 0;
+    };
+
+//  Released resources go to 'deletionQueue', which must outlive the manager. Batched texture loads decode on 'jobs'
+    bool init(const struct VulkanContext* context, class DeletionQueue* deletionQueue, class JobSystem* jobs) noexcept;
+
+//  Destroys every resource regardless of outstanding references, the device has to be idle
+    void destroy(VkDevice device) noexcept;
+
+//  'format' applies to PNG/JPG sources, KTX2 and DDS files carry their own
+    TextureHandle loadTexture(const char* filepath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB) noexcept;
+
+//  One handle per path in 'textures'. The PNG/JPG files not resident yet are read, decoded and uploaded together
+//  by one TextureLoader batch, which succeeds or fails as a whole
+    void loadTextures(std::span<const char* const> filepaths, std::span<TextureHandle> textures, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB) noexcept;
+
+    template<class T>
+    BufferHandle loadBuffer(std::span<const T> data, VkBufferUsageFlags usage) noexcept
+    {
+        return loadBuffer(data.data(), data.size_bytes(), static_cast<uint32_t>(data.size()), usage);
+    }
+
+    BufferHandle loadBuffer(const void* data, VkDeviceSize size, uint32_t elementCount, VkBufferUsageFlags usage) noexcept;
+
+//  Another owner for an existing handle, false when the handle is stale
+    bool retain(TextureHandle texture) noexcept;
+    bool retain(BufferHandle buffer) noexcept;
+
+//  The last release queues the resource for destruction once the frames in flight are done with it
+    void release(TextureHandle texture) noexcept;
+    void release(BufferHandle buffer) noexcept;
+
+    const Texture2D* getTexture(TextureHandle texture) const noexcept;
+    Buffer getBuffer(BufferHandle buffer) const noexcept;
+
+private:
+    enum class State : uint8_t
+    {
+        Loading,
+        Ready,
+        Failed
+    };
+
+    struct TextureEntry
+    {
+        std::string key;
+        Texture2D   texture;
+        uint32_t    refCount = 0;
+        State       state    = State::Loading;
+    };
+
+    struct BufferKey
+    {
+        uint64_t           hash;
+        VkDeviceSize       size;
+        VkBufferUsageFlags usage;
+
+        bool operator == (const BufferKey& other) const noexcept = default;
+    };
+
+    struct BufferKeyHash
+    {
+        size_t operator () (const BufferKey& key) const noexcept
+        {
+            return static_cast<size_t>(key.hash ^ (key.size * 0x9E3779B97F4A7C15ull) ^ key.usage);
+        }
+    };
+
+    struct BufferEntry
+    {
+        BufferKey            key;
+        std::vector<uint8_t> bytes;                   // compared on a hash match, immutable once the entry is ready
+        VkBuffer             handle       = VK_NULL_HANDLE;
+        VkDeviceMemory       memory       = VK_NULL_HANDLE;
+        uint32_t             elementCount = 0;
+        uint32_t             refCount     = 0;
+        State                state        = State::Loading;
+    };
+
+    bool uploadTexture(Texture2D& texture, const char* filepath) noexcept; // KTX2 and DDS files
+    bool uploadBuffer(BufferEntry& entry, const void* data) noexcept;
+    bool submit(class UploadBatch& batch) noexcept;
+
+//  Command pools are not thread-safe: a load takes one from the free list, or creates one, for its submission
+    VkCommandPool acquirePool() noexcept;
+    void releasePool(VkCommandPool pool) noexcept;
+
+//  All of them expect m_lock to be held
+    TextureEntry* findTexture(TextureHandle texture) const noexcept;
+    BufferEntry* findBuffer(BufferHandle buffer) const noexcept;
+    void releaseTexture(uint32_t index) noexcept;
+    void releaseBuffer(uint32_t index) noexcept;
+
+    const struct VulkanContext* m_context       = nullptr;
+    class DeletionQueue*        m_deletionQueue = nullptr;
+    class JobSystem*            m_jobs          = nullptr;
+
+    mutable std::mutex      m_lock;
+    std::condition_variable m_loaded;
+
+    std::mutex                 m_poolLock;
+    std::vector<VkCommandPool> m_pools;
+    std::vector<VkCommandPool> m_freePools;
+
+    std::vector<std::unique_ptr<TextureEntry>>   m_textures;
+    std::vector<uint32_t>                        m_textureGenerations; // bumped whenever a slot is freed
+    std::vector<uint32_t>                        m_freeTextures;
+    std::unordered_map<std::string, uint32_t>    m_textureIndex;
+
+    std::vector<std::unique_ptr<BufferEntry>>                 m_buffers;
+    std::vector<uint32_t>                                     m_bufferGenerations;
+    std::vector<uint32_t>                                     m_freeBuffers;
+    std::unordered_map<BufferKey, uint32_t, BufferKeyHash>    m_bufferIndex;
+};
+
+#endif // !RESOURCE_MANAGER_HPP
@@ -0,0 +1,751 @@
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <system_error>
+
+#include "camera/Frustum.hpp"
+#include "scene/BoundingVolumeHierarchy.hpp"
+
+
+namespace
+{
+    constexpr uint32_t MAX_LEAF_SIZE      = 4;
+    constexpr uint32_t BINS               = 16;
+    constexpr uint32_t STACK_SIZE         = 64;
+    constexpr uint32_t MEDIAN_SPLIT_DEPTH = 40; // deeper nodes are halved, which keeps every path shorter than STACK_SIZE
+    constexpr float    TRAVERSAL_COST     = 1.f; // relative to testing one object
+
+
+    struct Bounds
+    {
+        float min[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+        float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void grow(const float* lower, const float* upper) noexcept
+        {
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                min[axis] = std::min(min[axis], lower[axis]);
+                max[axis] = std::max(max[axis], upper[axis]);
+            }
+        }
+
+        float area() const noexcept
+        {
+            const float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+
+            return (x < 0.f) ? 0.f : (x * y + y * z + z * x);
+        }
+    };
+
+
+    bool overlaps(const float* minA, const float* maxA, const float* minB, const float* maxB) noexcept
+    {
+        return minA[0] <= maxB[0] && maxA[0] >= minB[0] &&
+               minA[1] <= maxB[1] && maxA[1] >= minB[1] &&
+               minA[2] <= maxB[2] && maxA[2] >= minB[2];
+    }
+
+
+    float distance_squared(const float* min, const float* max, const float* point) noexcept
+    {
+        float result = 0.f;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float d = std::max({ min[axis] - point[axis], 0.f, point[axis] - max[axis] });
+            result += d * d;
+        }
+
+        return result;
+    }
+
+
+//  Entry distance of the ray into the box, or FLT_MAX on a miss
+    float intersect_ray(const float* min, const float* max, const float* origin, const float* inverseDirection, float maxDistance) noexcept
+    {
+        float tNear = 0.f;
+        float tFar  = maxDistance;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+            float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            tNear = std::max(tNear, t0);
+            tFar  = std::min(tFar, t1);
+        }
+
+        return (tNear <= tFar) ? tNear : FLT_MAX;
+    }
+
+
+    enum class Side { OUTSIDE, INSIDE, INTERSECTING };
+
+
+//  Planes the box lies fully inside of are cleared from 'mask'
+    Side classify(const Frustum& frustum, const float* min, const float* max, uint32_t& mask) noexcept
+    {
+        for (uint32_t i = 0; i < Frustum::PLANE_COUNT; ++i)
+        {
+            if ( ! (mask & (1u << i)) )
+                continue;
+
+            const vec4s& plane = frustum.planes[i];
+
+//  Corner furthest along the normal decides outside, the opposite one fully inside
+            const float outer = plane.x * ((plane.x >= 0.f) ? max[0] : min[0]) + plane.y * ((plane.y >= 0.f) ? max[1] : min[1]) + plane.z * ((plane.z >= 0.f) ? max[2] : min[2]) + plane.w;
+            const float inner = plane.x * ((plane.x >= 0.f) ? min[0] : max[0]) + plane.y * ((plane.y >= 0.f) ? min[1] : max[1]) + plane.z * ((plane.z >= 0.f) ? min[2] : max[2]) + plane.w;
+
+            if (outer < 0.f)
+                return Side::OUTSIDE;
+
+            if (inner >= 0.f)
+                mask &= ~(1u << i);
+        }
+
+        return mask ? Side::INTERSECTING : Side::INSIDE;
+    }
+
+
+    uint32_t emit(uint32_t proxy, uint32_t* out, uint32_t capacity, uint32_t found) noexcept
+    {
+        if (found < capacity)
+            out[found] = proxy;
+
+        return found + 1;
+    }
+}
+
+
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+    waitRebuild();
+}
+
+
+void BoundingVolumeHierarchy::setSettings(const Settings& settings) noexcept
+{
+    m_settings = settings;
+}
+
+
+bool BoundingVolumeHierarchy::reserve(uint32_t capacity) noexcept
+{
+//  Each list holds every proxy at most once, so none of them can outgrow the proxy array
+    try
+    {
+        m_proxies.reserve(capacity);
+        m_freeProxies.reserve(capacity);
+        m_pending.reserve(capacity);
+        m_removed.reserve(capacity);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+uint32_t BoundingVolumeHierarchy::insert(const Aabb& box, uint32_t userData) noexcept
+{
+    if (m_freeProxies.empty() && m_proxies.size() == m_proxies.capacity())
+    {
+        const uint32_t size     = static_cast<uint32_t>(m_proxies.size());
+        const uint32_t capacity = (size < 64) ? 64 : size * 2;
+
+        if ( ! reserve(capacity) )
+            return INVALID_PROXY;
+    }
+
+    uint32_t proxy;
+
+    if (m_freeProxies.empty())
+    {
+        proxy = static_cast<uint32_t>(m_proxies.size());
+        m_proxies.push_back({});
+    }
+    else
+    {
+        proxy = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    }
+
+    m_proxies[proxy] = { box, userData, true };
+    m_pending.push_back(proxy);
+
+    ++m_count;
+    ++m_changes;
+
+    return proxy;
+}
+
+
+void BoundingVolumeHierarchy::remove(uint32_t proxy) noexcept
+{
+    if (proxy >= m_proxies.size() || ! m_proxies[proxy].alive )
+        return;
+
+//  Trees may still point at the proxy, it is recycled once a tree built without it is in use
+    m_proxies[proxy].alive = false;
+    m_removed.push_back(proxy);
+
+    --m_count;
+    m_moved = true;
+}
+
+
+void BoundingVolumeHierarchy::move(uint32_t proxy, const Aabb& box) noexcept
+{
+    if (proxy >= m_proxies.size() || ! m_proxies[proxy].alive )
+        return;
+
+    m_proxies[proxy].box = box;
+    m_moved = true;
+    ++m_changes;
+}
+
+
+uint32_t BoundingVolumeHierarchy::getUserData(uint32_t proxy) const noexcept
+{
+    return m_proxies[proxy].userData;
+}
+
+
+const Aabb& BoundingVolumeHierarchy::getBox(uint32_t proxy) const noexcept
+{
+    return m_proxies[proxy].box;
+}
+
+
+uint32_t BoundingVolumeHierarchy::getCount() const noexcept
+{
+    return m_count;
+}
+
+
+bool BoundingVolumeHierarchy::build() noexcept
+{
+    waitRebuild();
+
+    if (m_building)
+    {
+        m_building = false;
+
+        if ( ! m_buildFailed )
+            swapTree();
+    }
+
+    if ( ! snapshot() || ! buildTree(m_buildRefs, m_buildTree) )
+        return false;
+
+    swapTree();
+
+    return true;
+}
+
+
+void BoundingVolumeHierarchy::update(bool background) noexcept
+{
+    if (m_building && m_buildDone.load(std::memory_order_acquire))
+    {
+        waitRebuild(); // the thread is done, joining only reclaims it
+        m_building = false;
+
+        if ( ! m_buildFailed )
+            swapTree(); // refits as well
+    }
+
+    if (m_moved)
+        refit();
+
+    const uint32_t threshold = std::max(m_settings.minRebuildCount, static_cast<uint32_t>(m_settings.rebuildFraction * m_count));
+
+    if (m_building || m_changes < threshold)
+        return;
+
+    if ( ! snapshot() )
+        return;
+
+    if (background)
+    {
+        m_building = true;
+        m_buildDone.store(false, std::memory_order_relaxed);
+
+        try
+        {
+            m_buildThread = std::thread([this]()
+            {
+                m_buildFailed = ! buildTree(m_buildRefs, m_buildTree);
+                m_buildDone.store(true, std::memory_order_release);
+            });
+
+            return;
+        }
+        catch (const std::system_error&)
+        {
+            m_building = false;
+        }
+    }
+
+    if (buildTree(m_buildRefs, m_buildTree))
+        swapTree();
+}
+
+
+void BoundingVolumeHierarchy::waitRebuild() noexcept
+{
+    if (m_buildThread.joinable())
+        m_buildThread.join();
+}
+
+
+uint32_t BoundingVolumeHierarchy::queryFrustum(const Frustum& frustum, uint32_t* out, uint32_t capacity) const noexcept
+{
+    constexpr uint32_t ALL_PLANES = (1u << Frustum::PLANE_COUNT) - 1;
+
+    uint32_t found = 0;
+
+    for (uint32_t proxy : m_pending)
+    {
+        const Proxy& entry = m_proxies[proxy];
+        uint32_t mask = ALL_PLANES;
+
+        if (entry.alive && classify(frustum, entry.box.min.raw, entry.box.max.raw, mask) != Side::OUTSIDE)
+            found = emit(proxy, out, capacity, found);
+    }
+
+    if (m_tree.nodes.empty())
+        return found;
+
+    struct Entry { uint32_t node; uint32_t mask; };
+
+    Entry stack[STACK_SIZE];
+    uint32_t top = 0;
+
+    stack[top++] = { 0, ALL_PLANES };
+
+    while (top)
+    {
+        const Entry entry = stack[--top];
+        const Node& node  = m_tree.nodes[entry.node];
+        uint32_t    mask  = entry.mask;
+
+//  Fully inside planes stay cleared for the whole subtree, a node fully inside all of them is not tested at all
+        if (mask && classify(frustum, node.min, node.max, mask) == Side::OUTSIDE)
+            continue;
+
+        if (node.count)
+        {
+            for (uint32_t i = node.index, end = node.index + node.count; i < end; ++i)
+            {
+                const uint32_t proxy = m_tree.leafProxies[i];
+                const Proxy&   leaf  = m_proxies[proxy];
+                uint32_t       leafMask = mask;
+
+                if (leaf.alive && (leafMask == 0 || classify(frustum, leaf.box.min.raw, leaf.box.max.raw, leafMask) != Side::OUTSIDE))
+                    found = emit(proxy, out, capacity, found);
+            }
+        }
+        else
+        {
+            stack[top++] = { node.index, mask };
+            stack[top++] = { entry.node + 1, mask };
+        }
+    }
+
+    return found;
+}
+
+
+uint32_t BoundingVolumeHierarchy::queryBox(const Aabb& box, uint32_t* out, uint32_t capacity) const noexcept
+{
+    return query([&box](const float* min, const float* max)
+    {
+        return overlaps(min, max, box.min.raw, box.max.raw);
+    }, out, capacity);
+}
+
+
+uint32_t BoundingVolumeHierarchy::querySphere(vec3s center, float radius, uint32_t* out, uint32_t capacity) const noexcept
+{
+    const float radiusSquared = radius * radius;
+
+    return query([&center, radiusSquared](const float* min, const float* max)
+    {
+        return distance_squared(min, max, center.raw) <= radiusSquared;
+    }, out, capacity);
+}
+
+
+BoundingVolumeHierarchy::RayHit BoundingVolumeHierarchy::raycast(vec3s origin, vec3s direction, float maxDistance) const noexcept
+{
+    RayHit hit;
+
+    const float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+
+    if (length <= 0.f)
+        return hit;
+
+//  Division by a zero component gives an infinity, which the slab test handles
+    const float inverse[3] = { length / direction.x, length / direction.y, length / direction.z };
+    float closest = maxDistance;
+
+    auto test = [&](uint32_t proxy)
+    {
+        const Proxy& entry = m_proxies[proxy];
+
+        if ( ! entry.alive )
+            return;
+
+        const float t = intersect_ray(entry.box.min.raw, entry.box.max.raw, origin.raw, inverse, closest);
+
+        if (t < closest || (t == closest && hit.proxy == INVALID_PROXY))
+        {
+            closest      = t;
+            hit.proxy    = proxy;
+            hit.distance = t;
+        }
+    };
+
+    for (uint32_t proxy : m_pending)
+        test(proxy);
+
+    if (m_tree.nodes.empty())
+        return hit;
+
+    uint32_t stack[STACK_SIZE];
+    uint32_t top = 0;
+
+    stack[top++] = 0;
+
+    while (top)
+    {
+        const Node& node = m_tree.nodes[stack[--top]];
+
+        if (intersect_ray(node.min, node.max, origin.raw, inverse, closest) == FLT_MAX)
+            continue;
+
+        if (node.count)
+        {
+            for (uint32_t i = node.index, end = node.index + node.count; i < end; ++i)
+                test(m_tree.leafProxies[i]);
+
+            continue;
+        }
+
+//  Nearer child on top of the stack, its hits shrink the range the other one is tested with
+        const uint32_t left  = static_cast<uint32_t>(&node - m_tree.nodes.data()) + 1;
+        const uint32_t right = node.index;
+
+        const float tLeft  = intersect_ray(m_tree.nodes[left].min, m_tree.nodes[left].max, origin.raw, inverse, closest);
+        const float tRight = intersect_ray(m_tree.nodes[right].min, m_tree.nodes[right].max, origin.raw, inverse, closest);
+
+        if (tLeft <= tRight)
+        {
+            if (tRight != FLT_MAX) stack[top++] = right;
+            if (tLeft  != FLT_MAX) stack[top++] = left;
+        }
+        else
+        {
+            if (tLeft  != FLT_MAX) stack[top++] = left;
+            if (tRight != FLT_MAX) stack[top++] = right;
+        }
+    }
+
+    return hit;
+}
+
+
+bool BoundingVolumeHierarchy::snapshot() noexcept
+{
+    try
+    {
+        m_buildRefs.clear();
+        m_buildRefs.reserve(m_count);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (uint32_t proxy = 0; proxy < m_proxies.size(); ++proxy)
+    {
+        const Proxy& entry = m_proxies[proxy];
+
+        if ( ! entry.alive )
+            continue;
+
+        const vec3s& min = entry.box.min;
+        const vec3s& max = entry.box.max;
+
+        m_buildRefs.push_back(
+        {
+            { min.x, min.y, min.z },
+            { max.x, max.y, max.z },
+            { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f },
+            proxy
+        });
+    }
+
+    m_buildPending = static_cast<uint32_t>(m_pending.size());
+    m_buildRemoved = static_cast<uint32_t>(m_removed.size());
+    m_changes      = 0;
+
+    return true;
+}
+
+
+bool BoundingVolumeHierarchy::buildTree(std::vector<Ref>& refs, Tree& tree) noexcept
+{
+    tree.nodes.clear();
+    tree.leafProxies.clear();
+
+    if (refs.empty())
+        return true;
+
+    try
+    {
+//  A binary tree with at least one object per leaf has fewer than twice as many nodes as objects
+        tree.nodes.reserve(refs.size() * 2);
+        tree.leafProxies.resize(refs.size());
+
+        buildNode(refs.data(), 0, static_cast<uint32_t>(refs.size()), 0, tree);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < refs.size(); ++i)
+        tree.leafProxies[i] = refs[i].proxy;
+
+    return true;
+}
+
+
+void BoundingVolumeHierarchy::buildNode(Ref* refs, uint32_t begin, uint32_t end, uint32_t depth, Tree& tree)
+{
+    const uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+    const uint32_t count = end - begin;
+
+    Bounds bounds;
+    Bounds centroids;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        bounds.grow(refs[i].min, refs[i].max);
+        centroids.grow(refs[i].centroid, refs[i].centroid);
+    }
+
+    tree.nodes.push_back({ { bounds.min[0], bounds.min[1], bounds.min[2] }, begin, { bounds.max[0], bounds.max[1], bounds.max[2] }, count });
+
+    if (count <= 1)
+        return;
+
+    uint32_t axis = 0;
+
+    for (uint32_t i = 1; i < 3; ++i)
+        if (centroids.max[i] - centroids.min[i] > centroids.max[axis] - centroids.min[axis])
+            axis = i;
+
+    const float extent = centroids.max[axis] - centroids.min[axis];
+    uint32_t    middle = begin + count / 2;
+
+    if (extent <= 0.f)
+    {
+//  Every centroid in one spot, no plane separates them
+        if (count <= MAX_LEAF_SIZE)
+            return;
+    }
+    else if (depth >= MEDIAN_SPLIT_DEPTH)
+    {
+        std::nth_element(refs + begin, refs + middle, refs + end, [axis](const Ref& a, const Ref& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+    else
+    {
+        Bounds   binBounds[BINS];
+        uint32_t binCounts[BINS] = {};
+
+        const float scale = BINS * (1.f - 1e-5f) / extent;
+
+        auto bin_of = [&](const Ref& ref)
+        {
+            return std::min(static_cast<uint32_t>((ref.centroid[axis] - centroids.min[axis]) * scale), BINS - 1);
+        };
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const uint32_t bin = bin_of(refs[i]);
+
+            binBounds[bin].grow(refs[i].min, refs[i].max);
+            ++binCounts[bin];
+        }
+
+//  Surface area heuristic for the BINS - 1 planes between the bins, swept from both sides
+        float    rightAreas[BINS];
+        uint32_t rightCounts[BINS];
+        Bounds   right;
+        uint32_t rightCount = 0;
+
+        for (uint32_t i = BINS - 1; i > 0; --i)
+        {
+            right.grow(binBounds[i].min, binBounds[i].max);
+            rightCount += binCounts[i];
+            rightAreas[i]  = right.area();
+            rightCounts[i] = rightCount;
+        }
+
+        Bounds   left;
+        uint32_t leftCount = 0;
+        uint32_t bestSplit = 0;
+        float    bestCost  = FLT_MAX;
+
+        for (uint32_t i = 0; i < BINS - 1; ++i)
+        {
+            left.grow(binBounds[i].min, binBounds[i].max);
+            leftCount += binCounts[i];
+
+            if (leftCount == 0 || rightCounts[i + 1] == 0)
+                continue;
+
+            const float cost = left.area() * leftCount + rightAreas[i + 1] * rightCounts[i + 1];
+
+            if (cost < bestCost)
+            {
+                bestCost  = cost;
+                bestSplit = i;
+            }
+        }
+
+        const float area     = bounds.area();
+        const float leafCost = static_cast<float>(count);
+        const float cost     = (area > 0.f) ? TRAVERSAL_COST + bestCost / area : leafCost;
+
+        if (count <= MAX_LEAF_SIZE && cost >= leafCost)
+            return;
+
+        if (bestCost != FLT_MAX)
+            middle = static_cast<uint32_t>(std::partition(refs + begin, refs + end, [&](const Ref& ref) { return bin_of(ref) <= bestSplit; }) - refs);
+    }
+
+    tree.nodes[index].count = 0;
+
+    buildNode(refs, begin, middle, depth + 1, tree);
+    tree.nodes[index].index = static_cast<uint32_t>(tree.nodes.size());
+    buildNode(refs, middle, end, depth + 1, tree);
+}
+
+
+void BoundingVolumeHierarchy::swapTree() noexcept
+{
+    m_tree.nodes.swap(m_buildTree.nodes);
+    m_tree.leafProxies.swap(m_buildTree.leafProxies);
+
+//  Objects the new tree covers leave the pending list, proxies removed before the snapshot are referenced by nothing now
+    m_pending.erase(m_pending.begin(), m_pending.begin() + m_buildPending);
+
+    for (uint32_t i = 0; i < m_buildRemoved; ++i)
+        m_freeProxies.push_back(m_removed[i]);
+
+    m_removed.erase(m_removed.begin(), m_removed.begin() + m_buildRemoved);
+
+    m_buildPending = 0;
+    m_buildRemoved = 0;
+
+//  Whatever moved while the build was running
+    refit();
+}
+
+
+void BoundingVolumeHierarchy::refit() noexcept
+{
+    m_moved = false;
+
+//  Children always come after their parent, so a backward sweep sees them first
+    for (size_t i = m_tree.nodes.size(); i-- > 0; )
+    {
+        Node&  node = m_tree.nodes[i];
+        Bounds bounds;
+
+        if (node.count)
+        {
+            for (uint32_t j = node.index, end = node.index + node.count; j < end; ++j)
+            {
+                const Proxy& leaf = m_proxies[m_tree.leafProxies[j]];
+
+                if (leaf.alive)
+                    bounds.grow(leaf.box.min.raw, leaf.box.max.raw);
+            }
+        }
+        else
+        {
+            const Node& left  = m_tree.nodes[i + 1];
+            const Node& right = m_tree.nodes[node.index];
+
+            bounds.grow(left.min, left.max);
+            bounds.grow(right.min, right.max);
+        }
+
+        std::copy(bounds.min, bounds.min + 3, node.min);
+        std::copy(bounds.max, bounds.max + 3, node.max);
+    }
+}
+
+
+template<class Overlaps>
+uint32_t BoundingVolumeHierarchy::query(const Overlaps& overlaps, uint32_t* out, uint32_t capacity) const noexcept
+{
+    uint32_t found = 0;
+
+    for (uint32_t proxy : m_pending)
+    {
+        const Proxy& entry = m_proxies[proxy];
+
+        if (entry.alive && overlaps(entry.box.min.raw, entry.box.max.raw))
+            found = emit(proxy, out, capacity, found);
+    }
+
+    if (m_tree.nodes.empty())
+        return found;
+
+    uint32_t stack[STACK_SIZE];
+    uint32_t top = 0;
+
+    stack[top++] = 0;
+
+    while (top)
+    {
+        const uint32_t index = stack[--top];
+        const Node&    node  = m_tree.nodes[index];
+
+        if ( ! overlaps(node.min, node.max) )
+            continue;
+
+        if (node.count)
+        {
+            for (uint32_t i = node.index, end = node.index + node.count; i < end; ++i)
+            {
+                const uint32_t proxy = m_tree.leafProxies[i];
+                const Proxy&   leaf  = m_proxies[proxy];
+
+                if (leaf.alive && overlaps(leaf.box.min.raw, leaf.box.max.raw))
+                    found = emit(proxy, out, capacity, found);
+            }
+        }
+        else
+        {
+            stack[top++] = node.index;
+            stack[top++] = index + 1;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,144 @@
+#ifndef BOUNDING_VOLUME_HIERARCHY_HPP
+#define BOUNDING_VOLUME_HIERARCHY_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <cglm/struct/vec3.h>
+
+
+struct Aabb
+{
+    vec3s min;
+    vec3s max;
+};
+
+
+// Spatial index over object bounds for culling, picking and proximity queries.
+// The tree is built with binned SAH into a flat depth-first node array: the left child directly follows
+// its parent, so a traversal mostly walks forward through memory, and two 32 byte nodes share a cache line.
+// Moving an object only refits the bounds on the next update(). Once enough objects moved or were inserted
+// since the last build, update() snapshots the bounds and rebuilds on a thread of its own while queries keep
+// using the old tree, which is swapped out when the new one is ready. The build takes too long for a job, it
+// would hold a worker for many frames.
+// Objects inserted after the last build are tested one by one until the next build picks them up.
+// Not thread-safe: everything but the background build runs on the owning thread
+class BoundingVolumeHierarchy
+{
+public:
+    static constexpr uint32_t INVALID_PROXY = UINT32_MAX;
+
+    struct Settings
+    {
+        float    rebuildFraction = 0.25f; // share of moved or inserted objects that triggers a rebuild
+        uint32_t minRebuildCount = 64;    // below this many changes refits are always enough
+    };
+
+    struct RayHit
+    {
+        uint32_t proxy    = INVALID_PROXY;
+        float    distance = 0.f;          // along the normalized ray direction
+    };
+
+    BoundingVolumeHierarchy() noexcept = default;
+    BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+    BoundingVolumeHierarchy& operator = (const BoundingVolumeHierarchy&) = delete;
+    ~BoundingVolumeHierarchy();
+
+    void setSettings(const Settings& settings) noexcept;
+    bool reserve(uint32_t capacity) noexcept;
+
+    uint32_t insert(const Aabb& box, uint32_t userData) noexcept;
+    void     remove(uint32_t proxy) noexcept;
+    void     move(uint32_t proxy, const Aabb& box) noexcept;
+
+    uint32_t    getUserData(uint32_t proxy) const noexcept;
+    const Aabb& getBox(uint32_t proxy) const noexcept;
+    uint32_t    getCount() const noexcept;
+
+//  Full build on the calling thread, waits for a background build first
+    bool build() noexcept;
+
+//  Once per frame: swaps in a finished background build, refits moved objects and starts a rebuild when needed.
+//  With 'background' false rebuilds run on the calling thread
+    void update(bool background = true) noexcept;
+
+//  Blocks until the background build in flight (if any) is done
+    void waitRebuild() noexcept;
+
+//  Queries write up to 'capacity' proxies to 'out' and return how many matched, which may be more.
+//  The frustum traversal stops testing a plane once a node lies fully inside it
+    uint32_t queryFrustum(const struct Frustum& frustum, uint32_t* out, uint32_t capacity) const noexcept;
+    uint32_t queryBox(const Aabb& box, uint32_t* out, uint32_t capacity) const noexcept;
+    uint32_t querySphere(vec3s center, float radius, uint32_t* out, uint32_t capacity) const noexcept;
+
+//  Closest object box hit by the ray, 'direction' does not have to be normalized
+    RayHit raycast(vec3s origin, vec3s direction, float maxDistance) const noexcept;
+
+private:
+//  count == 0: interior node, 'index' is the right child (the left one is the next node).
+//  count > 0:  leaf, 'index' is the first of its proxies in the leaf proxy array
+    struct Node
+    {
+        float    min[3];
+        uint32_t index;
+        float    max[3];
+        uint32_t count;
+    };
+
+    struct Proxy
+    {
+        Aabb     box;
+        uint32_t userData = 0;
+        bool     alive    = false;
+    };
+
+//  Bounds snapshot the build works on, reordered in place
+    struct Ref
+    {
+        float    min[3];
+        float    max[3];
+        float    centroid[3];
+        uint32_t proxy;
+    };
+
+    struct Tree
+    {
+        std::vector<Node>     nodes;
+        std::vector<uint32_t> leafProxies;
+    };
+
+    bool snapshot() noexcept;
+    static bool buildTree(std::vector<Ref>& refs, Tree& tree) noexcept;
+    static void buildNode(Ref* refs, uint32_t begin, uint32_t end, uint32_t depth, Tree& tree); // throws std::bad_alloc
+    void swapTree() noexcept;
+    void refit() noexcept;
+
+    template<class Overlaps>
+    uint32_t query(const Overlaps& overlaps, uint32_t* out, uint32_t capacity) const noexcept;
+
+    std::vector<Proxy>    m_proxies;
+    std::vector<uint32_t> m_freeProxies;
+    std::vector<uint32_t> m_pending; // inserted since the snapshot of the current tree
+    std::vector<uint32_t> m_removed; // still referenced by a tree, recycled after the next swap
+    uint32_t              m_count = 0;
+
+    Tree     m_tree;
+    Settings m_settings;
+    uint32_t m_changes = 0; // moves and inserts since the last snapshot
+    bool     m_moved   = false;
+
+//  Background build
+    Tree              m_buildTree;
+    std::vector<Ref>  m_buildRefs;
+    uint32_t          m_buildPending = 0; // leading entries of m_pending the build covers
+    uint32_t          m_buildRemoved = 0; // leading entries of m_removed the build no longer references
+    std::thread       m_buildThread;
+    std::atomic<bool> m_buildDone    = false;
+    bool              m_building     = false;
+    bool              m_buildFailed  = false;
+};
+
+#endif // !BOUNDING_VOLUME_HIERARCHY_HPP
@@ -0,0 +1,458 @@
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+
+#include "jobs/JobSystem.hpp"
+#include "scene/TransformHierarchy.hpp"
+
+
+namespace
+{
+    constexpr uint32_t GRAIN = 4096; // nodes per job within one level
+
+
+//  Column-major like cglm: m[column][row]
+    void build_matrix(const vec3s& p, const versors& q, const vec3s& s, float m[4][4]) noexcept
+    {
+        const float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+        const float xx = q.x * x2, yy = q.y * y2, zz = q.z * z2;
+        const float xy = q.x * y2, xz = q.x * z2, yz = q.y * z2;
+        const float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+
+        m[0][0] = (1.f - (yy + zz)) * s.x; m[0][1] = (xy + wz) * s.x;        m[0][2] = (xz - wy) * s.x;        m[0][3] = 0.f;
+        m[1][0] = (xy - wz) * s.y;         m[1][1] = (1.f - (xx + zz)) * s.y; m[1][2] = (yz + wx) * s.y;        m[1][3] = 0.f;
+        m[2][0] = (xz + wy) * s.z;         m[2][1] = (yz - wx) * s.z;        m[2][2] = (1.f - (xx + yy)) * s.z; m[2][3] = 0.f;
+        m[3][0] = p.x;                     m[3][1] = p.y;                    m[3][2] = p.z;                    m[3][3] = 1.f;
+    }
+
+
+//  Both sides are TRS matrices, the last row (0, 0, 0, 1) is not multiplied
+    void multiply_affine(const mat4s& a, const float b[4][4], float m[4][4]) noexcept
+    {
+        for (uint32_t column = 0; column < 4; ++column)
+            for (uint32_t row = 0; row < 4; ++row)
+                m[column][row] = a.raw[0][row] * b[column][0] + a.raw[1][row] * b[column][1] + a.raw[2][row] * b[column][2] + ((column == 3) ? a.raw[3][row] : 0.f);
+    }
+}
+
+
+
+bool TransformHierarchy::reserve(uint32_t capacity) noexcept
+{
+    try
+    {
+        m_local.reserve(capacity);
+        m_world.reserve(capacity);
+        m_parent.reserve(capacity);
+        m_firstChild.reserve(capacity);
+        m_childCount.reserve(capacity);
+        m_owner.reserve(capacity);
+        m_dirty.reserve(capacity);
+        m_dirtyNodes.reserve(capacity);
+        m_slots.reserve(capacity);
+        m_freeSlots.reserve(capacity);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+NodeHandle TransformHierarchy::create(NodeHandle parent, vec3s position, versors rotation, vec3s scale) noexcept
+{
+    if (parent.index != INVALID_INDEX && ! isValid(parent) )
+        return {};
+
+    const uint32_t count = getCount();
+
+//  Every array has room for one more element afterwards, so the push_backs below cannot throw halfway
+    if (count == m_owner.capacity() || (m_freeSlots.empty() && m_slots.size() == m_slots.capacity()))
+    {
+        const uint32_t capacity = (count < 64) ? 64 : count * 2;
+
+        if ( ! reserve(capacity) )
+            return {};
+    }
+
+    uint32_t slot;
+
+    if (m_freeSlots.empty())
+    {
+        slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back({});
+    }
+    else
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+
+    Slot& entry = m_slots[slot];
+    entry.node   = count;
+    entry.parent = parent.index;
+    entry.alive  = true;
+
+//  Appended unsorted, the next update() moves the node behind its parent and computes it
+    m_local.push_back({ position, rotation, scale });
+    m_world.push_back(glms_mat4_identity());
+    m_parent.push_back(INVALID_INDEX);
+    m_firstChild.push_back(0);
+    m_childCount.push_back(0);
+    m_owner.push_back(slot);
+    m_dirty.push_back(0);
+
+    markDirty(count);
+    m_sorted = false;
+
+    return { slot, entry.generation };
+}
+
+
+void TransformHierarchy::destroy(NodeHandle handle) noexcept
+{
+    if (getNode(handle) == INVALID_INDEX)
+        return;
+
+//  The node stays in the arrays until the next sort, which also drops its descendants.
+//  Its slot is recycled only then, so the descendants cannot be adopted by a new node in between
+    Slot& slot = m_slots[handle.index];
+    slot.alive = false;
+    ++slot.generation;
+
+    m_sorted = false;
+}
+
+
+bool TransformHierarchy::isValid(NodeHandle handle) const noexcept
+{
+    return (getNode(handle) != INVALID_INDEX);
+}
+
+
+void TransformHierarchy::setLocal(NodeHandle handle, vec3s position, versors rotation, vec3s scale) noexcept
+{
+    const uint32_t node = getNode(handle);
+
+    if (node == INVALID_INDEX)
+        return;
+
+    m_local[node] = { position, rotation, scale };
+    markDirty(node);
+}
+
+
+void TransformHierarchy::setPosition(NodeHandle handle, vec3s position) noexcept
+{
+    const uint32_t node = getNode(handle);
+
+    if (node == INVALID_INDEX)
+        return;
+
+    m_local[node].position = position;
+    markDirty(node);
+}
+
+
+void TransformHierarchy::setRotation(NodeHandle handle, versors rotation) noexcept
+{
+    const uint32_t node = getNode(handle);
+
+    if (node == INVALID_INDEX)
+        return;
+
+    m_local[node].rotation = rotation;
+    markDirty(node);
+}
+
+
+void TransformHierarchy::update(JobSystem* jobs) noexcept
+{
+    if ( ! m_sorted )
+    {
+        if ( ! sort() )
+            return; // tried again on the next update
+
+        m_sorted = true;
+        ++m_version;
+    }
+
+    if (m_dirtyNodes.empty())
+        return;
+
+//  Sorted node order is level order, so the flagged nodes are consumed one level at a time
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+
+    const uint32_t levelCount = static_cast<uint32_t>(m_levelStart.size()) - 1;
+    const uint32_t dirtyCount = static_cast<uint32_t>(m_dirtyNodes.size());
+    uint32_t dirty = 0;
+    uint32_t level = 0;
+
+    m_next.clear();
+
+    while (level < levelCount)
+    {
+//  Nothing carried over from the level above, skip straight to the level of the next flagged node
+        if (m_next.empty())
+        {
+            if (dirty == dirtyCount)
+                break;
+
+            level = static_cast<uint32_t>(std::upper_bound(m_levelStart.begin(), m_levelStart.end(), m_dirtyNodes[dirty]) - m_levelStart.begin()) - 1;
+        }
+
+        const uint32_t levelEnd = m_levelStart[level + 1];
+        uint32_t       last     = dirty;
+
+        while (last < dirtyCount && m_dirtyNodes[last] < levelEnd)
+            ++last;
+
+//  Flagged nodes of this level plus the children of everything updated above, both ascending.
+//  Capacity was reserved by sort(), so the inserter never allocates
+        m_current.clear();
+        std::set_union(m_dirtyNodes.begin() + dirty, m_dirtyNodes.begin() + last, m_next.begin(), m_next.end(), std::back_inserter(m_current));
+        dirty = last;
+
+        const uint32_t* nodes = m_current.data();
+        const uint32_t  count = static_cast<uint32_t>(m_current.size());
+
+        if (jobs)
+            jobs->parallelFor(count, GRAIN, [this, nodes](uint32_t begin, uint32_t end) { computeWorld(nodes + begin, end - begin); });
+        else
+            computeWorld(nodes, count);
+
+//  Children of a node are contiguous and follow the order of their parents, so this stays ascending
+        m_next.clear();
+
+        for (uint32_t node : m_current)
+            for (uint32_t child = m_firstChild[node], end = child + m_childCount[node]; child < end; ++child)
+                m_next.push_back(child);
+
+        ++level;
+    }
+
+    m_dirtyNodes.clear();
+    ++m_version;
+}
+
+
+const mat4s* TransformHierarchy::getWorldMatrices() const noexcept
+{
+    return m_world.data();
+}
+
+
+uint32_t TransformHierarchy::getCount() const noexcept
+{
+    return static_cast<uint32_t>(m_owner.size());
+}
+
+
+uint32_t TransformHierarchy::getWorldIndex(NodeHandle handle) const noexcept
+{
+    return getNode(handle);
+}
+
+
+uint64_t TransformHierarchy::getVersion() const noexcept
+{
+    return m_version;
+}
+
+
+uint32_t TransformHierarchy::getNode(NodeHandle handle) const noexcept
+{
+    if (handle.index >= m_slots.size())
+        return INVALID_INDEX;
+
+    const Slot& slot = m_slots[handle.index];
+
+    return (slot.alive && slot.generation == handle.generation) ? slot.node : INVALID_INDEX;
+}
+
+
+void TransformHierarchy::markDirty(uint32_t node) noexcept
+{
+    if (m_dirty[node])
+        return;
+
+    m_dirty[node] = 1;
+    m_dirtyNodes.push_back(node); // capacity covers every node
+}
+
+
+bool TransformHierarchy::sort() noexcept
+{
+    const uint32_t oldCount  = getCount();
+    const uint32_t slotCount = static_cast<uint32_t>(m_slots.size());
+
+    std::vector<uint32_t> childStart;
+    std::vector<uint32_t> children;
+    std::vector<uint32_t> order; // slots in breadth-first order
+    std::vector<uint8_t>  reached;
+    std::vector<uint32_t> levelStart;
+
+    std::vector<Local>    local;
+    std::vector<mat4s>    world;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> firstChild;
+    std::vector<uint32_t> childCount;
+    std::vector<uint8_t>  dirty;
+
+    try
+    {
+        childStart.assign(slotCount + 1, 0);
+        children.resize(oldCount);
+        order.reserve(m_local.capacity());
+        reached.assign(slotCount, 0);
+        levelStart.reserve(16);
+
+        local.reserve(m_local.capacity());
+        world.reserve(m_local.capacity());
+        parent.reserve(m_local.capacity());
+        firstChild.reserve(m_local.capacity());
+        childCount.reserve(m_local.capacity());
+        dirty.reserve(m_local.capacity());
+
+        m_current.reserve(m_local.capacity());
+        m_next.reserve(m_local.capacity());
+
+//  Children of every live slot, in current node order so siblings keep their relative order
+        for (uint32_t node = 0; node < oldCount; ++node)
+        {
+            const Slot& slot = m_slots[m_owner[node]];
+
+            if (slot.alive && slot.parent != INVALID_INDEX)
+                ++childStart[slot.parent + 1];
+        }
+
+        for (uint32_t i = 0; i < slotCount; ++i)
+            childStart[i + 1] += childStart[i];
+
+        std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+
+        for (uint32_t node = 0; node < oldCount; ++node)
+        {
+            const Slot& slot = m_slots[m_owner[node]];
+
+            if (slot.alive && slot.parent != INVALID_INDEX)
+                children[cursor[slot.parent]++] = m_owner[node];
+        }
+
+//  Roots form the first level, every level appends the children of the previous one.
+//  Nodes under a destroyed ancestor are never reached
+        for (uint32_t node = 0; node < oldCount; ++node)
+        {
+            const Slot& slot = m_slots[m_owner[node]];
+
+            if (slot.alive && slot.parent == INVALID_INDEX)
+                order.push_back(m_owner[node]);
+        }
+
+        for (uint32_t node = 0; node < order.size(); ++node)
+            parent.push_back(INVALID_INDEX);
+
+        levelStart.push_back(0);
+
+        for (uint32_t begin = 0; begin < order.size(); )
+        {
+            const uint32_t end = static_cast<uint32_t>(order.size());
+
+            for (uint32_t node = begin; node < end; ++node)
+            {
+                const uint32_t slot = order[node];
+
+                firstChild.push_back(static_cast<uint32_t>(order.size()));
+
+                for (uint32_t i = childStart[slot]; i < childStart[slot + 1]; ++i)
+                {
+                    order.push_back(children[i]);
+                    parent.push_back(node);
+                }
+
+                childCount.push_back(static_cast<uint32_t>(order.size()) - firstChild.back());
+            }
+
+            levelStart.push_back(end);
+            begin = end;
+        }
+
+        for (uint32_t slot : order)
+        {
+            const uint32_t node = m_slots[slot].node;
+
+            local.push_back(m_local[node]);
+            world.push_back(m_world[node]);
+            dirty.push_back(m_dirty[node]);
+            reached[slot] = 1;
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+//  Everything left behind is destroyed, descendants of a destroyed node get a new generation here
+    for (uint32_t node = 0; node < oldCount; ++node)
+    {
+        const uint32_t slot = m_owner[node];
+
+        if (reached[slot])
+            continue;
+
+        Slot& entry = m_slots[slot];
+
+        if (entry.alive)
+        {
+            entry.alive = false;
+            ++entry.generation;
+        }
+
+        entry.node   = INVALID_INDEX;
+        entry.parent = INVALID_INDEX;
+        m_freeSlots.push_back(slot); // capacity was reserved together with the slot
+    }
+
+    m_dirtyNodes.clear();
+
+    for (uint32_t node = 0; node < order.size(); ++node)
+    {
+        m_slots[order[node]].node = node;
+
+        if (dirty[node])
+            m_dirtyNodes.push_back(node);
+    }
+
+    m_local.swap(local);
+    m_world.swap(world);
+    m_parent.swap(parent);
+    m_firstChild.swap(firstChild);
+    m_childCount.swap(childCount);
+    m_owner.swap(order);
+    m_dirty.swap(dirty);
+    m_levelStart.swap(levelStart);
+
+    return true;
+}
+
+
+void TransformHierarchy::computeWorld(const uint32_t* nodes, uint32_t count) noexcept
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t node  = nodes[i];
+        const Local&   local = m_local[node];
+        float          matrix[4][4];
+
+        build_matrix(local.position, local.rotation, local.scale, matrix);
+
+        if (m_parent[node] == INVALID_INDEX)
+            memcpy(m_world[node].raw, matrix, sizeof(matrix));
+        else
+            multiply_affine(m_world[m_parent[node]], matrix, m_world[node].raw);
+
+        m_dirty[node] = 0;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef TRANSFORM_HIERARCHY_HPP
+#define TRANSFORM_HIERARCHY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <cglm/struct/vec3.h>
+#include <cglm/struct/quat.h>
+#include <cglm/struct/mat4.h>
+
+
+// Stays valid until the node or one of its ancestors is destroyed
+struct NodeHandle
+{
+    uint32_t index      = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+
+// Parented transforms (ships with turrets, planets with moons) kept in breadth-first order:
+// every level is one contiguous range, a parent always comes before its children and the children
+// of a node are contiguous. Setting a local transform only flags the node, update() then walks down
+// from the flagged nodes level by level, so a static scene costs nothing and a moving root pays for
+// its own subtree only. Nodes of one level are independent and are computed in parallel.
+// Creating or destroying nodes re-sorts the arrays on the next update()
+class TransformHierarchy
+{
+public:
+    bool reserve(uint32_t capacity) noexcept;
+
+//  An invalid parent makes the node a root. Destroying a node destroys its whole subtree
+    NodeHandle create(NodeHandle parent, vec3s position, versors rotation, vec3s scale) noexcept;
+    void destroy(NodeHandle handle) noexcept;
+    bool isValid(NodeHandle handle) const noexcept;
+
+    void setLocal(NodeHandle handle, vec3s position, versors rotation, vec3s scale) noexcept;
+    void setPosition(NodeHandle handle, vec3s position) noexcept;
+    void setRotation(NodeHandle handle, versors rotation) noexcept;
+
+//  Re-sorts after topology changes and recomputes the world matrices of every changed subtree
+    void update(class JobSystem* jobs = nullptr) noexcept;
+
+//  Breadth-first order, valid after update()
+    const mat4s* getWorldMatrices() const noexcept;
+    uint32_t     getCount() const noexcept;
+    uint32_t     getWorldIndex(NodeHandle handle) const noexcept;
+
+//  Changes whenever update() wrote a world matrix or moved one, copies of the matrices can be kept until then
+    uint64_t getVersion() const noexcept;
+
+private:
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    struct Local
+    {
+        vec3s   position;
+        versors rotation;
+        vec3s   scale;
+    };
+
+    struct Slot
+    {
+        uint32_t node       = INVALID_INDEX; // position in the sorted arrays
+        uint32_t parent     = INVALID_INDEX; // slot of the parent
+        uint32_t generation = 0;
+        bool     alive      = false;
+    };
+
+    uint32_t getNode(NodeHandle handle) const noexcept;
+    void markDirty(uint32_t node) noexcept;
+    bool sort() noexcept;
+    void computeWorld(const uint32_t* nodes, uint32_t count) noexcept;
+
+//  Sorted arrays, one entry per node
+    std::vector<Local>    m_local;
+    std::vector<mat4s>    m_world;
+    std::vector<uint32_t> m_parent;     // node index, INVALID_INDEX for roots
+    std::vector<uint32_t> m_firstChild;
+    std::vector<uint32_t> m_childCount;
+    std::vector<uint32_t> m_owner;      // slot of every node
+    std::vector<uint8_t>  m_dirty;
+
+    std::vector<uint32_t> m_levelStart; // first node of every level, plus the node count
+    std::vector<uint32_t> m_dirtyNodes; // flagged since the last update, each node at most once
+
+    std::vector<Slot>     m_slots;
+    std::vector<uint32_t> m_freeSlots;
+
+//  Scratch for update()
+    std::vector<uint32_t> m_current;
+    std::vector<uint32_t> m_next;
+
+    uint64_t m_version = 0;
+    bool     m_sorted  = true;
+};
+
+#endif // !TRANSFORM_HIERARCHY_HPP
@@ -0,0 +1,343 @@
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_STORE_SSE
+#endif
+
+#include "jobs/JobSystem.hpp"
+#include "scene/TransformStore.hpp"
+
+
+namespace
+{
+    constexpr uint32_t GRAIN = 16384; // matrices per job, a multiple of the SIMD width
+
+
+//  Column-major like cglm: m[column][row]
+    void build_matrix(float px, float py, float pz, float qx, float qy, float qz, float qw, float sx, float sy, float sz, float m[4][4]) noexcept
+    {
+        const float x2 = qx + qx, y2 = qy + qy, z2 = qz + qz;
+        const float xx = qx * x2, yy = qy * y2, zz = qz * z2;
+        const float xy = qx * y2, xz = qx * z2, yz = qy * z2;
+        const float wx = qw * x2, wy = qw * y2, wz = qw * z2;
+
+        m[0][0] = (1.f - (yy + zz)) * sx; m[0][1] = (xy + wz) * sx;        m[0][2] = (xz - wy) * sx;        m[0][3] = 0.f;
+        m[1][0] = (xy - wz) * sy;         m[1][1] = (1.f - (xx + zz)) * sy; m[1][2] = (yz + wx) * sy;        m[1][3] = 0.f;
+        m[2][0] = (xz + wy) * sz;         m[2][1] = (yz - wx) * sz;        m[2][2] = (1.f - (xx + yy)) * sz; m[2][3] = 0.f;
+        m[3][0] = px;                     m[3][1] = py;                    m[3][2] = pz;                    m[3][3] = 1.f;
+    }
+
+
+//  The last row of a TRS matrix is (0, 0, 0, 1), which drops a quarter of the multiply
+    void multiply_affine(const mat4s& a, const float b[4][4], float m[4][4]) noexcept
+    {
+        for (uint32_t column = 0; column < 4; ++column)
+            for (uint32_t row = 0; row < 4; ++row)
+                m[column][row] = a.raw[0][row] * b[column][0] + a.raw[1][row] * b[column][1] + a.raw[2][row] * b[column][2] + ((column == 3) ? a.raw[3][row] : 0.f);
+    }
+}
+
+
+
+bool TransformStore::reserve(uint32_t capacity) noexcept
+{
+    try
+    {
+        for (auto* component : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ })
+            component->reserve(capacity);
+
+        m_owners.reserve(capacity);
+        m_slots.reserve(capacity);
+        m_freeSlots.reserve(capacity);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+TransformHandle TransformStore::create(vec3s position, versors rotation, vec3s scale) noexcept
+{
+    const uint32_t count = getCount();
+
+//  Every array has room for one more element afterwards, so the push_backs below cannot throw halfway
+    if (count == m_owners.capacity() || (m_freeSlots.empty() && m_slots.size() == m_slots.capacity()))
+    {
+        const uint32_t capacity = (count < 64) ? 64 : count * 2;
+
+        if ( ! reserve(capacity) )
+            return {};
+    }
+
+    uint32_t slot;
+
+    if (m_freeSlots.empty())
+    {
+        slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back({});
+    }
+    else
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+
+    m_slots[slot].dense = count;
+
+    m_positionX.push_back(position.x);
+    m_positionY.push_back(position.y);
+    m_positionZ.push_back(position.z);
+    m_rotationX.push_back(rotation.x);
+    m_rotationY.push_back(rotation.y);
+    m_rotationZ.push_back(rotation.z);
+    m_rotationW.push_back(rotation.w);
+    m_scaleX.push_back(scale.x);
+    m_scaleY.push_back(scale.y);
+    m_scaleZ.push_back(scale.z);
+    m_owners.push_back(slot);
+
+    return { slot, m_slots[slot].generation };
+}
+
+
+void TransformStore::destroy(TransformHandle handle) noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return;
+
+//  The last transform fills the hole, so the arrays stay dense
+    const uint32_t last = getCount() - 1;
+
+    for (auto* component : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ })
+    {
+        (*component)[index] = (*component)[last];
+        component->pop_back();
+    }
+
+    m_owners[index] = m_owners[last];
+    m_slots[m_owners[index]].dense = index;
+    m_owners.pop_back();
+
+    Slot& slot = m_slots[handle.index];
+    slot.dense = INVALID_INDEX;
+    ++slot.generation;
+
+    m_freeSlots.push_back(handle.index); // capacity was reserved together with the slot
+}
+
+
+bool TransformStore::isValid(TransformHandle handle) const noexcept
+{
+    return (getIndex(handle) != INVALID_INDEX);
+}
+
+
+void TransformStore::setPosition(TransformHandle handle, vec3s position) noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return;
+
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+}
+
+
+void TransformStore::setRotation(TransformHandle handle, versors rotation) noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return;
+
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    m_rotationW[index] = rotation.w;
+}
+
+
+void TransformStore::setScale(TransformHandle handle, vec3s scale) noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return;
+
+    m_scaleX[index] = scale.x;
+    m_scaleY[index] = scale.y;
+    m_scaleZ[index] = scale.z;
+}
+
+
+vec3s TransformStore::getPosition(TransformHandle handle) const noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return glms_vec3_zero();
+
+    return {{ m_positionX[index], m_positionY[index], m_positionZ[index] }};
+}
+
+
+versors TransformStore::getRotation(TransformHandle handle) const noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return glms_quat_identity();
+
+    return {{ m_rotationX[index], m_rotationY[index], m_rotationZ[index], m_rotationW[index] }};
+}
+
+
+vec3s TransformStore::getScale(TransformHandle handle) const noexcept
+{
+    const uint32_t index = getIndex(handle);
+
+    if (index == INVALID_INDEX)
+        return glms_vec3_one();
+
+    return {{ m_scaleX[index], m_scaleY[index], m_scaleZ[index] }};
+}
+
+
+uint32_t TransformStore::getCount() const noexcept
+{
+    return static_cast<uint32_t>(m_owners.size());
+}
+
+
+uint32_t TransformStore::getDenseIndex(TransformHandle handle) const noexcept
+{
+    return getIndex(handle);
+}
+
+
+void TransformStore::computeWorldMatrices(mat4s* out, JobSystem* jobs) const noexcept
+{
+    if (jobs)
+        jobs->parallelFor(getCount(), GRAIN, [this, out](uint32_t begin, uint32_t end) { computeMatrices(nullptr, out + begin, begin, end); });
+    else
+        computeMatrices(nullptr, out, 0, getCount());
+}
+
+
+void TransformStore::computeMvpMatrices(const mat4s& viewProjection, mat4s* out, JobSystem* jobs) const noexcept
+{
+    const mat4s* matrix = &viewProjection;
+
+    if (jobs)
+        jobs->parallelFor(getCount(), GRAIN, [this, matrix, out](uint32_t begin, uint32_t end) { computeMatrices(matrix, out + begin, begin, end); });
+    else
+        computeMatrices(matrix, out, 0, getCount());
+}
+
+
+void TransformStore::computeMatrices(const mat4s* viewProjection, mat4s* out, uint32_t begin, uint32_t end) const noexcept
+{
+    uint32_t i = begin;
+
+#ifdef TRANSFORM_STORE_SSE
+//  Four transforms per iteration, lane k of every register belongs to transform i + k.
+//  The 16 matrix elements are built lane-wise, then each column is transposed out to its own matrix
+    __m128 vp[4][4];
+
+    if (viewProjection)
+        for (uint32_t column = 0; column < 4; ++column)
+            for (uint32_t row = 0; row < 4; ++row)
+                vp[column][row] = _mm_set1_ps(viewProjection->raw[column][row]);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.f);
+
+    for ( ; i + 4 <= end; i += 4)
+    {
+        const __m128 qx = _mm_loadu_ps(m_rotationX.data() + i);
+        const __m128 qy = _mm_loadu_ps(m_rotationY.data() + i);
+        const __m128 qz = _mm_loadu_ps(m_rotationZ.data() + i);
+        const __m128 qw = _mm_loadu_ps(m_rotationW.data() + i);
+        const __m128 sx = _mm_loadu_ps(m_scaleX.data() + i);
+        const __m128 sy = _mm_loadu_ps(m_scaleY.data() + i);
+        const __m128 sz = _mm_loadu_ps(m_scaleZ.data() + i);
+
+        const __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+        const __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+        const __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+        const __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+        __m128 m[4][4] =
+        {
+            { _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero },
+            { _mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy), _mm_mul_ps(_mm_add_ps(yz, wx), sy), zero },
+            { _mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero },
+            { _mm_loadu_ps(m_positionX.data() + i), _mm_loadu_ps(m_positionY.data() + i), _mm_loadu_ps(m_positionZ.data() + i), one }
+        };
+
+        if (viewProjection)
+        {
+            __m128 mvp[4][4];
+
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                for (uint32_t row = 0; row < 4; ++row)
+                {
+                    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vp[0][row], m[column][0]), _mm_mul_ps(vp[1][row], m[column][1])),
+                                            _mm_mul_ps(vp[2][row], m[column][2]));
+
+                    mvp[column][row] = (column == 3) ? _mm_add_ps(sum, vp[3][row]) : sum;
+                }
+            }
+
+            memcpy(m, mvp, sizeof(m));
+        }
+
+        mat4s* dst = out + (i - begin);
+
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            __m128 r0 = m[column][0], r1 = m[column][1], r2 = m[column][2], r3 = m[column][3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            _mm_storeu_ps(dst[0].raw[column], r0);
+            _mm_storeu_ps(dst[1].raw[column], r1);
+            _mm_storeu_ps(dst[2].raw[column], r2);
+            _mm_storeu_ps(dst[3].raw[column], r3);
+        }
+    }
+#endif
+
+    for ( ; i < end; ++i)
+    {
+        float world[4][4];
+
+        build_matrix(m_positionX[i], m_positionY[i], m_positionZ[i],
+                     m_rotationX[i], m_rotationY[i], m_rotationZ[i], m_rotationW[i],
+                     m_scaleX[i], m_scaleY[i], m_scaleZ[i], world);
+
+        if (viewProjection)
+            multiply_affine(*viewProjection, world, out[i - begin].raw);
+        else
+            memcpy(out[i - begin].raw, world, sizeof(world));
+    }
+}
+
+
+uint32_t TransformStore::getIndex(TransformHandle handle) const noexcept
+{
+    if (handle.index >= m_slots.size())
+        return INVALID_INDEX;
+
+    const Slot& slot = m_slots[handle.index];
+
+    return (slot.generation == handle.generation) ? slot.dense : INVALID_INDEX;
+}
@@ -0,0 +1,81 @@
+#ifndef TRANSFORM_STORE_HPP
+#define TRANSFORM_STORE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <cglm/struct/vec3.h>
+#include <cglm/struct/quat.h>
+#include <cglm/struct/mat4.h>
+
+
+// Stays valid until the transform is destroyed, a stale handle fails the generation check
+struct TransformHandle
+{
+    uint32_t index      = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+
+// Position, rotation and scale of every scene object, stored as structure of arrays with one array per component.
+// Live transforms are kept dense (destroy moves the last one into the hole), so the batched matrix builders
+// stream through plain float arrays four objects at a time and write straight into mapped GPU memory.
+// Matrices come out in dense order, getDenseIndex() tells where the matrix of a handle lands
+class TransformStore
+{
+public:
+    bool reserve(uint32_t capacity) noexcept;
+
+    TransformHandle create(vec3s position, versors rotation, vec3s scale) noexcept;
+    void destroy(TransformHandle handle) noexcept;
+    bool isValid(TransformHandle handle) const noexcept;
+
+    void setPosition(TransformHandle handle, vec3s position) noexcept;
+    void setRotation(TransformHandle handle, versors rotation) noexcept;
+    void setScale(TransformHandle handle, vec3s scale) noexcept;
+
+    vec3s   getPosition(TransformHandle handle) const noexcept;
+    versors getRotation(TransformHandle handle) const noexcept;
+    vec3s   getScale(TransformHandle handle) const noexcept;
+
+    uint32_t getCount() const noexcept;
+    uint32_t getDenseIndex(TransformHandle handle) const noexcept;
+
+//  translate * rotate * scale for every transform, out has room for getCount() matrices.
+//  With a job system the work is split across its workers
+    void computeWorldMatrices(mat4s* out, class JobSystem* jobs = nullptr) const noexcept;
+
+//  viewProjection * world, for shaders that take a single matrix per object
+    void computeMvpMatrices(const mat4s& viewProjection, mat4s* out, class JobSystem* jobs = nullptr) const noexcept;
+
+//  Dense range [begin, end) only, out points at the matrix of 'begin'
+    void computeMatrices(const mat4s* viewProjection, mat4s* out, uint32_t begin, uint32_t end) const noexcept;
+
+private:
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    struct Slot
+    {
+        uint32_t dense      = INVALID_INDEX;
+        uint32_t generation = 0;
+    };
+
+    uint32_t getIndex(TransformHandle handle) const noexcept;
+
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_rotationX;
+    std::vector<float> m_rotationY;
+    std::vector<float> m_rotationZ;
+    std::vector<float> m_rotationW;
+    std::vector<float> m_scaleX;
+    std::vector<float> m_scaleY;
+    std::vector<float> m_scaleZ;
+
+    std::vector<uint32_t> m_owners; // slot of every dense element
+    std::vector<Slot>     m_slots;
+    std::vector<uint32_t> m_freeSlots;
+};
+
+#endif // !TRANSFORM_STORE_HPP
@@ -1,9 +1,32 @@
 #version 460
 
-layout(push_constant) uniform constants 
+// Written right before vkQueueSubmit when late latching is on, so the camera is as fresh as possible
+layout(binding = 1) uniform CameraUniforms
 {
-    mat4 modelViewProjection;
-} matrices;
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustum[6]; // read by occlusion_cull.comp
+} camera;
+
+// World matrices of every transform, built on the CPU in one batch per frame
+layout(std430, binding = 2) readonly buffer Instances
+{
+    mat4 models[];
+} instances;
+
+// Instances that passed occlusion culling, indexed by gl_InstanceIndex of the indirect draws or of the CPU culled draw
+layout(std430, binding = 3) readonly buffer DrawList
+{
+    uint indices[];
+} drawList;
+
+layout(push_constant) uniform Constants
+{
+    uint  useDrawList;
+    uint  impostorFirst; // instances from here on are far away, drawn as a quad facing the camera
+    float impostorSize;
+} constants;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
@@ -12,6 +35,25 @@ layout(location = 0) out vec2 fragTexCoord;
 
 void main() 
 {
-    gl_Position = matrices.modelViewProjection * vec4(inPosition, 1.f);
+    uint instance = (constants.useDrawList != 0) ? drawList.indices[gl_InstanceIndex] : gl_InstanceIndex;
+
+    mat4 model = instances.models[instance];
+
+    if (uint(gl_InstanceIndex) >= constants.impostorFirst)
+    {
+        // The quad spans the camera's right and up axes around the object's origin, scaled like its largest axis
+        vec3 right = vec3(camera.view[0][0], camera.view[1][0], camera.view[2][0]);
+        vec3 up    = vec3(camera.view[0][1], camera.view[1][1], camera.view[2][1]);
+        float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz))) * constants.impostorSize;
+
+        vec3 position = model[3].xyz + (right * inPosition.x + up * inPosition.y) * scale;
+
+        gl_Position = camera.viewProjection * vec4(position, 1.f);
+    }
+    else
+    {
+        gl_Position = camera.viewProjection * model * vec4(inPosition, 1.f);
+    }
+
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+}
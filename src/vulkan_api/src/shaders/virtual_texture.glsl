@@ -0,0 +1,83 @@
+// Virtual texture lookups, shared by the feedback pass and the shaders sampling the texture.
+// Matches VirtualTexture on the C++ side: the uniform block is VirtualTexture::Uniforms,
+// page table texels are (slot x, slot y, level) and feedback ids pack level, page y and page x in 8/12/12 bits.
+// Define the bindings before including this file when the defaults clash with the including shader
+
+#ifndef VT_ATLAS_BINDING
+#define VT_ATLAS_BINDING 0
+#endif
+
+#ifndef VT_PAGE_TABLE_BINDING
+#define VT_PAGE_TABLE_BINDING 2
+#endif
+
+#ifndef VT_UNIFORMS_BINDING
+#define VT_UNIFORMS_BINDING 3
+#endif
+
+layout(binding = VT_ATLAS_BINDING) uniform sampler2D vtAtlas;
+layout(binding = VT_PAGE_TABLE_BINDING) uniform usampler2D vtPageTable;
+
+layout(binding = VT_UNIFORMS_BINDING) uniform VirtualTextureUniforms
+{
+    vec2  virtualSize;
+    float atlasSize;
+    float feedbackBias;
+    uint  pagesX;
+    uint  pagesY;
+    uint  levelCount;
+    uint  tileSize;
+    uint  border;
+} vt;
+
+
+float vtLevel(vec2 uv, float bias)
+{
+    vec2 texel = uv * vt.virtualSize;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float rho = max(dot(dx, dx), dot(dy, dy));
+
+    return clamp(0.5 * log2(max(rho, 1e-8)) + bias, 0.0, float(vt.levelCount - 1u));
+}
+
+
+uvec2 vtPage(vec2 uv, uint level)
+{
+    vec2 levelSize = max(vt.virtualSize / float(1u << level), vec2(1.0));
+    uvec2 lastPage = uvec2(max(vt.pagesX >> level, 1u), max(vt.pagesY >> level, 1u)) - 1u;
+
+    return min(uvec2(uv * levelSize / float(vt.tileSize)), lastPage);
+}
+
+
+// Written by the feedback pass, the page the pixel would like to sample
+uint vtFeedback(vec2 uv)
+{
+    uv = clamp(uv, 0.0, 1.0);
+
+    uint level = uint(vtLevel(uv, vt.feedbackBias));
+    uvec2 page = vtPage(uv, level);
+
+    return (level << 24) | (page.y << 12) | page.x;
+}
+
+
+// The page table already resolves a missing page to its finest resident ancestor,
+// so the lookup is one texel fetch and one bilinear tap inside the bordered atlas slot
+vec4 vtSample(vec2 uv)
+{
+    uv = clamp(uv, 0.0, 1.0);
+
+    uint level = uint(vtLevel(uv, 0.0));
+    uvec4 entry = texelFetch(vtPageTable, ivec2(vtPage(uv, level)), int(level));
+    uint mapped = entry.b;
+
+    vec2 levelSize = max(vt.virtualSize / float(1u << mapped), vec2(1.0));
+    vec2 inPage = uv * levelSize - vec2(vtPage(uv, mapped)) * float(vt.tileSize);
+
+    float paddedSize = float(vt.tileSize + 2u * vt.border);
+    vec2 atlasTexel = vec2(entry.rg) * paddedSize + float(vt.border) + inPage;
+
+    return textureLod(vtAtlas, atlasTexel / vt.atlasSize, 0.0);
+}
@@ -0,0 +1,13 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "virtual_texture.glsl"
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out uint outPage;
+
+void main() 
+{
+    outPage = vtFeedback(fragTexCoord);
+}
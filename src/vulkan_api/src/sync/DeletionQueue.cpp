@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <type_traits>
+
+#include "context/Context.hpp"
+#include "texture/SamplerCache.hpp"
+#include "texture/Texture2D.hpp"
+#include "sync/DeletionQueue.hpp"
+
+
+namespace
+{
+//  Non-dispatchable handles are pointers on 64-bit targets and uint64_t on 32-bit ones
+    template<class T>
+    uint64_t to_handle(T handle) noexcept
+    {
+        if constexpr (std::is_pointer_v<T>)
+            return reinterpret_cast<uint64_t>(handle);
+        else
+            return static_cast<uint64_t>(handle);
+    }
+
+
+    template<class T>
+    T from_handle(uint64_t handle) noexcept
+    {
+        if constexpr (std::is_pointer_v<T>)
+            return reinterpret_cast<T>(handle);
+        else
+            return static_cast<T>(handle);
+    }
+}
+
+
+
+void DeletionQueue::init(const VulkanContext* context) noexcept
+{
+    m_context = context;
+}
+
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) noexcept
+{
+    const Entry entries[] =
+    {
+        { VK_OBJECT_TYPE_BUFFER, to_handle(buffer) },
+        { VK_OBJECT_TYPE_DEVICE_MEMORY, to_handle(memory) }
+    };
+
+    push(entries);
+}
+
+
+void DeletionQueue::destroyImage(VkImage image, VkDeviceMemory memory) noexcept
+{
+    const Entry entries[] =
+    {
+        { VK_OBJECT_TYPE_IMAGE, to_handle(image) },
+        { VK_OBJECT_TYPE_DEVICE_MEMORY, to_handle(memory) }
+    };
+
+    push(entries);
+}
+
+
+void DeletionQueue::destroyImageView(VkImageView imageView) noexcept
+{
+    const Entry entry = { VK_OBJECT_TYPE_IMAGE_VIEW, to_handle(imageView) };
+
+    push({ &entry, 1 });
+}
+
+
+void DeletionQueue::destroyTexture(const Texture2D& texture) noexcept
+{
+//  Views before images before memory, flush() keeps the order of release
+    const Entry entries[] =
+    {
+        { VK_OBJECT_TYPE_IMAGE_VIEW, to_handle(texture.imageView) },
+        { VK_OBJECT_TYPE_IMAGE, to_handle(texture.image) },
+        { VK_OBJECT_TYPE_DEVICE_MEMORY, to_handle(texture.imageMemory) },
+        { VK_OBJECT_TYPE_SAMPLER, to_handle(texture.sampler), 0, texture.samplerCache }
+    };
+
+    push(entries);
+}
+
+
+void DeletionQueue::flush(VkDevice device, uint64_t frameNumber, uint64_t completedFrames) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_frameNumber = frameNumber;
+
+//  A frame is complete once completedFrames has moved past its number
+    const auto retired = std::stable_partition(m_entries.begin(), m_entries.end(), [completedFrames](const Entry& entry)
+    {
+        return entry.frameNumber >= completedFrames;
+    });
+
+    for (auto it = retired; it != m_entries.end(); ++it)
+        destroy(device, *it);
+
+    m_entries.erase(retired, m_entries.end());
+}
+
+
+void DeletionQueue::flushAll(VkDevice device) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    for (const auto& entry : m_entries)
+        destroy(device, entry);
+
+    m_entries.clear();
+}
+
+
+size_t DeletionQueue::getPendingCount() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_entries.size();
+}
+
+
+void DeletionQueue::push(std::span<const Entry> entries) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+//  Room for every entry is made first, so a release is either queued whole or not at all
+    try
+    {
+        if (m_entries.capacity() - m_entries.size() < entries.size())
+            m_entries.reserve(std::max(2 * m_entries.capacity(), m_entries.size() + entries.size()));
+    }
+    catch (const std::bad_alloc&)
+    {
+        if ( ! m_context )
+            return;
+
+        {
+            std::lock_guard<std::mutex> queueLock(m_context->queueLock);
+            vkDeviceWaitIdle(m_context->device);
+        }
+
+        for (const auto& entry : entries)
+        {
+            if (entry.handle != 0)
+                destroy(m_context->device, entry);
+        }
+
+        return;
+    }
+
+    for (const auto& entry : entries)
+    {
+        if (entry.handle != 0)
+            m_entries.push_back({ entry.type, entry.handle, m_frameNumber, entry.samplerCache });
+    }
+}
+
+
+void DeletionQueue::destroy(VkDevice device, const Entry& entry) noexcept
+{
+    switch (entry.type)
+    {
+        case VK_OBJECT_TYPE_BUFFER:
+            vkDestroyBuffer(device, from_handle<VkBuffer>(entry.handle), VK_NULL_HANDLE);
+            break;
+
+        case VK_OBJECT_TYPE_IMAGE:
+            vkDestroyImage(device, from_handle<VkImage>(entry.handle), VK_NULL_HANDLE);
+            break;
+
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+            vkDestroyImageView(device, from_handle<VkImageView>(entry.handle), VK_NULL_HANDLE);
+            break;
+
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+            vkFreeMemory(device, from_handle<VkDeviceMemory>(entry.handle), VK_NULL_HANDLE);
+            break;
+
+        case VK_OBJECT_TYPE_SAMPLER:
+            if (entry.samplerCache)
+                entry.samplerCache->release(from_handle<VkSampler>(entry.handle), device);
+            else
+                vkDestroySampler(device, from_handle<VkSampler>(entry.handle), VK_NULL_HANDLE);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef DELETION_QUEUE_HPP
+#define DELETION_QUEUE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <span>
+
+#include <vulkan/vulkan.h>
+
+
+// Vulkan objects released while the application runs. Each one is stamped with the frame being recorded
+// at the time of release and destroyed once that frame's fence has signaled, so freeing a resource never
+// needs vkDeviceWaitIdle. Any thread may release, the render thread flushes once per frame
+class DeletionQueue
+{
+public:
+//  Without memory for the entry, a release waits for the device to go idle and destroys the objects at once
+    void init(const struct VulkanContext* context) noexcept;
+
+    void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) noexcept;
+    void destroyImage(VkImage image, VkDeviceMemory memory) noexcept;
+    void destroyImageView(VkImageView imageView) noexcept;
+
+//  View, image and memory are destroyed, the sampler goes back to its cache
+    void destroyTexture(const struct Texture2D& texture) noexcept;
+
+//  Render thread, right after the fence of the frame slot has been waited on.
+//  'frameNumber' is the frame about to be recorded, releases from now on are stamped with it
+    void flush(VkDevice device, uint64_t frameNumber, uint64_t completedFrames) noexcept;
+
+//  Destroys everything, the device has to be idle
+    void flushAll(VkDevice device) noexcept;
+
+    size_t getPendingCount() const noexcept;
+
+private:
+    struct Entry
+    {
+        VkObjectType type;
+        uint64_t     handle;
+        uint64_t     frameNumber = 0;
+        class SamplerCache* samplerCache = nullptr; // only for samplers
+    };
+
+//  Queues the objects of one release together, in the order they have to be destroyed
+    void push(std::span<const Entry> entries) noexcept;
+    static void destroy(VkDevice device, const Entry& entry) noexcept;
+
+    const struct VulkanContext* m_context = nullptr;
+
+    mutable std::mutex m_lock;
+    std::vector<Entry> m_entries;
+    uint64_t           m_frameNumber = 0;
+};
+
+#endif // !DELETION_QUEUE_HPP
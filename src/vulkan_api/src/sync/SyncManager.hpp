@@ -15,6 +15,13 @@ struct SyncManager
     std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> renderFinishedSemaphores = { VK_NULL_HANDLE, VK_NULL_HANDLE };
     std::array<VkFence, MAX_FRAMES_IN_FLIGHT>     inFlightFences           = { VK_NULL_HANDLE, VK_NULL_HANDLE };
     uint32_t currentFrame = 0;
+    uint64_t frameNumber  = 0; // frames submitted so far
+
+//  Number of frames whose in-flight fence is known to be signaled once the fence of currentFrame was waited on
+    uint64_t completedFrames() const noexcept
+    {
+        return (frameNumber >= MAX_FRAMES_IN_FLIGHT) ? frameNumber - MAX_FRAMES_IN_FLIGHT + 1 : 0;
+    }
 };
 
 #endif // !SYNC_MANAGER_HPP
\ No newline at end of file
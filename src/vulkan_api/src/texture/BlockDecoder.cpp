@@ -0,0 +1,487 @@
+#include <algorithm>
+#include <cstring>
+
+#include "texture/BlockDecoder.hpp"
+
+
+namespace
+{
+    void unpack_565(uint16_t color, uint8_t* rgb) noexcept
+    {
+        const uint32_t r = (color >> 11) & 0x1F;
+        const uint32_t g = (color >> 5)  & 0x3F;
+        const uint32_t b = color & 0x1F;
+
+        rgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+        rgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+        rgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    }
+
+
+//  Writes 16 RGBA texels, BC3 color blocks always use the four-color mode
+    void decode_color_block(const uint8_t* block, uint8_t* texels, bool allowTransparency) noexcept
+    {
+        const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+        const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+        uint8_t palette[4][4] = {};
+
+        unpack_565(c0, palette[0]);
+        unpack_565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+
+        if (c0 > c1 || ! allowTransparency)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+            }
+
+            palette[2][3] = palette[3][3] = 255;
+        }
+        else
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+                palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+
+            palette[2][3] = 255;
+        //  palette[3] stays transparent black
+        }
+
+        const uint32_t indices = static_cast<uint32_t>(block[4]) | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+        for (uint32_t i = 0; i < 16; ++i)
+            memcpy(texels + i * 4, palette[(indices >> (i * 2)) & 0x3], 4);
+    }
+
+
+//  Writes 16 single-channel values with the given texel stride
+    void decode_alpha_block(const uint8_t* block, uint8_t* texels, uint32_t stride) noexcept
+    {
+        uint32_t palette[8];
+        palette[0] = block[0];
+        palette[1] = block[1];
+
+        if (palette[0] > palette[1])
+        {
+            for (uint32_t i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * palette[0] + i * palette[1] + 3) / 7;
+        }
+        else
+        {
+            for (uint32_t i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * palette[0] + i * palette[1] + 2) / 5;
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t indices = 0;
+
+        for (uint32_t i = 0; i < 6; ++i)
+            indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+
+        for (uint32_t i = 0; i < 16; ++i)
+            texels[i * stride] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 0x7]);
+    }
+
+
+//  Same as above for SNORM blocks, the values are written as two's complement bytes in [-127, 127]
+    void decode_signed_alpha_block(const uint8_t* block, uint8_t* texels, uint32_t stride) noexcept
+    {
+        int32_t palette[8];
+        palette[0] = std::max(static_cast<int32_t>(static_cast<int8_t>(block[0])), -127);
+        palette[1] = std::max(static_cast<int32_t>(static_cast<int8_t>(block[1])), -127);
+
+    //  Rounds to nearest, away from zero on ties like the unsigned blocks
+        const auto interpolate = [](int32_t sum, int32_t divisor) { return (sum + ((sum < 0) ? -divisor / 2 : divisor / 2)) / divisor; };
+
+        if (palette[0] > palette[1])
+        {
+            for (int32_t i = 1; i < 7; ++i)
+                palette[i + 1] = interpolate((7 - i) * palette[0] + i * palette[1], 7);
+        }
+        else
+        {
+            for (int32_t i = 1; i < 5; ++i)
+                palette[i + 1] = interpolate((5 - i) * palette[0] + i * palette[1], 5);
+
+            palette[6] = -127;
+            palette[7] = 127;
+        }
+
+        uint64_t indices = 0;
+
+        for (uint32_t i = 0; i < 6; ++i)
+            indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+
+        for (uint32_t i = 0; i < 16; ++i)
+            texels[i * stride] = static_cast<uint8_t>(static_cast<int8_t>(palette[(indices >> (i * 3)) & 0x7]));
+    }
+
+
+//  BC2 alpha: 4 explicit bits per texel, row by row
+    void decode_explicit_alpha_block(const uint8_t* block, uint8_t* texels, uint32_t stride) noexcept
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            const uint32_t alpha = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+            texels[i * stride] = static_cast<uint8_t>(alpha * 17);
+        }
+    }
+
+
+//  BC7 tables from the format specification. Two-subset partitions hold one bit per texel,
+//  three-subset ones two bits per texel, texel 0 first
+    constexpr uint16_t BC7_PARTITIONS_2[64] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+
+    constexpr uint32_t BC7_PARTITIONS_3[64] =
+    {
+        0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+        0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+        0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+        0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+        0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+        0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+        0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+        0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+    };
+
+//  Texels whose index drops its top bit, besides texel 0: the second subset's and the third subset's
+    constexpr uint8_t BC7_ANCHORS_2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+    };
+
+    constexpr uint8_t BC7_ANCHORS_3[2][64] =
+    {
+        {
+             3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+             3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+             8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+             3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+        },
+        {
+            15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+            15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+            15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+            15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+        }
+    };
+
+    constexpr uint8_t BC7_WEIGHTS_2[4]  = { 0, 21, 43, 64 };
+    constexpr uint8_t BC7_WEIGHTS_3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    constexpr uint8_t BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Mode
+    {
+        uint8_t subsets;
+        uint8_t partitionBits;
+        uint8_t rotationBits;
+        uint8_t selectorBits;
+        uint8_t colorBits;
+        uint8_t alphaBits;
+        uint8_t endpointPBits; // one per endpoint
+        uint8_t sharedPBits;   // one per subset
+        uint8_t indexBits;
+        uint8_t secondaryIndexBits;
+    };
+
+    constexpr Bc7Mode BC7_MODES[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+    };
+
+
+//  Reads the 128 bits of a block from the least significant bit up
+    class BitReader
+    {
+    public:
+        explicit BitReader(const uint8_t* block) noexcept
+        {
+            memcpy(&m_low, block, 8);
+            memcpy(&m_high, block + 8, 8);
+        }
+
+        uint32_t read(uint32_t count) noexcept
+        {
+            if (count == 0)
+                return 0;
+
+            const uint32_t value = static_cast<uint32_t>(m_low & ((1ull << count) - 1));
+
+            m_low  = (m_low >> count) | (m_high << (64 - count));
+            m_high = m_high >> count;
+
+            return value;
+        }
+
+    private:
+        uint64_t m_low;
+        uint64_t m_high;
+    };
+
+
+    const uint8_t* bc7_weights(uint32_t indexBits) noexcept
+    {
+        return (indexBits == 2) ? BC7_WEIGHTS_2 : (indexBits == 3) ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4;
+    }
+
+
+    void decode_bc7_block(const uint8_t* block, uint8_t* texels) noexcept
+    {
+        BitReader bits(block);
+
+        uint32_t mode = 0;
+
+        while (mode < 8 && bits.read(1) == 0)
+            ++mode;
+
+    //  Reserved encoding, decoded as transparent black
+        if (mode == 8)
+        {
+            memset(texels, 0, 16 * 4);
+            return;
+        }
+
+        const Bc7Mode& info = BC7_MODES[mode];
+
+        const uint32_t partition = bits.read(info.partitionBits);
+        const uint32_t rotation  = bits.read(info.rotationBits);
+        const uint32_t selector  = bits.read(info.selectorBits);
+
+    //  Endpoints as [subset * 2 + end][channel], channel by channel like in the block
+        const uint32_t endpointCount = info.subsets * 2u;
+        uint32_t endpoints[6][4] = {};
+
+        for (uint32_t c = 0; c < 3; ++c)
+            for (uint32_t e = 0; e < endpointCount; ++e)
+                endpoints[e][c] = bits.read(info.colorBits);
+
+        for (uint32_t e = 0; e < endpointCount; ++e)
+            endpoints[e][3] = info.alphaBits ? bits.read(info.alphaBits) : 255;
+
+        uint32_t colorBits = info.colorBits;
+        uint32_t alphaBits = info.alphaBits;
+
+        if (info.endpointPBits || info.sharedPBits)
+        {
+            uint32_t pbits[6];
+
+            if (info.endpointPBits)
+            {
+                for (uint32_t e = 0; e < endpointCount; ++e)
+                    pbits[e] = bits.read(1);
+            }
+            else
+            {
+                for (uint32_t subset = 0; subset < info.subsets; ++subset)
+                    pbits[subset * 2] = pbits[subset * 2 + 1] = bits.read(1);
+            }
+
+            for (uint32_t e = 0; e < endpointCount; ++e)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                    endpoints[e][c] = (endpoints[e][c] << 1) | pbits[e];
+
+                if (info.alphaBits)
+                    endpoints[e][3] = (endpoints[e][3] << 1) | pbits[e];
+            }
+
+            ++colorBits;
+            alphaBits += info.alphaBits ? 1 : 0;
+        }
+
+    //  Expanded to 8 bits by replicating the top bits into the bottom ones
+        for (uint32_t e = 0; e < endpointCount; ++e)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+                endpoints[e][c] = ((endpoints[e][c] << (8 - colorBits)) | (endpoints[e][c] >> (2 * colorBits - 8))) & 0xFF;
+
+            if (alphaBits && alphaBits < 8)
+                endpoints[e][3] = ((endpoints[e][3] << (8 - alphaBits)) | (endpoints[e][3] >> (2 * alphaBits - 8))) & 0xFF;
+        }
+
+        uint32_t subsets[16] = {};
+        bool     anchors[16] = { true };
+
+        if (info.subsets == 2)
+        {
+            for (uint32_t i = 0; i < 16; ++i)
+                subsets[i] = (BC7_PARTITIONS_2[partition] >> i) & 0x1;
+
+            anchors[BC7_ANCHORS_2[partition]] = true;
+        }
+        else if (info.subsets == 3)
+        {
+            for (uint32_t i = 0; i < 16; ++i)
+                subsets[i] = (BC7_PARTITIONS_3[partition] >> (i * 2)) & 0x3;
+
+            anchors[BC7_ANCHORS_3[0][partition]] = true;
+            anchors[BC7_ANCHORS_3[1][partition]] = true;
+        }
+
+    //  Anchor texels store their index without its top bit, which is always zero
+        uint32_t indices[16];
+        uint32_t secondaryIndices[16] = {};
+
+        for (uint32_t i = 0; i < 16; ++i)
+            indices[i] = bits.read(info.indexBits - (anchors[i] ? 1 : 0));
+
+        if (info.secondaryIndexBits)
+        {
+            for (uint32_t i = 0; i < 16; ++i)
+                secondaryIndices[i] = bits.read(info.secondaryIndexBits - (i == 0 ? 1 : 0));
+        }
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            const uint32_t* e0 = endpoints[subsets[i] * 2];
+            const uint32_t* e1 = endpoints[subsets[i] * 2 + 1];
+
+        //  Separate alpha indices exist in modes 4 and 5, mode 4 may swap which set drives the color
+            uint32_t colorWeight = bc7_weights(info.indexBits)[indices[i]];
+            uint32_t alphaWeight = colorWeight;
+
+            if (info.secondaryIndexBits)
+            {
+                const uint32_t secondaryWeight = bc7_weights(info.secondaryIndexBits)[secondaryIndices[i]];
+
+                if (selector)
+                    colorWeight = secondaryWeight;
+                else
+                    alphaWeight = secondaryWeight;
+            }
+
+            uint8_t* texel = texels + i * 4;
+
+            for (uint32_t c = 0; c < 3; ++c)
+                texel[c] = static_cast<uint8_t>(((64 - colorWeight) * e0[c] + colorWeight * e1[c] + 32) >> 6);
+
+            texel[3] = static_cast<uint8_t>(((64 - alphaWeight) * e0[3] + alphaWeight * e1[3] + 32) >> 6);
+
+            if (rotation)
+                std::swap(texel[3], texel[rotation - 1]);
+        }
+    }
+}
+
+
+
+bool BlockDecoder::decode(Encoding encoding, const uint8_t* blocks, uint64_t size, uint32_t width, uint32_t height, uint8_t* rgba) noexcept
+{
+    const uint32_t blocksX   = (width + 3) / 4;
+    const uint32_t blocksY   = (height + 3) / 4;
+    const uint32_t blockSize = getBlockSize(encoding);
+
+    if (static_cast<uint64_t>(blocksX) * blocksY * blockSize > size)
+        return false;
+
+    uint8_t texels[16 * 4];
+
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            const uint8_t* block = blocks + (static_cast<uint64_t>(by) * blocksX + bx) * blockSize;
+
+            switch (encoding)
+            {
+                case BC1:
+                    decode_color_block(block, texels, true);
+                    break;
+
+                case BC2:
+                    decode_color_block(block + 8, texels, false);
+                    decode_explicit_alpha_block(block, texels + 3, 4);
+                    break;
+
+                case BC3:
+                    decode_color_block(block + 8, texels, false);
+                    decode_alpha_block(block, texels + 3, 4);
+                    break;
+
+                case BC4:
+                    decode_alpha_block(block, texels, 4);
+
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        texels[i * 4 + 1] = texels[i * 4 + 2] = texels[i * 4];
+                        texels[i * 4 + 3] = 255;
+                    }
+                    break;
+
+                case BC5:
+                    decode_alpha_block(block, texels, 4);
+                    decode_alpha_block(block + 8, texels + 1, 4);
+
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        texels[i * 4 + 2] = 0;
+                        texels[i * 4 + 3] = 255;
+                    }
+                    break;
+
+            //  Signed channels stay signed for an RGBA8 SNORM image, 127 is an alpha of 1
+                case BC4_SNORM:
+                    decode_signed_alpha_block(block, texels, 4);
+
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        texels[i * 4 + 1] = texels[i * 4 + 2] = texels[i * 4];
+                        texels[i * 4 + 3] = 127;
+                    }
+                    break;
+
+                case BC5_SNORM:
+                    decode_signed_alpha_block(block, texels, 4);
+                    decode_signed_alpha_block(block + 8, texels + 1, 4);
+
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        texels[i * 4 + 2] = 0;
+                        texels[i * 4 + 3] = 127;
+                    }
+                    break;
+
+                case BC7:
+                    decode_bc7_block(block, texels);
+                    break;
+            }
+
+        //  Edge blocks of non multiple-of-4 levels are clipped
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+            {
+                const uint32_t columns = (width - bx * 4 < 4) ? (width - bx * 4) : 4;
+                uint8_t* row = rgba + ((static_cast<uint64_t>(by) * 4 + y) * width + bx * 4) * 4;
+
+                memcpy(row, texels + y * 16, columns * 4);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+uint32_t BlockDecoder::getBlockSize(Encoding encoding) noexcept
+{
+    return (encoding == BC1 || encoding == BC4 || encoding == BC4_SNORM) ? 8 : 16;
+}
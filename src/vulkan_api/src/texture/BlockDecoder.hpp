@@ -0,0 +1,27 @@
+#ifndef BLOCK_DECODER_HPP
+#define BLOCK_DECODER_HPP
+
+#include <cstdint>
+
+
+// CPU fallback for block-compressed textures the GPU cannot sample directly.
+// Decodes a whole level into tightly packed RGBA8 pixels, signed for the SNORM encodings
+struct BlockDecoder
+{
+    enum Encoding
+    {
+        BC1,
+        BC2,
+        BC3,
+        BC4,
+        BC4_SNORM,
+        BC5,
+        BC5_SNORM,
+        BC7
+    };
+
+    static bool decode(Encoding encoding, const uint8_t* blocks, uint64_t size, uint32_t width, uint32_t height, uint8_t* rgba) noexcept;
+    static uint32_t getBlockSize(Encoding encoding) noexcept;
+};
+
+#endif // !BLOCK_DECODER_HPP
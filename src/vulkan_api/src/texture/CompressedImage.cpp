@@ -0,0 +1,571 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <string_view>
+
+#include "utils/Tools.hpp"
+#include "texture/Image.hpp"
+#include "texture/BlockDecoder.hpp"
+#include "assets/AssetPack.hpp"
+#include "texture/CompressedImage.hpp"
+
+
+namespace
+{
+    struct FormatInfo
+    {
+        VkFormat format;
+        uint32_t blockWidth;
+        uint32_t blockHeight;
+        uint32_t blockSize;
+    };
+
+    constexpr FormatInfo FORMATS[] = 
+    {
+        { VK_FORMAT_BC1_RGB_UNORM_BLOCK,       4, 4, 8  },
+        { VK_FORMAT_BC1_RGB_SRGB_BLOCK,        4, 4, 8  },
+        { VK_FORMAT_BC1_RGBA_UNORM_BLOCK,      4, 4, 8  },
+        { VK_FORMAT_BC1_RGBA_SRGB_BLOCK,       4, 4, 8  },
+        { VK_FORMAT_BC3_UNORM_BLOCK,           4, 4, 16 },
+        { VK_FORMAT_BC3_SRGB_BLOCK,            4, 4, 16 },
+        { VK_FORMAT_BC4_UNORM_BLOCK,           4, 4, 8  },
+        { VK_FORMAT_BC4_SNORM_BLOCK,           4, 4, 8  },
+        { VK_FORMAT_BC5_UNORM_BLOCK,           4, 4, 16 },
+        { VK_FORMAT_BC5_SNORM_BLOCK,           4, 4, 16 },
+        { VK_FORMAT_BC7_UNORM_BLOCK,           4, 4, 16 },
+        { VK_FORMAT_BC7_SRGB_BLOCK,            4, 4, 16 },
+        { VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,   4, 4, 8  },
+        { VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK,    4, 4, 8  },
+        { VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK, 4, 4, 8  },
+        { VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK,  4, 4, 8  },
+        { VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, 4, 4, 16 },
+        { VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK,  4, 4, 16 },
+        { VK_FORMAT_ASTC_4x4_UNORM_BLOCK,      4, 4, 16 },
+        { VK_FORMAT_ASTC_4x4_SRGB_BLOCK,       4, 4, 16 },
+        { VK_FORMAT_ASTC_6x6_UNORM_BLOCK,      6, 6, 16 },
+        { VK_FORMAT_ASTC_6x6_SRGB_BLOCK,       6, 6, 16 },
+        { VK_FORMAT_ASTC_8x8_UNORM_BLOCK,      8, 8, 16 },
+        { VK_FORMAT_ASTC_8x8_SRGB_BLOCK,       8, 8, 16 },
+        { VK_FORMAT_R8G8B8A8_UNORM,            1, 1, 4  },
+        { VK_FORMAT_R8G8B8A8_SRGB,             1, 1, 4  },
+        { VK_FORMAT_B8G8R8A8_UNORM,            1, 1, 4  },
+        { VK_FORMAT_B8G8R8A8_SRGB,             1, 1, 4  }
+    };
+
+
+    const FormatInfo* find_format_info(VkFormat format) noexcept
+    {
+        for (const auto& info : FORMATS)
+            if (info.format == format)
+                return &info;
+
+        return nullptr;
+    }
+
+
+    uint64_t get_level_size(const FormatInfo& info, uint32_t width, uint32_t height) noexcept
+    {
+        const uint64_t blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+        const uint64_t blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+
+        return blocksX * blocksY * info.blockSize;
+    }
+
+
+    uint32_t read_u32(const uint8_t* ptr) noexcept
+    {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+
+        return value;
+    }
+
+
+    uint64_t read_u64(const uint8_t* ptr) noexcept
+    {
+        uint64_t value;
+        memcpy(&value, ptr, sizeof(value));
+
+        return value;
+    }
+
+
+    constexpr uint32_t make_fourcc(char a, char b, char c, char d) noexcept
+    {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+    }
+
+
+    VkFormat from_fourcc(uint32_t fourcc) noexcept
+    {
+        switch (fourcc)
+        {
+            case make_fourcc('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            case make_fourcc('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+            case make_fourcc('A', 'T', 'I', '1'): 
+            case make_fourcc('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+            case make_fourcc('B', 'C', '4', 'S'): return VK_FORMAT_BC4_SNORM_BLOCK;
+            case make_fourcc('A', 'T', 'I', '2'): 
+            case make_fourcc('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+            case make_fourcc('B', 'C', '5', 'S'): return VK_FORMAT_BC5_SNORM_BLOCK;
+        }
+
+        return VK_FORMAT_UNDEFINED;
+    }
+
+
+    VkFormat from_dxgi(uint32_t dxgiFormat) noexcept
+    {
+        switch (dxgiFormat)
+        {
+            case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+            case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+            case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+            case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+            case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+            case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+            case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+            case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+            case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+            case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+            case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+            case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+            case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+        }
+
+        return VK_FORMAT_UNDEFINED;
+    }
+
+
+    constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr uint64_t KTX2_LEVEL_INDEX_OFFSET = 80;
+    constexpr uint64_t KTX2_LEVEL_INDEX_STRIDE = 24;
+
+    constexpr uint32_t DDS_MAGIC             = make_fourcc('D', 'D', 'S', ' ');
+    constexpr uint32_t DDS_HEADER_SIZE       = 124;
+    constexpr uint32_t DDS_DX10_HEADER_SIZE  = 20;
+    constexpr uint32_t DDPF_FOURCC           = 0x4;
+    constexpr uint32_t DDPF_RGB              = 0x40;
+    constexpr uint32_t DDSCAPS2_CUBEMAP      = 0x200;
+    constexpr uint32_t DDSCAPS2_VOLUME       = 0x200000;
+}
+
+
+
+bool CompressedImage::loadFromFile(const char* filepath) noexcept
+{
+    FILE* file = fopen(filepath, "rb");
+
+    if ( ! file )
+    {
+#ifdef DEBUG
+        fprintf(stderr, "Failed to open file: %s\n", filepath);
+#endif
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool result = false;
+
+    if (fileSize > 0)
+    {
+        try
+        {
+            data.resize(static_cast<size_t>(fileSize));
+            result = (fread(data.data(), 1, data.size(), file) == data.size());
+        }
+        catch (const std::bad_alloc&)
+        {
+            result = false;
+        }
+    }
+
+    fclose(file);
+
+    if ( ! result )
+        return false;
+
+    m_bytes      = data.data();
+    m_byteSize   = data.size();
+    m_headerSize = data.size();
+    m_pack       = nullptr;
+    m_entry      = nullptr;
+
+    result = (parseKTX2() || parseDDS());
+
+#ifdef DEBUG
+    if ( ! result )
+        fprintf(stderr, "Unsupported texture container: %s\n", filepath);
+#endif
+
+    return result;
+}
+
+
+bool CompressedImage::loadFromMemory(const uint8_t* bytes, uint64_t size) noexcept
+{
+    data.clear();
+
+    m_bytes      = bytes;
+    m_byteSize   = size;
+    m_headerSize = size;
+    m_pack       = nullptr;
+    m_entry      = nullptr;
+
+    return (parseKTX2() || parseDDS());
+}
+
+
+bool CompressedImage::loadFromPack(const AssetPack& pack, std::string_view name) noexcept
+{
+    const AssetPack::Entry* entry = pack.find(name);
+
+    if ( ! entry )
+        return false;
+
+//  Stored entries are parsed straight from the mapping, compressed ones from their uncompressed prefix
+    const auto prefix = pack.getPrefix(*entry);
+    const bool stored = (entry->compression == AssetPack::Uncompressed);
+
+    data.clear();
+
+    m_bytes      = prefix.data();
+    m_byteSize   = stored ? prefix.size() : entry->size;
+    m_headerSize = prefix.size();
+    m_pack       = nullptr;
+    m_entry      = nullptr;
+
+    if ( ! (parseKTX2() || parseDDS()) )
+        return false;
+
+    if (stored)
+        return true;
+
+//  Only the header may live in the prefix, the levels are expanded from the body by readBody()
+    for (const auto& level : levels)
+        if (level.offset < entry->prefixSize)
+            return false;
+
+    m_pack  = &pack;
+    m_entry = entry;
+
+    return true;
+}
+
+
+bool CompressedImage::isSupported(VkPhysicalDevice gpu) const noexcept
+{
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+    return (vktools::find_supported_format(&format, 1, VK_IMAGE_TILING_OPTIMAL, features, gpu) == format);
+}
+
+
+bool CompressedImage::decompress(Image& image, VkFormat* decodedFormat) const noexcept
+{
+    BlockDecoder::Encoding encoding;
+    bool srgb  = false;
+    bool snorm = false;
+
+    switch (format)
+    {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            encoding = BlockDecoder::BC1;
+            break;
+
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+            encoding = BlockDecoder::BC2;
+            break;
+
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            encoding = BlockDecoder::BC3;
+            break;
+
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            encoding = BlockDecoder::BC4;
+            break;
+
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            encoding = BlockDecoder::BC4_SNORM;
+            snorm    = true;
+            break;
+
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            encoding = BlockDecoder::BC5;
+            break;
+
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+            encoding = BlockDecoder::BC5_SNORM;
+            snorm    = true;
+            break;
+
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            srgb = true;
+            [[fallthrough]];
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            encoding = BlockDecoder::BC7;
+            break;
+
+        default:
+#ifdef DEBUG
+            fprintf(stderr, "No CPU fallback for texture format %d\n", static_cast<int>(format));
+#endif
+            return false;
+    }
+
+    if (levels.empty() || ! image.create(width, height))
+        return false;
+
+//  The decode needs the blocks in memory, a compressed entry is expanded once for it
+    std::vector<uint8_t> body;
+    const uint8_t* blocks = getLevelData(0);
+
+    if ( ! blocks )
+    {
+        try
+        {
+            body.resize(static_cast<size_t>(getBodySize()));
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        if ( ! readBody(body.data()) )
+            return false;
+
+        blocks = body.data() + (levels[0].offset - getBodyOffset());
+    }
+
+    if ( ! BlockDecoder::decode(encoding, blocks, levels[0].size, width, height, image.pixels) )
+        return false;
+
+    *decodedFormat = snorm ? VK_FORMAT_R8G8B8A8_SNORM : srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+    return true;
+}
+
+
+const uint8_t* CompressedImage::getLevelData(uint32_t level) const noexcept
+{
+    return m_pack ? nullptr : m_bytes + levels[level].offset;
+}
+
+
+bool CompressedImage::hasLevelData() const noexcept
+{
+    return (m_pack == nullptr);
+}
+
+
+uint64_t CompressedImage::getSize() const noexcept
+{
+    uint64_t size = 0;
+
+    for (const auto& level : levels)
+        size += level.size;
+
+    return size;
+}
+
+
+uint64_t CompressedImage::getBodyOffset() const noexcept
+{
+    if (m_pack)
+        return m_entry->prefixSize;
+
+    uint64_t offset = m_byteSize;
+
+    for (const auto& level : levels)
+        offset = std::min(offset, level.offset);
+
+    return offset;
+}
+
+
+uint64_t CompressedImage::getBodySize() const noexcept
+{
+    if (m_pack)
+        return m_entry->size - m_entry->prefixSize;
+
+    uint64_t end = 0;
+
+    for (const auto& level : levels)
+        end = std::max(end, level.offset + level.size);
+
+    return end - getBodyOffset();
+}
+
+
+bool CompressedImage::readBody(void* dst) const noexcept
+{
+    if (m_pack)
+        return m_pack->readBody(*m_entry, dst);
+
+    memcpy(dst, m_bytes + getBodyOffset(), static_cast<size_t>(getBodySize()));
+
+    return true;
+}
+
+
+bool CompressedImage::isCompressedFile(const char* filepath) noexcept
+{
+    const std::string_view path(filepath);
+
+    return (path.ends_with(".ktx2") || path.ends_with(".dds"));
+}
+
+
+bool CompressedImage::parseKTX2() noexcept
+{
+    if (m_headerSize < KTX2_LEVEL_INDEX_OFFSET || memcmp(m_bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+        return false;
+
+    const uint8_t* header = m_bytes + sizeof(KTX2_IDENTIFIER);
+
+    const VkFormat vkFormat         = static_cast<VkFormat>(read_u32(header));
+    const uint32_t pixelWidth       = read_u32(header + 8);
+    const uint32_t pixelHeight      = read_u32(header + 12);
+    const uint32_t pixelDepth       = read_u32(header + 16);
+    const uint32_t layerCount       = read_u32(header + 20);
+    const uint32_t faceCount        = read_u32(header + 24);
+    const uint32_t levelCount       = read_u32(header + 28);
+    const uint32_t supercompression = read_u32(header + 32);
+
+//  Only plain 2D textures, Basis/zstd supercompressed payloads would need a transcoder
+    if (pixelDepth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0 || pixelWidth == 0 || pixelHeight == 0)
+        return false;
+
+    const FormatInfo* info = find_format_info(vkFormat);
+
+    if ( ! info )
+        return false;
+
+    const uint32_t count = (levelCount > 0) ? levelCount : 1;
+
+    if (KTX2_LEVEL_INDEX_OFFSET + count * KTX2_LEVEL_INDEX_STRIDE > m_headerSize)
+        return false;
+
+    levels.clear();
+    levels.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint8_t* entry = m_bytes + KTX2_LEVEL_INDEX_OFFSET + i * KTX2_LEVEL_INDEX_STRIDE;
+
+        const uint64_t offset = read_u64(entry);
+        const uint64_t size   = read_u64(entry + 8);
+
+        const uint32_t levelWidth  = (pixelWidth >> i)  ? (pixelWidth >> i)  : 1;
+        const uint32_t levelHeight = (pixelHeight >> i) ? (pixelHeight >> i) : 1;
+
+        if (offset > m_byteSize || size > m_byteSize - offset || size < get_level_size(*info, levelWidth, levelHeight))
+            return false;
+
+        levels.push_back({ offset, size, levelWidth, levelHeight });
+    }
+
+    format = vkFormat;
+    width  = pixelWidth;
+    height = pixelHeight;
+
+    return true;
+}
+
+
+bool CompressedImage::parseDDS() noexcept
+{
+    if (m_headerSize < 4 + DDS_HEADER_SIZE || read_u32(m_bytes) != DDS_MAGIC)
+        return false;
+
+    const uint8_t* header = m_bytes + 4;
+
+    if (read_u32(header) != DDS_HEADER_SIZE)
+        return false;
+
+    const uint32_t ddsHeight   = read_u32(header + 8);
+    const uint32_t ddsWidth    = read_u32(header + 12);
+    const uint32_t mipCount    = read_u32(header + 24);
+    const uint32_t pixelFlags  = read_u32(header + 76);
+    const uint32_t fourcc      = read_u32(header + 80);
+    const uint32_t bitCount    = read_u32(header + 84);
+    const uint32_t redMask     = read_u32(header + 88);
+    const uint32_t caps2       = read_u32(header + 108);
+
+    if (ddsWidth == 0 || ddsHeight == 0 || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+        return false;
+
+    uint64_t offset = 4 + DDS_HEADER_SIZE;
+    VkFormat ddsFormat = VK_FORMAT_UNDEFINED;
+
+    if ((pixelFlags & DDPF_FOURCC) && fourcc == make_fourcc('D', 'X', '1', '0'))
+    {
+        if (m_headerSize < offset + DDS_DX10_HEADER_SIZE)
+            return false;
+
+        const uint8_t* extended = m_bytes + offset;
+
+        if (read_u32(extended + 12) > 1) // texture arrays are not supported
+            return false;
+
+        ddsFormat = from_dxgi(read_u32(extended));
+        offset += DDS_DX10_HEADER_SIZE;
+    }
+    else if (pixelFlags & DDPF_FOURCC)
+    {
+        ddsFormat = from_fourcc(fourcc);
+    }
+    else if ((pixelFlags & DDPF_RGB) && bitCount == 32)
+    {
+        ddsFormat = (redMask == 0x000000FF) ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_B8G8R8A8_UNORM;
+    }
+
+    const FormatInfo* info = find_format_info(ddsFormat);
+
+    if ( ! info )
+        return false;
+
+    const uint32_t count = (mipCount > 0) ? mipCount : 1;
+
+    levels.clear();
+    levels.reserve(count);
+
+//  DDS stores the levels back to back, largest first
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t levelWidth  = (ddsWidth >> i)  ? (ddsWidth >> i)  : 1;
+        const uint32_t levelHeight = (ddsHeight >> i) ? (ddsHeight >> i) : 1;
+        const uint64_t size = get_level_size(*info, levelWidth, levelHeight);
+
+        if (offset + size > m_byteSize)
+            return false;
+
+        levels.push_back({ offset, size, levelWidth, levelHeight });
+        offset += size;
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+    }
+
+    format = ddsFormat;
+    width  = ddsWidth;
+    height = ddsHeight;
+
+    return true;
+}
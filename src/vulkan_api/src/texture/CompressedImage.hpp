@@ -0,0 +1,70 @@
+#ifndef COMPRESSED_IMAGE_HPP
+#define COMPRESSED_IMAGE_HPP
+
+#include <vector>
+#include <string_view>
+
+#include <vulkan/vulkan.h>
+
+#include "assets/AssetPack.hpp"
+
+
+// Pre-compressed texture read from a KTX2 or DDS container.
+// The blocks of every mip level stay in their GPU layout, so the upload is a plain memcpy into staging
+struct CompressedImage
+{
+    struct Level
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    bool loadFromFile(const char* filepath) noexcept;
+
+//  Parses the container in place, the memory must outlive the image (e.g. a mapped asset pack)
+    bool loadFromMemory(const uint8_t* bytes, uint64_t size) noexcept;
+
+//  A compressed entry is parsed from its stored prefix (the container header), its levels
+//  stay compressed in the pack until readBody() expands them where they are needed
+    bool loadFromPack(const AssetPack& pack, std::string_view name) noexcept;
+
+//  True when the GPU can sample the stored format with linear filtering
+    bool isSupported(VkPhysicalDevice gpu) const noexcept;
+
+//  Decodes the base level into RGBA8 for GPUs without support for the format, BC1-BC5 and BC7 only.
+//  Signed BC4/BC5 come out as RGBA8 SNORM
+    bool decompress(struct Image& image, VkFormat* decodedFormat) const noexcept;
+
+//  Null for every level when hasLevelData() is false
+    const uint8_t* getLevelData(uint32_t level) const noexcept;
+    bool hasLevelData() const noexcept;
+    uint64_t getSize() const noexcept;
+
+//  Everything after the container header, level i sits at levels[i].offset - getBodyOffset() inside it
+    uint64_t getBodyOffset() const noexcept;
+    uint64_t getBodySize() const noexcept;
+    bool readBody(void* dst) const noexcept;
+
+    static bool isCompressedFile(const char* filepath) noexcept;
+
+    std::vector<uint8_t> data; // owned storage, empty when the image views external memory
+    std::vector<Level>   levels;
+    VkFormat             format = VK_FORMAT_UNDEFINED;
+    uint32_t             width  = 0;
+    uint32_t             height = 0;
+
+private:
+    bool parseKTX2() noexcept;
+    bool parseDDS() noexcept;
+
+    const uint8_t* m_bytes      = nullptr;
+    uint64_t       m_byteSize   = 0;
+    uint64_t       m_headerSize = 0; // readable bytes at m_bytes, less than m_byteSize for a compressed entry
+
+    const AssetPack*        m_pack  = nullptr;
+    const AssetPack::Entry* m_entry = nullptr;
+};
+
+#endif // !COMPRESSED_IMAGE_HPP
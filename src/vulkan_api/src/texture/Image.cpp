@@ -0,0 +1,142 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstddef>
+#include <new>
+
+#include "texture/Image.hpp"
+
+
+Image::~Image()
+{
+    stbi_image_free(pixels);
+}
+
+
+bool Image::loadFromFile(const char* filepath) noexcept
+{
+    int32_t w = 0;
+    int32_t h = 0;
+    int32_t channels = 0;
+
+    stbi_uc* data = stbi_load(filepath, &w, &h, &channels, STBI_rgb_alpha);
+
+    if ( ! data )
+        return false;
+
+    stbi_image_free(pixels);
+
+    pixels = data;
+    width  = static_cast<uint32_t>(w);
+    height = static_cast<uint32_t>(h);
+
+    return true;
+}
+
+
+bool Image::loadFromMemory(const uint8_t* encoded, uint64_t size) noexcept
+{
+    int32_t w = 0;
+    int32_t h = 0;
+    int32_t channels = 0;
+
+    stbi_uc* data = stbi_load_from_memory(encoded, static_cast<int>(size), &w, &h, &channels, STBI_rgb_alpha);
+
+    if ( ! data )
+        return false;
+
+    stbi_image_free(pixels);
+
+    pixels = data;
+    width  = static_cast<uint32_t>(w);
+    height = static_cast<uint32_t>(h);
+
+    return true;
+}
+
+
+bool Image::create(uint32_t w, uint32_t h) noexcept
+{
+    auto* data = static_cast<stbi_uc*>(STBI_MALLOC(static_cast<size_t>(w) * h * 4));
+
+    if ( ! data )
+        return false;
+
+    stbi_image_free(pixels);
+
+    pixels = data;
+    width  = w;
+    height = h;
+
+    return true;
+}
+
+
+uint64_t Image::getSize() const noexcept
+{
+    return static_cast<uint64_t>(width) * height * 4;
+}
+
+
+bool Image::generateMipmaps(uint32_t mipLevels) noexcept
+{
+    if ( ! pixels || mipLevels < 2 )
+        return false;
+
+    uint64_t chainSize = 0;
+
+    for (uint32_t i = 1, w = width, h = height; i < mipLevels; ++i)
+    {
+        w = (w > 1) ? w / 2 : 1;
+        h = (h > 1) ? h / 2 : 1;
+        chainSize += static_cast<uint64_t>(w) * h * 4;
+    }
+
+    try
+    {
+        mipChain.resize(static_cast<size_t>(chainSize));
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    const uint8_t* src = pixels;
+    uint8_t* dst = mipChain.data();
+    uint32_t srcWidth  = width;
+    uint32_t srcHeight = height;
+
+    for (uint32_t i = 1; i < mipLevels; ++i)
+    {
+        const uint32_t dstWidth  = (srcWidth > 1)  ? srcWidth / 2  : 1;
+        const uint32_t dstHeight = (srcHeight > 1) ? srcHeight / 2 : 1;
+
+        for (uint32_t y = 0; y < dstHeight; ++y)
+        {
+            const uint32_t y0 = (y * 2 < srcHeight) ? y * 2 : srcHeight - 1;
+            const uint32_t y1 = (y0 + 1 < srcHeight) ? y0 + 1 : y0;
+
+            for (uint32_t x = 0; x < dstWidth; ++x)
+            {
+                const uint32_t x0 = (x * 2 < srcWidth) ? x * 2 : srcWidth - 1;
+                const uint32_t x1 = (x0 + 1 < srcWidth) ? x0 + 1 : x0;
+
+                const uint8_t* p00 = src + (static_cast<size_t>(y0) * srcWidth + x0) * 4;
+                const uint8_t* p01 = src + (static_cast<size_t>(y0) * srcWidth + x1) * 4;
+                const uint8_t* p10 = src + (static_cast<size_t>(y1) * srcWidth + x0) * 4;
+                const uint8_t* p11 = src + (static_cast<size_t>(y1) * srcWidth + x1) * 4;
+                uint8_t* out = dst + (static_cast<size_t>(y) * dstWidth + x) * 4;
+
+                for (uint32_t c = 0; c < 4; ++c)
+                    out[c] = static_cast<uint8_t>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+
+        src = dst;
+        dst += static_cast<size_t>(dstWidth) * dstHeight * 4;
+        srcWidth  = dstWidth;
+        srcHeight = dstHeight;
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include <cstdint>
+#include <vector>
+
+
+// Decoded RGBA8 pixels in host memory, safe to fill on a worker thread
+struct Image
+{
+    Image() noexcept = default;
+    Image(const Image&)              = delete;
+    Image& operator = (const Image&) = delete;
+    ~Image();
+
+    bool loadFromFile(const char* filepath) noexcept;
+    bool loadFromMemory(const uint8_t* encoded, uint64_t size) noexcept;
+    bool create(uint32_t w, uint32_t h) noexcept;
+
+    uint64_t getSize() const noexcept;
+
+//  CPU box-filter fallback for formats the GPU cannot blit with a linear filter.
+//  Levels [1, mipLevels) are packed one after another into mipChain
+    bool generateMipmaps(uint32_t mipLevels) noexcept;
+
+    uint8_t* pixels = nullptr;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    std::vector<uint8_t> mipChain;
+};
+
+#endif // !IMAGE_HPP
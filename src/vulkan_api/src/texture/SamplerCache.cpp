@@ -0,0 +1,158 @@
+#include <cstring>
+
+#include "texture/SamplerCache.hpp"
+
+
+
+VkSamplerCreateInfo SamplerCache::getDefaultInfo(VkPhysicalDevice gpu) noexcept
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(gpu, &properties);
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(gpu, &features);
+
+    const VkSamplerCreateInfo samplerInfo = 
+    {
+        .sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext                   = VK_NULL_HANDLE,
+        .flags                   = 0,
+        .magFilter               = VK_FILTER_LINEAR,
+        .minFilter               = VK_FILTER_LINEAR,
+        .mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .mipLodBias              = 0.f,
+        .anisotropyEnable        = features.samplerAnisotropy,
+        .maxAnisotropy           = features.samplerAnisotropy ? properties.limits.maxSamplerAnisotropy : 1.f,
+        .compareEnable           = VK_FALSE,
+        .compareOp               = VK_COMPARE_OP_ALWAYS,
+        .minLod                  = 0.f,
+        .maxLod                  = VK_LOD_CLAMP_NONE,
+        .borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE
+    };
+
+    return samplerInfo;
+}
+
+
+VkSampler SamplerCache::acquire(const VkSamplerCreateInfo& info, VkDevice device) noexcept
+{
+    if (info.pNext)
+        return VK_NULL_HANDLE;
+
+    const Key key = 
+    {
+        .flags                   = info.flags,
+        .magFilter               = info.magFilter,
+        .minFilter               = info.minFilter,
+        .mipmapMode              = info.mipmapMode,
+        .addressModeU            = info.addressModeU,
+        .addressModeV            = info.addressModeV,
+        .addressModeW            = info.addressModeW,
+        .mipLodBias              = info.mipLodBias,
+        .anisotropyEnable        = info.anisotropyEnable,
+        .maxAnisotropy           = info.maxAnisotropy,
+        .compareEnable           = info.compareEnable,
+        .compareOp               = info.compareOp,
+        .minLod                  = info.minLod,
+        .maxLod                  = info.maxLod,
+        .borderColor             = info.borderColor,
+        .unnormalizedCoordinates = info.unnormalizedCoordinates
+    };
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (auto found = m_samplers.find(key); found != m_samplers.end())
+    {
+        ++found->second.refCount;
+
+        return found->second.sampler;
+    }
+
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    if (vkCreateSampler(device, &info, VK_NULL_HANDLE, &sampler) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+
+    try
+    {
+        m_samplers.emplace(key, Entry{ sampler, 1 });
+    }
+    catch (const std::bad_alloc&)
+    {
+        vkDestroySampler(device, sampler, VK_NULL_HANDLE);
+
+        return VK_NULL_HANDLE;
+    }
+
+    return sampler;
+}
+
+
+void SamplerCache::release(VkSampler sampler, VkDevice device) noexcept
+{
+    if ( ! sampler )
+        return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+//  A handful of distinct samplers exist at any time, a linear search is cheaper than a second map
+    for (auto it = m_samplers.begin(); it != m_samplers.end(); ++it)
+    {
+        if (it->second.sampler != sampler)
+            continue;
+
+        if (--it->second.refCount == 0)
+        {
+            vkDestroySampler(device, sampler, VK_NULL_HANDLE);
+            m_samplers.erase(it);
+        }
+
+        return;
+    }
+}
+
+
+void SamplerCache::destroy(VkDevice device) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    for (const auto& [key, entry] : m_samplers)
+        vkDestroySampler(device, entry.sampler, VK_NULL_HANDLE);
+
+    m_samplers.clear();
+}
+
+
+uint32_t SamplerCache::getSamplerCount() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    return static_cast<uint32_t>(m_samplers.size());
+}
+
+
+bool SamplerCache::Key::operator == (const Key& other) const noexcept
+{
+//  Every member is a 32-bit word, so the bytes compare like the values (-0.f and NaN aside, which only cost a duplicate)
+    return (memcmp(this, &other, sizeof(Key)) == 0);
+}
+
+
+size_t SamplerCache::KeyHash::operator () (const Key& key) const noexcept
+{
+//  FNV-1a over the key words
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&key);
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < sizeof(Key); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return static_cast<size_t>(hash);
+}
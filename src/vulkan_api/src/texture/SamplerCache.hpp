@@ -0,0 +1,66 @@
+#ifndef SAMPLER_CACHE_HPP
+#define SAMPLER_CACHE_HPP
+
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+
+// Shares one VkSampler between every user asking for the same sampler state.
+// Samplers are reference counted and destroyed when the last user releases them
+class SamplerCache
+{
+public:
+//  Linear filtering, repeat addressing, the maximum anisotropy the device allows and no LOD clamp:
+//  the image view already limits the levels, so this sampler fits every regular texture
+    static VkSamplerCreateInfo getDefaultInfo(VkPhysicalDevice gpu) noexcept;
+
+//  pNext chains are not supported, such samplers have to be created directly
+    VkSampler acquire(const VkSamplerCreateInfo& info, VkDevice device) noexcept;
+    void release(VkSampler sampler, VkDevice device) noexcept;
+    void destroy(VkDevice device) noexcept;
+
+    uint32_t getSamplerCount() const noexcept;
+
+private:
+    struct Key
+    {
+        VkSamplerCreateFlags flags;
+        VkFilter             magFilter;
+        VkFilter             minFilter;
+        VkSamplerMipmapMode  mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float                mipLodBias;
+        VkBool32             anisotropyEnable;
+        float                maxAnisotropy;
+        VkBool32             compareEnable;
+        VkCompareOp          compareOp;
+        float                minLod;
+        float                maxLod;
+        VkBorderColor        borderColor;
+        VkBool32             unnormalizedCoordinates;
+
+        bool operator == (const Key& other) const noexcept;
+    };
+
+    static_assert(sizeof(Key) == 16 * sizeof(uint32_t), "sampler keys are compared and hashed as padding-free 32-bit words");
+
+    struct KeyHash
+    {
+        size_t operator () (const Key& key) const noexcept;
+    };
+
+    struct Entry
+    {
+        VkSampler sampler;
+        uint32_t  refCount;
+    };
+
+    mutable std::mutex m_lock; // textures are created on the loading threads and the render thread alike
+    std::unordered_map<Key, Entry, KeyHash> m_samplers;
+};
+
+#endif // !SAMPLER_CACHE_HPP
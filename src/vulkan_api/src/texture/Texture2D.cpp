@@ -1,177 +1,175 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <vector>
 
 #include "utils/Tools.hpp"
 #include "context/Context.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "texture/Image.hpp"
+#include "texture/CompressedImage.hpp"
 #include "texture/Texture2D.hpp"
 
 
-namespace
+bool Texture2D::loadFromFile(const char* filepath, const VulkanContext* context, VkCommandPool pool) noexcept
 {
-    struct StbImage
+    Image decoded;
+
+    if (CompressedImage::isCompressedFile(filepath))
     {
-        StbImage(const char* filepath, int mode) noexcept:
-            pixels(nullptr), width(0), height(0), channels(0)
+        CompressedImage compressed;
+
+        if ( ! compressed.loadFromFile(filepath) )
+            return false;
+
+        UploadBatch batch;
+
+        if (compressed.isSupported(context->GPU))
         {
-            pixels = stbi_load(filepath, &width, &height, &channels, mode);
+            if ( ! loadFromCompressed(compressed, context, batch) )
+                return false;
         }
-
-        ~StbImage()
+        else
         {
-            stbi_image_free(pixels);
+            VkFormat format;
+
+            if ( ! compressed.decompress(decoded, &format) || ! loadFromImage(decoded, context, batch, format) )
+                return false;
         }
 
-        stbi_uc* pixels;
-        int32_t  width;
-        int32_t  height;
-        int32_t  channels;
-    };
+        return batch.submit(context, pool);
+    }
+
+    if ( ! decoded.loadFromFile(filepath) )
+        return false;
+
+    UploadBatch batch;
+
+    if ( ! loadFromImage(decoded, context, batch) )
+        return false;
+
+    return batch.submit(context, pool);
+}
+
+
+bool Texture2D::loadFromImage(Image& decoded, const VulkanContext* context, UploadBatch& batch, VkFormat format) noexcept
+{
+    if ( ! decoded.pixels )
+        return false;
+
+    const VkExtent2D extent = { decoded.width, decoded.height };
+
+    mipLevels = vktools::get_mip_levels(extent);
 
+//  Blitting needs linear filtering support for the format, otherwise the chain is built on the CPU.
+//  The CPU filter averages unsigned bytes, signed texels keep their base level only
+    const bool blitMipmaps = vktools::supports_linear_blit(format, context->GPU);
 
-    struct BufferMemoryDeleter
+    if ( ! blitMipmaps && (format == VK_FORMAT_R8G8B8A8_SNORM || ! decoded.generateMipmaps(mipLevels)) )
+        mipLevels = 1;
+
+    if ( ! create(extent, format, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, context) )
+        return false;
+
+//  Layout transitions, the copy and the mip chain are recorded by the batch, together with every other pending upload
+    if (blitMipmaps || mipLevels == 1)
     {
-        ~BufferMemoryDeleter() 
+        batch.addImage(image, extent, mipLevels, decoded.pixels, decoded.getSize());
+    }
+    else
+    {
+        std::vector<UploadBatch::ImageLevel> levels;
+        levels.reserve(mipLevels);
+        levels.push_back({ decoded.pixels, decoded.getSize(), extent });
+
+        const uint8_t* level = decoded.mipChain.data();
+        VkExtent2D levelExtent = extent;
+
+        for (uint32_t i = 1; i < mipLevels; ++i)
         {
-            if (buffer) vkDestroyBuffer(device, buffer, nullptr);
-            if (memory) vkFreeMemory(device, memory, nullptr);
-        }
+            levelExtent.width  = (levelExtent.width > 1)  ? levelExtent.width / 2  : 1;
+            levelExtent.height = (levelExtent.height > 1) ? levelExtent.height / 2 : 1;
 
-        VkDeviceMemory memory = nullptr;
-        VkBuffer buffer = nullptr;
-        VkDevice device = nullptr;
-    };
+            const VkDeviceSize size = static_cast<VkDeviceSize>(levelExtent.width) * levelExtent.height * 4;
+            levels.push_back({ level, size, levelExtent });
+            level += size;
+        }
 
+        batch.addImage(image, levels);
+    }
 
-    bool create_sampler(Texture2D* texture, VkPhysicalDevice gpu, VkDevice device) noexcept;
+    return true;
 }
 
 
-
-bool Texture2D::loadFromFile(const char* filepath, const VulkanContext* context, VkCommandPool pool) noexcept
+bool Texture2D::loadFromCompressed(const CompressedImage& compressed, const VulkanContext* context, UploadBatch& batch) noexcept
 {
-    StbImage stbImage(filepath, STBI_rgb_alpha);
-
-    if ( ! stbImage.pixels )
+    if (compressed.levels.empty())
         return false;
 
-    VkDeviceSize imageSize = stbImage.width * stbImage.height * 4;
+    const VkExtent2D extent = { compressed.width, compressed.height };
 
-    VkDeviceMemory stagingBufferMemory;
-    VkBuffer stagingBuffer = vktools::create_buffer(
-                                                    imageSize, 
-                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                                                    &stagingBufferMemory, 
-                                                    context->device, 
-                                                    context->GPU);
+    mipLevels = static_cast<uint32_t>(compressed.levels.size());
 
-    if(!stagingBuffer)
+    if ( ! create(extent, compressed.format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, context) )
         return false;
 
-    BufferMemoryDeleter guard = { stagingBufferMemory, stagingBuffer, context->device };
+//  The blocks go to staging as they are, no CPU decode and no GPU mip generation
+    std::vector<UploadBatch::ImageLevel> levels;
+    levels.reserve(mipLevels);
 
-    if (void* data; vkMapMemory(context->device, stagingBufferMemory, 0, imageSize, 0, &data) == VK_SUCCESS)
+    const uint64_t bodyOffset = compressed.getBodyOffset();
+
+    for (uint32_t i = 0; i < mipLevels; ++i)
     {
-        memcpy(data, stbImage.pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(context->device, stagingBufferMemory);
+        const auto& level = compressed.levels[i];
+        levels.push_back({ compressed.getLevelData(i), level.size, { level.width, level.height }, level.offset - bodyOffset });
     }
-    else return false;
 
-    const VkExtent2D extent = { static_cast<uint32_t>(stbImage.width), static_cast<uint32_t>(stbImage.height) };
+//  A compressed pack entry is expanded by the batch straight into its staging slice
+    if (compressed.hasLevelData())
+        batch.addImage(image, levels);
+    else
+        batch.addImage(image, levels, compressed.getBodySize(), [source = &compressed](void* dst) { return source->readBody(dst); });
+
+    return true;
+}
 
+
+bool Texture2D::create(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, const VulkanContext* context) noexcept
+{
     if(!vktools::create_image_2D(
                                  extent, 
-                                 VK_FORMAT_R8G8B8A8_SRGB, 
+                                 format, 
                                  VK_IMAGE_TILING_OPTIMAL, 
-                                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+                                 usage, 
                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
                                  &image, 
                                  &imageMemory, 
                                  context->GPU, 
-                                 context->device))
-        return false;
-        
-    if ( ! vktools::transition_image_layout(
-                                            image, 
-                                            VK_FORMAT_R8G8B8A8_SRGB, 
-                                            VK_IMAGE_LAYOUT_UNDEFINED, 
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-                                            context->device, pool, 
-                                            context->queue))
-        return false;
-
-    if ( ! vktools::copy_buffer_to_image(
-                                         stagingBuffer, 
-                                         image, 
-                                         static_cast<uint32_t>(stbImage.width), 
-                                         static_cast<uint32_t>(stbImage.height), 
-                                         context->device, 
-                                         pool, 
-                                         context->queue) )
-        return false;
-
-    if ( ! vktools::transition_image_layout(
-                                            image, 
-                                            VK_FORMAT_R8G8B8A8_SRGB, 
-                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
-                                            context->device, 
-                                            pool, 
-                                            context->queue) )
+                                 context->device, 
+                                 mipLevels))
         return false;
 
     if( ! vktools::create_image_view_2D(
                                         context->device, 
                                         image, 
-                                        VK_FORMAT_R8G8B8A8_SRGB, 
+                                        format, 
                                         VK_IMAGE_ASPECT_COLOR_BIT, 
-                                        &imageView))
+                                        &imageView, 
+                                        mipLevels))
         return false;
     
-    if ( ! create_sampler(this, context->GPU, context->device) )
-        return false;
+    samplerCache = &context->samplers;
+    sampler      = samplerCache->acquire(SamplerCache::getDefaultInfo(context->GPU), context->device);
 
-    return true;
+    return (sampler != VK_NULL_HANDLE);
 }
 
 
 void Texture2D::destroy(VkDevice device) noexcept
 {
-    vkDestroySampler(device, sampler, VK_NULL_HANDLE);
+    if (samplerCache)
+        samplerCache->release(sampler, device);
+
     vkDestroyImageView(device, imageView, VK_NULL_HANDLE);
     vkDestroyImage(device, image, VK_NULL_HANDLE);
     vkFreeMemory(device, imageMemory, VK_NULL_HANDLE);
 }
-
-namespace
-{
-    bool create_sampler(Texture2D* texture, VkPhysicalDevice gpu, VkDevice device) noexcept
-    {
-        VkPhysicalDeviceProperties properties;
-        vkGetPhysicalDeviceProperties(gpu, &properties);
-
-        const VkSamplerCreateInfo samplerInfo = 
-        {
-            .sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-            .pNext                   = VK_NULL_HANDLE,
-            .flags                   = 0,
-            .magFilter               = VK_FILTER_LINEAR,
-            .minFilter               = VK_FILTER_LINEAR,
-            .mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-            .addressModeU            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .addressModeV            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .addressModeW            = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-            .mipLodBias              = 0.f,
-            .anisotropyEnable        = VK_TRUE,
-            .maxAnisotropy           = properties.limits.maxSamplerAnisotropy,
-            .compareEnable           = VK_FALSE,
-            .compareOp               = VK_COMPARE_OP_ALWAYS,
-            .minLod                  = 0.f,
-            .maxLod                  = 0.f,
-            .borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-            .unnormalizedCoordinates = VK_FALSE
-        };
-
-        return (vkCreateSampler(device, &samplerInfo, VK_NULL_HANDLE, &texture->sampler) == VK_SUCCESS);
-    }
-}
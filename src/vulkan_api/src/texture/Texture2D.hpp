@@ -6,12 +6,20 @@
 struct Texture2D
 {
     bool loadFromFile(const char* filepath, const struct VulkanContext* context, VkCommandPool pool) noexcept;
+    bool loadFromImage(struct Image& decoded, const struct VulkanContext* context, class UploadBatch& batch, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB) noexcept;
+    bool loadFromCompressed(const struct CompressedImage& compressed, const struct VulkanContext* context, class UploadBatch& batch) noexcept;
+
+//  Image, view and sampler for 'mipLevels' levels, the contents are uploaded separately
+    bool create(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, const struct VulkanContext* context) noexcept;
     void destroy(VkDevice device) noexcept;
 
     VkDeviceMemory imageMemory = VK_NULL_HANDLE;
     VkImage        image       = VK_NULL_HANDLE;
     VkImageView    imageView   = VK_NULL_HANDLE;
     VkSampler      sampler     = VK_NULL_HANDLE;
+    uint32_t       mipLevels   = 1;
+
+    class SamplerCache* samplerCache = nullptr; // owner of 'sampler', shared with every texture using the same state
 };
 
 #endif // !TEXTURE2D_HPP
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "utils/Tools.hpp"
+#include "context/Context.hpp"
+#include "jobs/JobSystem.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "texture/Image.hpp"
+#include "texture/Texture2D.hpp"
+#include "texture/TextureLoader.hpp"
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Source
+    {
+        std::vector<uint8_t> bytes;
+        VkExtent2D           extent = {};
+        bool                 valid  = false;
+    };
+
+//  First decode start and last decode end over all workers, in nanoseconds since 'origin'
+    struct DecodeSpan
+    {
+        Clock::time_point     origin;
+        std::atomic<int64_t>  begin = INT64_MAX;
+        std::atomic<int64_t>  end   = 0;
+
+        void record(Clock::time_point start, Clock::time_point stop) noexcept
+        {
+            const int64_t b = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+            const int64_t e = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - origin).count();
+
+            int64_t current = begin.load(std::memory_order_relaxed);
+            while (b < current && ! begin.compare_exchange_weak(current, b, std::memory_order_relaxed));
+
+            current = end.load(std::memory_order_relaxed);
+            while (e > current && ! end.compare_exchange_weak(current, e, std::memory_order_relaxed));
+        }
+
+        float milliseconds() const noexcept
+        {
+            const int64_t b = begin.load(std::memory_order_relaxed);
+            const int64_t e = end.load(std::memory_order_relaxed);
+
+            return (e > b) ? static_cast<float>(e - b) / 1'000'000.f : 0.f;
+        }
+    };
+
+    bool read_file(const char* filepath, std::vector<uint8_t>& bytes) noexcept;
+    float elapsed_ms(Clock::time_point since) noexcept;
+}
+
+
+
+bool TextureLoader::loadFromFiles(std::span<const char* const> filepaths, 
+                                  std::span<Texture2D> textures, 
+                                  const VulkanContext* context, 
+                                  VkCommandPool pool, 
+                                  JobSystem& jobs, 
+                                  VkFormat format, 
+                                  Timings* timings) noexcept
+{
+    if (filepaths.size() != textures.size() || filepaths.empty())
+        return false;
+
+    const uint32_t count = static_cast<uint32_t>(filepaths.size());
+
+    std::vector<Source> sources;
+
+    try
+    {
+        sources.resize(count);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    Timings stats;
+
+//  Stage 1: read the encoded files and peek at their headers
+    auto start = Clock::now();
+
+    jobs.parallelFor(count, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            Source& source = sources[i];
+
+            if ( ! read_file(filepaths[i], source.bytes) )
+                continue;
+
+            int32_t w = 0;
+            int32_t h = 0;
+            int32_t channels = 0;
+
+            if (stbi_info_from_memory(source.bytes.data(), static_cast<int>(source.bytes.size()), &w, &h, &channels))
+            {
+                source.extent = { static_cast<uint32_t>(w), static_cast<uint32_t>(h) };
+                source.valid  = (w > 0 && h > 0);
+            }
+        }
+    });
+
+    stats.io = elapsed_ms(start);
+
+    for (const auto& source : sources)
+        if ( ! source.valid )
+            return false;
+
+    UploadBatch batch;
+    bool result = true;
+
+//  Without blit support the mip chains are built on the CPU, so the pixels have to be decoded up front
+    if ( ! vktools::supports_linear_blit(format, context->GPU) )
+    {
+//      Images can be neither copied nor moved, so they do not go in a vector
+        std::unique_ptr<Image[]> decoded(new (std::nothrow) Image[count]);
+
+        if ( ! decoded )
+            return false;
+
+        start = Clock::now();
+
+        jobs.parallelFor(count, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                if (decoded[i].loadFromMemory(sources[i].bytes.data(), sources[i].bytes.size()))
+                    decoded[i].generateMipmaps(vktools::get_mip_levels(sources[i].extent));
+        });
+
+        stats.decode = elapsed_ms(start);
+        start = Clock::now();
+
+        for (uint32_t i = 0; i < count && result; ++i)
+            result = textures[i].loadFromImage(decoded[i], context, batch, format);
+
+        result = result && batch.submit(context, pool);
+        stats.upload = elapsed_ms(start);
+    }
+    else
+    {
+        DecodeSpan decodeSpan;
+
+        start = Clock::now();
+        decodeSpan.origin = start;
+
+        for (uint32_t i = 0; i < count && result; ++i)
+        {
+            Texture2D& texture = textures[i];
+            const VkExtent2D extent = sources[i].extent;
+
+            texture.mipLevels = vktools::get_mip_levels(extent);
+
+            if ( ! texture.create(extent, format, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, context) )
+            {
+                result = false;
+                break;
+            }
+
+            const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+            Source* source = &sources[i];
+            DecodeSpan* span = &decodeSpan;
+
+//  stb can not decode into caller memory, so the worker decodes and copies its own slice while the others do the same
+            batch.addImage(texture.image, extent, texture.mipLevels, size, [source, size, span](void* staging)
+            {
+                const auto decodeStart = Clock::now();
+
+                int32_t w = 0;
+                int32_t h = 0;
+                int32_t channels = 0;
+
+                stbi_uc* pixels = stbi_load_from_memory(source->bytes.data(), static_cast<int>(source->bytes.size()), &w, &h, &channels, STBI_rgb_alpha);
+
+                if ( ! pixels )
+                    return false;
+
+//              The slice was sized from the header peeked in stage 1, a file that decodes to another extent would overrun it
+                if (static_cast<uint32_t>(w) != source->extent.width || static_cast<uint32_t>(h) != source->extent.height)
+                {
+                    stbi_image_free(pixels);
+
+                    return false;
+                }
+
+                memcpy(staging, pixels, size);
+                stbi_image_free(pixels);
+
+                span->record(decodeStart, Clock::now());
+
+                return true;
+            });
+        }
+
+        result = result && batch.submit(context, pool, &jobs);
+
+        stats.decode = decodeSpan.milliseconds();
+        stats.upload = elapsed_ms(start) - stats.decode;
+    }
+
+//  Nothing was submitted or the submission failed, a half-created texture is destroyed too
+    if ( ! result )
+    {
+        for (auto& texture : textures)
+        {
+            texture.destroy(context->device);
+            texture = {};
+        }
+    }
+
+#ifdef DEBUG
+    if (result)
+        fprintf(stdout, "Loaded %u textures: io %.2f ms, decode %.2f ms, upload %.2f ms\n", count, stats.io, stats.decode, stats.upload);
+#endif
+
+    if (timings)
+        *timings = stats;
+
+    return result;
+}
+
+
+
+namespace
+{
+    bool read_file(const char* filepath, std::vector<uint8_t>& bytes) noexcept
+    {
+        FILE* file = fopen(filepath, "rb");
+
+        if ( ! file )
+        {
+#ifdef DEBUG
+            fprintf(stderr, "Failed to open file: %s\n", filepath);
+#endif
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        const long fileSize = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        bool result = false;
+
+        if (fileSize > 0)
+        {
+            try
+            {
+                bytes.resize(static_cast<size_t>(fileSize));
+                result = (fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+            }
+            catch (const std::bad_alloc&)
+            {
+                result = false;
+            }
+        }
+
+        fclose(file);
+
+        return result;
+    }
+
+
+    float elapsed_ms(Clock::time_point since) noexcept
+    {
+        return std::chrono::duration<float, std::milli>(Clock::now() - since).count();
+    }
+}
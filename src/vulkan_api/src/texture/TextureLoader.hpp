@@ -0,0 +1,32 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include <span>
+
+#include <vulkan/vulkan.h>
+
+
+// Loads a set of PNG/JPG textures at once. The files are read and decoded in parallel on the job system,
+// every worker writes its pixels straight into its own slice of one shared staging buffer,
+// and all copies, layout transitions and mip chains go to the GPU in a single submission.
+// Either every texture is loaded or none is: on failure the ones already created are destroyed and reset
+struct TextureLoader
+{
+//  Wall-clock milliseconds spent in each stage
+    struct Timings
+    {
+        float io     = 0.f;
+        float decode = 0.f;
+        float upload = 0.f;
+    };
+
+    static bool loadFromFiles(std::span<const char* const> filepaths, 
+                              std::span<struct Texture2D> textures, 
+                              const struct VulkanContext* context, 
+                              VkCommandPool pool, 
+                              class JobSystem& jobs, 
+                              VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, 
+                              Timings* timings = nullptr) noexcept;
+};
+
+#endif // !TEXTURE_LOADER_HPP
@@ -0,0 +1,546 @@
+#include <cstring>
+#include <algorithm>
+#include <array>
+
+#include "context/Context.hpp"
+#include "jobs/JobSystem.hpp"
+#include "sync/DeletionQueue.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "texture/CompressedImage.hpp"
+#include "texture/TextureStreamer.hpp"
+
+
+namespace
+{
+    constexpr VkDeviceSize STAGING_ALIGNMENT = 16; // satisfies the texel block size and 4-byte rules of vkCmdCopyBufferToImage
+    constexpr VkDeviceSize INVALID_OFFSET    = UINT64_MAX;
+    constexpr VkImageUsageFlags TEXTURE_USAGE = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+
+    VkDeviceSize align_up(VkDeviceSize size) noexcept
+    {
+        return (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    }
+
+
+    VkImageMemoryBarrier image_barrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, uint32_t levelCount) noexcept
+    {
+        const VkImageMemoryBarrier barrier =
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = srcAccess,
+            .dstAccessMask       = dstAccess,
+            .oldLayout           = oldLayout,
+            .newLayout           = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = 0,
+                .levelCount     = levelCount,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        return barrier;
+    }
+}
+
+
+
+bool TextureStreamer::init(const VulkanContext* context, JobSystem* jobs, DeletionQueue* deletionQueue, const Settings& settings) noexcept
+{
+    m_context       = context;
+    m_jobs          = jobs;
+    m_deletionQueue = deletionQueue;
+    m_settings      = settings;
+
+    return m_staging.create(settings.stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context);
+}
+
+
+void TextureStreamer::destroy(VkDevice device) noexcept
+{
+    for (auto& streamed : m_textures)
+        streamed.texture.destroy(device);
+
+    m_textures.clear();
+    m_stagingBlocks.clear();
+    m_staging.destroy(device);
+
+    m_residentBytes = 0;
+    m_stagingHead   = 0;
+}
+
+
+uint32_t TextureStreamer::add(const CompressedImage* source, UploadBatch& batch) noexcept
+{
+//  Levels are read again whenever they stream in, so they have to be addressable (not compressed in a pack)
+    if ( ! source || ! source->hasLevelData() || source->levels.empty() || source->levels.size() > MAX_LEVELS )
+        return INVALID_TEXTURE;
+
+    const uint32_t count = static_cast<uint32_t>(source->levels.size());
+    uint32_t tailMip = count - 1;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (std::max(source->levels[i].width, source->levels[i].height) <= m_settings.tailSize)
+        {
+            tailMip = i;
+            break;
+        }
+    }
+
+    StreamedTexture streamed;
+    streamed.source      = source;
+    streamed.residentMip = tailMip;
+    streamed.tailMip     = tailMip;
+    streamed.wantedMip   = tailMip;
+    streamed.texture.mipLevels = count - tailMip;
+
+    const VkExtent2D extent = { source->levels[tailMip].width, source->levels[tailMip].height };
+
+    if ( ! streamed.texture.create(extent, source->format, TEXTURE_USAGE, m_context) )
+    {
+        streamed.texture.destroy(m_context->device);
+
+        return INVALID_TEXTURE;
+    }
+
+//  The tail is small enough to go out with the regular startup uploads
+    std::array<UploadBatch::ImageLevel, MAX_LEVELS> levels;
+
+    for (uint32_t i = tailMip; i < count; ++i)
+    {
+        const auto& level = source->levels[i];
+        levels[i - tailMip] = { source->getLevelData(i), level.size, { level.width, level.height } };
+    }
+
+    batch.addImage(streamed.texture.image, std::span(levels.data(), count - tailMip));
+
+    m_residentBytes += getLevelBytes(streamed, tailMip, count);
+    m_textures.push_back(std::move(streamed));
+
+    return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+
+void TextureStreamer::requestSize(uint32_t texture, float screenPixels) noexcept
+{
+    if (texture < m_textures.size())
+        m_textures[texture].requestedPixels = std::max(m_textures[texture].requestedPixels, screenPixels);
+}
+
+
+void TextureStreamer::update(VkCommandBuffer cmd, uint64_t frameNumber, uint64_t completedFrames) noexcept
+{
+    releaseStaging(completedFrames);
+
+//  Levels the workers have finished copying into staging go to the GPU with this frame
+    for (auto& streamed : m_textures)
+    {
+        if ( ! streamed.pending || ! streamed.pending->ready.load(std::memory_order_acquire) )
+            continue;
+
+        resize(cmd, streamed, streamed.pending->firstMip, streamed.pending.get(), frameNumber);
+
+        for (auto& block : m_stagingBlocks)
+            if (block.start == streamed.pending->stagingStart && block.frameNumber == UINT64_MAX)
+                block.frameNumber = frameNumber + 1;
+
+        streamed.pending.reset();
+    }
+
+//  The finest level still covered by at least one texel per pixel
+    for (auto& streamed : m_textures)
+    {
+        const auto& levels = streamed.source->levels;
+
+        streamed.wantedMip = streamed.tailMip;
+
+        if (streamed.requestedPixels > 0.f)
+        {
+            uint32_t mip = 0;
+
+            while (mip < streamed.tailMip && static_cast<float>(std::max(levels[mip + 1].width, levels[mip + 1].height)) >= streamed.requestedPixels)
+                ++mip;
+
+            streamed.wantedMip = mip;
+        }
+
+        streamed.requestedPixels = 0.f;
+
+        if (streamed.wantedMip <= streamed.residentMip)
+            streamed.lastNeededFrame = frameNumber;
+    }
+
+//  Levels nobody asked for in a while are dropped even without memory pressure
+    for (auto& streamed : m_textures)
+    {
+        if ( ! streamed.pending && streamed.wantedMip > streamed.residentMip && frameNumber - streamed.lastNeededFrame > m_settings.evictAfterFrames )
+            resize(cmd, streamed, streamed.wantedMip, nullptr, frameNumber);
+    }
+
+    VkDeviceSize requested = 0;
+
+    for (auto& streamed : m_textures)
+    {
+        if (streamed.pending || streamed.wantedMip >= streamed.residentMip)
+            continue;
+
+//  Coarse levels first when the whole range does not fit this frame, the rest follows on the next ones
+        uint32_t firstMip = streamed.wantedMip;
+
+        while (firstMip + 1 < streamed.residentMip && requested + getLevelBytes(streamed, firstMip, streamed.residentMip) > m_settings.uploadBytesPerFrame)
+            ++firstMip;
+
+        if (requested > 0 && requested + getLevelBytes(streamed, firstMip, streamed.residentMip) > m_settings.uploadBytesPerFrame)
+            continue;
+
+        if (m_residentBytes + getLevelBytes(streamed, firstMip, streamed.residentMip) > m_settings.memoryBudget)
+            evict(cmd, m_residentBytes + getLevelBytes(streamed, firstMip, streamed.residentMip) - m_settings.memoryBudget, &streamed, frameNumber);
+
+        while (firstMip < streamed.residentMip && m_residentBytes + getLevelBytes(streamed, firstMip, streamed.residentMip) > m_settings.memoryBudget)
+            ++firstMip;
+
+        if (firstMip == streamed.residentMip)
+            continue;
+
+        const VkDeviceSize bytes = getLevelBytes(streamed, firstMip, streamed.residentMip);
+
+        if (requestLevels(streamed, firstMip))
+            requested += bytes;
+    }
+}
+
+
+const Texture2D& TextureStreamer::getTexture(uint32_t texture) const noexcept
+{
+    return m_textures[texture].texture;
+}
+
+
+uint32_t TextureStreamer::getVersion(uint32_t texture) const noexcept
+{
+    return m_textures[texture].version;
+}
+
+
+VkDeviceSize TextureStreamer::getResidentBytes() const noexcept
+{
+    return m_residentBytes;
+}
+
+
+bool TextureStreamer::isSettled() const noexcept
+{
+    for (const auto& streamed : m_textures)
+        if (streamed.pending || streamed.wantedMip < streamed.residentMip)
+            return false;
+
+    return true;
+}
+
+
+bool TextureStreamer::resize(VkCommandBuffer cmd, StreamedTexture& streamed, uint32_t firstMip, const Pending* pending, uint64_t frameNumber) noexcept
+{
+    const auto& levels   = streamed.source->levels;
+    const uint32_t count = static_cast<uint32_t>(levels.size());
+
+//  Stream-ins reserved their bytes when they were requested, evictions give theirs back here
+    const VkDeviceSize reserved = pending ? getLevelBytes(streamed, firstMip, streamed.residentMip) : 0;
+
+    Texture2D next;
+    next.mipLevels = count - firstMip;
+
+    if ( ! next.create({ levels[firstMip].width, levels[firstMip].height }, streamed.source->format, TEXTURE_USAGE, m_context) )
+    {
+        next.destroy(m_context->device);
+        m_residentBytes -= reserved;
+
+        return false;
+    }
+
+    const std::array<VkImageMemoryBarrier, 2> toTransfer =
+    {
+        image_barrier(streamed.texture.image,
+                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      VK_ACCESS_SHADER_READ_BIT,
+                      VK_ACCESS_TRANSFER_READ_BIT,
+                      streamed.texture.mipLevels),
+        image_barrier(next.image,
+                      VK_IMAGE_LAYOUT_UNDEFINED,
+                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      VK_ACCESS_NONE,
+                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                      next.mipLevels)
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+
+//  Levels present in both images are copied on the GPU
+    std::array<VkImageCopy, MAX_LEVELS> copies;
+    uint32_t copyCount = 0;
+
+    for (uint32_t i = std::max(firstMip, streamed.residentMip); i < count; ++i)
+    {
+        copies[copyCount++] =
+        {
+            .srcSubresource =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = i - streamed.residentMip,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .srcOffset      = { 0, 0, 0 },
+            .dstSubresource =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = i - firstMip,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .dstOffset      = { 0, 0, 0 },
+            .extent         = { levels[i].width, levels[i].height, 1 }
+        };
+    }
+
+    vkCmdCopyImage(cmd,
+                   streamed.texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   next.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   copyCount, copies.data());
+
+//  New levels come from the staging ring
+    if (pending)
+    {
+        std::array<VkBufferImageCopy, MAX_LEVELS> regions;
+        uint32_t regionCount = 0;
+
+        for (uint32_t i = firstMip; i < streamed.residentMip; ++i)
+        {
+            regions[regionCount++] =
+            {
+                .bufferOffset      = pending->offsets[i - firstMip],
+                .bufferRowLength   = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource  =
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = i - firstMip,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1
+                },
+                .imageOffset = { 0, 0, 0 },
+                .imageExtent = { levels[i].width, levels[i].height, 1 }
+            };
+        }
+
+        vkCmdCopyBufferToImage(cmd, m_staging.handle, next.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions.data());
+    }
+
+    const VkImageMemoryBarrier toShader = image_barrier(next.image,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                        VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                        VK_ACCESS_SHADER_READ_BIT,
+                                                        next.mipLevels);
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         1, &toShader);
+
+    if ( ! pending )
+        m_residentBytes -= getLevelBytes(streamed, streamed.residentMip, firstMip);
+
+//  Frames still in flight may sample the old image, and this one copies from it
+    m_deletionQueue->destroyTexture(streamed.texture);
+
+    streamed.texture     = next;
+    streamed.residentMip = firstMip;
+    ++streamed.version;
+
+    return true;
+}
+
+
+bool TextureStreamer::requestLevels(StreamedTexture& streamed, uint32_t firstMip) noexcept
+{
+    const auto& levels = streamed.source->levels;
+
+    VkDeviceSize stagingSize = 0;
+
+    for (uint32_t i = firstMip; i < streamed.residentMip; ++i)
+        stagingSize += align_up(levels[i].size);
+
+    VkDeviceSize blockStart = 0;
+    VkDeviceSize offset = allocateStaging(stagingSize, &blockStart);
+
+    if (offset == INVALID_OFFSET)
+        return false;
+
+    Pending* pending = nullptr;
+
+    try
+    {
+        streamed.pending = std::make_unique<Pending>();
+        pending = streamed.pending.get();
+    }
+    catch (const std::bad_alloc&)
+    {
+        m_stagingBlocks.back().frameNumber = 0; // nothing will be recorded, the block is free right away
+
+        return false;
+    }
+
+    pending->firstMip     = firstMip;
+    pending->stagingStart = blockStart;
+
+    for (uint32_t i = firstMip; i < streamed.residentMip; ++i)
+    {
+        pending->offsets[i - firstMip] = offset;
+        offset += align_up(levels[i].size);
+    }
+
+    m_residentBytes += getLevelBytes(streamed, firstMip, streamed.residentMip);
+
+//  Reading the levels touches the mapped pack or file, so the copy runs on a worker, never on the render thread
+    const CompressedImage* source = streamed.source;
+    const uint32_t endMip = streamed.residentMip;
+    uint8_t* staging = static_cast<uint8_t*>(m_staging.data);
+
+    auto copy_levels = [pending, source, staging, endMip]()
+    {
+        for (uint32_t i = pending->firstMip; i < endMip; ++i)
+            memcpy(staging + pending->offsets[i - pending->firstMip], source->getLevelData(i), static_cast<size_t>(source->levels[i].size));
+
+        pending->ready.store(true, std::memory_order_release);
+    };
+
+    if (m_jobs)
+        m_jobs->run(m_jobs->createJob(copy_levels));
+    else
+        copy_levels();
+
+    return true;
+}
+
+
+void TextureStreamer::evict(VkCommandBuffer cmd, VkDeviceSize required, const StreamedTexture* keep, uint64_t frameNumber) noexcept
+{
+//  Only levels beyond what the feedback asks for are given up, least recently needed first
+    while (required > 0)
+    {
+        StreamedTexture* victim = nullptr;
+
+        for (auto& streamed : m_textures)
+        {
+            if (&streamed == keep || streamed.pending || streamed.wantedMip <= streamed.residentMip)
+                continue;
+
+            if ( ! victim || streamed.lastNeededFrame < victim->lastNeededFrame )
+                victim = &streamed;
+        }
+
+        if ( ! victim )
+            return;
+
+        const VkDeviceSize freed = getLevelBytes(*victim, victim->residentMip, victim->wantedMip);
+
+        if ( ! resize(cmd, *victim, victim->wantedMip, nullptr, frameNumber) )
+            return;
+
+        required = (freed < required) ? required - freed : 0;
+    }
+}
+
+
+VkDeviceSize TextureStreamer::getLevelBytes(const StreamedTexture& streamed, uint32_t firstMip, uint32_t endMip) const noexcept
+{
+    VkDeviceSize bytes = 0;
+
+    for (uint32_t i = firstMip; i < endMip; ++i)
+        bytes += streamed.source->levels[i].size;
+
+    return bytes;
+}
+
+
+VkDeviceSize TextureStreamer::allocateStaging(VkDeviceSize size, VkDeviceSize* blockStart) noexcept
+{
+    const VkDeviceSize capacity = m_staging.size;
+
+    if (size == 0 || size > capacity)
+        return INVALID_OFFSET;
+
+    VkDeviceSize offset = INVALID_OFFSET;
+    VkDeviceSize start  = m_stagingHead;
+
+    if (m_stagingBlocks.empty())
+    {
+        start  = 0;
+        offset = 0;
+    }
+    else
+    {
+        const VkDeviceSize tail = m_stagingBlocks.front().start;
+
+        if (m_stagingHead > tail)
+        {
+//  Free space at the end and in front of the oldest block, an allocation that does not fit at the end wraps around
+            if (m_stagingHead + size <= capacity)
+                offset = m_stagingHead;
+            else if (size <= tail)
+                offset = 0;
+        }
+        else if (m_stagingHead + size <= tail)
+        {
+            offset = m_stagingHead;
+        }
+    }
+
+    if (offset == INVALID_OFFSET)
+        return INVALID_OFFSET;
+
+    const VkDeviceSize span = (offset < start) ? (capacity - start) + size : size;
+
+    try
+    {
+        m_stagingBlocks.push_back({ start, span, UINT64_MAX });
+    }
+    catch (const std::bad_alloc&)
+    {
+        return INVALID_OFFSET;
+    }
+
+    m_stagingHead = offset + size;
+    *blockStart   = start;
+
+    return offset;
+}
+
+
+void TextureStreamer::releaseStaging(uint64_t completedFrames) noexcept
+{
+//  Blocks are freed in allocation order, one still waiting for its worker holds back the ones behind it
+    while ( ! m_stagingBlocks.empty() && m_stagingBlocks.front().frameNumber <= completedFrames )
+        m_stagingBlocks.pop_front();
+
+    if (m_stagingBlocks.empty())
+        m_stagingHead = 0;
+}
@@ -0,0 +1,116 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+
+#include "buffers/MappedBuffer.hpp"
+#include "texture/Texture2D.hpp"
+
+
+// Progressive mip residency for cooked textures. Only the small mip tail is uploaded up front,
+// finer levels are streamed in when the screen-space feedback asks for them and dropped again
+// when they are no longer needed or the memory budget runs out.
+// A texture with levels [first, count) resident lives in an image of exactly that size, so the view
+// never exposes missing levels and the shaders need neither a minLod clamp nor a LOD bias.
+// Resizing the image is a GPU-side copy of the kept levels plus a staging copy of the new ones,
+// recorded into the frame command buffer; the old image goes to the deletion queue
+class TextureStreamer
+{
+public:
+    struct Settings
+    {
+        VkDeviceSize memoryBudget        = 256ull << 20; // bytes of streamed levels allowed in VRAM
+        VkDeviceSize stagingSize         = 32ull << 20;  // persistent staging ring shared by all uploads
+        VkDeviceSize uploadBytesPerFrame = 8ull << 20;   // caps how much new data a single frame may request
+        uint32_t     tailSize            = 128;          // the largest level kept resident at all times, in texels
+        uint32_t     evictAfterFrames    = 120;          // unneeded levels are dropped after this many frames
+    };
+
+    static constexpr uint32_t INVALID_TEXTURE = UINT32_MAX;
+    static constexpr uint32_t MAX_LEVELS      = 16;
+
+//  Replaced images go to 'deletionQueue', which must outlive the streamer
+    bool init(const struct VulkanContext* context, class JobSystem* jobs, class DeletionQueue* deletionQueue, const Settings& settings) noexcept;
+
+//  Must be called once the job system has been shut down and the device is idle
+    void destroy(VkDevice device) noexcept;
+
+//  The source levels are read on demand, so 'source' has to stay valid while the streamer is alive
+//  (a mapped asset pack or a loaded file) and its levels stored uncompressed. Only the mip tail goes through 'batch'
+    uint32_t add(const struct CompressedImage* source, class UploadBatch& batch) noexcept;
+
+//  Feedback: the largest size in pixels the texture covers on screen this frame
+    void requestSize(uint32_t texture, float screenPixels) noexcept;
+
+//  Render thread, after the deletion queue has been flushed for this frame and before rendering begins.
+//  'frameNumber' is the frame being recorded into 'cmd'
+    void update(VkCommandBuffer cmd, uint64_t frameNumber, uint64_t completedFrames) noexcept;
+
+    const Texture2D& getTexture(uint32_t texture) const noexcept;
+
+//  Changes every time the image of the texture is replaced, descriptors holding an older version must be rewritten
+    uint32_t getVersion(uint32_t texture) const noexcept;
+
+    VkDeviceSize getResidentBytes() const noexcept;
+
+//  No loads in flight and every texture holds the levels the last update() wanted
+    bool isSettled() const noexcept;
+
+private:
+//  Levels being copied into the staging ring by a worker
+    struct Pending
+    {
+        uint32_t          firstMip     = 0;
+        VkDeviceSize      stagingStart = 0;
+        VkDeviceSize      offsets[MAX_LEVELS] = {};
+        std::atomic<bool> ready = false;
+    };
+
+    struct StreamedTexture
+    {
+        const struct CompressedImage* source = nullptr;
+        Texture2D texture;
+
+        uint32_t residentMip     = 0; // first source level held by 'texture'
+        uint32_t tailMip         = 0; // never evicted
+        uint32_t wantedMip       = 0; // from this frame's feedback
+        uint32_t version         = 0;
+        float    requestedPixels = 0.f;
+        uint64_t lastNeededFrame = 0; // last frame every resident level was wanted
+
+        std::unique_ptr<Pending> pending;
+    };
+
+    struct StagingBlock
+    {
+        VkDeviceSize start;
+        VkDeviceSize span;
+        uint64_t     frameNumber; // UINT64_MAX while the upload has not been recorded yet
+    };
+
+    bool resize(VkCommandBuffer cmd, StreamedTexture& streamed, uint32_t firstMip, const Pending* pending, uint64_t frameNumber) noexcept;
+    bool requestLevels(StreamedTexture& streamed, uint32_t firstMip) noexcept;
+    void evict(VkCommandBuffer cmd, VkDeviceSize required, const StreamedTexture* keep, uint64_t frameNumber) noexcept;
+
+//  Size of the source levels [firstMip, endMip)
+    VkDeviceSize getLevelBytes(const StreamedTexture& streamed, uint32_t firstMip, uint32_t endMip) const noexcept;
+    VkDeviceSize allocateStaging(VkDeviceSize size, VkDeviceSize* blockStart) noexcept;
+    void releaseStaging(uint64_t completedFrames) noexcept;
+
+    const struct VulkanContext* m_context = nullptr;
+    class JobSystem*            m_jobs    = nullptr;
+    class DeletionQueue*        m_deletionQueue = nullptr;
+    Settings                    m_settings;
+
+    std::vector<StreamedTexture> m_textures;
+    VkDeviceSize                 m_residentBytes = 0;
+
+    MappedBuffer             m_staging;
+    std::deque<StagingBlock> m_stagingBlocks;
+    VkDeviceSize             m_stagingHead = 0;
+};
+
+#endif // !TEXTURE_STREAMER_HPP
@@ -0,0 +1,865 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <array>
+
+#include "utils/Tools.hpp"
+#include "context/Context.hpp"
+#include "jobs/JobSystem.hpp"
+#include "sync/DeletionQueue.hpp"
+#include "buffers/UploadBatch.hpp"
+#include "texture/VirtualTexture.hpp"
+
+
+namespace
+{
+    constexpr VkFormat PAGE_TABLE_FORMAT = VK_FORMAT_R8G8B8A8_UINT;
+    constexpr uint32_t MAX_PAGES_PER_SIDE = 4096; // feedback ids hold 12 bits per page coordinate
+    constexpr uint32_t MAX_ATLAS_PAGES    = 255;  // page table texels hold 8 bits per slot coordinate
+
+
+//  Feedback id: level in the top 8 bits, then 12 bits of page y and 12 bits of page x
+    uint32_t feedback_level(uint32_t id) noexcept { return id >> 24; }
+    uint32_t feedback_y(uint32_t id)     noexcept { return (id >> 12) & 0xFFF; }
+    uint32_t feedback_x(uint32_t id)     noexcept { return id & 0xFFF; }
+
+
+//  Page table texel: R = slot x, G = slot y, B = level of the page held by the slot
+    uint32_t pack_entry(uint32_t slotX, uint32_t slotY, uint32_t level) noexcept
+    {
+        return slotX | (slotY << 8) | (level << 16);
+    }
+
+
+    bool seek(FILE* file, uint64_t offset) noexcept
+    {
+#ifdef _WIN32
+        return (_fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0);
+#else
+        return (fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0);
+#endif
+    }
+
+
+    VkImageMemoryBarrier image_barrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                       uint32_t levelCount, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT) noexcept
+    {
+        const VkImageMemoryBarrier barrier =
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = VK_NULL_HANDLE,
+            .srcAccessMask       = srcAccess,
+            .dstAccessMask       = dstAccess,
+            .oldLayout           = oldLayout,
+            .newLayout           = newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    =
+            {
+                .aspectMask     = aspect,
+                .baseMipLevel   = 0,
+                .levelCount     = levelCount,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        return barrier;
+    }
+
+
+//  Swaps the default sampler of a texture for a clamped one without mipmaps and anisotropy
+    bool replace_sampler(Texture2D& texture, VkFilter filter, const VulkanContext* context) noexcept
+    {
+        VkSamplerCreateInfo info = SamplerCache::getDefaultInfo(context->GPU);
+        info.magFilter        = filter;
+        info.minFilter        = filter;
+        info.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        info.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        info.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        info.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        info.anisotropyEnable = VK_FALSE;
+        info.maxAnisotropy    = 1.f;
+
+        texture.samplerCache->release(texture.sampler, context->device);
+        texture.sampler = texture.samplerCache->acquire(info, context->device);
+
+        return (texture.sampler != VK_NULL_HANDLE);
+    }
+}
+
+
+
+bool VirtualTexture::load(const char* filepath, const VulkanContext* context, JobSystem* jobs, DeletionQueue* deletionQueue,
+                          UploadBatch& batch, const Settings& settings) noexcept
+{
+    m_context       = context;
+    m_jobs          = jobs;
+    m_deletionQueue = deletionQueue;
+    m_settings      = settings;
+
+    m_file = fopen(filepath, "rb");
+
+    if ( ! m_file )
+        return false;
+
+    if (fread(&m_header, sizeof(m_header), 1, m_file) != 1 ||
+        m_header.magic != VirtualTextureFile::MAGIC ||
+        m_header.version != VirtualTextureFile::VERSION ||
+        m_header.tileSize == 0 ||
+        m_header.levelCount == 0 ||
+        m_header.levelCount > VirtualTextureFile::MAX_LEVELS)
+    {
+#ifdef DEBUG
+        fprintf(stderr, "VirtualTexture: %s is not a virtual texture\n", filepath);
+#endif
+        return false;
+    }
+
+    uint32_t pageCount = 0;
+
+    for (uint32_t i = 0; i < m_header.levelCount; ++i)
+    {
+        m_pagesX[i]       = VirtualTextureFile::getPagesX(m_header, i);
+        m_pagesY[i]       = VirtualTextureFile::getPagesY(m_header, i);
+        m_levelOffsets[i] = pageCount;
+        pageCount += m_pagesX[i] * m_pagesY[i];
+    }
+
+    const uint32_t lastLevel = m_header.levelCount - 1;
+
+    if (m_pagesX[0] > MAX_PAGES_PER_SIDE || m_pagesY[0] > MAX_PAGES_PER_SIDE || m_pagesX[lastLevel] != 1 || m_pagesY[lastLevel] != 1)
+        return false;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->GPU, &properties);
+
+    const uint32_t paddedSize = m_header.tileSize + 2 * m_header.border;
+
+    m_tileBytes  = VirtualTextureFile::getTileBytes(m_header);
+    m_atlasPages = std::clamp(settings.atlasPages, 2u, std::min(MAX_ATLAS_PAGES, properties.limits.maxImageDimension2D / paddedSize));
+    m_loadCount  = std::max(settings.uploadsPerFrame, 1u) * (MAX_FRAMES_IN_FLIGHT + 2); // loads still on disk plus copies in flight
+
+    const uint32_t slotCount = m_atlasPages * m_atlasPages;
+
+    try
+    {
+        m_pages.resize(pageCount);
+        m_entries.resize(pageCount);
+        m_slots.assign(slotCount, INVALID_SLOT);
+        m_freeSlots.reserve(slotCount);
+        m_requests.reserve(pageCount);
+        m_copies.reserve(m_loadCount);
+        m_lastLevel.resize(static_cast<size_t>(m_tileBytes));
+        m_loads = std::make_unique<TileLoad[]>(m_loadCount);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_header.levelCount; ++i)
+        for (uint32_t page = m_levelOffsets[i]; page < m_levelOffsets[i] + m_pagesX[i] * m_pagesY[i]; ++page)
+            m_pages[page].level = static_cast<uint8_t>(i);
+
+//  Slot 0 holds the single page of the last level for the whole lifetime, the rest are handed out from slot 1 on
+    for (uint32_t slot = slotCount - 1; slot > 0; --slot)
+        m_freeSlots.push_back(slot);
+
+    const uint32_t pinned = m_levelOffsets[lastLevel];
+
+    if ( ! readTile(pinned, m_lastLevel.data()) )
+        return false;
+
+    m_pages[pinned].slot = 0;
+    m_slots[0]           = pinned;
+    m_residentPages      = 1;
+
+    rebuildPageTable();
+
+    const VkFormat format = static_cast<VkFormat>(m_header.format);
+
+    m_atlas.mipLevels     = 1;
+    m_pageTable.mipLevels = m_header.levelCount;
+
+    if ( ! m_atlas.create({ m_atlasPages * paddedSize, m_atlasPages * paddedSize }, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, context) ||
+         ! m_pageTable.create({ m_pagesX[0], m_pagesY[0] }, PAGE_TABLE_FORMAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, context) )
+        return false;
+
+//  The page border covers the bilinear footprint, filtering across slots or between levels is never needed
+    if ( ! replace_sampler(m_atlas, VK_FILTER_LINEAR, context) || ! replace_sampler(m_pageTable, VK_FILTER_NEAREST, context) )
+        return false;
+
+    if ( ! m_uniforms.create(sizeof(Uniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, context) ||
+         ! m_tileStaging.create(m_loadCount * m_tileBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context) )
+        return false;
+
+    for (auto& staging : m_pageTableStaging)
+        if ( ! staging.create(pageCount * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context) )
+            return false;
+
+//  The feedback target is smaller than the view, so its derivatives select levels that much too coarse
+    const Uniforms uniforms =
+    {
+        .virtualSize  = { static_cast<float>(m_header.width), static_cast<float>(m_header.height) },
+        .atlasSize    = static_cast<float>(m_atlasPages * paddedSize),
+        .feedbackBias = -std::log2(static_cast<float>(std::max(settings.feedbackDivisor, 1u))),
+        .pagesX       = m_pagesX[0],
+        .pagesY       = m_pagesY[0],
+        .levelCount   = m_header.levelCount,
+        .tileSize     = m_header.tileSize,
+        .border       = m_header.border,
+        .padding      = {}
+    };
+
+    memcpy(m_uniforms.data, &uniforms, sizeof(uniforms));
+
+    const UploadBatch::ImageLevel atlasLevel = { m_lastLevel.data(), m_tileBytes, { paddedSize, paddedSize } };
+    batch.addImage(m_atlas.image, { &atlasLevel, 1 });
+
+    std::array<UploadBatch::ImageLevel, VirtualTextureFile::MAX_LEVELS> tableLevels;
+
+    for (uint32_t i = 0; i < m_header.levelCount; ++i)
+        tableLevels[i] = { m_entries.data() + m_levelOffsets[i], m_pagesX[i] * m_pagesY[i] * sizeof(uint32_t), { m_pagesX[i], m_pagesY[i] } };
+
+    batch.addImage(m_pageTable.image, { tableLevels.data(), m_header.levelCount });
+
+    return true;
+}
+
+
+void VirtualTexture::destroy(VkDevice device) noexcept
+{
+    vkDestroyImageView(device, m_feedback.colorView, VK_NULL_HANDLE);
+    vkDestroyImage(device, m_feedback.color, VK_NULL_HANDLE);
+    vkFreeMemory(device, m_feedback.colorMemory, VK_NULL_HANDLE);
+    vkDestroyImageView(device, m_feedback.depthView, VK_NULL_HANDLE);
+    vkDestroyImage(device, m_feedback.depth, VK_NULL_HANDLE);
+    vkFreeMemory(device, m_feedback.depthMemory, VK_NULL_HANDLE);
+    m_feedback = {};
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        m_readback[i].destroy(device);
+        m_pageTableStaging[i].destroy(device);
+        m_readbackValid[i] = false;
+    }
+
+    m_tileStaging.destroy(device);
+    m_uniforms.destroy(device);
+
+    if (m_atlas.image)
+        m_atlas.destroy(device);
+
+    if (m_pageTable.image)
+        m_pageTable.destroy(device);
+
+    m_atlas     = {};
+    m_pageTable = {};
+
+    if (m_file)
+        fclose(m_file);
+
+    m_file = nullptr;
+    m_loads.reset();
+    m_pages.clear();
+    m_entries.clear();
+    m_slots.clear();
+    m_freeSlots.clear();
+    m_requests.clear();
+    m_lastLevel.clear();
+    m_residentPages = 0;
+}
+
+
+bool VirtualTexture::resizeFeedback(VkExtent2D viewExtent) noexcept
+{
+    retireFeedback();
+
+    const uint32_t divisor = std::max(m_settings.feedbackDivisor, 1u);
+    const VkExtent2D extent = { std::max(viewExtent.width / divisor, 1u), std::max(viewExtent.height / divisor, 1u) };
+
+    const VkDevice         device = m_context->device;
+    const VkPhysicalDevice GPU    = m_context->GPU;
+    const VkFormat depthFormat    = vktools::find_depth_format(GPU);
+
+    m_feedback.extent = extent;
+
+    if ( ! vktools::create_image_2D(extent, FEEDBACK_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_feedback.color, &m_feedback.colorMemory, GPU, device) ||
+         ! vktools::create_image_view_2D(device, m_feedback.color, FEEDBACK_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, &m_feedback.colorView) )
+        return false;
+
+    if ( ! vktools::create_image_2D(extent, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_feedback.depth, &m_feedback.depthMemory, GPU, device) ||
+         ! vktools::create_image_view_2D(device, m_feedback.depth, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, &m_feedback.depthView) )
+        return false;
+
+    const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * sizeof(uint32_t);
+
+    for (auto& readback : m_readback)
+        if ( ! readback.create(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_context) )
+            return false;
+
+    return true;
+}
+
+
+void VirtualTexture::update(VkCommandBuffer cmd, uint32_t frame, uint64_t frameNumber, uint64_t completedFrames) noexcept
+{
+    if ( ! m_file )
+        return;
+
+//  The startup batch has been submitted before the first frame
+    if ( ! m_lastLevel.empty() )
+    {
+        m_lastLevel.clear();
+        m_lastLevel.shrink_to_fit();
+    }
+
+    processFeedback(frame, frameNumber);
+    startLoads(completedFrames);
+    recordCopies(cmd, frame, frameNumber);
+}
+
+
+void VirtualTexture::beginFeedback(VkCommandBuffer cmd) noexcept
+{
+//  The previous frame copied the ids out, and nothing of the old contents is kept
+    const VkImageMemoryBarrier colorBarrier = image_barrier(m_feedback.color,
+                                                            VK_IMAGE_LAYOUT_UNDEFINED,
+                                                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                            VK_ACCESS_NONE,
+                                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                                            1);
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         1, &colorBarrier);
+
+    const VkImageMemoryBarrier depthBarrier = image_barrier(m_feedback.depth,
+                                                            VK_IMAGE_LAYOUT_UNDEFINED,
+                                                            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                            VK_ACCESS_NONE,
+                                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                                            1,
+                                                            VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         1, &depthBarrier);
+
+    VkClearValue clearId;
+    clearId.color.uint32[0] = NO_PAGE;
+    clearId.color.uint32[1] = 0;
+    clearId.color.uint32[2] = 0;
+    clearId.color.uint32[3] = 0;
+
+    const VkRenderingAttachmentInfoKHR colorAttachmentInfo =
+    {
+        .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .pNext              = VK_NULL_HANDLE,
+        .imageView          = m_feedback.colorView,
+        .imageLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .resolveMode        = VK_RESOLVE_MODE_NONE,
+        .resolveImageView   = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue         = clearId
+    };
+
+    const VkRenderingAttachmentInfoKHR depthAttachmentInfo =
+    {
+        .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .pNext              = VK_NULL_HANDLE,
+        .imageView          = m_feedback.depthView,
+        .imageLayout        = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .resolveMode        = VK_RESOLVE_MODE_NONE,
+        .resolveImageView   = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp            = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .clearValue         = { 1.f, 0.f }
+    };
+
+    const VkRenderingInfoKHR renderingInfo =
+    {
+        .sType                = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .pNext                = VK_NULL_HANDLE,
+        .flags                = 0,
+        .renderArea           = { { 0, 0 }, m_feedback.extent },
+        .layerCount           = 1,
+        .viewMask             = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments    = &colorAttachmentInfo,
+        .pDepthAttachment     = &depthAttachmentInfo,
+        .pStencilAttachment   = VK_NULL_HANDLE
+    };
+
+    vkCmdBeginRendering(cmd, &renderingInfo);
+
+    const VkViewport viewport =
+    {
+        .x        = 0.f,
+        .y        = 0.f,
+        .width    = static_cast<float>(m_feedback.extent.width),
+        .height   = static_cast<float>(m_feedback.extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f
+    };
+
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor =
+    {
+        .offset = { 0, 0 },
+        .extent = m_feedback.extent
+    };
+
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+
+void VirtualTexture::endFeedback(VkCommandBuffer cmd, uint32_t frame) noexcept
+{
+    vkCmdEndRendering(cmd);
+
+    const VkImageMemoryBarrier toTransfer = image_barrier(m_feedback.color,
+                                                          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                          VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                                          VK_ACCESS_TRANSFER_READ_BIT,
+                                                          1);
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         1, &toTransfer);
+
+    const VkBufferImageCopy region =
+    {
+        .bufferOffset      = 0,
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource  =
+        {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { m_feedback.extent.width, m_feedback.extent.height, 1 }
+    };
+
+    vkCmdCopyImageToBuffer(cmd, m_feedback.color, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_readback[frame].handle, 1, &region);
+
+//  Read on the host once the fence of this frame slot has signaled
+    const VkBufferMemoryBarrier toHost =
+    {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = VK_NULL_HANDLE,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = m_readback[frame].handle,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE
+    };
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         1, &toHost,
+                         0, VK_NULL_HANDLE);
+
+    m_readbackValid[frame] = true;
+}
+
+
+const Texture2D& VirtualTexture::getAtlas() const noexcept
+{
+    return m_atlas;
+}
+
+
+const Texture2D& VirtualTexture::getPageTable() const noexcept
+{
+    return m_pageTable;
+}
+
+
+VkBuffer VirtualTexture::getUniformBuffer() const noexcept
+{
+    return m_uniforms.handle;
+}
+
+
+VkExtent2D VirtualTexture::getFeedbackExtent() const noexcept
+{
+    return m_feedback.extent;
+}
+
+
+uint32_t VirtualTexture::getResidentPages() const noexcept
+{
+    return m_residentPages;
+}
+
+
+void VirtualTexture::processFeedback(uint32_t frame, uint64_t frameNumber) noexcept
+{
+    if ( ! m_readbackValid[frame] )
+        return;
+
+    const uint32_t* ids = static_cast<const uint32_t*>(m_readback[frame].data);
+    const uint32_t count = m_feedback.extent.width * m_feedback.extent.height;
+    uint32_t previous = NO_PAGE;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+//  Neighbouring pixels mostly want the same page
+        const uint32_t id = ids[i];
+
+        if (id == NO_PAGE || id == previous)
+            continue;
+
+        previous = id;
+
+        uint32_t level = feedback_level(id);
+        uint32_t x     = feedback_x(id);
+        uint32_t y     = feedback_y(id);
+
+        if (level >= m_header.levelCount || x >= m_pagesX[level] || y >= m_pagesY[level])
+            continue;
+
+//  Ancestors are the fallback while the page is missing, so they count as used too.
+//  Once a page has been touched this frame, so has the rest of its chain
+        for ( ; level < m_header.levelCount; ++level, x >>= 1, y >>= 1)
+        {
+            Page& page = m_pages[getPageIndex(level, x, y)];
+
+            if (page.lastUsed == frameNumber)
+                break;
+
+            page.lastUsed = frameNumber;
+
+            if (page.slot == INVALID_SLOT && ! page.loading && ! page.failed)
+                m_requests.push_back(getPageIndex(level, x, y));
+        }
+    }
+}
+
+
+void VirtualTexture::startLoads(uint64_t completedFrames) noexcept
+{
+//  A staging slice is reusable once the frame that copied from it has completed
+    for (uint32_t i = 0; i < m_loadCount; ++i)
+    {
+        TileLoad& load = m_loads[i];
+
+        if (load.state.load(std::memory_order_relaxed) == TileLoad::UPLOADED && load.frameNumber < completedFrames)
+            load.state.store(TileLoad::FREE, std::memory_order_relaxed);
+    }
+
+//  Coarse pages first, they replace the blurriest fallbacks and cover the most screen
+    std::sort(m_requests.begin(), m_requests.end(), [this](uint32_t a, uint32_t b)
+    {
+        return m_pages[a].level > m_pages[b].level;
+    });
+
+    uint8_t* staging = static_cast<uint8_t*>(m_tileStaging.data);
+    uint32_t started = 0;
+    uint32_t cursor  = 0;
+
+    for (uint32_t page : m_requests)
+    {
+        if (started == m_settings.uploadsPerFrame)
+            break;
+
+        while (cursor < m_loadCount && m_loads[cursor].state.load(std::memory_order_relaxed) != TileLoad::FREE)
+            ++cursor;
+
+        if (cursor == m_loadCount)
+            break;
+
+        TileLoad* load = &m_loads[cursor];
+        load->page = page;
+        load->state.store(TileLoad::LOADING, std::memory_order_relaxed);
+        m_pages[page].loading = true;
+
+//  Disk reads never block the render thread
+        VirtualTexture* self = this;
+        uint8_t* dst = staging + cursor * m_tileBytes;
+
+        auto read_tile = [self, load, dst]()
+        {
+            const bool result = self->readTile(load->page, dst);
+            load->state.store(result ? TileLoad::READY : TileLoad::FAILED, std::memory_order_release);
+        };
+
+        if (m_jobs)
+            m_jobs->run(m_jobs->createJob(read_tile));
+        else
+            read_tile();
+
+        ++started;
+    }
+
+    m_requests.clear();
+}
+
+
+void VirtualTexture::recordCopies(VkCommandBuffer cmd, uint32_t frame, uint64_t frameNumber) noexcept
+{
+    const uint32_t paddedSize = m_header.tileSize + 2 * m_header.border;
+
+    m_copies.clear();
+
+    for (uint32_t i = 0; i < m_loadCount && m_copies.size() < m_settings.uploadsPerFrame; ++i)
+    {
+        TileLoad& load = m_loads[i];
+        const uint32_t state = load.state.load(std::memory_order_acquire);
+
+        if (state == TileLoad::FAILED)
+        {
+#ifdef DEBUG
+            fprintf(stderr, "VirtualTexture: cannot read page %u\n", load.page);
+#endif
+            m_pages[load.page].loading = false;
+            m_pages[load.page].failed  = true;
+            load.state.store(TileLoad::FREE, std::memory_order_relaxed);
+
+            continue;
+        }
+
+        if (state != TileLoad::READY)
+            continue;
+
+//  Every slot holds a page needed this frame, the tile waits in staging
+        const uint32_t slot = allocateSlot(frameNumber);
+
+        if (slot == INVALID_SLOT)
+            break;
+
+        Page& page = m_pages[load.page];
+        page.slot    = slot;
+        page.loading = false;
+        m_slots[slot] = load.page;
+        ++m_residentPages;
+        m_pageTableDirty = true;
+
+        m_copies.push_back(
+        {
+            .bufferOffset      = i * m_tileBytes,
+            .bufferRowLength   = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource  =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = 0,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .imageOffset = { static_cast<int32_t>((slot % m_atlasPages) * paddedSize), static_cast<int32_t>((slot / m_atlasPages) * paddedSize), 0 },
+            .imageExtent = { paddedSize, paddedSize, 1 }
+        });
+
+        load.frameNumber = frameNumber;
+        load.state.store(TileLoad::UPLOADED, std::memory_order_relaxed);
+    }
+
+    if (m_copies.empty() && ! m_pageTableDirty)
+        return;
+
+    if (m_pageTableDirty)
+        rebuildPageTable();
+
+//  Earlier frames still sampling an evicted slot come first in submission order, so the barrier covers them
+    std::array<VkImageMemoryBarrier, 2> toTransfer;
+    std::array<VkImageMemoryBarrier, 2> toShader;
+    uint32_t barrierCount = 0;
+
+    if ( ! m_copies.empty() )
+    {
+        toTransfer[barrierCount] = image_barrier(m_atlas.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                 VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 1);
+        toShader[barrierCount++] = image_barrier(m_atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 1);
+    }
+
+    if (m_pageTableDirty)
+    {
+        toTransfer[barrierCount] = image_barrier(m_pageTable.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                 VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, m_header.levelCount);
+        toShader[barrierCount++] = image_barrier(m_pageTable.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, m_header.levelCount);
+    }
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         barrierCount, toTransfer.data());
+
+    if ( ! m_copies.empty() )
+        vkCmdCopyBufferToImage(cmd, m_tileStaging.handle, m_atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(m_copies.size()), m_copies.data());
+
+    if (m_pageTableDirty)
+    {
+//  The staging buffer of this frame slot was last read by the frame whose fence has just been waited on
+        memcpy(m_pageTableStaging[frame].data, m_entries.data(), m_entries.size() * sizeof(uint32_t));
+
+        std::array<VkBufferImageCopy, VirtualTextureFile::MAX_LEVELS> regions;
+
+        for (uint32_t i = 0; i < m_header.levelCount; ++i)
+        {
+            regions[i] =
+            {
+                .bufferOffset      = m_levelOffsets[i] * sizeof(uint32_t),
+                .bufferRowLength   = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource  =
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = i,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1
+                },
+                .imageOffset = { 0, 0, 0 },
+                .imageExtent = { m_pagesX[i], m_pagesY[i], 1 }
+            };
+        }
+
+        vkCmdCopyBufferToImage(cmd, m_pageTableStaging[frame].handle, m_pageTable.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_header.levelCount, regions.data());
+    }
+
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, VK_NULL_HANDLE,
+                         0, VK_NULL_HANDLE,
+                         barrierCount, toShader.data());
+
+    m_pageTableDirty = false;
+}
+
+
+void VirtualTexture::rebuildPageTable() noexcept
+{
+//  Coarse to fine, so the entry of a missing page can be taken from its parent
+    for (uint32_t level = m_header.levelCount; level-- > 0; )
+    {
+        for (uint32_t y = 0; y < m_pagesY[level]; ++y)
+        {
+            for (uint32_t x = 0; x < m_pagesX[level]; ++x)
+            {
+                const uint32_t index = getPageIndex(level, x, y);
+                const uint32_t slot  = m_pages[index].slot;
+
+                m_entries[index] = (slot != INVALID_SLOT) ? pack_entry(slot % m_atlasPages, slot / m_atlasPages, level)
+                                                          : m_entries[getPageIndex(level + 1, x >> 1, y >> 1)];
+            }
+        }
+    }
+}
+
+
+uint32_t VirtualTexture::allocateSlot(uint64_t frameNumber) noexcept
+{
+    if ( ! m_freeSlots.empty() )
+    {
+        const uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+
+        return slot;
+    }
+
+//  Least recently used page, never the pinned last level and never one the current feedback asked for
+    uint32_t victim = INVALID_SLOT;
+    uint64_t oldest = frameNumber;
+
+    for (uint32_t slot = 0; slot < m_slots.size(); ++slot)
+    {
+        const Page& page = m_pages[m_slots[slot]];
+
+        if (page.level == m_header.levelCount - 1 || page.lastUsed >= oldest)
+            continue;
+
+        victim = slot;
+        oldest = page.lastUsed;
+    }
+
+    if (victim == INVALID_SLOT)
+        return INVALID_SLOT;
+
+    m_pages[m_slots[victim]].slot = INVALID_SLOT;
+    m_slots[victim] = INVALID_SLOT;
+    --m_residentPages;
+    m_pageTableDirty = true;
+
+    return victim;
+}
+
+
+bool VirtualTexture::readTile(uint32_t page, void* dst) noexcept
+{
+    const uint64_t offset = m_header.dataOffset + page * m_tileBytes;
+
+    std::lock_guard<std::mutex> lock(m_fileLock);
+
+    return seek(m_file, offset) && fread(dst, 1, static_cast<size_t>(m_tileBytes), m_file) == m_tileBytes;
+}
+
+
+void VirtualTexture::retireFeedback() noexcept
+{
+//  Frames in flight may still render into the old target or copy out of it
+    if (m_feedback.color)
+    {
+        m_deletionQueue->destroyImageView(m_feedback.colorView);
+        m_deletionQueue->destroyImage(m_feedback.color, m_feedback.colorMemory);
+    }
+
+    if (m_feedback.depth)
+    {
+        m_deletionQueue->destroyImageView(m_feedback.depthView);
+        m_deletionQueue->destroyImage(m_feedback.depth, m_feedback.depthMemory);
+    }
+
+    m_feedback = {};
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        if (m_readback[i].handle)
+            m_deletionQueue->destroyBuffer(m_readback[i].handle, m_readback[i].memory);
+
+        m_readback[i]      = {};
+        m_readbackValid[i] = false;
+    }
+}
+
+
+uint32_t VirtualTexture::getPageIndex(uint32_t level, uint32_t x, uint32_t y) const noexcept
+{
+    return m_levelOffsets[level] + y * m_pagesX[level] + x;
+}
@@ -0,0 +1,161 @@
+#ifndef VIRTUAL_TEXTURE_HPP
+#define VIRTUAL_TEXTURE_HPP
+
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "buffers/MappedBuffer.hpp"
+#include "texture/Texture2D.hpp"
+#include "texture/VirtualTextureFile.hpp"
+
+
+// Software virtual texturing: a texture far larger than VRAM is cut into 128x128 pages by the cooker,
+// and only the pages the screen actually needs live in a fixed-size physical atlas.
+// The page table is an RGBA8_UINT image with one texel per page and one mip level per texture level,
+// every texel names the atlas slot and level of the finest resident page covering it, so a missing page
+// falls back to its nearest resident ancestor (the single page of the last level is always resident).
+// A low resolution feedback pass writes the page every pixel wants, the readback of a frame slot is
+// consumed the next time the slot is recorded, missing pages are read from disk by the job system
+// and copied into the atlas, least recently needed pages make room for them.
+// No sparse binding is involved, so it runs on any Vulkan 1.3 implementation
+class VirtualTexture
+{
+public:
+    struct Settings
+    {
+        uint32_t atlasPages      = 16; // the atlas holds atlasPages x atlasPages pages
+        uint32_t uploadsPerFrame = 16; // page loads started and atlas copies recorded per frame
+        uint32_t feedbackDivisor = 8;  // the feedback target is this many times smaller than the view
+    };
+
+//  The feedback pass renders page ids into this format, with depth
+    static constexpr VkFormat FEEDBACK_FORMAT = VK_FORMAT_R32_UINT;
+    static constexpr uint32_t NO_PAGE         = UINT32_MAX; // feedback clear value
+
+//  Layout of the uniform block declared in shaders/virtual_texture.glsl
+    struct Uniforms
+    {
+        float    virtualSize[2];
+        float    atlasSize;
+        float    feedbackBias;
+        uint32_t pagesX;
+        uint32_t pagesY;
+        uint32_t levelCount;
+        uint32_t tileSize;
+        uint32_t border;
+        uint32_t padding[3];
+    };
+
+//  The last level goes through 'batch', which has to be submitted before the first update(), everything else
+//  is streamed. Feedback targets replaced by a resize go to 'deletionQueue', which must outlive the virtual texture
+    bool load(const char* filepath, const struct VulkanContext* context, class JobSystem* jobs, class DeletionQueue* deletionQueue,
+              class UploadBatch& batch, const Settings& settings) noexcept;
+
+//  Must be called once the job system has been shut down and the device is idle
+    void destroy(VkDevice device) noexcept;
+
+//  Sizes the feedback target after the view, call again when the view is resized
+    bool resizeFeedback(VkExtent2D viewExtent) noexcept;
+
+//  Render thread, after the fence of 'frame' has been waited on and before rendering begins.
+//  Reads back the feedback last written by this frame slot, starts loads and records atlas and page table copies
+    void update(VkCommandBuffer cmd, uint32_t frame, uint64_t frameNumber, uint64_t completedFrames) noexcept;
+
+//  Brackets the feedback draws, which use a pipeline with FEEDBACK_FORMAT color and the view depth format.
+//  endFeedback() copies the ids into the readback buffer of 'frame'
+    void beginFeedback(VkCommandBuffer cmd) noexcept;
+    void endFeedback(VkCommandBuffer cmd, uint32_t frame) noexcept;
+
+    const Texture2D& getAtlas() const noexcept;
+    const Texture2D& getPageTable() const noexcept;
+    VkBuffer         getUniformBuffer() const noexcept;
+    VkExtent2D       getFeedbackExtent() const noexcept;
+    uint32_t         getResidentPages() const noexcept;
+
+private:
+    static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+    struct Page
+    {
+        uint32_t slot     = INVALID_SLOT; // atlas slot while resident
+        uint8_t  level    = 0;
+        bool     loading  = false;
+        bool     failed   = false;        // never requested again
+        uint64_t lastUsed = 0;            // last frame the feedback asked for the page or one of its descendants
+    };
+
+//  A page being read into its slice of the tile staging buffer
+    struct TileLoad
+    {
+        enum State : uint32_t { FREE, LOADING, READY, FAILED, UPLOADED };
+
+        uint32_t              page = 0;
+        uint64_t              frameNumber = 0; // frame that copied the tile into the atlas
+        std::atomic<uint32_t> state = FREE;
+    };
+
+    struct FeedbackTarget
+    {
+        VkImage        color       = VK_NULL_HANDLE;
+        VkDeviceMemory colorMemory = VK_NULL_HANDLE;
+        VkImageView    colorView   = VK_NULL_HANDLE;
+        VkImage        depth       = VK_NULL_HANDLE;
+        VkDeviceMemory depthMemory = VK_NULL_HANDLE;
+        VkImageView    depthView   = VK_NULL_HANDLE;
+        VkExtent2D     extent      = { 0, 0 };
+    };
+
+    void processFeedback(uint32_t frame, uint64_t frameNumber) noexcept;
+    void startLoads(uint64_t completedFrames) noexcept;
+    void recordCopies(VkCommandBuffer cmd, uint32_t frame, uint64_t frameNumber) noexcept;
+    void rebuildPageTable() noexcept;
+
+    uint32_t allocateSlot(uint64_t frameNumber) noexcept;
+    bool     readTile(uint32_t page, void* dst) noexcept;
+    void     retireFeedback() noexcept;
+
+    uint32_t getPageIndex(uint32_t level, uint32_t x, uint32_t y) const noexcept;
+
+    const struct VulkanContext* m_context       = nullptr;
+    class JobSystem*            m_jobs          = nullptr;
+    class DeletionQueue*        m_deletionQueue = nullptr;
+    Settings                    m_settings;
+
+    VirtualTextureFile::Header m_header = {};
+    FILE*                      m_file   = nullptr;
+    std::mutex                 m_fileLock; // workers share the file position
+    uint64_t                   m_tileBytes = 0;
+
+    uint32_t m_pagesX[VirtualTextureFile::MAX_LEVELS]       = {};
+    uint32_t m_pagesY[VirtualTextureFile::MAX_LEVELS]       = {};
+    uint32_t m_levelOffsets[VirtualTextureFile::MAX_LEVELS] = {}; // first page of each level
+
+    std::vector<Page>              m_pages;     // every level, level 0 first, row-major
+    std::vector<uint32_t>          m_entries;   // packed page table texels in the same order
+    std::vector<uint32_t>          m_slots;     // page held by each atlas slot
+    std::vector<uint32_t>          m_freeSlots;
+    std::vector<uint32_t>          m_requests;
+    std::vector<VkBufferImageCopy> m_copies;
+    std::vector<uint8_t>           m_lastLevel; // tile of the pinned last level until the startup batch is submitted
+    uint32_t                       m_atlasPages     = 0;
+    uint32_t                       m_residentPages  = 0;
+    bool                           m_pageTableDirty = false;
+
+    Texture2D    m_atlas;
+    Texture2D    m_pageTable;
+    MappedBuffer m_uniforms;
+
+    MappedBuffer                m_tileStaging;
+    std::unique_ptr<TileLoad[]> m_loads;
+    uint32_t                    m_loadCount = 0;
+
+    MappedBuffer   m_pageTableStaging[MAX_FRAMES_IN_FLIGHT];
+    MappedBuffer   m_readback[MAX_FRAMES_IN_FLIGHT];
+    bool           m_readbackValid[MAX_FRAMES_IN_FLIGHT] = {};
+    FeedbackTarget m_feedback;
+};
+
+#endif // !VIRTUAL_TEXTURE_HPP
@@ -0,0 +1,57 @@
+#ifndef VIRTUAL_TEXTURE_FILE_HPP
+#define VIRTUAL_TEXTURE_FILE_HPP
+
+#include <cstdint>
+
+
+// On-disk layout of a virtual texture, written by the cooker and read tile by tile at run time.
+//
+//  Header
+//  Tiles, level 0 first, row-major inside a level
+//
+// Every tile is (tileSize + 2 * border)^2 RGBA8 texels: the page itself surrounded by a border copied
+// from its neighbours (clamped at the image edge), so bilinear filtering never reads across two pages in the atlas.
+// All tiles have the same size, tile i starts at dataOffset + i * tileBytes.
+// Width and height are powers of two and at least tileSize, the last level is a single page
+struct VirtualTextureFile
+{
+    static constexpr uint32_t MAGIC      = 0x54565344; // "DSVT"
+    static constexpr uint32_t VERSION    = 1;
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;      // of level 0, in texels
+        uint32_t height;
+        uint32_t tileSize;   // page size without the border
+        uint32_t border;
+        uint32_t levelCount;
+        uint32_t format;     // VkFormat of the texels, R8G8B8A8 SRGB or UNORM
+        uint64_t dataOffset; // first tile
+    };
+
+    static uint32_t getPagesX(const Header& header, uint32_t level) noexcept
+    {
+        const uint32_t width = (header.width >> level) ? (header.width >> level) : 1;
+
+        return (width + header.tileSize - 1) / header.tileSize;
+    }
+
+    static uint32_t getPagesY(const Header& header, uint32_t level) noexcept
+    {
+        const uint32_t height = (header.height >> level) ? (header.height >> level) : 1;
+
+        return (height + header.tileSize - 1) / header.tileSize;
+    }
+
+    static uint64_t getTileBytes(const Header& header) noexcept
+    {
+        const uint64_t paddedSize = header.tileSize + 2 * header.border;
+
+        return paddedSize * paddedSize * 4;
+    }
+};
+
+#endif // !VIRTUAL_TEXTURE_FILE_HPP
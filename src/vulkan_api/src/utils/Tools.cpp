@@ -1,3 +1,6 @@
+#include <mutex>
+
+#include "context/Context.hpp"
 #include "utils/Tools.hpp"
 
 
@@ -51,9 +54,11 @@ VkCommandBuffer vktools::begin_single_time_commands(VkDevice device, VkCommandPo
 }
 
 
-void vktools::end_single_time_commands(VkCommandBuffer cmd, VkDevice device, VkCommandPool pool, VkQueue queue) noexcept
+bool vktools::end_single_time_commands(VkCommandBuffer cmd, const VulkanContext* context, VkCommandPool pool) noexcept
 {
-    vkEndCommandBuffer(cmd);
+    VkDevice device = context->device;
+
+    bool result = (vkEndCommandBuffer(cmd) == VK_SUCCESS);
 
     const VkSubmitInfo submitInfo = 
     {
@@ -68,9 +73,35 @@ void vktools::end_single_time_commands(VkCommandBuffer cmd, VkDevice device, VkC
         .pSignalSemaphores    = VK_NULL_HANDLE
     };
 
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
+    const VkFenceCreateInfo fenceInfo = 
+    {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = VK_NULL_HANDLE,
+        .flags = 0
+    };
+
+    VkFence fence = VK_NULL_HANDLE;
+
+    result = result && (vkCreateFence(device, &fenceInfo, VK_NULL_HANDLE, &fence) == VK_SUCCESS);
+
+//  The queue may be shared with a render thread, only the submission itself is serialized.
+//  A fence instead of vkQueueWaitIdle does not wait for the frames in flight
+    if (result)
+    {
+        {
+            std::lock_guard<std::mutex> lock(context->queueLock);
+            result = (vkQueueSubmit(context->queue, 1, &submitInfo, fence) == VK_SUCCESS);
+        }
+
+        result = result && (vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS);
+    }
+
+    if (fence)
+        vkDestroyFence(device, fence, VK_NULL_HANDLE);
+
     vkFreeCommandBuffers(device, pool, 1, &cmd);
+
+    return result;
 }
 
 
@@ -123,9 +154,9 @@ VkBuffer vktools::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkM
 }
 
 
-void vktools::copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDevice device, VkCommandPool pool, VkQueue queue) noexcept
+void vktools::copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, const VulkanContext* context, VkCommandPool pool) noexcept
 {
-    VkCommandBuffer cmd = begin_single_time_commands(device, pool);
+    VkCommandBuffer cmd = begin_single_time_commands(context->device, pool);
 
     if(cmd)
     {
@@ -137,14 +168,14 @@ void vktools::copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize s
         };
 
         vkCmdCopyBuffer(cmd, srcBuffer, dstBuffer, 1, &copyRegion);
-        end_single_time_commands(cmd, device, pool, queue);
+        end_single_time_commands(cmd, context, pool);
     }
 }
 
 
-bool vktools::transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, VkDevice device, VkCommandPool pool, VkQueue queue) noexcept
+bool vktools::transition_image_layout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, const VulkanContext* context, VkCommandPool pool) noexcept
 {
-    VkCommandBuffer cmd = begin_single_time_commands(device, pool);
+    VkCommandBuffer cmd = begin_single_time_commands(context->device, pool);
 
     if(cmd)
     {
@@ -198,7 +229,7 @@ bool vktools::transition_image_layout(VkImage image, VkFormat format, VkImageLay
         }
         else
         {
-            end_single_time_commands(cmd, device, pool, queue);
+            end_single_time_commands(cmd, context, pool);
 
             return false; // unsupported transition
         } 
@@ -211,7 +242,7 @@ bool vktools::transition_image_layout(VkImage image, VkFormat format, VkImageLay
             0, VK_NULL_HANDLE,
             1, &barrier);
 
-        end_single_time_commands(cmd, device, pool, queue);
+        end_single_time_commands(cmd, context, pool);
 
         return true;
     }
@@ -220,9 +251,9 @@ bool vktools::transition_image_layout(VkImage image, VkFormat format, VkImageLay
 }
 
 
-bool vktools::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDevice device, VkCommandPool pool, VkQueue queue) noexcept
+bool vktools::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, const VulkanContext* context, VkCommandPool pool) noexcept
 {
-    VkCommandBuffer cmd = begin_single_time_commands(device, pool);
+    VkCommandBuffer cmd = begin_single_time_commands(context->device, pool);
 
     if(cmd)
     {
@@ -253,7 +284,7 @@ bool vktools::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t widt
         };
 
         vkCmdCopyBufferToImage(cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-        end_single_time_commands(cmd, device, pool, queue);
+        end_single_time_commands(cmd, context, pool);
 
         return true;
     }
@@ -271,7 +302,8 @@ bool vktools::create_image_2D(
                     VkImage* image, 
                     VkDeviceMemory* imageMemory, 
                     VkPhysicalDevice gpu, 
-                    VkDevice device) noexcept
+                    VkDevice device,
+                    uint32_t mipLevels) noexcept
 {
     bool result = false;
 
@@ -288,7 +320,7 @@ bool vktools::create_image_2D(
             .height = extent.height,
             .depth  = 1
         },
-        .mipLevels             = 1,
+        .mipLevels             = mipLevels,
         .arrayLayers           = 1,
         .samples               = VK_SAMPLE_COUNT_1_BIT,
         .tiling                = tiling,
@@ -324,7 +356,7 @@ bool vktools::create_image_2D(
 }
 
 
-bool vktools::create_image_view_2D(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView) noexcept
+bool vktools::create_image_view_2D(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView* imageView, uint32_t mipLevels) noexcept
 {
     const VkImageViewCreateInfo viewInfo = 
     {
@@ -345,7 +377,7 @@ bool vktools::create_image_view_2D(VkDevice device, VkImage image, VkFormat form
         {
             .aspectMask     = aspectFlags,
             .baseMipLevel   = 0,
-            .levelCount     = 1,
+            .levelCount     = mipLevels,
             .baseArrayLayer = 0,
             .layerCount     = 1
         }
@@ -355,6 +387,17 @@ bool vktools::create_image_view_2D(VkDevice device, VkImage image, VkFormat form
 }
 
 
+uint32_t vktools::get_mip_levels(VkExtent2D extent) noexcept
+{
+    uint32_t levels = 1;
+
+    for (uint32_t size = (extent.width > extent.height) ? extent.width : extent.height; size > 1; size >>= 1)
+        ++levels;
+
+    return levels;
+}
+
+
 VkFormat vktools::find_supported_format(const VkFormat* formats, uint32_t count, VkImageTiling tiling, VkFormatFeatureFlags features, VkPhysicalDevice gpu) noexcept
 {
     for (uint32_t i = 0; i < count; ++i)
@@ -387,4 +430,12 @@ VkFormat vktools::find_depth_format(VkPhysicalDevice gpu) noexcept
 bool vktools::has_stencil_component(VkFormat format) noexcept
 {
     return ( (format == VK_FORMAT_D32_SFLOAT_S8_UINT) || (format == VK_FORMAT_D24_UNORM_S8_UINT) );
+}
+
+
+bool vktools::supports_linear_blit(VkFormat format, VkPhysicalDevice gpu) noexcept
+{
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (find_supported_format(&format, 1, VK_IMAGE_TILING_OPTIMAL, features, gpu) == format);
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <cstring>
+
+#include "utils/XXHash.hpp"
+
+
+namespace
+{
+    constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+
+    uint64_t rotl(uint64_t value, uint32_t bits) noexcept
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+
+//  Unaligned little-endian reads, memcpy compiles to a plain load
+    uint64_t read64(const uint8_t* p) noexcept
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+
+        return value;
+    }
+
+
+    uint32_t read32(const uint8_t* p) noexcept
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+
+        return value;
+    }
+
+
+    uint64_t round(uint64_t accumulator, uint64_t input) noexcept
+    {
+        accumulator += input * PRIME64_2;
+        accumulator  = rotl(accumulator, 31);
+
+        return accumulator * PRIME64_1;
+    }
+
+
+    uint64_t merge_round(uint64_t accumulator, uint64_t value) noexcept
+    {
+        accumulator ^= round(0, value);
+
+        return accumulator * PRIME64_1 + PRIME64_4;
+    }
+}
+
+
+
+uint64_t XXHash::hash64(const void* data, size_t size, uint64_t seed) noexcept
+{
+    const auto* p   = static_cast<const uint8_t*>(data);
+    const auto* end = p + size;
+
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+//      Four independent lanes over 32-byte stripes
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        const auto* limit = end - 32;
+
+        do
+        {
+            v1 = round(v1, read64(p));      p += 8;
+            v2 = round(v2, read64(p));      p += 8;
+            v3 = round(v3, read64(p));      p += 8;
+            v4 = round(v4, read64(p));      p += 8;
+        }
+        while (p <= limit);
+
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    while (end - p >= 8)
+    {
+        hash ^= round(0, read64(p));
+        hash  = rotl(hash, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+
+    if (end - p >= 4)
+    {
+        hash ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+        hash  = rotl(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        hash ^= static_cast<uint64_t>(*p) * PRIME64_5;
+        hash  = rotl(hash, 11) * PRIME64_1;
+        ++p;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
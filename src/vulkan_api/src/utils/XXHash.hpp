@@ -0,0 +1,15 @@
+#ifndef XXHASH_HPP
+#define XXHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+// XXH64, bit-compatible with the reference implementation (https://github.com/Cyan4973/xxHash).
+// Fast enough to fingerprint geometry and other blobs at memory bandwidth
+struct XXHash
+{
+    static uint64_t hash64(const void* data, size_t size, uint64_t seed = 0) noexcept;
+};
+
+#endif // !XXHASH_HPP